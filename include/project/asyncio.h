@@ -0,0 +1,176 @@
+/**
+ * @file asyncio.h
+ * @brief Background writer service and read-ahead loader for the drivers
+ *
+ * The drivers compute a refinement level and then write it as SWC and UGX;
+ * with blocking writes the CPU idles while the disk works. IoService runs
+ * file operations on dedicated I/O threads behind a bounded queue, so level
+ * k is written while level k+1 is computed, and ReadAhead loads the next
+ * inputs while the current one is processed. Completion and errors come back
+ * through std::future: get() rethrows what the operation threw.
+ *
+ * Example usage:
+ * @code
+ * IoService writer(1, 4);
+ * std::vector<std::future<void>> writes;
+ * graph.splitEdgesN(nodes, 6, [&](int i, const std::map<int, SWCNode>& level) {
+ *     auto copy = std::make_shared<std::map<int, SWCNode>>(level);
+ *     writes.push_back(writer.submit([copy, i] { NeuronGraph().writeToFile(*copy, name(i)); }));
+ * });
+ * for (auto& w : writes) w.get();   // rethrows the first failed write
+ * @endcode
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Dedicated I/O threads working through a bounded FIFO queue
+ *
+ * Operations start in submission order. With one thread they also finish
+ * in that order, which keeps the files of a driver in a predictable state.
+ * The queue bound keeps a fast producer from buffering every level of a
+ * refinement in memory: submit() blocks while @c capacity operations are
+ * waiting.
+ */
+class IoService {
+public:
+    /**
+     * @brief Starts the I/O threads
+     * @param[in] threads Number of I/O threads (at least 1)
+     * @param[in] capacity Operations that may wait in the queue (at least 1)
+     */
+    explicit IoService(std::size_t threads = 1, std::size_t capacity = 4);
+
+    /** @brief Finishes every queued operation and joins the threads */
+    ~IoService();
+
+    IoService(const IoService&) = delete;
+    IoService& operator=(const IoService&) = delete;
+
+    /**
+     * @brief Queues an operation, blocking while the queue is full
+     * @tparam Operation Callable without arguments
+     * @param[in] operation Work to run on an I/O thread
+     * @return Future of the operation's result; get() rethrows its exception
+     */
+    template <typename Operation>
+    std::future<std::invoke_result_t<Operation>> submit(Operation operation) {
+        using Result = std::invoke_result_t<Operation>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(operation));
+        std::future<Result> result = task->get_future();
+        push([task] { (*task)(); });
+        return result;
+    }
+
+    /** @brief Blocks until the queue is empty and no operation is running */
+    void drain();
+
+    /** @brief Operations queued or running */
+    std::size_t pending() const;
+
+    /** @brief Queue bound given to the constructor */
+    std::size_t capacity() const { return maxQueued; }
+
+private:
+    void push(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;   ///< queue gained a task or the service stops
+    std::condition_variable spaceAvailable;  ///< queue lost a task
+    std::condition_variable idle;            ///< nothing queued or running
+    std::size_t maxQueued;
+    std::size_t running = 0;
+    bool stopping = false;
+};
+
+/**
+ * @brief Loads a list of inputs in order, keeping the next ones in flight
+ * @tparam T Loaded value (e.g. NeuronGraph)
+ *
+ * Up to @c depth loads run ahead of the consumer on the loader's own I/O
+ * threads. next() hands out the values in input order. Destroying the
+ * loader waits for the loads already started.
+ *
+ * Example usage:
+ * @code
+ * ReadAhead<NeuronGraph> inputs(files, [](const std::string& f) { return NeuronGraph(f); });
+ * while (!inputs.done()) {
+ *     std::string file = inputs.nextInput();
+ *     NeuronGraph graph = inputs.next();   // the following file is already loading
+ *     process(file, graph);
+ * }
+ * @endcode
+ */
+template <typename T>
+class ReadAhead {
+public:
+    /**
+     * @brief Starts loading the first inputs
+     * @param[in] inputs Inputs in the order they will be consumed
+     * @param[in] load Loads one input; may throw
+     * @param[in] depth Inputs loaded ahead of the consumer (at least 1)
+     * @param[in] threads I/O threads used for loading (at least 1)
+     */
+    ReadAhead(std::vector<std::string> inputs, std::function<T(const std::string&)> load, std::size_t depth = 2,
+              std::size_t threads = 1)
+        : inputs(std::move(inputs)), load(std::move(load)), depth(depth < 1 ? 1 : depth), io(threads, this->depth) {
+        refill();
+    }
+
+    /** @brief True once every input has been handed out */
+    bool done() const { return taken == inputs.size(); }
+
+    /** @brief Input that the next call of next() returns; requires !done() */
+    const std::string& nextInput() const { return inputs[taken]; }
+
+    /**
+     * @brief Waits for the next input and starts loading a further one
+     * @return The loaded value; rethrows the exception of a failed load
+     */
+    T next() {
+        std::future<T> front = std::move(loading.front());
+        loading.pop_front();
+        ++taken;
+        refill();
+        return front.get();
+    }
+
+private:
+    void refill() {
+        while (started < inputs.size() && loading.size() < depth) {
+            const std::string& input = inputs[started++];
+            loading.push_back(io.submit([this, &input] { return load(input); }));
+        }
+    }
+
+    std::vector<std::string> inputs;
+    std::function<T(const std::string&)> load;
+    std::size_t depth;
+    std::deque<std::future<T>> loading;
+    std::size_t started = 0;
+    std::size_t taken = 0;
+    IoService io;   // last: destroyed first, finishing loads that still use the members above
+};
+
+#endif // ASYNCIO_H
@@ -0,0 +1,92 @@
+/**
+ * @file batch.h
+ * @brief Parallel batch processing of many neuron files
+ *
+ * The driver executables (splitrefineset, extracttrunks) process one file
+ * per call of a job function. This header provides the pieces needed to run
+ * such a job over a whole data set: collecting inputs from a directory or a
+ * manifest, running the jobs on a ThreadPool while bounding how much input
+ * is in flight at once, and reporting the per-file outcome.
+ *
+ * A failing job (one that throws) is recorded and the batch continues.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Scheduling limits for runBatch()
+ */
+struct BatchOptions {
+    std::size_t threads = 0;              ///< Worker threads (0 = hardware concurrency)
+    std::size_t maxInFlight = 0;          ///< Jobs queued or running at once (0 = 2 x threads)
+    std::uintmax_t maxInFlightBytes = 0;  ///< Total input file size in flight (0 = unlimited)
+};
+
+/**
+ * @brief Outcome of one batch job
+ */
+struct BatchResult {
+    std::string input;      ///< Input file the job was run on
+    bool ok = false;        ///< True if the job returned normally
+    std::string error;      ///< Exception message if the job failed
+    double seconds = 0.0;   ///< Wall-clock run time of the job
+};
+
+/** @brief Job run once per input file; signals failure by throwing */
+using BatchJob = std::function<void(const std::string& input)>;
+
+/**
+ * @brief Collects the input files of a batch
+ * @param[in] source A directory or a manifest file
+ * @param[in] extension Extension a directory entry must have (empty = any);
+ *            a compressed entry (`neuron.swc.gz`) matches by the extension before `.gz`/`.zst`
+ * @return Input paths; sorted by name for directories, in file order for manifests
+ *
+ * A directory is scanned with listFilesInDirectory(). Any other path is read
+ * as a manifest with one input path per line; blank lines and lines starting
+ * with '#' are ignored, and relative paths are resolved against the
+ * manifest's directory.
+ *
+ * @note Prints an error and returns an empty list if @p source cannot be read
+ */
+std::vector<std::string> collectBatchInputs(const std::string& source,
+                                            const std::string& extension = ".swc");
+
+/**
+ * @brief Runs a job over every input on a work-stealing thread pool
+ * @param[in] inputs Input files
+ * @param[in] job Function applied to each input
+ * @param[in] options Thread count and in-flight limits
+ * @return One result per input, in the order of @p inputs
+ *
+ * Jobs are submitted one at a time; submission blocks while maxInFlight jobs
+ * are outstanding or while admitting the next file would exceed
+ * maxInFlightBytes. A file larger than the byte budget is still admitted
+ * once nothing else is in flight.
+ */
+std::vector<BatchResult> runBatch(const std::vector<std::string>& inputs,
+                                  const BatchJob& job,
+                                  const BatchOptions& options = {});
+
+/**
+ * @brief Prints per-file timings and failures followed by a summary
+ * @param[in] results Results returned by runBatch()
+ * @param[in,out] out Stream to print to
+ * @return Number of failed jobs
+ */
+std::size_t printBatchReport(const std::vector<BatchResult>& results, std::ostream& out = std::cout);
+
+#endif // BATCH_H
@@ -0,0 +1,235 @@
+/**
+ * @file bincache.h
+ * @brief Versioned binary container for morphology and mesh data
+ *
+ * Text formats (SWC, UGX) have to be parsed every time they are loaded. This
+ * header defines a compact binary container that stores the same data as
+ * raw, 64-byte aligned structure-of-arrays sections so it can be
+ * memory-mapped and used in place.
+ *
+ * File layout (native byte order, recorded in the header so files from a
+ * machine of the other endianness are rejected rather than misread):
+ * @code
+ * +-------------------------------+  offset 0
+ * | BinaryCacheHeader (64 bytes)  |
+ * +-------------------------------+  offset 64
+ * | BinarySectionEntry[n]         |  24 bytes each
+ * +-------------------------------+  aligned to 64
+ * | section 0 payload             |
+ * +-------------------------------+  aligned to 64
+ * | ...                           |
+ * +-------------------------------+
+ * @endcode
+ *
+ * NeuronGraph stores its flat Morphology columns (see morphology.h), and
+ * UgxObject stores points, radii, edges, faces and subsets.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef BINCACHE_H
+#define BINCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+/** @brief Current version of the binary container format */
+constexpr std::uint32_t kBinaryCacheVersion = 1;
+
+/** @brief Alignment of every section payload in bytes */
+constexpr std::size_t kBinaryCacheAlignment = 64;
+
+/**
+ * @brief What a binary cache file contains
+ */
+enum class BinaryCacheKind : std::uint32_t {
+    Morphology = 1,   ///< NeuronGraph nodes (flat Morphology columns)
+    Geometry   = 2    ///< UgxObject geometry (points, edges, faces, subsets)
+};
+
+/**
+ * @brief Storage type of the floating point sections of a binary cache file
+ *
+ * Readers look at the element size of a section, so both kinds load through
+ * the same calls and always come back as double.
+ */
+enum class StoragePrecision {
+    Float64,   ///< Exact copies of the in-memory values
+    Float32    ///< Half the size; about 7 significant digits
+};
+
+/**
+ * @brief Identifiers of the sections a binary cache file can contain
+ */
+enum class BinarySection : std::uint32_t {
+    // Morphology sections (one element per node)
+    NodeId = 1,           ///< int32 SWC id
+    NodeParentId,         ///< int32 SWC parent id
+    NodeType,             ///< int32 SWC type
+    NodeX,                ///< float64 or float32 x coordinate
+    NodeY,                ///< float64 or float32 y coordinate
+    NodeZ,                ///< float64 or float32 z coordinate
+    NodeRadius,           ///< float64 or float32 radius
+    NodeParentIndex,      ///< int32 dense parent row (-1 for none)
+    ChildOffsets,         ///< int32 CSR offsets (nodes + 1 entries)
+    Children,             ///< int32 CSR child rows
+
+    // Geometry sections
+    PointIds = 100,       ///< int32 point index keys
+    Points,               ///< float64 or float32 x, y, z triples
+    RadiusKeys,           ///< int32 vertex index of each radius
+    Radii,                ///< float64 or float32 radius values
+    Edges,                ///< int32 vertex pairs
+    Faces,                ///< int32 vertex triples
+    VertexSubsets,        ///< int32 (vertex, subset) pairs
+    EdgeSubsets,          ///< int32 (edge, subset) pairs
+    FaceSubsets,          ///< int32 (face, subset) pairs
+    SubsetIds,            ///< int32 subset ids
+    SubsetNameOffsets,    ///< uint64 offsets into SubsetNameChars (subsets + 1 entries)
+    SubsetNameChars       ///< char concatenated subset names
+};
+
+/**
+ * @brief Fixed-size header at the start of every binary cache file
+ */
+struct BinaryCacheHeader {
+    char magic[8];                ///< "NMBCACHE"
+    std::uint32_t version;        ///< kBinaryCacheVersion
+    std::uint32_t kind;           ///< BinaryCacheKind
+    std::uint32_t byteOrder;      ///< 0x01020304 as written by the producer
+    std::uint32_t sectionCount;   ///< Number of BinarySectionEntry records
+    std::uint64_t fileSize;       ///< Total size of the file in bytes
+    std::uint8_t reserved[32];    ///< Zero
+};
+static_assert(sizeof(BinaryCacheHeader) == 64, "BinaryCacheHeader must be 64 bytes");
+
+/**
+ * @brief Location of one section payload
+ */
+struct BinarySectionEntry {
+    std::uint32_t id;             ///< BinarySection
+    std::uint32_t elementSize;    ///< Size of one element in bytes
+    std::uint64_t offset;         ///< Payload offset from the start of the file
+    std::uint64_t count;          ///< Number of elements
+};
+static_assert(sizeof(BinarySectionEntry) == 24, "BinarySectionEntry must be 24 bytes");
+
+/**
+ * @brief Read-only pointer/length view of a section payload
+ * @tparam T Element type
+ */
+template <typename T>
+struct BinarySpan {
+    const T* data = nullptr;
+    std::size_t size = 0;
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    const T& operator[](std::size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+};
+
+/**
+ * @brief Collects sections in memory and writes a binary cache file
+ *
+ * Section payloads are referenced, not copied, so the data passed to
+ * addSection() must stay alive until write() returns.
+ */
+class BinaryCacheWriter {
+public:
+    /**
+     * @brief Registers a section
+     * @tparam T Element type (trivially copyable)
+     * @param[in] id Section identifier
+     * @param[in] data Pointer to the first element
+     * @param[in] count Number of elements
+     */
+    template <typename T>
+    void addSection(BinarySection id, const T* data, std::size_t count) {
+        sections.push_back({id, sizeof(T), data, count});
+    }
+
+    /** @brief Registers a section backed by a vector */
+    template <typename T>
+    void addSection(BinarySection id, const std::vector<T>& values) {
+        addSection(id, values.data(), values.size());
+    }
+
+    /**
+     * @brief Writes the header, section table and payloads
+     * @param[in] filename Output path
+     * @param[in] kind Content type recorded in the header
+     * @return true if the file was written completely
+     */
+    bool write(const std::string& filename, BinaryCacheKind kind) const;
+
+private:
+    struct Pending {
+        BinarySection id;
+        std::size_t elementSize;
+        const void* data;
+        std::size_t count;
+    };
+    std::vector<Pending> sections;
+};
+
+/**
+ * @brief Memory-maps a binary cache file and exposes its sections in place
+ *
+ * Section views returned by section() point directly into the mapping and
+ * stay valid for the lifetime of the BinaryCacheFile.
+ */
+class BinaryCacheFile {
+public:
+    /**
+     * @brief Maps and validates a binary cache file
+     * @param[in] filename Path of the file
+     * @return true if the file is a valid cache of a supported version
+     *
+     * On failure errorMessage() describes the problem.
+     */
+    bool open(const std::string& filename);
+
+    /** @brief Content type recorded in the header */
+    BinaryCacheKind kind() const { return static_cast<BinaryCacheKind>(header.kind); }
+
+    /** @brief True if the file contains the given section */
+    bool hasSection(BinarySection id) const { return find(id) != nullptr; }
+
+    /**
+     * @brief Returns a typed view of a section
+     * @tparam T Element type the section is expected to hold
+     * @param[in] id Section identifier
+     * @return The view, or an empty view if the section is absent or its
+     *         element size does not match T
+     */
+    template <typename T>
+    BinarySpan<T> section(BinarySection id) const {
+        const BinarySectionEntry* e = find(id);
+        if (!e || e->elementSize != sizeof(T)) return {};
+        return {reinterpret_cast<const T*>(file.data() + e->offset), static_cast<std::size_t>(e->count)};
+    }
+
+    /** @brief Size of the mapped file in bytes */
+    std::size_t size() const { return file.size(); }
+
+    /** @brief Description of the last open() failure */
+    const std::string& errorMessage() const { return error; }
+
+private:
+    const BinarySectionEntry* find(BinarySection id) const;
+
+    MappedFile file;
+    BinaryCacheHeader header{};
+    std::vector<BinarySectionEntry> entries;
+    std::string error;
+};
+
+#endif // BINCACHE_H
@@ -0,0 +1,219 @@
+/**
+ * @file compression.h
+ * @brief Transparent gzip and zstd compression of SWC and UGX files
+ *
+ * SWC and UGX are verbose ASCII and shrink several times under any general
+ * purpose compressor, which matters once refinement levels and meshes are
+ * written to a network file system. A file whose name ends in `.gz` or
+ * `.zst` (e.g. `refinement_6.ugx.zst`, `neuron.swc.gz`) is compressed by
+ * every writer and decompressed by every reader in the library:
+ *
+ * - CompressedFileWriter is the sink behind UgxStreamWriter and the SWC
+ *   writer. It compresses while the document is produced, so the
+ *   uncompressed text never exists as a whole. gzip output is cut into
+ *   blocks that are compressed on worker threads as independent gzip members
+ *   (a concatenation every gzip reader accepts); zstd uses the library's own
+ *   worker threads.
+ * - MappedFile decompresses such files into memory when it opens them, so
+ *   the readers parse the same bytes as for an uncompressed file.
+ * - UGX files with a compressed name are always written and read by the
+ *   streaming backend, whose output is byte-identical to the DOM backend.
+ *
+ * gzip needs zlib (CMake option NEURONMESHER_ZLIB, NEURONMESHER_WITH_ZLIB)
+ * and zstd needs libzstd (NEURONMESHER_ZSTD, NEURONMESHER_WITH_ZSTD); a
+ * codec that was not built in makes opening such a file fail with a message.
+ *
+ * Example usage:
+ * @code
+ * CompressionOptions options;
+ * options.level = 9;
+ * options.threads = 8;
+ * setCompressionOptions(options);
+ * graph.writeToFileUGX("output/neuron.ugx.gz");   // compressed on 8 threads
+ * @endcode
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Compression format of a file
+ */
+enum class Compression {
+    None,   ///< Plain file
+    Gzip,   ///< gzip (RFC 1952), name ends in .gz
+    Zstd    ///< Zstandard, name ends in .zst
+};
+
+/**
+ * @brief Compression format implied by a file name
+ * @param[in] filename File name or path
+ * @return Compression::Gzip for `.gz`, Compression::Zstd for `.zst`, otherwise Compression::None
+ */
+Compression compressionFromFilename(const std::string& filename);
+
+/** @brief True if the format was built in (Compression::None always is) */
+bool compressionAvailable(Compression compression);
+
+/**
+ * @brief Settings of the compressing writers
+ */
+struct CompressionOptions {
+    int level = -1;            ///< Codec level (gzip 1-9, zstd 1-19); negative = codec default
+    std::size_t threads = 1;   ///< Compression threads (0 = all cores)
+
+    /**
+     * @brief Options from NEURONMESHER_COMPRESSION_LEVEL and NEURONMESHER_COMPRESSION_THREADS
+     * @return Defaults for variables that are unset
+     */
+    static CompressionOptions fromEnvironment();
+};
+
+/**
+ * @brief Sets the options used by writers that are not given any
+ * @param[in] options Options for files opened from now on
+ */
+void setCompressionOptions(const CompressionOptions& options);
+
+/**
+ * @brief Returns the current writer options
+ * @return Options last set, initially CompressionOptions::fromEnvironment()
+ */
+CompressionOptions getCompressionOptions();
+
+/**
+ * @brief Suffix that the drivers append to their output files
+ * @return ".gz" or ".zst" if NEURONMESHER_COMPRESS is "gz" or "zst", otherwise ""
+ */
+std::string outputCompressionSuffix();
+
+/**
+ * @brief Decompresses a complete gzip or zstd file image
+ * @param[in] compression Format of @p input
+ * @param[in] input Compressed bytes; concatenated gzip members or zstd frames are all decoded
+ * @param[out] output Decompressed bytes
+ * @param[out] error Description of the failure
+ * @return true on success; false for corrupt or truncated input or an unavailable codec
+ */
+bool decompressBuffer(Compression compression, std::string_view input, std::vector<char>& output,
+                      std::string& error);
+
+/**
+ * @brief Output file that compresses according to its name
+ *
+ * Writes go to the file directly for plain names. For compressed names the
+ * data is compressed in blocks as it arrives; with more than one thread
+ * the blocks are compressed concurrently and written in order, while at
+ * most two blocks per thread are held in memory.
+ */
+class CompressedFileWriter {
+public:
+    CompressedFileWriter();
+
+    /** @brief Finishes and closes the file if still open */
+    ~CompressedFileWriter();
+
+    CompressedFileWriter(const CompressedFileWriter&) = delete;
+    CompressedFileWriter& operator=(const CompressedFileWriter&) = delete;
+
+    /**
+     * @brief Creates the file
+     * @param[in] filename Path; the extension selects the compression
+     * @param[in] options Level and threads
+     * @return false if the file cannot be created or its codec is not built in
+     */
+    bool open(const std::string& filename, const CompressionOptions& options = getCompressionOptions());
+
+    /**
+     * @brief Appends data
+     * @return false once any write has failed
+     */
+    bool write(const char* data, std::size_t size);
+
+    /** @overload */
+    bool write(std::string_view text) { return write(text.data(), text.size()); }
+
+    /**
+     * @brief Writes the remaining compressed data and closes the file
+     * @return true if every write succeeded
+     */
+    bool close();
+
+    /** @brief True between a successful open() and close() */
+    bool isOpen() const;
+
+    /** @brief Format of the open file */
+    Compression compression() const { return format; }
+
+    /** @brief Description of the last failure */
+    const std::string& errorMessage() const { return error; }
+
+private:
+    struct Codec;
+
+    bool writeRaw(const char* data, std::size_t size);
+
+    std::FILE* file = nullptr;
+    Compression format = Compression::None;
+    std::unique_ptr<Codec> codec;
+    bool ok = true;
+    std::string error;
+};
+
+/**
+ * @brief std::ostream writing through a CompressedFileWriter
+ *
+ * Lets `<<`-based writers (such as the SWC writer) produce compressed files
+ * with unchanged formatting.
+ */
+class CompressedOutputStream : public std::ostream {
+public:
+    /** @brief Opens @p filename; check is_open() */
+    explicit CompressedOutputStream(const std::string& filename,
+                                    const CompressionOptions& options = getCompressionOptions());
+
+    /** @brief Closes the file if still open */
+    ~CompressedOutputStream() override;
+
+    /** @brief True if the file was opened */
+    bool is_open() const { return writer.isOpen(); }
+
+    /**
+     * @brief Flushes and closes the file
+     * @return true if every write succeeded
+     */
+    bool close();
+
+private:
+    class Buffer : public std::streambuf {
+    public:
+        explicit Buffer(CompressedFileWriter& writer);
+
+    protected:
+        int_type overflow(int_type c) override;
+        int sync() override;
+
+    private:
+        CompressedFileWriter& writer;
+        std::vector<char> storage;
+    };
+
+    CompressedFileWriter writer;
+    Buffer buffer;
+};
+
+#endif // COMPRESSION_H
@@ -0,0 +1,106 @@
+/**
+ * @file mappedfile.h
+ * @brief Read-only memory-mapped file access
+ *
+ * This header defines MappedFile, a small RAII wrapper that maps a whole file
+ * into memory so parsers can scan it in place instead of copying it line by
+ * line. On POSIX systems the file is mapped with mmap(); elsewhere its
+ * contents are read into an owned buffer, so callers see the same interface.
+ * Files named *.gz or *.zst are decompressed into the owned buffer (see
+ * compression.h), so every parser built on MappedFile reads them as well.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Read-only view of an entire file's contents
+ *
+ * The mapping stays valid for the lifetime of the object. MappedFile is
+ * movable but not copyable.
+ *
+ * Example usage:
+ * @code
+ * MappedFile file("neuron.swc");
+ * if (file.isOpen()) {
+ *     std::string_view text = file.view();
+ * }
+ * @endcode
+ */
+class MappedFile {
+public:
+    /** @brief Creates an empty, unopened file view */
+    MappedFile() = default;
+
+    /**
+     * @brief Opens and maps a file
+     * @param[in] filename Path of the file to map
+     * @see open()
+     */
+    explicit MappedFile(const std::string& filename) { open(filename); }
+
+    /** @brief Unmaps the file */
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Maps a file, releasing any previous mapping
+     * @param[in] filename Path of the file to map
+     * @return true if the file could be opened, false otherwise
+     *
+     * An empty file opens successfully with size() == 0. A compressed file
+     * (see compressionFromFilename()) is viewed decompressed; corrupt data
+     * prints an error and fails.
+     */
+    bool open(const std::string& filename);
+
+    /** @brief Releases the mapping */
+    void close();
+
+    /** @brief True if a file is currently open */
+    bool isOpen() const { return opened; }
+
+    /** @brief Pointer to the first byte of the file (may be null if empty) */
+    const char* data() const { return ptr; }
+
+    /** @brief Size of the file in bytes */
+    std::size_t size() const { return len; }
+
+    /** @brief The file contents as a string view */
+    std::string_view view() const { return std::string_view(ptr, len); }
+
+private:
+    /** @brief Maps or reads the file as it is on disk */
+    bool openRaw(const std::string& filename);
+
+    /** @brief Start of the mapped or buffered contents */
+    const char* ptr = nullptr;
+
+    /** @brief Number of bytes available at @c ptr */
+    std::size_t len = 0;
+
+    /** @brief True if @c ptr refers to an mmap() region */
+    bool mapped = false;
+
+    /** @brief True after a successful open() */
+    bool opened = false;
+
+    /** @brief Owned contents when memory mapping is unavailable or the file was decompressed */
+    std::vector<char> buffer;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,161 @@
+/**
+ * @file morphology.h
+ * @brief Flat structure-of-arrays storage for neuron morphologies
+ *
+ * This header defines the Morphology structure, a contiguous, densely indexed
+ * representation of an SWC neuron. Node properties are stored in parallel
+ * arrays (x, y, z, radius, type, parent) and the child relationships are kept
+ * in compressed sparse row (CSR) form. NeuronGraph uses this storage internally;
+ * the std::map<int,SWCNode> based interfaces are thin adapters on top of it.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+struct SWCNode;
+
+/**
+ * @brief Dense structure-of-arrays representation of an SWC morphology
+ *
+ * Row @c i of every array describes the same node. Rows are always kept in
+ * strictly increasing order of SWC id, so iterating the arrays visits nodes in
+ * exactly the same order as iterating a std::map<int,SWCNode>.
+ *
+ * After buildTopology() has been called:
+ * - @c parent[i] is the dense index of the parent row (-1 for roots or for
+ *   parents that are not part of the morphology)
+ * - the children of row @c i are @c children[childOffsets[i]] ..
+ *   @c children[childOffsets[i+1]-1], in increasing row order
+ */
+struct Morphology {
+    /** @brief SWC node id of each row (strictly increasing) */
+    std::vector<int> id;
+
+    /** @brief SWC parent id of each row as read from the input (-1 for roots) */
+    std::vector<int> pid;
+
+    /** @brief SWC type of each row */
+    std::vector<int> type;
+
+    /** @brief Coordinates of each row */
+    std::vector<double> x, y, z;
+
+    /** @brief Radius of each row */
+    std::vector<double> radius;
+
+    /** @brief Dense row index of the parent (-1 if none); valid after buildTopology() */
+    std::vector<int> parent;
+
+    /** @brief CSR offsets into @c children (size() + 1 entries); valid after buildTopology() */
+    std::vector<int> childOffsets;
+
+    /** @brief CSR child row indices; valid after buildTopology() */
+    std::vector<int> children;
+
+    /** @brief Number of nodes stored */
+    std::size_t size() const { return id.size(); }
+
+    /** @brief True if no nodes are stored */
+    bool empty() const { return id.empty(); }
+
+    /** @brief Removes all nodes and derived topology */
+    void clear();
+
+    /** @brief Reserves capacity for @p n nodes in every array */
+    void reserve(std::size_t n);
+
+    /**
+     * @brief Returns the row index of an SWC id
+     * @param[in] nodeId SWC id to look up
+     * @return Dense row index, or -1 if the id is not present
+     *
+     * Contiguous id ranges are resolved in O(1); otherwise a binary search
+     * over the sorted id column is used.
+     */
+    int indexOf(int nodeId) const;
+
+    /** @brief True if a node with the given SWC id is stored */
+    bool contains(int nodeId) const { return indexOf(nodeId) != -1; }
+
+    /**
+     * @brief Inserts or overwrites a node, keeping rows sorted by id
+     * @param[in] node Node to store
+     * @return Row index of the stored node
+     *
+     * Appending ids in increasing order (the common case when reading files)
+     * is O(1). Out-of-order ids are inserted at their sorted position.
+     * Inserting invalidates the derived topology.
+     */
+    int setNode(const SWCNode& node);
+
+    /** @brief Returns row @p i as an SWCNode */
+    SWCNode node(std::size_t i) const;
+
+    /**
+     * @brief Resolves parent indices and rebuilds the CSR child lists
+     *
+     * Runs in O(n) with a counting pass over the parent column.
+     */
+    void buildTopology();
+
+    /**
+     * @brief Installs a precomputed topology (e.g. loaded from a binary cache)
+     * @param[in] parentRows Dense parent row of every node
+     * @param[in] offsets CSR offsets (size() + 1 entries)
+     * @param[in] childRows CSR child rows
+     * @return true if the arrays are consistent and were adopted; otherwise the
+     *         topology is rebuilt with buildTopology() and false is returned
+     */
+    bool assignTopology(std::vector<int> parentRows, std::vector<int> offsets, std::vector<int> childRows);
+
+    /**
+     * @brief Process-wide unique stamp of the current contents
+     *
+     * Every mutation through clear(), setNode(), buildTopology() or
+     * assignTopology() assigns a new stamp, so a derived index stamped with
+     * an older revision is known to be stale. Copies share the stamp of
+     * their source. Code writing the columns directly must finish with
+     * buildTopology() or assignTopology().
+     */
+    std::uint64_t revision() const { return stamp; }
+
+    /** @brief True if parent/childOffsets/children reflect the current rows */
+    bool hasTopology() const { return topologyValid; }
+
+    /** @brief Number of children of row @p i (requires topology) */
+    int childCount(std::size_t i) const { return childOffsets[i + 1] - childOffsets[i]; }
+
+    /**
+     * @brief Number of tree neighbours (parent plus children) of row @p i
+     * @note Requires topology
+     */
+    int degree(std::size_t i) const { return childCount(i) + (parent[i] != -1 ? 1 : 0); }
+
+    /** @brief Builds a flat morphology from a node map */
+    static Morphology fromNodes(const std::map<int, SWCNode>& nodeSet);
+
+    /** @brief Converts the flat morphology back to a node map */
+    std::map<int, SWCNode> toNodes() const;
+
+private:
+    /** @brief Appends a row without any ordering checks */
+    void appendRow(const SWCNode& node);
+
+    /** @brief Returns a stamp no morphology has used before */
+    static std::uint64_t nextRevision();
+
+    bool topologyValid = false;
+    std::uint64_t stamp = nextRevision();
+};
+
+#endif // MORPHOLOGY_H
@@ -0,0 +1,115 @@
+/**
+ * @file morphometrics.h
+ * @brief Morphometric measures of a neuron computed natively in one pass
+ *
+ * Lengths, surface areas, branch orders, section tortuosity and the Sholl
+ * profile used to be computed in Python from exported node dicts. They are
+ * computed here from the flat Morphology columns:
+ *
+ * - Every node's segment (the edge to its parent) is measured in fixed
+ *   blocks of rows. The parent coordinates of a block are gathered first,
+ *   so the length, area and volume loop runs over contiguous arrays and is
+ *   vectorized by the compiler; per-type sums and the Sholl crossings are
+ *   accumulated per block.
+ * - The tree is split into sections (unbranched paths between branch
+ *   points, roots and tips). Sections are measured in parallel, linked in
+ *   one short pass over the sections, and their node values written in
+ *   parallel again.
+ *
+ * Blocks and sections do not depend on the thread count, and their partial
+ * sums are combined in a fixed order, so the result is the same for any
+ * number of threads.
+ *
+ * Example usage:
+ * @code
+ * MorphometricsOptions options;
+ * options.shollStep = 20.0;
+ * options.threads = 0;
+ * Morphometrics m = graph.morphometrics(options);
+ * std::cout << m.totalLength << " um, dendrites " << m.lengthByType[3] << " um\n";
+ * @endcode
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef MORPHOMETRICS_H
+#define MORPHOMETRICS_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "morphology.h"
+
+/**
+ * @brief Parameters of computeMorphometrics()
+ */
+struct MorphometricsOptions {
+    double shollStep = 10.0;    ///< Radius step between Sholl spheres
+    std::size_t threads = 1;    ///< Threads (0 = all cores, 1 = serial)
+};
+
+/**
+ * @brief Morphometric measures of one neuron
+ *
+ * A segment is the edge from a node to its parent; it has the type of the
+ * node. Its surface area is the lateral area of the truncated cone between
+ * the two radii and its volume that cone's volume. Soma nodes contribute
+ * through their segments like any other node.
+ *
+ * A section is a maximal path without branching: it starts at a root or at
+ * a child of a node with several children and ends at a tip or at the next
+ * such node. Sections are listed in depth-first order from the roots, so a
+ * section always comes after its parent.
+ */
+struct Morphometrics {
+    double totalLength = 0.0;       ///< Sum of all segment lengths
+    double totalArea = 0.0;         ///< Sum of all segment surface areas
+    double totalVolume = 0.0;       ///< Sum of all segment volumes
+    int branchPoints = 0;           ///< Non-soma nodes with two or more children
+    int tips = 0;                   ///< Non-soma nodes without children
+    int stems = 0;                  ///< Non-soma nodes whose parent is a soma node
+    int maxBranchOrder = 0;         ///< Largest branch order of any node
+    double maxPathDistance = 0.0;   ///< Largest path distance of any node
+
+    /** @brief Length, area and volume per SWC type (index = type, up to the largest type present) */
+    std::vector<double> lengthByType, areaByType, volumeByType;
+
+    /** @brief Per node, in morphology row order: length of the segment to the parent (0 for roots) */
+    std::vector<double> segmentLength;
+
+    /** @brief Per node: path length from its root */
+    std::vector<double> pathDistance;
+
+    /**
+     * @brief Per node: non-soma branch points between the node and its root
+     * @note -1 for nodes not reachable from a root (parent cycles)
+     */
+    std::vector<int> branchOrder;
+
+    /** @brief Section rows, concatenated; section s is sectionRows[sectionOffsets[s]] .. [sectionOffsets[s+1]-1] */
+    std::vector<int> sectionRows;
+    std::vector<int> sectionOffsets;        ///< Sections + 1 entries
+    std::vector<int> sectionParent;         ///< Parent section (-1 for root sections)
+    std::vector<int> sectionOrder;          ///< Branch order of the section
+    std::vector<double> sectionLength;      ///< Path length including the edge to the parent branch point
+    std::vector<double> sectionTortuosity;  ///< Path length over the straight distance between the section ends (1 if they coincide)
+
+    std::array<double, 3> shollCenter{};    ///< Centroid of the soma nodes, or the first root without a soma
+    std::vector<double> shollRadii;         ///< shollStep, 2 shollStep, ... up to the farthest node
+    std::vector<int> shollIntersections;    ///< Segments crossing each sphere (soma-to-soma segments excluded)
+};
+
+/**
+ * @brief Measures a morphology
+ * @param[in] morph Nodes; the parent rows are used if its topology is built, otherwise resolved by id
+ * @param[in] options Sholl step and threads
+ * @return All measures; empty arrays for an empty morphology
+ * @throws std::invalid_argument if options.shollStep is not positive
+ */
+Morphometrics computeMorphometrics(const Morphology& morph, const MorphometricsOptions& options = {});
+
+#endif // MORPHOMETRICS_H
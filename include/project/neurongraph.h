@@ -26,12 +26,21 @@
 #include <queue>
 #include <cmath>
 #include <numeric>
+#include <functional>
+#include <memory>
 #include <limits>
 #include <iomanip>
 #include <algorithm>
 #include <filesystem>
+#include <shared_mutex>
 
 #include "ugxobject.h"
+#include "morphology.h"
+#include "topology.h"
+#include "spatialindex.h"
+#include "morphometrics.h"
+#include "ugxstream.h"
+#include "instrumentation.h"
 
 /**
  * @brief Structure representing a single node in an SWC neuron morphology
@@ -75,6 +84,18 @@ struct SWCNode {
     double radius;
 };
 
+/**
+ * @brief Parameters of NeuronGraph::meshSurface()
+ */
+struct SurfaceMeshOptions {
+    int segments = 16;          ///< Vertices per ring
+    double insetFactor = 0.25;  ///< Pull of the junction curves towards the branch point (smoothBranchWithBezier())
+    int bezierPoints = 8;       ///< Segments of every junction curve
+    double delta = 0.0;         ///< Cubic resampling spacing of the trunks (0 = mesh the nodes as they are)
+    bool capTips = true;        ///< Close the rings at terminal nodes with a fan
+    std::size_t threads = 1;    ///< Threads (0 = all cores, 1 = serial)
+};
+
 /**
  * @brief Class for representing and processing neuron morphology graphs
  * 
@@ -92,11 +113,37 @@ struct SWCNode {
  */
 class NeuronGraph {
 	private:
-	    /** @brief Map of node IDs to SWCNode objects */
-	    std::map<int,SWCNode> nodes;
-	    
-	    /** @brief Adjacency list representation of the neuron graph */
-	    std::map<int, std::vector<int>> edges;
+	    /**
+	     * @brief Flat structure-of-arrays node storage
+	     *
+	     * All nodes of the graph live here, sorted by id. Parent/child links are
+	     * kept as dense row indices in CSR form; the map-based interfaces below
+	     * convert to and from this storage.
+	     */
+	    Morphology morph;
+
+	    /**
+	     * @brief Derived indices of morph, rebuilt when morph.revision() moves on
+	     *
+	     * Held as shared immutable snapshots so copies of the graph and
+	     * concurrent readers can share one build.
+	     */
+	    mutable std::shared_ptr<const TopologyIndex> topologyCache;
+	    mutable std::shared_ptr<const TrunkDecomposition> trunkCache;
+	    mutable std::shared_ptr<const SegmentIndex> segmentCache;
+
+	    /**
+	     * @brief Reader/writer lock handed out by accessMutex()
+	     *
+	     * Never taken by the graph's own methods. A copy of the graph gets a
+	     * fresh, unlocked mutex.
+	     */
+	    struct AccessLock {
+	        mutable std::shared_mutex mutex;
+	        AccessLock() = default;
+	        AccessLock(const AccessLock&) {}
+	        AccessLock& operator=(const AccessLock&) { return *this; }
+	    } accessLock;
 
 	    /**
 	     * @brief Builds a neighbor map from a set of nodes
@@ -113,7 +160,7 @@ class NeuronGraph {
 	     * 
 	     * Creates an empty NeuronGraph with no nodes or edges.
 	     */
-	    NeuronGraph() {nodes.clear(); edges.clear();};
+	    NeuronGraph() {morph.clear();};
 	    
 	    /**
 	     * @brief Constructor that loads a neuron from file
@@ -129,6 +176,12 @@ class NeuronGraph {
 	     */
 	    NeuronGraph(const std::map<int, SWCNode>& nodeSet);
 
+	    /**
+	     * @brief Constructs a NeuronGraph directly from flat storage
+	     * @param[in] morphology Flat structure-of-arrays morphology
+	     */
+	    NeuronGraph(const Morphology& morphology);
+
 	    /**
 	     * @brief Adds a single node to the graph
 	     * @param[in] node The SWCNode to add
@@ -147,6 +200,34 @@ class NeuronGraph {
 		 */
 		void setNodes(const std::map<int,SWCNode>& nodeSet);
 
+		/**
+		 * @brief Replaces the current nodes with flat storage
+		 * @param[in] morphology New flat morphology to use
+		 *
+		 * The topology (parent indices and CSR child lists) is rebuilt if needed.
+		 */
+		void setMorphology(const Morphology& morphology);
+
+		/**
+		 * @brief Returns the flat structure-of-arrays storage of the graph
+		 * @return Reference to the internal Morphology with up-to-date topology
+		 */
+		const Morphology& getMorphology();
+
+		/**
+		 * @brief Reader/writer lock of this graph for callers that share it between threads
+		 * @return Mutex to hold shared around const calls and exclusively around
+		 *         all other calls
+		 *
+		 * The graph does not lock itself. Concurrent const calls are safe, but a
+		 * call that may change the nodes or build the topology (every non-const
+		 * method, getMorphology() included) must not overlap any other call on
+		 * the same graph. Callers that allow this from several threads, such as
+		 * the Python bindings, which release the GIL in every method, hold this
+		 * lock around each call.
+		 */
+		std::shared_mutex& accessMutex() const { return accessLock.mutex; }
+
 		/**
 		 * @brief Checks if a set of nodes is topologically sorted
 		 * @param[in] nodeSet The set of nodes to check
@@ -162,7 +243,7 @@ class NeuronGraph {
 		 * @overload
 		 * Checks if the current graph's nodes are topologically sorted
 		 */
-		bool isTopologicallySorted() const {return this->isTopologicallySorted(this->nodes);};
+		bool isTopologicallySorted() const;
 
 		/**
 		 * @brief Sorts nodes topologically using Kahn's algorithm
@@ -181,7 +262,7 @@ class NeuronGraph {
 		 * @overload
 		 * Sorts the current graph's nodes topologically
 		 */
-		std::map<int, SWCNode> topologicalSort() const {return this->topologicalSort(this->nodes);};
+		std::map<int, SWCNode> topologicalSort() const {return this->topologicalSort(this->getNodes());};
 
 		/**
 		 * @brief Checks if the node set contains a soma segment
@@ -196,7 +277,7 @@ class NeuronGraph {
 		 * @overload
 		 * Checks if the current graph contains a soma segment
 		 */
-		bool hasSomaSegment() const {return this->hasSomaSegment(this->nodes);};
+		bool hasSomaSegment() const;
 
 		/**
 		 * @brief Checks if the node set is missing a soma
@@ -211,7 +292,7 @@ class NeuronGraph {
 		 * @overload
 		 * Checks if the current graph is missing a soma
 		 */
-		bool isSomaMissing() const {return this->isSomaMissing(this->nodes);};
+		bool isSomaMissing() const;
 
 		/**
 		 * @brief Removes the soma segment from a set of nodes
@@ -227,7 +308,7 @@ class NeuronGraph {
 		 * @overload
 		 * Removes the soma segment from the current graph
 		 */
-		std::map<int, SWCNode> removeSomaSegment() const {return this->removeSomaSegment(this->nodes);};
+		std::map<int, SWCNode> removeSomaSegment() const {return this->removeSomaSegment(this->getNodes());};
 
 		/**
 		 * @brief Adds a soma node if none exists
@@ -243,7 +324,7 @@ class NeuronGraph {
 		 * @overload
 		 * Adds a soma node to the current graph if none exists
 		 */
-		std::map<int, SWCNode> setSoma() const {return this->setSoma(this->nodes);};
+		std::map<int, SWCNode> setSoma() const {return this->setSoma(this->getNodes());};
 
 		/**
 		 * @brief Applies standard preprocessing steps to a set of nodes
@@ -259,7 +340,7 @@ class NeuronGraph {
 
 	    /**
 	     * @brief Reads neuron data from an SWC file
-	     * @param[in] filename Path to the SWC file to read
+	     * @param[in] filename Path to the SWC file to read (optionally gzip or zstd compressed)
 	     * 
 	     * @throws std::runtime_error If the file cannot be opened or parsed
 	     * @see http://www.neuronland.org/NLMorphologyConverter/MorphologyFormats/SWC/Spec.html
@@ -269,7 +350,7 @@ class NeuronGraph {
 	    /**
 	     * @brief Writes a set of nodes to an SWC file
 	     * @param[in] nodeSet The nodes to write
-	     * @param[in] filename Path to the output file
+	     * @param[in] filename Path to the output file; a name ending in .gz or .zst is compressed (see compression.h)
 	     * 
 	     * @note The file will be overwritten if it already exists
 	     */
@@ -280,7 +361,7 @@ class NeuronGraph {
 	     * @overload
 	     * Writes the current graph's nodes to an SWC file
 	     */
-	    void writeToFile(const std::string& filename) {this->writeToFile(this->nodes, filename);};
+	    void writeToFile(const std::string& filename) {this->writeToFile(this->getNodes(), filename);};
 
 	    /**
 	     * @brief Reads neuron data from a UGX file
@@ -291,6 +372,17 @@ class NeuronGraph {
 	     */
 	    void readFromFileUGX(const std::string& filename);
 
+	    /**
+	     * @brief Reads a UGX file with the streaming pull parser
+	     * @param[in] filename Path to the UGX file
+	     *
+	     * Produces the same graph as the DOM based readFromFileUGX() without
+	     * building an XML tree: the file is memory-mapped and the element text
+	     * is parsed in place. readFromFileUGX() uses this path when the
+	     * streaming backend is selected with setUgxBackend().
+	     */
+	    void readFromFileUGXStream(const std::string& filename);
+
 		/**
 		 * @brief Reads a neuron file, automatically detecting the format
 		 * @param[in] filename Path to the neuron file (SWC or UGX)
@@ -305,7 +397,7 @@ class NeuronGraph {
 		/**
 		 * @brief Writes a set of nodes to a UGX file
 		 * @param[in] nodeSet The nodes to write
-		 * @param[in] filename Path to the output file
+		 * @param[in] filename Path to the output file; a name ending in .gz or .zst is compressed (see compression.h)
 		 * 
 		 * @note The file will be overwritten if it already exists
 		 */
@@ -316,7 +408,43 @@ class NeuronGraph {
 		 * @overload
 		 * Writes the current graph's nodes to a UGX file
 		 */
-		void writeToFileUGX(const std::string& filename) {this->writeToFileUGX(this->nodes, filename);};
+		void writeToFileUGX(const std::string& filename) {this->writeToFileUGX(this->getNodes(), filename);};
+
+		/**
+		 * @brief Writes a set of nodes to a UGX file with the streaming writer
+		 * @param[in] nodeSet The nodes to write
+		 * @param[in] filename Path to the output file
+		 *
+		 * The output is byte-identical to writeToFileUGX() with the DOM backend,
+		 * but values are formatted straight into a fixed-size output buffer.
+		 */
+		void writeToFileUGXStream(const std::map<int,SWCNode>& nodeSet,
+				const std::string& filename);
+
+		/**
+		 * @brief Writes a set of nodes to a binary cache file
+		 * @param[in] nodeSet The nodes to write
+		 * @param[in] filename Path to the output file
+		 * @param[in] precision Storage type of coordinates and radii; Float32
+		 *            halves their size, readFromFileBIN() widens them back to double
+		 *
+		 * The binary format (see bincache.h) stores the flat node columns and
+		 * topology in aligned sections that readFromFileBIN() maps back in place.
+		 */
+		void writeToFileBIN(const std::map<int,SWCNode>& nodeSet, const std::string& filename,
+		                    StoragePrecision precision = StoragePrecision::Float64);
+
+		/**
+		 * @overload
+		 * Writes the current graph's nodes to a binary cache file
+		 */
+		void writeToFileBIN(const std::string& filename, StoragePrecision precision = StoragePrecision::Float64);
+
+		/**
+		 * @brief Reads neuron data from a binary cache file
+		 * @param[in] filename Path to a file written by writeToFileBIN()
+		 */
+		void readFromFileBIN(const std::string& filename);
 
 		/**
 		 * @brief Converts an SWC file to UGX format
@@ -327,6 +455,20 @@ class NeuronGraph {
 		 */
 		void swc2ugx(const std::string& inputfile, const std::string& outputfile);
 
+		/**
+		 * @brief Converts an SWC file to the binary cache format
+		 * @param[in] inputfile Path to the input SWC file
+		 * @param[in] outputfile Path for the output .bin file
+		 */
+		void swc2bin(const std::string& inputfile, const std::string& outputfile);
+
+		/**
+		 * @brief Converts a UGX neuron file to the binary cache format
+		 * @param[in] inputfile Path to the input UGX file
+		 * @param[in] outputfile Path for the output .bin file
+		 */
+		void ugx2bin(const std::string& inputfile, const std::string& outputfile);
+
 		/**
 		 * @brief Converts a UGX file to SWC format
 		 * @param[in] inputfile Path to the input UGX file
@@ -340,19 +482,19 @@ class NeuronGraph {
 	     * @brief Returns the number of nodes in the graph
 	     * @return The total number of nodes
 	     */
-	    int numberOfNodes() {return this->nodes.size();};
+	    int numberOfNodes() const {return static_cast<int>(this->morph.size());};
 
 	    /**
 	     * @brief Returns the number of edges in the graph
-	     * @return The total number of edges
+	     * @return The number of distinct parent nodes that have at least one child
 	     */
-	    int numberOfEdges() {return this->edges.size();};
+	    int numberOfEdges() const;
 
 	    /**
 	     * @brief Returns a copy of all nodes in the graph
 	     * @return A map of node IDs to SWCNode objects
 	     */
-	    auto getNodes() { return this->nodes; };
+	    std::map<int, SWCNode> getNodes() const { return this->morph.toNodes(); };
 
 		/**
 		 * @brief Splits all edges in the graph by inserting midpoint nodes
@@ -369,7 +511,7 @@ class NeuronGraph {
 		 * @overload
 		 * Splits all edges in the current graph
 		 */
-		std::map<int, SWCNode> splitEdges() const {return this->splitEdges(this->nodes);};
+		std::map<int, SWCNode> splitEdges() const {return this->splitEdges(this->getNodes());};
 
 		/**
 		 * @brief Applies edge splitting N times recursively
@@ -384,7 +526,19 @@ class NeuronGraph {
 		 * @overload
 		 * Applies edge splitting N times to the current graph
 		 */
-		std::vector<std::map<int, SWCNode>> splitEdgesN(int N) const {return this->splitEdgesN(this->nodes, N);};
+		std::vector<std::map<int, SWCNode>> splitEdgesN(int N) const {return this->splitEdgesN(this->getNodes(), N);};
+
+		/**
+		 * @brief Applies edge splitting N times, handing each level to a callback
+		 * @param[in] nodeSet The set of nodes to process
+		 * @param[in] N Number of times to split the edges
+		 * @param[in] onLevel Called with (i, nodes) for the result of i+1 splits
+		 *
+		 * Only the current level is kept in memory, so the levels can be written
+		 * out as they are produced.
+		 */
+		void splitEdgesN(const std::map<int, SWCNode>& nodeSet, int N,
+		                 const std::function<void(int, const std::map<int, SWCNode>&)>& onLevel) const;
 
 		/**
 		 * @brief Extracts trunk segments from a neuron morphology
@@ -401,7 +555,61 @@ class NeuronGraph {
 		 * @overload
 		 * Extracts trunk segments from the current graph
 		 */
-		std::map<int,std::map<int,SWCNode>> getTrunks(bool resetIndex = false) const {return this->getTrunks(this->nodes, resetIndex);};
+		std::map<int,std::map<int,SWCNode>> getTrunks(bool resetIndex = false) const;
+
+		/**
+		 * @brief Extracts trunk segments as spans of one contiguous node array
+		 * @param[in] nodeSet The set of nodes to process
+		 * @param[in] resetIndex If true, renumbers node IDs sequentially along each trunk
+		 * @return Trunks numbered as getTrunks(), nodes in path order, with parent trunks
+		 */
+		TrunkSpans getTrunkSpans(const std::map<int,SWCNode>& nodeSet, bool resetIndex = false) const;
+
+		/**
+		 * @overload
+		 * Trunk spans of the current graph, from the cached decomposition
+		 */
+		TrunkSpans getTrunkSpans(bool resetIndex = false) const;
+
+		/**
+		 * @brief Converts trunk spans into the map form returned by getTrunks()
+		 * @param[in] spans Trunk spans
+		 * @return Map of trunk IDs to their nodes keyed by node ID
+		 */
+		static std::map<int,std::map<int,SWCNode>> trunkSpansToMaps(const TrunkSpans& spans);
+
+		/**
+		 * @brief Returns the adjacency, branch point and soma index of the current graph
+		 * @return Index built on first use and reused until the nodes change
+		 */
+		std::shared_ptr<const TopologyIndex> topology() const;
+
+		/**
+		 * @brief Returns the trunk decomposition of the current graph
+		 * @return Trunks as row spans, built on first use and reused until the nodes change
+		 *
+		 * getTrunks(bool) and getTrunkParentMap() of the current graph are read from it.
+		 */
+		std::shared_ptr<const TrunkDecomposition> trunkDecomposition() const;
+
+		/**
+		 * @brief Returns the segment BVH of the current graph
+		 * @return Capsule index built on first use and reused until the nodes change
+		 *
+		 * Nearest-node, radius, ray and self-intersection queries run against
+		 * it in logarithmic time per query; hit indices are morphology rows.
+		 */
+		std::shared_ptr<const SegmentIndex> segmentIndex() const;
+
+		/**
+		 * @brief Computes the morphometrics of the current graph
+		 * @param[in] options Sholl step and threads
+		 * @return Lengths, areas, volumes, branch orders, sections and Sholl profile
+		 * @throws std::invalid_argument if options.shollStep is not positive
+		 *
+		 * One pass over the flat node columns; see computeMorphometrics().
+		 */
+		Morphometrics morphometrics(const MorphometricsOptions& options = {}) const;
 
 		/**
 		 * @brief Creates a mapping from trunk IDs to their parent trunk IDs
@@ -412,6 +620,12 @@ class NeuronGraph {
 		std::map<int, int> getTrunkParentMap(const std::map<int, SWCNode>& nodeSet,
 			                                 const std::map<int, std::map<int, SWCNode>>& trunkNodeSets) const;
 
+		/**
+		 * @overload
+		 * Parent trunk of every trunk returned by getTrunks(bool) for the current graph
+		 */
+		std::map<int, int> getTrunkParentMap() const;
+
 		/**
 		 * @brief Combines multiple trunks into a single node set
 		 * @param[in] trunkNodeSets Map of trunk IDs to their nodes
@@ -433,6 +647,21 @@ class NeuronGraph {
 		std::map<int, SWCNode> assembleTrunks(const std::map<int, std::map<int, SWCNode>>& resampledTrunks,
 											  const std::map<int,int>& trunkParentMap);
 
+		/**
+		 * @brief Combines resampled trunks into one dense node array, in parallel over the trunks
+		 * @param[in] resampledTrunks Map of trunk IDs to their resampled nodes
+		 * @param[in] trunkParentMap Map of trunk IDs to their parent trunk IDs
+		 * @param[in] threads Number of threads (0 = all cores, 1 = serial)
+		 * @return The same nodes as assembleTrunks(resampledTrunks, trunkParentMap);
+		 *         element i has id i + 1
+		 *
+		 * Trunk id ranges come from a prefix sum over the trunk lengths, so every
+		 * trunk is written into the preallocated array independently.
+		 */
+		std::vector<SWCNode> assembleTrunksDense(const std::map<int, std::map<int, SWCNode>>& resampledTrunks,
+		                                         const std::map<int,int>& trunkParentMap,
+		                                         std::size_t threads = 0) const;
+
 		/**
 		 * @brief Resamples a single trunk using linear interpolation
 		 * @param[in] trunk The trunk to resample (map of node IDs to SWCNodes)
@@ -445,9 +674,13 @@ class NeuronGraph {
 		 * @brief Resamples all trunks using linear interpolation
 		 * @param[in,out] trunks Map of trunk IDs to their nodes
 		 * @param[in,out] delta Target spacing between resampled points (may be adjusted)
+		 * @param[in] threads Number of threads (0 = all cores, 1 = serial)
 		 * @return A new map of resampled trunks
+		 *
+		 * The result is identical for every thread count.
 		 */
-		std::map<int, std::map<int, SWCNode>> allLinearSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta) const;
+		std::map<int, std::map<int, SWCNode>> allLinearSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta,
+		                                                                     std::size_t threads = 1) const;
 
 		/**
 		 * @brief Resamples a single trunk using cubic spline interpolation
@@ -464,16 +697,35 @@ class NeuronGraph {
 		 * @brief Resamples all trunks using cubic spline interpolation
 		 * @param[in,out] trunks Map of trunk IDs to their nodes
 		 * @param[in,out] delta Target spacing between resampled points (may be adjusted)
+		 * @param[in] threads Number of threads (0 = all cores, 1 = serial)
 		 * @return A new map of resampled trunks
+		 *
+		 * The result is identical for every thread count.
+		 */
+		std::map<int, std::map<int, SWCNode>> allCubicSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta,
+		                                                                    std::size_t threads = 1) const;
+
+		/**
+		 * @brief Resamples a single trunk along its cubic spline with curvature-dependent spacing
+		 * @param[in] trunk The trunk to resample (map of node IDs to SWCNodes)
+		 * @param[in] tolerance Largest deviation of the spline and of the radius from
+		 *                      the straight segment between two consecutive samples
+		 * @param[in] maxSpacing Largest arc length between consecutive samples
+		 * @return A new set of nodes representing the resampled trunk
+		 *
+		 * Straight, evenly tapered stretches get samples up to @p maxSpacing apart;
+		 * bends and radius changes are sampled as densely as the tolerance requires.
 		 */
-		std::map<int, std::map<int, SWCNode>> allCubicSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta) const;
+		std::map<int, SWCNode> adaptiveSplineResampleTrunk(const std::map<int, SWCNode>& trunk, double tolerance,
+		                                                   double maxSpacing) const;
 
 		/**
 		 * @brief Generates multiple levels of refined neuron morphologies
 		 * @param[in] nodeSet The set of nodes to refine
 		 * @param[in,out] delta Initial spacing parameter for refinement
 		 * @param[in,out] N Number of refinement levels to generate
-		 * @param[in,out] method Refinement method ("linear" or "cubic")
+		 * @param[in,out] method Refinement method ("linear", "cubic" or "adaptive")
+		 * @param[in] threads Number of threads used to resample trunks (0 = all cores, 1 = serial)
 		 * @return A map where keys are refinement levels and values are the refined node sets
 		 * 
 		 * This method generates a series of increasingly refined versions of the input
@@ -482,7 +734,8 @@ class NeuronGraph {
 		std::map<int, std::map<int,SWCNode>> generateRefinements(const std::map<int,SWCNode>& nodeSet, 
 																 double& delta, 
 																 int& N, 
-																 std::string& method);
+																 std::string& method,
+																 std::size_t threads = 1);
 
 		/**
 		 * @overload
@@ -490,23 +743,87 @@ class NeuronGraph {
 		 */
 		std::map<int, std::map<int,SWCNode>> generateRefinements(double& delta, 
 																 int& N, 
-																 std::string& method) {
-			return this->generateRefinements(this->nodes, delta, N, method); 
+																 std::string& method,
+																 std::size_t threads = 1) {
+			return this->generateRefinements(this->getNodes(), delta, N, method, threads); 
 		};
 
+		/**
+		 * @brief Generates refinement levels and writes each one as soon as it is produced
+		 * @param[in] nodeSet The set of nodes to refine
+		 * @param[in] delta Spacing of level 0 (halved at each level)
+		 * @param[in] N Number of refinement levels
+		 * @param[in] method Refinement method ("linear", "cubic" or "adaptive")
+		 * @param[in] outputFolder Existing folder receiving refinement_<i>.swc and refinement_<i>.ugx
+		 * @param[in] threads Number of threads used to resample trunks (0 = all cores, 1 = serial)
+		 *
+		 * Produces the same levels as generateRefinements() from a RefinementHierarchy
+		 * but never holds more than one level in memory.
+		 */
+		void writeRefinements(const std::map<int,SWCNode>& nodeSet, double delta, int N,
+		                      const std::string& method, const std::string& outputFolder,
+		                      std::size_t threads = 1);
+
 
 		std::map<int, std::vector<int>> getNeighborMap(const std::map<int, SWCNode>& nodeSet);
-		std::map<int, std::vector<int>> getNeighborMap(){return this->getNeighborMap(this->getNodes());
-		};
+		std::map<int, std::vector<int>> getNeighborMap();
 
 		std::map<int, std::map<int, SWCNode>> extractBranchSubgraphs(const std::map<int, SWCNode>& nodeSet);
-		std::map<int, std::map<int, SWCNode>> extractBranchSubgraphs(){return this->extractBranchSubgraphs(this->getNodes());};
+		std::map<int, std::map<int, SWCNode>> extractBranchSubgraphs();
 
 		std::map<int, std::map<int, SWCNode>> smoothBranchWithBezier(const std::map<int, SWCNode>& nodeSet,
 																	 double insetFactor,
     																 int numberOfBezierPoints);
+
+		/**
+		 * @brief Quadratic Bezier curves between consecutive neighbours of a branch point
+		 * @param[in] center Branch point
+		 * @param[in] neighbours Its neighbours; curve i runs from neighbour i to neighbour i + 1 (cyclic)
+		 * @param[in] insetFactor Position of the control point between the center (0) and the neighbours' midpoint (1)
+		 * @param[in] numberOfBezierPoints Segments per curve
+		 * @return One path per neighbour with ids 1..numberOfBezierPoints + 1
+		 *
+		 * The curves smoothBranchWithBezier() builds for a star subgraph.
+		 */
+		static std::vector<std::map<int, SWCNode>> junctionBezierCurves(const SWCNode& center,
+		                                                                const std::vector<SWCNode>& neighbours,
+		                                                                double insetFactor, int numberOfBezierPoints);
 		
 		UgxObject pftFromPath(const std::map<int, SWCNode>& path, int segments);
+
+		/**
+		 * @brief Tube surface around a path in dense form (same mesh as pftFromPath())
+		 * @param[in] path Nodes of the path, in id order
+		 * @param[in] segments Vertices per ring
+		 * @return Contiguous vertices, radii, edges, faces and subsets, without map nodes per vertex
+		 */
+		static DenseUgxGeometry pftDenseFromPath(const std::map<int, SWCNode>& path, int segments);
+
+		/**
+		 * @brief Surface mesh of a whole neuron, built in memory
+		 * @param[in] nodeSet Nodes to mesh
+		 * @param[in] options Ring resolution, junction curves, resampling and threads
+		 * @return One connected geometry of all trunk tubes and junctions
+		 *
+		 * Every trunk of getTrunks() becomes a pftFromPath() tube, clipped back
+		 * to the neighbours of the branch points it connects. Every branch point
+		 * becomes the junction curves of smoothBranchWithBezier() between its
+		 * neighbours, each meshed as a tube. All parts are meshed concurrently
+		 * and merged with DenseUgxGeometry::appendAll(); the rings that several
+		 * parts place on the same node are then welded to the ring of the first
+		 * part, so trunks and junctions share vertices instead of overlapping,
+		 * and DenseUgxGeometry::compact() removes the repeated ring edges.
+		 * The result is the same for any thread count.
+		 *
+		 * @note Like getTrunks(), a node set without branch points has no trunks and gives an empty mesh
+		 */
+		DenseUgxGeometry meshSurface(const std::map<int, SWCNode>& nodeSet, const SurfaceMeshOptions& options = {}) const;
+
+		/**
+		 * @overload
+		 * Meshes the graph's own nodes with the cached topology and trunks
+		 */
+		DenseUgxGeometry meshSurface(const SurfaceMeshOptions& options = {}) const;
 };
 
 #endif // NEURONGRAPH_H
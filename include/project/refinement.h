@@ -0,0 +1,177 @@
+/**
+ * @file refinement.h
+ * @brief Reusable trunk data and a streaming multi-level refinement hierarchy
+ *
+ * Resampling a trunk at a new spacing needs the same ordered nodes, arc
+ * length table and (for cubic resampling) spline coefficients every time.
+ * PreparedTrunk holds that data so it is computed once per trunk, and
+ * RefinementHierarchy keeps the trunk decomposition of a whole neuron so
+ * that each refinement level only costs the sampling and the reassembly.
+ *
+ * Levels are handed to a callback as soon as they are produced, so a caller
+ * writing them to disk never holds more than one level in memory.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef REFINEMENT_H
+#define REFINEMENT_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "neurongraph.h"
+#include "spline.h"
+
+/**
+ * @brief Per-trunk data that does not depend on the sampling distance
+ */
+struct PreparedTrunk {
+    std::vector<SWCNode> nodes;       ///< Original trunk nodes in id order
+    std::vector<double> arcLength;    ///< Cumulative arc length at each node
+    int dominantType = 0;             ///< Most frequent node type
+    double clampRadius = 0.0;         ///< Lower bound for cubic radii (1.05 x minimum radius)
+    bool cubic = false;               ///< True if spline holds a fit
+    NaturalCubicSpline<4> spline;     ///< x, y, z, radius against arc length
+};
+
+/**
+ * @brief Builds the distance-independent data of a trunk
+ * @param[in] trunk Trunk nodes keyed by id
+ * @param[in] cubic Also fit the x/y/z/radius spline
+ * @return The prepared trunk (with no nodes if the trunk has fewer than 2)
+ */
+PreparedTrunk prepareTrunk(const std::map<int, SWCNode>& trunk, bool cubic);
+
+/**
+ * @overload
+ * @param[in] nodes Trunk nodes sorted by id
+ * @param[in] cubic Also fit the x/y/z/radius spline
+ */
+PreparedTrunk prepareTrunk(std::vector<SWCNode> nodes, bool cubic);
+
+/**
+ * @brief Samples a prepared trunk by linear interpolation between its nodes
+ * @param[in] trunk Prepared trunk
+ * @param[in] delta Target spacing
+ * @return Resampled trunk with ids 1..N
+ * @see NeuronGraph::linearSplineResampleTrunk()
+ */
+std::map<int, SWCNode> sampleTrunkLinear(const PreparedTrunk& trunk, double delta);
+
+/**
+ * @brief Samples a prepared trunk along its cubic spline
+ * @param[in] trunk Prepared trunk (prepared with cubic = true)
+ * @param[in] delta Target spacing
+ * @return Resampled trunk with ids 1..N
+ * @see NeuronGraph::cubicSplineResampleTrunk()
+ */
+std::map<int, SWCNode> sampleTrunkCubic(const PreparedTrunk& trunk, double delta);
+
+/**
+ * @brief Samples a prepared trunk along its cubic spline with curvature-dependent spacing
+ * @param[in] trunk Prepared trunk (prepared with cubic = true)
+ * @param[in] tolerance Largest distance allowed between the spline and the straight
+ *                      segment joining two consecutive samples; also bounds the
+ *                      radius error of linear interpolation between them
+ * @param[in] maxSpacing Largest arc length between consecutive samples
+ * @return Resampled trunk with ids 1..N (at least 4 nodes, like the uniform sampling)
+ *
+ * The trunk is split into equal pieces no longer than @p maxSpacing, and a
+ * piece is bisected while the spline or its radius deviates from the chord
+ * by more than @p tolerance at a quarter, half or three quarters of it.
+ * Straight trunks of constant radius keep few nodes; bends and tapering
+ * get as many as they need.
+ * @see NeuronGraph::adaptiveSplineResampleTrunk()
+ */
+std::map<int, SWCNode> sampleTrunkAdaptive(const PreparedTrunk& trunk, double tolerance, double maxSpacing);
+
+/** @brief Tolerance of the "adaptive" method at refinement spacing delta, as a fraction of delta */
+constexpr double adaptiveToleranceRatio = 0.05;
+
+/** @brief Largest spacing of the "adaptive" method at refinement spacing delta, as a multiple of delta */
+constexpr double adaptiveSpacingRatio = 8.0;
+
+/**
+ * @brief Multi-level refinement of one neuron built from cached trunk data
+ *
+ * The neuron is decomposed into trunks and each trunk is prepared once on
+ * construction. level() then resamples the cached trunks at a given spacing
+ * and reassembles the neuron; generate() produces a sequence of halving
+ * spacings and streams each level to a callback.
+ *
+ * Example usage:
+ * @code
+ * RefinementHierarchy hierarchy(graph, graph.getNodes(), "cubic", 0);
+ * hierarchy.generate(12.0, 6, [&](int i, const std::map<int, SWCNode>& nodes) {
+ *     graph.writeToFile(nodes, folder + "/refinement_" + std::to_string(i) + ".swc");
+ * });
+ * @endcode
+ */
+class RefinementHierarchy {
+public:
+    /** @brief Callback receiving a refinement level and its nodes */
+    using LevelCallback = std::function<void(int level, const std::map<int, SWCNode>& nodes)>;
+
+    /** @brief Polled while a level is built; returning true abandons the level */
+    using CancelCheck = std::function<bool()>;
+
+    /**
+     * @brief Decomposes and prepares a neuron
+     * @param[in] graph Graph whose getTrunks() and getTrunkParentMap() decompose @p nodeSet
+     * @param[in] nodeSet Neuron nodes
+     * @param[in] method "cubic", "adaptive" or "linear" (anything else is treated as linear)
+     * @param[in] threads Threads used to prepare, resample and assemble trunks (0 = all cores)
+     */
+    RefinementHierarchy(const NeuronGraph& graph, const std::map<int, SWCNode>& nodeSet,
+                        const std::string& method, std::size_t threads = 1);
+
+    /**
+     * @brief Resamples every trunk at @p delta and reassembles the neuron
+     * @param[in] delta Target spacing; for "adaptive" the tolerance is
+     *                  adaptiveToleranceRatio x delta and the largest spacing
+     *                  adaptiveSpacingRatio x delta
+     * @return Nodes of the refined neuron
+     */
+    std::map<int, SWCNode> level(double delta) const;
+
+    /**
+     * @brief Cancellable level(): resamples every trunk at @p delta unless @p cancelled
+     * @param[in] delta Target spacing, as for level(double)
+     * @param[in] cancelled Checked before every trunk (from the worker threads,
+     *                      so it must be thread-safe) and before the reassembly
+     * @return Nodes of the refined neuron, or nothing if @p cancelled returned
+     *         true; the trunks resampled so far are dropped
+     */
+    std::optional<std::map<int, SWCNode>> level(double delta, const CancelCheck& cancelled) const;
+
+    /**
+     * @brief Produces N levels with spacings delta, delta/2, ..., delta/2^(N-1)
+     * @param[in] delta Spacing of level 0
+     * @param[in] N Number of levels
+     * @param[in] onLevel Called with each level as soon as it is assembled;
+     *                    the nodes are released before the next level is built
+     */
+    void generate(double delta, int N, const LevelCallback& onLevel) const;
+
+    /** @brief Number of trunks the neuron was decomposed into */
+    std::size_t numberOfTrunks() const { return trunkIds.size(); }
+
+private:
+    enum class Sampling { Linear, Cubic, Adaptive };
+
+    Sampling sampling;
+    std::size_t threads;
+    std::vector<int> trunkIds;
+    std::vector<PreparedTrunk> trunks;
+    std::map<int, int> trunkParentMap;
+};
+
+#endif // REFINEMENT_H
@@ -0,0 +1,234 @@
+/**
+ * @file resultcache.h
+ * @brief Content-addressed on-disk cache of refinements and meshes
+ *
+ * Jobs often refine or mesh the same SWC files with the same parameters.
+ * ResultCache stores such results in the binary container format (see
+ * bincache.h) under a key built from a hash of the input file contents, the
+ * operation and its parameters, so a repeated request is answered by
+ * mapping the stored files instead of recomputing them. The key also covers
+ * kResultCacheVersion, so results of an older build are never served.
+ *
+ * Layout of the cache folder:
+ * @code
+ * <folder>/<key>/level_<i>.bin      one Morphology file per refinement level
+ * <folder>/<key>/levels.txt         number of refinement levels in the entry
+ * <folder>/<key>/geometry.bin       one Geometry file for meshes
+ * <folder>/<key>/geometry.txt       vertex, edge and face counts of the mesh
+ * <folder>/<key>/size.txt           size of the entry in bytes, recorded at commit
+ * <folder>/.pending-<key>-<tag>/    entry being written
+ * <folder>/.evicted-<key>-<tag>/    entry being removed
+ * @endcode
+ *
+ * Several processes may share a folder. An entry is written under a private
+ * pending name and published with a single rename, so readers only ever see
+ * complete entries; if two processes publish the same key the second rename
+ * fails and its copy is dropped. Eviction renames an entry away before
+ * deleting it. A reader that loses an entry to eviction simply misses,
+ * even halfway through its files: refinement entries record their level
+ * count and mesh entries their element counts, and a read that finds less
+ * is a miss.
+ *
+ * The folder is bounded in size: every hit refreshes the modification time
+ * of its entry, and trim() (run after each store) removes the least
+ * recently used entries until the total fits. The total is the sum of the
+ * sizes recorded by the entries, so a trim lists the folder but does not
+ * walk the files of every entry.
+ *
+ * Example usage:
+ * @code
+ * ResultCache cache = ResultCache::fromEnvironment();
+ * std::string key = ResultCache::key(ResultCache::hashFile("neuron.swc"), "generateRefinements", {12.0, 6}, "cubic");
+ * std::map<int, std::map<int, SWCNode>> levels;
+ * if (!cache.loadLevels(key, levels)) {
+ *     levels = graph.generateRefinements(delta, N, method);
+ *     cache.storeLevels(key, levels);
+ * }
+ * @endcode
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "neurongraph.h"
+#include "ugxobject.h"
+
+/** @brief Default size bound of a result cache folder (1 GiB) */
+constexpr std::uint64_t kDefaultResultCacheBytes = std::uint64_t(1) << 30;
+
+/**
+ * @brief Version of the cached results, hashed into every key
+ *
+ * Bump it whenever a change to the code alters what a cached operation
+ * returns (refinement, resampling or meshing results, or the entry file
+ * formats): entries of older versions then simply miss and age out.
+ */
+constexpr int kResultCacheVersion = 1;
+
+/**
+ * @brief Persistent, size-bounded cache of results keyed by input content
+ */
+class ResultCache {
+public:
+    /**
+     * @brief An entry being written; published by commit(), discarded otherwise
+     *
+     * Files are written into folder(). Destroying an uncommitted entry
+     * removes its pending folder.
+     */
+    class PendingEntry {
+    public:
+        PendingEntry(const PendingEntry&) = delete;
+        PendingEntry& operator=(const PendingEntry&) = delete;
+        PendingEntry(PendingEntry&& other) noexcept;
+        ~PendingEntry();
+
+        /** @brief Folder receiving the entry's files (empty if the cache is disabled) */
+        const std::string& folder() const { return pendingFolder; }
+
+        /**
+         * @brief Records the entry's size, publishes it and trims the cache
+         * @return true if this entry (or an identical one from another process) is now cached
+         */
+        bool commit();
+
+    private:
+        friend class ResultCache;
+        PendingEntry(const ResultCache* cache, std::string key, std::string pendingFolder)
+            : cache(cache), entryKey(std::move(key)), pendingFolder(std::move(pendingFolder)) {}
+
+        const ResultCache* cache;
+        std::string entryKey;
+        std::string pendingFolder;
+    };
+
+    /**
+     * @brief Uses (and creates) a cache folder
+     * @param[in] folder Cache folder; empty disables the cache
+     * @param[in] maxBytes Size bound enforced by trim()
+     */
+    explicit ResultCache(std::string folder, std::uint64_t maxBytes = kDefaultResultCacheBytes);
+
+    /**
+     * @brief Cache configured by the environment
+     *
+     * NEURONMESHER_CACHE_DIR selects the folder (default: output/cache next to
+     * the executable's bin folder, "off" disables the cache) and
+     * NEURONMESHER_CACHE_MB the size bound in MiB.
+     */
+    static ResultCache fromEnvironment();
+
+    /** @brief False if the cache was created with an empty folder */
+    bool enabled() const { return !root.empty(); }
+
+    /** @brief The cache folder */
+    const std::string& folder() const { return root; }
+
+    /**
+     * @brief 128-bit content hash of a file as 32 hex digits
+     * @param[in] filename File to hash
+     * @return The hash, or an empty string if the file cannot be read
+     *
+     * The hash is not cryptographic; it identifies inputs, it does not authenticate them.
+     */
+    static std::string hashFile(const std::string& filename);
+
+    /** @brief 128-bit hash of a byte string as 32 hex digits */
+    static std::string hashBytes(const void* data, std::size_t size);
+
+    /**
+     * @brief Key of a result
+     * @param[in] contentHash hashFile() of the input
+     * @param[in] operation Name of the operation (and of any preprocessing)
+     * @param[in] numbers Numeric parameters, formatted so they round-trip exactly
+     * @param[in] options Other parameters
+     * @return Hash of all four and kResultCacheVersion as 32 hex digits, or an
+     *         empty key (never cached) if @p contentHash is empty
+     */
+    static std::string key(const std::string& contentHash, const std::string& operation,
+                           std::initializer_list<double> numbers, const std::string& options = {});
+
+    /**
+     * @brief Looks up an entry and marks it as recently used
+     * @param[in] key Entry key
+     * @return Folder of the entry, or nothing on a miss
+     */
+    std::optional<std::string> find(const std::string& key) const;
+
+    /**
+     * @brief Starts writing an entry
+     * @param[in] key Entry key
+     * @return The pending entry (with an empty folder if the cache is disabled)
+     */
+    PendingEntry prepare(const std::string& key) const;
+
+    /**
+     * @brief Loads refinement levels stored by storeLevels()
+     * @param[in] key Entry key
+     * @param[out] levels Levels keyed by level index
+     * @return true on a hit; false (leaving @p levels unchanged) if the entry
+     *         is missing, has no level count or loses a level while being read
+     */
+    bool loadLevels(const std::string& key, std::map<int, std::map<int, SWCNode>>& levels) const;
+
+    /** @brief Stores refinement levels, one binary Morphology file per level, and their count */
+    void storeLevels(const std::string& key, const std::map<int, std::map<int, SWCNode>>& levels) const;
+
+    /**
+     * @brief Loads a mesh stored by storeGeometry()
+     * @param[in] key Entry key
+     * @param[out] geometry The mesh
+     * @return true on a hit, including a stored empty mesh; false (leaving
+     *         @p geometry unchanged) if the entry is missing, has no element
+     *         counts or reads back with different counts
+     */
+    bool loadGeometry(const std::string& key, DenseUgxGeometry& geometry) const;
+
+    /** @brief Stores a mesh as one binary Geometry file and its element counts */
+    void storeGeometry(const std::string& key, const DenseUgxGeometry& geometry) const;
+
+    /** @brief Path of refinement level @p level inside an entry folder */
+    static std::string levelPath(const std::string& entryFolder, int level);
+
+    /**
+     * @brief Records the number of refinement levels of an entry being written
+     * @param[in] entryFolder PendingEntry::folder() holding levels 0 .. @p levels - 1
+     * @param[in] levels Level count checked by loadLevels()
+     * @return false if the count could not be written (the entry should not be committed)
+     *
+     * Needed only by writers that fill the levelPath() files themselves;
+     * storeLevels() calls it.
+     */
+    static bool writeLevelCount(const std::string& entryFolder, int levels);
+
+    /** @brief Total size of the published entries in bytes, as recorded at commit */
+    std::uint64_t size() const;
+
+    /**
+     * @brief Evicts least recently used entries until size() <= the bound
+     *
+     * Also removes pending and evicted folders left behind by processes that
+     * stopped more than an hour ago.
+     */
+    void trim() const;
+
+    /** @brief Removes every entry */
+    void clear() const;
+
+private:
+    std::string root;
+    std::uint64_t maxBytes;
+};
+
+#endif // RESULTCACHE_H
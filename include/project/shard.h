@@ -0,0 +1,220 @@
+/**
+ * @file shard.h
+ * @brief Distributed batch runs: sharding a data set across processes
+ *
+ * A whole NeuroMorpho archive is more than one machine can mesh in
+ * reasonable time. The drivers (splitrefineset, extracttrunks) can split
+ * their input list across the ranks of a job, each rank running the usual
+ * threaded batch (runBatch()) on its share.
+ *
+ * - Sharding is size-aware: every input is weighted by its node count
+ *   (estimateNodeCount()) and the inputs are handed out largest first to the
+ *   least loaded rank, so one rank does not end up with all big neurons.
+ * - Progress is checkpointed: each rank appends every finished input to its
+ *   own file in a shared state folder. A rerun after a node failure reads
+ *   all of them and skips what is done; with MPI only the remaining inputs
+ *   are sharded, over however many ranks the rerun has.
+ * - Per-rank statistics are gathered on rank 0 and printed as one report.
+ *
+ * With NEURONMESHER_WITH_MPI (CMake option NEURONMESHER_MPI) the ranks are
+ * MPI ranks; the node counts are estimated in parallel and shared with
+ * MPI_Allreduce and the statistics are collected with MPI_Gather. Without
+ * MPI every process is a rank of its own, numbered by the launcher's
+ * environment (NEURONMESHER_RANK/NEURONMESHER_RANKS, SLURM_PROCID/
+ * SLURM_NTASKS, or the Open MPI and PMI variables). Their statistics files
+ * are tagged with a run id shared through the environment
+ * (NEURONMESHER_RUN_ID, or the SLURM or PBS job id); rank 0 waits for the
+ * files of this run and ignores those of earlier runs. Without a run id
+ * there is no way to tell the runs apart, and the combined report is
+ * skipped.
+ *
+ * Example usage:
+ * @code
+ * mpirun -n 16 ./bin/extracttrunks archive.txt 8 --distributed /scratch/state
+ * @endcode
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+
+/**
+ * @brief Rank and rank count of this process; initializes MPI when built with it
+ *
+ * Construct one session at the start of main(), before any other thread is
+ * started, and keep it until the end (MPI is finalized by the destructor).
+ */
+class ShardSession {
+public:
+    /** @brief Starts MPI (if built in) or reads the rank from the environment */
+    ShardSession(int& argc, char**& argv);
+    ~ShardSession();
+
+    ShardSession(const ShardSession&) = delete;
+    ShardSession& operator=(const ShardSession&) = delete;
+
+    /** @brief Session with an explicit rank, for tests and single-process runs */
+    ShardSession(int rank, int size, std::string runId = {});
+
+    int rank() const { return myRank; }
+    int size() const { return ranks; }
+
+    /** @brief True if the ranks communicate through MPI */
+    bool usesMpi() const { return mpi; }
+
+    /**
+     * @brief Id shared by the ranks of this run (empty if the launcher gave none)
+     *
+     * NEURONMESHER_RUN_ID, SLURM_JOB_ID (with SLURM_STEP_ID) or PBS_JOBID.
+     * Only needed without MPI, to tell this run's statistics files from
+     * those of earlier runs in the same state folder.
+     */
+    const std::string& runId() const { return run; }
+
+    /** @brief Waits for every rank (no-op without MPI) */
+    void barrier() const;
+
+    /**
+     * @brief Element-wise sum of a vector over all ranks, result on every rank
+     * @note Without MPI the vector is left as it is
+     */
+    void sumAll(std::vector<std::uint64_t>& values) const;
+
+private:
+    int myRank = 0;
+    int ranks = 1;
+    bool mpi = false;
+    bool ownsMpi = false;
+    std::string run;
+};
+
+/**
+ * @brief Estimated node count of a morphology file, used as its cost
+ * @param[in] filename SWC, binary (.bin) or UGX file, possibly compressed (.gz/.zst)
+ * @return Data lines of an SWC file, the node count of a binary file, or
+ *         the file size over 40 bytes for other files (0 if unreadable)
+ */
+std::uint64_t estimateNodeCount(const std::string& filename);
+
+/**
+ * @brief Assigns inputs to shards, largest first onto the least loaded shard
+ * @param[in] costs Cost of every input
+ * @param[in] shards Number of shards
+ * @return Shard of every input
+ *
+ * Greedy longest-processing-time scheduling; ties go to the lower input
+ * index and the lower shard, so every rank computes the same assignment.
+ */
+std::vector<int> assignShards(const std::vector<std::uint64_t>& costs, int shards);
+
+/**
+ * @brief Record of the inputs a distributed run has finished
+ *
+ * Every rank appends to its own file (done_rank<k>.txt) in the state
+ * folder, one input per line, flushed per input. Loading reads the files of
+ * all ranks and ignores a last line that was cut off by a crash.
+ */
+class BatchCheckpoint {
+public:
+    /** @brief Opens the state folder, creating it if needed, and reads every rank's record */
+    BatchCheckpoint(const std::string& folder, int rank);
+
+    /** @brief True if a previous or the current run finished the input */
+    bool done(const std::string& input) const;
+
+    /** @brief Records a finished input; safe to call from several threads */
+    void markDone(const std::string& input);
+
+    /** @brief Inputs finished when the checkpoint was opened */
+    std::size_t previouslyDone() const { return loaded; }
+
+private:
+    std::string file;
+    std::set<std::string> finished;
+    std::size_t loaded = 0;
+    mutable std::mutex mutex;
+};
+
+/**
+ * @brief Outcome of one rank of a distributed run
+ */
+struct ShardStats {
+    int rank = 0;
+    std::uint64_t assigned = 0;    ///< Inputs sharded to this rank
+    std::uint64_t succeeded = 0;   ///< Inputs finished in this run
+    std::uint64_t failed = 0;      ///< Inputs whose job threw
+    std::uint64_t skipped = 0;     ///< Inputs left out because an earlier run finished them
+    std::uint64_t nodes = 0;       ///< Estimated nodes of the assigned inputs
+    double seconds = 0.0;          ///< Wall time of the rank's batch
+};
+
+/**
+ * @brief Runs this rank's share of a batch
+ * @param[in] inputs Every input of the data set, in the same order on every rank
+ * @param[in] job Per-input job, as for runBatch()
+ * @param[in] session Rank and rank count
+ * @param[in] stateFolder Shared folder for checkpoints and statistics
+ * @param[in] options Threads and in-flight limits within the rank
+ * @param[out] stats Statistics of this rank
+ * @return Results of the inputs processed by this rank
+ *
+ * Inputs are weighted with estimateNodeCount() and sharded with
+ * assignShards(); inputs recorded in the checkpoint are skipped. Every
+ * input that succeeds is added to the checkpoint.
+ */
+std::vector<BatchResult> runShardedBatch(const std::vector<std::string>& inputs, const BatchJob& job,
+                                         const ShardSession& session, const std::string& stateFolder,
+                                         const BatchOptions& options, ShardStats& stats);
+
+/**
+ * @brief Collects the statistics of all ranks on rank 0
+ * @param[in] local Statistics of this rank
+ * @param[in] session Rank, rank count and run id
+ * @param[in] stateFolder Shared folder for checkpoints and statistics
+ * @param[in] waitSeconds Without MPI, how long rank 0 waits for the other ranks' files
+ * @return Statistics sorted by rank on rank 0, empty on the other ranks.
+ *         With MPI every rank is included. Without MPI only ranks whose
+ *         stats_rank<k>.txt carries this run's id (read within
+ *         @p waitSeconds); without a run id only rank 0 itself.
+ *
+ * Every rank also writes its own statistics file into the state folder.
+ */
+std::vector<ShardStats> gatherShardStats(const ShardStats& local, const ShardSession& session,
+                                         const std::string& stateFolder, double waitSeconds = 0.0);
+
+/**
+ * @brief Prints one line per rank and the totals
+ * @param[in] stats Result of gatherShardStats()
+ * @param[out] out Stream to print to
+ * @param[in] ranks Ranks of the run; ranks missing from @p stats are named as such
+ * @return Number of failed inputs over the reported ranks
+ */
+std::uint64_t printShardReport(const std::vector<ShardStats>& stats, std::ostream& out = std::cout, int ranks = 0);
+
+/**
+ * @brief Complete distributed run of a driver
+ * @param[in] source Directory or manifest of inputs (see collectBatchInputs())
+ * @param[in] job Per-input job
+ * @param[in] session Rank and rank count
+ * @param[in] stateFolder Shared folder for checkpoints and statistics
+ * @param[in] options Threads and in-flight limits within the rank
+ * @return Process exit code: 0 if this rank's inputs all succeeded
+ */
+int runDistributedDriver(const std::string& source, const BatchJob& job, const ShardSession& session,
+                         const std::string& stateFolder, const BatchOptions& options);
+
+#endif // SHARD_H
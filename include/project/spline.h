@@ -0,0 +1,160 @@
+/**
+ * @file spline.h
+ * @brief Natural cubic spline through several channels that share one knot vector
+ *
+ * Resampling a trunk fits x, y, z and radius against the same arc-length
+ * parameter. The tridiagonal system of a natural spline only depends on the
+ * knots, so it is factored once here and every channel reuses the
+ * factorization. Coefficients are stored channel-interleaved per segment so
+ * the channel loops in fit() and evaluate() are contiguous.
+ *
+ * Queries are located with a moving cursor: sweeping k sorted query points
+ * over n knots costs O(n + k) instead of O(n k).
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef SPLINE_H
+#define SPLINE_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Natural cubic spline with @p Channels values per knot
+ * @tparam Channels Number of interpolated quantities (e.g. 4 for x, y, z, r)
+ *
+ * Example usage:
+ * @code
+ * NaturalCubicSpline<4> spline;
+ * spline.fit(arcLength, xyzr);              // xyzr holds n * 4 values
+ * std::vector<double> out(ts.size() * 4);
+ * spline.evaluate(ts, out.data());
+ * @endcode
+ */
+template <std::size_t Channels>
+class NaturalCubicSpline {
+public:
+    /**
+     * @brief Fits the spline
+     * @param[in] knots Strictly increasing parameter values (at least 2)
+     * @param[in] values Knot values, knots.size() * Channels entries, knot-major
+     */
+    void fit(const std::vector<double>& knots, const double* values) {
+        x = knots;
+        coeffs.clear();
+        if (x.size() < 2) return;
+        coeffs.resize((x.size() - 1) * 4 * Channels);
+        std::vector<double> scratch;
+        fitInto(x.data(), x.size(), values, coeffs.data(), scratch);
+    }
+
+    /**
+     * @brief Evaluates all channels at one parameter value
+     * @param[in] t Query parameter; values outside the knots are extrapolated
+     *              from the first or last segment
+     * @param[out] out Channels values
+     * @param[in,out] cursor Segment index to start searching from; updated to
+     *                the segment of @p t so nearby queries are found quickly
+     */
+    void evaluate(double t, double* out, std::size_t& cursor) const {
+        evaluateAt(x.data(), x.size(), coeffs.data(), t, out, cursor);
+    }
+
+    /**
+     * @brief Fits a spline into caller-owned storage
+     * @param[in] knots @p n strictly increasing parameter values (n >= 2)
+     * @param[in] n Number of knots
+     * @param[in] values n * Channels knot values, knot-major
+     * @param[out] coeffs (n - 1) * 4 * Channels coefficients, laid out as in fit()
+     * @param[in,out] scratch Work space; batched fits reuse one across many splines
+     *
+     * fit() and the batched trunk resampling (trunkbatch.h) share this body,
+     * so both give bit-identical coefficients.
+     */
+    static void fitInto(const double* knots, std::size_t n, const double* values, double* coeffs,
+                        std::vector<double>& scratch) {
+        const double* x = knots;
+        scratch.assign((n - 1) + 2 * n + 2 * n * Channels, 0.0);
+        double* h = scratch.data();
+        double* l = h + (n - 1);
+        double* mu = l + n;
+        double* z = mu + n;
+        double* c = z + n * Channels;
+
+        for (std::size_t i = 0; i < n - 1; ++i)
+            h[i] = x[i + 1] - x[i];
+
+        // Forward elimination: l and mu depend on the knots only
+        l[0] = 1; mu[0] = 0;
+        for (std::size_t i = 1; i < n - 1; ++i) {
+            l[i] = 2 * (x[i + 1] - x[i - 1]) - h[i - 1] * mu[i - 1];
+            mu[i] = h[i] / l[i];
+            const double* y = values + i * Channels;
+            for (std::size_t k = 0; k < Channels; ++k) {
+                double alpha = (3.0 / h[i]) * (y[k + Channels] - y[k]) - (3.0 / h[i - 1]) * (y[k] - y[k - Channels]);
+                z[i * Channels + k] = (alpha - h[i - 1] * z[(i - 1) * Channels + k]) / l[i];
+            }
+        }
+
+        // Back substitution and per-segment coefficients
+        for (std::size_t j = n - 1; j-- > 0;) {
+            const double* y = values + j * Channels;
+            double* seg = coeffs + j * 4 * Channels;
+            for (std::size_t k = 0; k < Channels; ++k) {
+                double cj = z[j * Channels + k] - mu[j] * c[(j + 1) * Channels + k];
+                double cn = c[(j + 1) * Channels + k];
+                c[j * Channels + k] = cj;
+                seg[k]                = y[k];
+                seg[Channels + k]     = (y[k + Channels] - y[k]) / h[j] - h[j] * (cn + 2 * cj) / 3.0;
+                seg[2 * Channels + k] = cj;
+                seg[3 * Channels + k] = (cn - cj) / (3.0 * h[j]);
+            }
+        }
+    }
+
+    /**
+     * @brief Evaluates a spline held in caller-owned storage (see fitInto())
+     * @param[in] knots @p n knots
+     * @param[in] n Number of knots (at least 2)
+     * @param[in] coeffs Coefficients written by fitInto()
+     * @param[in] t Query parameter
+     * @param[out] out Channels values
+     * @param[in,out] cursor Segment search start, as in evaluate()
+     */
+    static void evaluateAt(const double* knots, std::size_t n, const double* coeffs, double t, double* out,
+                           std::size_t& cursor) {
+        const double* x = knots;
+        const std::size_t last = n - 2;
+        std::size_t i = cursor < last ? cursor : last;
+        while (i > 0 && t <= x[i]) --i;
+        while (i < last && t > x[i + 1]) ++i;
+        cursor = i;
+
+        const double* seg = coeffs + i * 4 * Channels;
+        double dx = t - x[i];
+        for (std::size_t k = 0; k < Channels; ++k) {
+            out[k] = seg[k] + seg[Channels + k] * dx + seg[2 * Channels + k] * dx * dx +
+                     seg[3 * Channels + k] * dx * dx * dx;
+        }
+    }
+
+    /**
+     * @brief Evaluates all channels at a sequence of parameter values
+     * @param[in] ts Query parameters (sorted queries are swept in linear time)
+     * @param[out] out ts.size() * Channels values, query-major
+     */
+    void evaluate(const std::vector<double>& ts, double* out) const {
+        std::size_t cursor = 0;
+        for (std::size_t q = 0; q < ts.size(); ++q) evaluate(ts[q], out + q * Channels, cursor);
+    }
+
+private:
+    std::vector<double> x;
+    std::vector<double> coeffs;   ///< Per segment: a[Channels], b[Channels], c[Channels], d[Channels]
+};
+
+#endif // SPLINE_H
@@ -0,0 +1,89 @@
+/**
+ * @file synthetic.h
+ * @brief Reproducible random neuron trees for scaling and stress tests
+ *
+ * The bundled reconstructions have at most a few thousand nodes. The
+ * generator grows trees of any size from a seed so benchmarks and tests can
+ * sweep problem sizes up to whole-axon reconstructions of millions of nodes.
+ *
+ * Neurites grow from a set of active tips. Every step picks a tip, bends its
+ * direction by a random amount scaled by the tortuosity, and adds one node a
+ * fixed step further on. With the branch probability the new node becomes a
+ * branch point and starts branchingFactor - 1 more tips. Radii taper
+ * geometrically towards a minimum.
+ *
+ * The random numbers come from std::mt19937, whose output is fixed by the
+ * standard, and are mapped to doubles by hand, so the same options give the
+ * same tree with every compiler and standard library.
+ *
+ * Example usage:
+ * @code
+ * SyntheticMorphologyOptions options;
+ * options.nodes = 1000000;
+ * options.seed = 7;
+ * NeuronGraph g(generateMorphology(options));
+ * @endcode
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "neurongraph.h"
+
+/**
+ * @brief Soma shapes of a synthetic neuron
+ */
+enum class SyntheticSoma {
+    None,         ///< No soma; the root is the first node of a dendrite
+    Point,        ///< One soma node
+    ThreePoint,   ///< NeuroMorpho three-point soma (centre and two nodes one radius away)
+    Cylinder      ///< A chain of somaNodes soma nodes along x
+};
+
+/**
+ * @brief Parameters of generateMorphology()
+ */
+struct SyntheticMorphologyOptions {
+    int nodes = 10000;                       ///< Total node count, soma included
+    std::uint32_t seed = 1;                  ///< Random seed
+    double branchProbability = 0.02;         ///< Chance that a new node becomes a branch point
+    int branchingFactor = 2;                 ///< Children of a branch point (2 = bifurcations)
+    double tortuosity = 0.3;                 ///< Largest random change of direction per step (0 = straight)
+    double stepLength = 1.0;                 ///< Distance between consecutive neurite nodes
+    int stems = 4;                           ///< Neurites leaving the soma
+    SyntheticSoma soma = SyntheticSoma::Point;
+    int somaNodes = 5;                       ///< Nodes of a Cylinder soma
+    double somaRadius = 8.0;                 ///< Radius of the soma nodes
+    double stemRadius = 2.0;                 ///< Radius of the first node of every stem
+    double taper = 0.998;                    ///< Radius factor per step
+    double minRadius = 0.2;                  ///< Lower bound of neurite radii
+};
+
+/**
+ * @brief Generates a reproducible random neuron tree
+ * @param[in] options Size, branching, tortuosity and soma configuration
+ * @return Nodes with ids 1..options.nodes, every parent id smaller than its child's id
+ *
+ * Stems alternate between axon (type 2) and dendrite (type 3); soma nodes
+ * have type 1.
+ */
+std::map<int, SWCNode> generateMorphology(const SyntheticMorphologyOptions& options);
+
+/**
+ * @brief Parses a soma configuration name
+ * @param[in] name "none", "point", "three-point" or "cylinder"
+ * @return The soma shape
+ * @throws std::invalid_argument for any other name
+ */
+SyntheticSoma syntheticSomaFromString(const std::string& name);
+
+#endif // SYNTHETIC_H
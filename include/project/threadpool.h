@@ -0,0 +1,142 @@
+/**
+ * @file threadpool.h
+ * @brief Work-stealing thread pool used by the batch driver and parallel kernels
+ *
+ * Every worker owns a task deque. Tasks submitted from a worker thread go to
+ * that worker's deque and are taken back in LIFO order; idle workers steal
+ * the oldest task from another worker's deque. Tasks submitted from outside
+ * the pool are spread round-robin over the deques.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size pool of worker threads with per-worker task deques
+ *
+ * Example usage:
+ * @code
+ * ThreadPool pool(4);
+ * for (const auto& file : files)
+ *     pool.submit([file] { process(file); });
+ * pool.wait();
+ * @endcode
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the worker threads
+     * @param[in] threads Number of workers (0 = defaultThreadCount())
+     */
+    explicit ThreadPool(std::size_t threads = 0);
+
+    /** @brief Waits for all submitted tasks and joins the workers */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queues a task for execution
+     * @param[in] task Callable to run on one of the workers
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Blocks until every submitted task has finished
+     *
+     * If a task threw, the first exception is rethrown here (once).
+     */
+    void wait();
+
+    /**
+     * @brief Calls body(i) for every i in [0, count) on the workers and waits
+     * @tparam Body Callable taking a std::size_t index
+     * @param[in] count Number of indices
+     * @param[in] body Work for one index; must only write to state owned by that index
+     *
+     * Indices are handed out one at a time, so uneven work items balance
+     * across the workers. Must not be called from one of this pool's own
+     * tasks.
+     */
+    template <typename Body>
+    void parallelFor(std::size_t count, const Body& body) {
+        std::atomic<std::size_t> next{0};
+        const std::size_t tasks = std::min(count, size());
+        for (std::size_t t = 0; t < tasks; ++t) {
+            submit([&next, &body, count] {
+                for (std::size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) body(i);
+            });
+        }
+        wait();
+    }
+
+    /** @brief Number of worker threads */
+    std::size_t size() const { return workers.size(); }
+
+    /** @brief Hardware concurrency, or 1 if it cannot be determined */
+    static std::size_t defaultThreadCount();
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool takeTask(std::size_t self, std::function<void()>& task);
+    void workerLoop(std::size_t self);
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    std::size_t queued = 0;     ///< Tasks pushed but not yet taken
+    std::size_t pending = 0;    ///< Tasks submitted but not yet finished
+    bool stopping = false;
+    std::exception_ptr firstError;
+
+    std::atomic<std::size_t> nextQueue{0};
+};
+
+/**
+ * @brief Runs body(i) for every i in [0, count) using up to @p threads threads
+ * @tparam Body Callable taking a std::size_t index
+ * @param[in] count Number of indices
+ * @param[in] threads Thread count (0 = hardware concurrency, 1 = run inline)
+ * @param[in] body Work for one index
+ *
+ * With one thread (or one index) the loop runs on the calling thread in
+ * index order; otherwise a temporary ThreadPool is used.
+ */
+template <typename Body>
+void parallelFor(std::size_t count, std::size_t threads, const Body& body) {
+    if (threads == 0) threads = ThreadPool::defaultThreadCount();
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (std::size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+    ThreadPool pool(threads);
+    pool.parallelFor(count, body);
+}
+
+#endif // THREADPOOL_H
@@ -0,0 +1,136 @@
+/**
+ * @file topology.h
+ * @brief Derived topology indices of a Morphology, built once and shared
+ *
+ * Adjacency, branch points, soma rows and the trunk decomposition used to be
+ * recomputed by a full scan in every query. NeuronGraph now builds them
+ * lazily from its Morphology and keeps them until the morphology changes:
+ * each index records the Morphology::revision() it was built from, and a
+ * query on a newer revision rebuilds it. Chained operations on an unchanged
+ * graph therefore share a single build.
+ *
+ * All indices refer to dense Morphology rows, not SWC ids.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "morphology.h"
+
+struct SWCNode;
+
+/**
+ * @brief Undirected adjacency and node classes of a morphology
+ *
+ * Parent and child edges are only kept when both rows are stored, which is
+ * the same rule NeuronGraph::getNeighborMap() applies.
+ */
+struct TopologyIndex {
+    /** @brief Morphology revision this index was built from */
+    std::uint64_t revision = 0;
+
+    /** @brief CSR offsets into @c neighbors (rows + 1 entries) */
+    std::vector<int> neighborOffsets;
+
+    /** @brief Neighbour rows, listed in the order of NeuronGraph::getNeighborMap() */
+    std::vector<int> neighbors;
+
+    /** @brief Rows with more than two neighbours, in increasing order */
+    std::vector<int> branchPoints;
+
+    /** @brief Rows of type 1 (soma), in increasing order */
+    std::vector<int> somaRows;
+
+    /** @brief Number of neighbours of a row */
+    int degree(std::size_t row) const { return neighborOffsets[row + 1] - neighborOffsets[row]; }
+
+    /**
+     * @brief Builds the index in two linear passes over the rows
+     * @param[in] morph Morphology to index (its topology need not be built)
+     * @param[in] members If given, an edge is also only kept when the parent
+     *                    id is stored in @p members (the rule getNeighborMap()
+     *                    applies to node sets that are not the graph itself)
+     */
+    static TopologyIndex build(const Morphology& morph, const Morphology* members = nullptr);
+};
+
+/**
+ * @brief Trunks of a morphology as spans of rows
+ *
+ * Trunk @c t is the path rows[offsets[t]] .. rows[offsets[t+1]-1], running
+ * from the branch point it was discovered from. Trunks are numbered exactly
+ * as NeuronGraph::getTrunks() numbers them.
+ *
+ * The build does no per-trunk allocation: visits are kept in a bit vector,
+ * and the only trunks that could be found twice (two branch points joined
+ * by a single edge) are recognised from their endpoints.
+ */
+struct TrunkDecomposition {
+    /** @brief Morphology revision this decomposition was built from */
+    std::uint64_t revision = 0;
+
+    /** @brief Span offsets into @c rows (number of trunks + 1 entries) */
+    std::vector<int> offsets;
+
+    /** @brief Rows of every trunk, concatenated in path order */
+    std::vector<int> rows;
+
+    /** @brief Parent trunk of every trunk (-1 for root trunks), as getTrunkParentMap() */
+    std::vector<int> parentTrunk;
+
+    /** @brief Number of trunks */
+    std::size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    /**
+     * @brief Decomposes a morphology into trunks
+     * @param[in] morph Morphology the index was built from
+     * @param[in] index Adjacency of @p morph
+     */
+    static TrunkDecomposition build(const Morphology& morph, const TopologyIndex& index);
+};
+
+/**
+ * @brief Trunk nodes as spans of one contiguous node array
+ *
+ * Trunk @c t is nodes[offsets[t]] .. nodes[offsets[t+1]-1] in path order.
+ * This is the allocation-light form of the std::map based result of
+ * NeuronGraph::getTrunks().
+ */
+struct TrunkSpans {
+    /** @brief Nodes of every trunk, concatenated */
+    std::vector<SWCNode> nodes;
+
+    /** @brief Span offsets into @c nodes (number of trunks + 1 entries) */
+    std::vector<int> offsets;
+
+    /** @brief Parent trunk of every trunk (-1 for root trunks) */
+    std::vector<int> parentTrunk;
+
+    /** @brief Number of trunks */
+    std::size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    /** @brief Number of nodes of trunk @p t */
+    int length(std::size_t t) const { return offsets[t + 1] - offsets[t]; }
+
+    /** @brief First node of trunk @p t */
+    const SWCNode* begin(std::size_t t) const;
+
+    /**
+     * @brief Copies the nodes of a decomposition into spans
+     * @param[in] morph Morphology the decomposition refers to
+     * @param[in] trunks Row spans of the trunks
+     * @param[in] resetIndex Renumber every trunk 1..n along its path, as getTrunks() does
+     */
+    static TrunkSpans fromDecomposition(const Morphology& morph, const TrunkDecomposition& trunks, bool resetIndex);
+};
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,154 @@
+/**
+ * @file trunkbatch.h
+ * @brief Flat trunk batches: batched spline resampling and tube emission
+ *
+ * Resampling every trunk of a neuron and building a tube around each are
+ * many small independent numeric problems. A TrunkBatch stores all trunks
+ * in a few flat arrays (row offsets, interleaved x/y/z/radius, types), so
+ * the batched routines below work on contiguous memory with one prefix sum
+ * to place every trunk's output, instead of on a map per trunk:
+ *
+ * - resampleTrunkBatchCubic() solves the natural spline system of every
+ *   trunk and samples it, giving the same nodes as
+ *   NeuronGraph::cubicSplineResampleTrunk() on each trunk.
+ * - writeTubeBatch() emits the tube vertices and triangles of every trunk
+ *   straight into caller-owned arrays. The layout (float x/y/z per vertex,
+ *   three 32-bit indices per triangle) is that of an OpenGL vertex and index
+ *   buffer, so a renderer can pass mapped buffer memory and skip the copy
+ *   through a DenseUgxGeometry.
+ *
+ * Both parallelize across trunks and give the same result for any thread
+ * count.
+ *
+ * Example usage:
+ * @code
+ * TrunkBatch trunks = TrunkBatch::fromTrunks(graph.getTrunks(false));
+ * TrunkBatch resampled = resampleTrunkBatchCubic(trunks, 2.0, 0);
+ * TubeBatchLayout layout = tubeBatchLayout(resampled, 16);
+ * std::vector<float> vertices(3 * layout.vertices());
+ * std::vector<std::uint32_t> triangles(3 * layout.triangles());
+ * writeTubeBatch(resampled, 16, layout, vertices.data(), triangles.data(), 0);
+ * @endcode
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef TRUNKBATCH_H
+#define TRUNKBATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "neurongraph.h"
+#include "topology.h"
+
+/**
+ * @brief Trunks stored as one flat array of rows
+ *
+ * Trunk @c t is rows offsets[t] .. offsets[t+1]-1 in path order; row @c i
+ * holds x, y, z and radius at xyzr[4i .. 4i+3] and the node type at types[i].
+ */
+struct TrunkBatch {
+    std::vector<std::size_t> offsets{0};   ///< Row offsets (number of trunks + 1 entries)
+    std::vector<double> xyzr;              ///< x, y, z, radius of every row
+    std::vector<int> types;                ///< Node type of every row
+
+    /** @brief Number of trunks */
+    std::size_t size() const { return offsets.size() - 1; }
+
+    /** @brief Number of rows of all trunks */
+    std::size_t rows() const { return types.size(); }
+
+    /** @brief Number of rows of trunk @p t */
+    std::size_t length(std::size_t t) const { return offsets[t + 1] - offsets[t]; }
+
+    /** @brief Appends a trunk, its nodes in id order */
+    void append(const std::map<int, SWCNode>& trunk);
+
+    /** @brief Batch of the trunks of getTrunks(), in trunk id order */
+    static TrunkBatch fromTrunks(const std::map<int, std::map<int, SWCNode>>& trunks);
+
+    /** @brief Batch of trunk spans, in span order */
+    static TrunkBatch fromSpans(const TrunkSpans& spans);
+
+    /**
+     * @brief Trunk @p t as SWC nodes
+     * @return Nodes with ids 1..n, each the parent of the next
+     */
+    std::map<int, SWCNode> trunk(std::size_t t) const;
+};
+
+/**
+ * @brief Cubic spline resampling of every trunk of a batch
+ * @param[in] batch Trunks to resample
+ * @param[in] delta Target spacing
+ * @param[in] threads Threads (0 = all cores, 1 = serial)
+ * @return Resampled trunks, in the order of @p batch
+ *
+ * Trunk @c t of the result holds the nodes of sampleTrunkCubic() on trunk
+ * @c t, bit for bit; trunks with fewer than two rows stay empty. Sample
+ * counts are computed first and turned into row offsets with a prefix sum,
+ * then every trunk fits its spline and writes its samples into its own rows.
+ */
+TrunkBatch resampleTrunkBatchCubic(const TrunkBatch& batch, double delta, std::size_t threads = 1);
+
+/**
+ * @brief Position of every trunk's tube in the vertex and triangle arrays
+ */
+struct TubeBatchLayout {
+    std::vector<std::size_t> vertexOffsets{0};     ///< First vertex of every tube (trunks + 1 entries)
+    std::vector<std::size_t> triangleOffsets{0};   ///< First triangle of every tube (trunks + 1 entries)
+
+    /** @brief Vertices of all tubes */
+    std::size_t vertices() const { return vertexOffsets.back(); }
+
+    /** @brief Triangles of all tubes */
+    std::size_t triangles() const { return triangleOffsets.back(); }
+};
+
+/**
+ * @brief Sizes and offsets of the tubes of a batch
+ * @param[in] batch Trunks
+ * @param[in] segments Vertices per ring
+ * @return Offsets; a trunk of n >= 2 rows has n * segments vertices and
+ *         2 (n - 1) segments triangles, shorter trunks have none
+ */
+TubeBatchLayout tubeBatchLayout(const TrunkBatch& batch, int segments);
+
+/**
+ * @brief Writes the tubes of a batch into caller-owned buffers
+ * @param[in] batch Trunks
+ * @param[in] segments Vertices per ring
+ * @param[in] layout Result of tubeBatchLayout() for @p batch and @p segments
+ * @param[out] vertices 3 * layout.vertices() floats, x/y/z per vertex
+ * @param[out] triangles 3 * layout.triangles() vertex indices into @p vertices
+ * @param[in] threads Threads (0 = all cores, 1 = serial)
+ *
+ * Every tube has the rings and triangles of NeuronGraph::pftDenseFromPath()
+ * on its trunk, shifted to its offsets in the buffers.
+ */
+void writeTubeBatch(const TrunkBatch& batch, int segments, const TubeBatchLayout& layout, float* vertices,
+                    std::uint32_t* triangles, std::size_t threads = 1);
+
+/**
+ * @brief Tube vertex and index buffers of a batch
+ */
+struct TubeBuffers {
+    std::vector<float> vertices;           ///< x, y, z per vertex
+    std::vector<std::uint32_t> triangles;  ///< Three vertex indices per triangle
+};
+
+/**
+ * @brief Allocates the buffers and fills them with writeTubeBatch()
+ * @param[in] batch Trunks
+ * @param[in] segments Vertices per ring
+ * @param[in] threads Threads (0 = all cores, 1 = serial)
+ */
+TubeBuffers meshTubeBatch(const TrunkBatch& batch, int segments, std::size_t threads = 1);
+
+#endif // TRUNKBATCH_H
@@ -17,15 +17,27 @@
 #include <algorithm>
 #include <filesystem>
 
+#include "bincache.h"
+
 //#include "neurongraph.h"
 struct SWCNode;
 
-// 3D point representation
-struct Coordinates {
-    double x = 0.0;
-    double y = 0.0;
-    double z = 0.0;
+// 3D point representation; Coordinates (double) is used for computation and by the
+// map-based geometry, Coordinates32 halves the footprint of stored meshes
+template <typename Scalar>
+struct BasicCoordinates {
+    Scalar x = 0;
+    Scalar y = 0;
+    Scalar z = 0;
 };
+using Coordinates = BasicCoordinates<double>;
+using Coordinates32 = BasicCoordinates<float>;
+
+// the same point at another precision
+template <typename To, typename From>
+BasicCoordinates<To> convertCoordinates(const BasicCoordinates<From>& c) {
+    return {static_cast<To>(c.x), static_cast<To>(c.y), static_cast<To>(c.z)};
+}
 
 // Container for geometry data
 struct UgxGeometry {
@@ -40,6 +52,106 @@ struct UgxGeometry {
     std::map<int, double> radii;                // vertex index → radius
 };
 
+// Contiguous form of UgxGeometry: vertex i is points[i], and the subset of element i
+// is stored at index i (-1 = none). Subset members are bucketed once by subsetMembers(),
+// so readers, writers and meshers touch every element once instead of once per subset.
+// radii and the subset vectors are either empty or have one entry per element.
+//
+// Scalar is the storage type of points and radii. Meshers compute in double and
+// produce DenseUgxGeometry; convert<float>() gives a DenseUgxGeometry32 with half the
+// vertex memory (float keeps about 7 digits, sub-nanometre for a neuron a few mm wide).
+// Both precisions are instantiated in ugxobject.cpp.
+template <typename Scalar>
+struct BasicDenseUgxGeometry {
+    using Point = BasicCoordinates<Scalar>;
+
+    std::vector<Point> points;
+    std::vector<Scalar> radii;                  // vertex index → radius
+    std::vector<std::pair<int, int>> edges;
+    std::vector<std::array<int, 3>> faces;
+
+    std::vector<int> vertexSubsets;             // vertex index → subset ID
+    std::vector<int> edgeSubsets;               // edge index   → subset ID
+    std::vector<int> faceSubsets;               // face index   → subset ID
+    std::map<int, std::string> subsetNames;     // subset ID    → name
+
+    // increasing element indices of one subset
+    struct SubsetMembers {
+        std::vector<int> vertices, edges, faces;
+    };
+
+    // members of every named subset, in the order of subsetNames (one pass over the elements)
+    std::vector<SubsetMembers> subsetMembers() const;
+
+    // append another dense geometry, shifting its indices by the current vertex, edge
+    // and face counts (subset names already present are kept)
+    void append(const BasicDenseUgxGeometry& part);
+
+    // append many parts in one pass: offsets are prefix sums over the parts and each
+    // part is copied into its own pre-sized range on up to `threads` threads (0 = all cores)
+    void appendAll(const std::vector<BasicDenseUgxGeometry>& parts, std::size_t threads = 1);
+
+    // mesh compaction before writing: vertices closer than `tolerance` are welded onto the
+    // first of them (spatial hash), faces that collapse or repeat are dropped, and the
+    // edges become the unique edges of the old edge list and of the faces. Subsets,
+    // radii and subset names follow the kept elements; returns old -> new vertex index
+    std::vector<int> compact(double tolerance = 1e-9);
+
+    // map keys become indices: gaps in the vertex keys are filled with zero points,
+    // missing radii with 0 and missing subsets with -1; entries beyond the last
+    // vertex, edge or face are dropped
+    static BasicDenseUgxGeometry fromGeometry(const UgxGeometry& geometry);
+    UgxGeometry toGeometry() const;
+
+    // the same mesh with points and radii stored as To
+    template <typename To>
+    BasicDenseUgxGeometry<To> convert() const {
+        BasicDenseUgxGeometry<To> other;
+        other.points.reserve(points.size());
+        for (const Point& p : points) other.points.push_back(convertCoordinates<To>(p));
+        other.radii.assign(radii.begin(), radii.end());
+        other.edges = edges;
+        other.faces = faces;
+        other.vertexSubsets = vertexSubsets;
+        other.edgeSubsets = edgeSubsets;
+        other.faceSubsets = faceSubsets;
+        other.subsetNames = subsetNames;
+        return other;
+    }
+};
+using DenseUgxGeometry = BasicDenseUgxGeometry<double>;
+using DenseUgxGeometry32 = BasicDenseUgxGeometry<float>;
+
+// Accumulates many geometries into one without re-copying what is already merged.
+// append() remaps the part's vertex, edge and face indices by the current offsets
+// exactly like UgxObject::addUGXGeometry, but works in place: merging T parts
+// costs O(total size) instead of O(T^2) copies.
+class UgxGeometryBuilder {
+public:
+    UgxGeometryBuilder() = default;
+    explicit UgxGeometryBuilder(UgxGeometry base);   // start from an existing geometry
+
+    // reserve edge and face capacity for parts that are about to be appended
+    void reserve(std::size_t edges, std::size_t faces);
+
+    // append one part (subset names already present are kept)
+    void append(const UgxGeometry& part);
+
+    // append many parts in one pass; offsets are prefix sums over the parts and the
+    // edge/face remapping runs on up to `threads` threads (0 = all cores)
+    void appendAll(const std::vector<UgxGeometry>& parts, std::size_t threads = 1);
+
+    const UgxGeometry& geometry() const {return g;}
+    UgxGeometry release();                           // move the result out and reset
+
+private:
+    static int vertexSpan(const UgxGeometry& part);
+    void appendMaps(const UgxGeometry& part, int vertexOffset, int edgeOffset, int faceOffset);
+
+    UgxGeometry g;
+    int nextVertex = 0;   // vertex offset of the next part (max vertex index + 1)
+};
+
 
 // Main object to manage UGX geometry
 class UgxObject {
@@ -57,6 +169,21 @@ public:
 	// write ugx file
 	void writeUGX(const std::string& filename) const;
 
+	// read/write ugx file with the streaming backend (no tinyxml2 DOM, same result)
+	void readUGXStream(const std::string& filename);
+	void writeUGXStream(const std::string& filename) const;
+
+	// read/write the binary cache format (see bincache.h); Float32 stores points and
+	// radii in single precision, readBIN() accepts both
+	void readBIN(const std::string& filename);
+	void writeBIN(const std::string& filename, StoragePrecision precision = StoragePrecision::Float64) const;
+
+	// read/write ugx files straight from/to dense geometry with the selected backend
+	// (writeUGX() output for geometries with vertex keys 0..n-1)
+	static DenseUgxGeometry readDenseUGX(const std::string& filename);
+	static void writeDenseUGX(const DenseUgxGeometry& geometry, const std::string& filename);
+	static void writeDenseUGX(const DenseUgxGeometry32& geometry, const std::string& filename);
+
     // convert swc data (std::map<int,SWCNode>) to ugx geometry type
     const UgxGeometry convertToUGX(const std::map<int,SWCNode>& nodeSet);
 
@@ -65,12 +192,14 @@ public:
 
 	// getter functions
     const UgxGeometry& getGeometry() const {return ugxg;}
+    DenseUgxGeometry getDenseGeometry() const {return DenseUgxGeometry::fromGeometry(ugxg);}
 	const std::map<int,Coordinates>& getPoints() const {return ugxg.points;}
     const std::vector<std::pair<int, int>>& getEdges() const {return ugxg.edges;}
     const std::vector<std::array<int, 3>>& getFaces() const {return ugxg.faces;}
 
     // setter functions
     void setGeometry(const UgxGeometry& ugxinput){this->ugxg = ugxinput;};
+    void setGeometry(UgxGeometry&& ugxinput){this->ugxg = std::move(ugxinput);};
 
 	// printing functions
 	void printCoordinates() const;
@@ -0,0 +1,317 @@
+/**
+ * @file ugxstream.h
+ * @brief Streaming (non-DOM) reading and writing of UGX files
+ *
+ * This header provides a lightweight alternative to building a full tinyxml2
+ * document for UGX files. Reading uses a pull parser that walks a
+ * memory-mapped file and hands out element text as views into the mapping;
+ * writing uses a chunked writer that formats numbers with std::to_chars into
+ * a fixed-size buffer. The writer reproduces the layout of tinyxml2's
+ * XMLPrinter exactly, so files written through either backend are
+ * byte-identical.
+ *
+ * NeuronGraph and UgxObject use the DOM backend unless the streaming backend
+ * is selected with setUgxBackend(), or their *Stream methods are called
+ * directly.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#ifndef UGXSTREAM_H
+#define UGXSTREAM_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <deque>
+
+#include "compression.h"
+#include "mappedfile.h"
+
+/**
+ * @brief Selects how NeuronGraph and UgxObject read and write UGX files
+ */
+enum class UgxBackend {
+    DOM,        ///< Build a tinyxml2 document (default)
+    Streaming   ///< Use UgxPullParser / UgxStreamWriter
+};
+
+/**
+ * @brief Sets the backend used by readFromFileUGX(), writeToFileUGX(),
+ *        UgxObject::readUGX() and UgxObject::writeUGX()
+ * @param[in] backend The backend to use from now on
+ */
+void setUgxBackend(UgxBackend backend);
+
+/**
+ * @brief Returns the currently selected UGX backend
+ * @return The active backend (UgxBackend::DOM unless changed)
+ */
+UgxBackend getUgxBackend();
+
+/**
+ * @brief True if @p filename is read and written by the streaming backend
+ * @return true if the streaming backend is selected, or if the name is
+ *         compressed (.gz, .zst), which only the streaming backend handles
+ */
+bool useUgxStreaming(const std::string& filename);
+
+/**
+ * @brief Scans whitespace-separated numbers from a text view
+ *
+ * Behaves like repeated stream extraction (`stream >> value`): leading
+ * whitespace is skipped, an optional '+' is accepted, and scanning stops at
+ * the first token that is not a number.
+ */
+class UgxTextScanner {
+public:
+    /** @brief Creates a scanner over @p text */
+    explicit UgxTextScanner(std::string_view text)
+        : cur(text.data()), end(text.data() + text.size()) {}
+
+    /**
+     * @brief Reads the next number
+     * @tparam T Arithmetic type to parse
+     * @param[out] value Parsed value
+     * @return true if a value was read, false at the end or on a bad token
+     */
+    template <typename T>
+    bool next(T& value) {
+        while (cur < end && isBlank(*cur)) ++cur;
+        const char* p = cur;
+        if (p < end && *p == '+') ++p;
+        auto [ptr, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc()) {
+            cur = end;
+            return false;
+        }
+        cur = ptr;
+        return true;
+    }
+
+    /** @brief True if only whitespace is left */
+    bool done() {
+        while (cur < end && isBlank(*cur)) ++cur;
+        return cur >= end;
+    }
+
+    /** @brief True for the characters std::istream treats as whitespace */
+    static bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+private:
+    const char* cur;
+    const char* end;
+};
+
+/**
+ * @brief Forward-only XML pull parser for UGX documents
+ *
+ * The parser walks an in-memory document (typically a MappedFile) and
+ * reports start tags, end tags and text one event at a time, so no tree is
+ * ever built. Names and text are returned as views: text without entity
+ * references points straight into the input, text with entities is
+ * decoded into an internal buffer that stays valid until the next call to
+ * next().
+ *
+ * Whitespace-only text between tags is not reported, matching tinyxml2.
+ * Comments, processing instructions and DOCTYPE declarations are skipped.
+ * Self-closing elements produce a StartElement followed by an EndElement.
+ */
+class UgxPullParser {
+public:
+    /** @brief Kind of event returned by next() */
+    enum class Event {
+        StartElement,   ///< An opening tag; name() and attribute() are valid
+        EndElement,     ///< A closing tag; name() is valid
+        Text,           ///< Character data; text() is valid
+        End,            ///< End of the document
+        Error           ///< Malformed input; errorMessage() describes it
+    };
+
+    /**
+     * @brief Creates a parser over a complete XML document
+     * @param[in] document Document bytes; must outlive the parser
+     */
+    explicit UgxPullParser(std::string_view document);
+
+    /**
+     * @brief Advances to the next event
+     * @return The event that was reached
+     */
+    Event next();
+
+    /** @brief Element name of the current start or end tag */
+    std::string_view name() const { return elementName; }
+
+    /** @brief Character data of the current text event */
+    std::string_view text() const { return textView; }
+
+    /**
+     * @brief Looks up an attribute of the current start tag
+     * @param[in] attrName Attribute name
+     * @param[out] value Decoded attribute value
+     * @return true if the attribute exists
+     */
+    bool attribute(std::string_view attrName, std::string_view& value) const;
+
+    /**
+     * @brief Nesting depth of the current event
+     *
+     * The document element has depth 0 and its children depth 1. For text
+     * events the depth is that of the enclosing element.
+     */
+    int depth() const { return currentDepth; }
+
+    /** @brief Description of the last error */
+    const std::string& errorMessage() const { return error; }
+
+private:
+    Event fail(const std::string& message);
+    bool decode(std::string_view raw, std::string& out);
+    bool skipMarkup();
+
+    const char* cur;
+    const char* end;
+
+    std::string_view elementName;
+    std::string_view textView;
+    std::vector<std::pair<std::string_view, std::string_view>> attributes;
+
+    /** @brief Storage for decoded text and attribute values (stable addresses) */
+    std::deque<std::string> decoded;
+
+    std::vector<std::string_view> openElements;
+    int currentDepth = -1;
+    bool pendingEnd = false;
+    std::string error;
+};
+
+/**
+ * @brief Buffered XML writer producing tinyxml2 XMLPrinter formatted output
+ *
+ * Elements are written as soon as they are opened, and text content can be
+ * emitted value by value with number(), so large coordinate, index and
+ * attachment lists never need to be materialised as strings. Output is
+ * collected in a fixed-size buffer and flushed to disk in chunks, through a
+ * CompressedFileWriter, so a `.ugx.gz` or `.ugx.zst` name compresses the
+ * chunks as they are flushed.
+ *
+ * Example usage:
+ * @code
+ * UgxStreamWriter w;
+ * w.open("mesh.ugx");
+ * w.declaration(R"(xml version="1.0" encoding="utf-8")");
+ * w.openElement("grid");
+ * w.attribute("name", "defGrid");
+ * w.openElement("vertices");
+ * w.beginText();
+ * w.number(1.0); w.number(2.0); w.number(3.0);
+ * w.closeElement();
+ * w.closeElement();
+ * bool ok = w.close();
+ * @endcode
+ */
+class UgxStreamWriter {
+public:
+    /**
+     * @brief Creates a writer
+     * @param[in] bufferSize Size of the output buffer in bytes
+     */
+    explicit UgxStreamWriter(std::size_t bufferSize = 1 << 16);
+
+    /** @brief Flushes and closes the file if still open */
+    ~UgxStreamWriter();
+
+    UgxStreamWriter(const UgxStreamWriter&) = delete;
+    UgxStreamWriter& operator=(const UgxStreamWriter&) = delete;
+
+    /**
+     * @brief Opens the output file
+     * @param[in] filename Path of the file to create; .gz and .zst names are compressed
+     * @return true if the file could be created
+     */
+    bool open(const std::string& filename);
+
+    /**
+     * @brief Flushes remaining output and closes the file
+     * @return true if every write succeeded
+     */
+    bool close();
+
+    /** @brief Writes an XML declaration such as `xml version="1.0"` */
+    void declaration(std::string_view text);
+
+    /** @brief Opens a new element as a child of the current one */
+    void openElement(std::string_view name);
+
+    /** @brief Adds an attribute to the element that was just opened */
+    void attribute(std::string_view name, std::string_view value);
+
+    /**
+     * @brief Starts the text content of the current element
+     *
+     * Equivalent to XMLElement::SetText(""): the element is written with an
+     * opening and closing tag on one line even if no values follow.
+     */
+    void beginText();
+
+    /** @brief Appends escaped character data to the current text */
+    void text(std::string_view value);
+
+    /** @brief Appends a space-separated integer to the current text */
+    void number(long long value);
+
+    /** @brief Appends a space-separated, escaped token to the current text */
+    void token(std::string_view value);
+
+    /** @brief Appends an int to the current text */
+    void number(int value) { number(static_cast<long long>(value)); }
+
+    /** @brief Appends an unsigned index to the current text */
+    void number(std::size_t value) { number(static_cast<long long>(value)); }
+
+    /**
+     * @brief Appends a space-separated floating point value to the current text
+     *
+     * Formatted like `std::ostream << value` with the default precision of 6.
+     */
+    void number(double value);
+
+    /** @brief Closes the most recently opened element */
+    void closeElement();
+
+private:
+    void put(char c) {
+        if (used == buffer.size()) flush();
+        buffer[used++] = c;
+    }
+    void write(std::string_view s);
+    void writeEscaped(std::string_view s, bool attributeValue);
+    void flush();
+    void space(int depth);
+    void sealElement();
+    void separator();
+
+    std::vector<char> buffer;
+    std::size_t used = 0;
+    CompressedFileWriter file;
+    bool ok = true;
+
+    std::vector<std::string> stack;
+    int depth = 0;
+    int textDepth = -1;
+    bool elementJustOpened = false;
+    bool firstElement = true;
+    bool textHasValues = false;
+};
+
+#endif // UGXSTREAM_H
@@ -83,3 +83,12 @@ void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
  * @param yoffset The scroll offset along the y-axis (positive = scroll up, negative = scroll down)
  */
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+
+/**
+ * @brief Swaps finished background refinement into the displayed neuron
+ * 
+ * Must be called once per frame on the thread owning the GL context.
+ * 
+ * @param window The main GLFW window
+ */
+void pollRefinement(GLFWwindow* window);
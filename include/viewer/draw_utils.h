@@ -103,3 +103,13 @@ void setColorByType(int type);
  */
 void renderSWC(const std::vector<SWCNode>& nodes);
 
+
+/**
+ * @brief Prepares a neuron morphology for retained-mode rendering
+ * @param nodes Vector of SWC nodes that renderSWC() will draw
+ * 
+ * Computes the parent index and segment vertex array once and discards the
+ * display lists compiled for the previous morphology. Call it whenever the
+ * rendered node vector is replaced (loading or refining a neuron).
+ */
+void uploadSWC(const std::vector<SWCNode>& nodes);
@@ -21,6 +21,7 @@
 
 // Forward declarations
 class NeuronGraph;
+class RefinementService;
 struct SWCNode;
 
 /// @name Rendering State
@@ -90,4 +91,7 @@ extern GLFWwindow* helpWindow;
 /// @brief The main neuron graph data structure
 extern NeuronGraph graph;
 
+/// @brief Background worker serving the F / Ctrl+F refinement requests
+extern RefinementService refinementService;
+
 ///@}
@@ -0,0 +1,99 @@
+/**
+ * @file refinement_service.h
+ * @brief Background refinement of the displayed neuron for the viewer
+ *
+ * Refining a large neuron takes seconds, which must not happen on the GLFW
+ * event thread. RefinementService keeps a RefinementHierarchy of the loaded
+ * neuron on a worker thread, resamples it at requested spacings, and caches
+ * every finished level so returning to an earlier spacing is immediate.
+ * The render loop collects finished geometry with poll().
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#pragma once
+#include <atomic>              // For std::atomic
+#include <condition_variable>  // For std::condition_variable
+#include <cstdint>             // For std::uint64_t
+#include <map>                 // For std::map
+#include <memory>              // For std::shared_ptr
+#include <mutex>               // For std::mutex
+#include <thread>              // For std::thread
+#include <vector>              // For std::vector
+
+// Forward declarations
+struct SWCNode;
+
+/**
+ * @brief Worker thread that refines the loaded neuron on request
+ *
+ * Only the most recent request is ever shown: a request made while another is
+ * running cancels it. The worker checks for a newer request between trunks,
+ * drops the partial level and starts on the new spacing right away. A new
+ * source neuron discards the cache and cancels any level still being
+ * computed for the previous one.
+ *
+ * Example usage:
+ * @code
+ * service.setSource(nodes);
+ * service.request(4.0);              // from the key callback
+ * if (service.poll(nodes, delta))    // once per frame
+ *     uploadSWC(nodes);
+ * @endcode
+ */
+class RefinementService {
+public:
+    RefinementService() = default;
+
+    /** @brief Stops and joins the worker thread */
+    ~RefinementService();
+
+    RefinementService(const RefinementService&) = delete;
+    RefinementService& operator=(const RefinementService&) = delete;
+
+    /**
+     * @brief Sets the neuron that later requests refine
+     * @param nodes Nodes of the newly loaded neuron
+     */
+    void setSource(const std::vector<SWCNode>& nodes);
+
+    /**
+     * @brief Asks for the source neuron resampled at @p delta
+     * @param delta Target spacing
+     *
+     * A cached spacing is delivered by the next poll() without recomputation.
+     */
+    void request(double delta);
+
+    /**
+     * @brief Takes the geometry of the latest request if it is finished
+     * @param[out] nodes Replaced by the refined nodes
+     * @param[out] delta Spacing of the delivered geometry
+     * @return true if @p nodes was replaced
+     */
+    bool poll(std::vector<SWCNode>& nodes, double& delta);
+
+private:
+    using Level = std::shared_ptr<const std::vector<SWCNode>>;
+
+    void workerLoop();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool stopping = false;
+
+    std::shared_ptr<const std::vector<SWCNode>> source;  ///< Neuron being refined
+    std::atomic<std::uint64_t> sourceVersion{0};         ///< Bumped by setSource(); read unlocked by the cancel check
+    std::map<double, Level> cache;                       ///< Finished levels of the current source
+
+    bool hasRequest = false;          ///< A request is waiting for the worker
+    double requestedDelta = 0.0;      ///< Spacing of the latest request
+    std::atomic<std::uint64_t> requestId{0};  ///< Id of the latest request; read unlocked by the cancel check
+
+    Level ready;                      ///< Finished geometry of the latest request
+    double readyDelta = 0.0;
+};
@@ -0,0 +1,118 @@
+/**
+ * @file scene_culling.h
+ * @brief Trunk chunks, a bounding volume hierarchy and level-of-detail selection for the viewer
+ *
+ * A neuron is split into render chunks, one per trunk (see NeuronGraph::getTrunks()),
+ * with long trunks cut into runs of at most kMaxChunkNodes nodes. Each chunk
+ * carries its bounding box and largest node radius. On every frame the chunk
+ * BVH is tested against the view frustum and each visible chunk is assigned a
+ * level of detail from the projected size of its nodes.
+ *
+ * Matrices are OpenGL column-major arrays as returned by glGetDoublev().
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#pragma once
+#include <array>   // For std::array
+#include <vector>  // For std::vector
+
+// Forward declarations
+struct SWCNode;
+
+/// @brief Largest number of nodes in one render chunk
+constexpr int kMaxChunkNodes = 256;
+
+/// @brief Level of detail of a chunk
+enum ChunkLOD {
+    LOD_FULL = 0,    ///< Spheres and cylinders at full tessellation
+    LOD_COARSE = 1,  ///< Coarser spheres and cylinders
+    LOD_LINES = 2,   ///< Lines (or points for sphere-only modes)
+    LOD_COUNT = 3
+};
+
+/**
+ * @brief A group of nodes drawn together
+ *
+ * Every node belongs to exactly one chunk; the segment to a node's parent is
+ * drawn by the chunk of the node.
+ */
+struct RenderChunk {
+    std::vector<int> nodes;                ///< Indices into the node vector
+    std::array<double, 3> min{}, max{};    ///< Bounds of the nodes and their parent segments
+    double maxRadius = 0.0;                ///< Largest node radius in the chunk
+};
+
+/**
+ * @brief The six clipping planes of a view
+ */
+struct Frustum {
+    std::array<std::array<double, 4>, 6> planes{};  ///< a*x + b*y + c*z + d >= 0 inside
+
+    /**
+     * @brief Extracts the planes of projection * modelview
+     * @param modelview Column-major modelview matrix
+     * @param projection Column-major projection matrix
+     */
+    static Frustum fromMatrices(const double* modelview, const double* projection);
+
+    /**
+     * @brief Conservative box test
+     * @return false only if the box lies completely outside one plane
+     */
+    bool intersects(const std::array<double, 3>& min, const std::array<double, 3>& max) const;
+};
+
+/**
+ * @brief Splits a neuron into render chunks along its trunks
+ * @param nodes Nodes in render order
+ * @param parentIndex Index of each node's parent in @p nodes, -1 if none
+ * @return Chunks covering every node exactly once
+ */
+std::vector<RenderChunk> buildRenderChunks(const std::vector<SWCNode>& nodes, const std::vector<int>& parentIndex);
+
+/**
+ * @brief Bounding volume hierarchy over render chunks
+ *
+ * Built by median splits along the longest axis of the chunk centers.
+ */
+class ChunkBVH {
+public:
+    /**
+     * @brief Builds the hierarchy
+     * @param chunks Chunks to index; must outlive queries
+     */
+    void build(const std::vector<RenderChunk>& chunks);
+
+    /**
+     * @brief Collects the chunks whose bounds intersect the frustum
+     * @param frustum View frustum
+     * @param visible Receives chunk indices (cleared first)
+     */
+    void query(const Frustum& frustum, std::vector<int>& visible) const;
+
+private:
+    struct Node {
+        std::array<double, 3> min, max;
+        int left = -1, right = -1;  ///< Child nodes, -1 for leaves
+        int first = 0, count = 0;   ///< Range in order for leaves
+    };
+
+    int buildRange(const std::vector<RenderChunk>& chunks, int first, int count);
+
+    std::vector<Node> tree;
+    std::vector<int> order;
+};
+
+/**
+ * @brief Picks the level of detail of a chunk from the projected node radius
+ * @param chunk Chunk to draw
+ * @param modelview Column-major modelview matrix
+ * @param projection Column-major projection matrix
+ * @param viewportHeight Viewport height in pixels
+ * @return LOD_FULL, LOD_COARSE or LOD_LINES
+ */
+ChunkLOD selectLOD(const RenderChunk& chunk, const double* modelview, const double* projection, int viewportHeight);
@@ -34,6 +34,8 @@ Notes:
 import pytest
 import os
 import inspect
+import shutil
+import numpy as np
 from rich import print
 from rich.table import Table
 import python_package.neurongraph as ng
@@ -565,4 +567,316 @@ def test_generate_refinements_linear(graph):
     refinements = graph.generateRefinements(before, delta, N, method)
     for _, after in refinements.items():
         print(f"\n[blue] TEST {fn}:[/] [yellow] before:[/] {len(before)}, [yellow] after:[/] {len(after)}")
-        assert len(after) >= len(before)
\ No newline at end of file
+        assert len(after) >= len(before)
+
+def test_numpy_columns(graph):
+    """
+    Test the NumPy accessors of the node columns.
+
+    Verifies that the column arrays, the coordinate array and the structured
+    node array describe the same nodes as getNodes(), in id order, and that
+    the arrays stay valid after the graph's nodes are replaced.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    nodes = graph.getNodes()
+    ids, radii, xyz = graph.ids(), graph.radii(), graph.coordinates()
+    records = graph.nodeArray()
+    print(f"\n[blue] TEST {fn}:[/] [yellow] rows:[/] {len(ids)}, [yellow] coords:[/] {xyz.shape}")
+    assert list(ids) == sorted(nodes.keys())
+    assert xyz.shape == (len(nodes), 3)
+    first = nodes[int(ids[0])]
+    assert records[0]["id"] == first.id and xyz[0][0] == first.x and radii[0] == first.radius
+    assert (graph.parentIndices() >= -1).all()
+    before = radii.copy()
+    graph.setNodes({})
+    assert (radii == before).all()
+    graph.setNodes(nodes)
+
+def test_numpy_trunks_and_pft(graph):
+    """
+    Test the array based trunk, resampling and PFT functions.
+
+    Checks that trunkArrays() splits the same trunks as getTrunks(), that a
+    trunk resampled from arrays stays an N x 3 path, and that pftFromArrays()
+    returns triangle faces indexing its vertices.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    trunks = graph.trunkArrays(False)
+    assert len(trunks["parentTrunk"]) == len(graph.getTrunks(False))
+    first = trunks["nodes"][trunks["offsets"][0]:trunks["offsets"][1]]
+    xyz = first[["x", "y", "z"]].tolist()
+
+    coords, radii = graph.resampleTrunkArrays(xyz, first["radius"].tolist(), delta, "cubic")
+    assert coords.shape[1] == 3 and len(radii) == coords.shape[0]
+
+    mesh = graph.pftFromArrays(coords, radii, 8)
+    print(f"\n[blue] TEST {fn}:[/] [yellow] vertices:[/] {mesh['vertices'].shape}, [yellow] faces:[/] {mesh['faces'].shape}")
+    assert mesh["faces"].shape[1] == 3
+    assert mesh["faces"].max() < len(mesh["vertices"])
+
+def test_batch_entry_points(graph, tmp_path):
+    """
+    Test the batch functions of the module.
+
+    Converts the test neuron and a copy of it under a second name in one
+    batch_swc2ugx() call, checks that an input whose output name is taken
+    fails instead of overwriting it, loads the results back with
+    batch_load(), and refines two node sets with batch_generate_refinements().
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+        tmp_path: pytest's per-test temporary directory.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    outdir = str(tmp_path / "batch")
+    path = get_test_data_path("neuron.swc")
+    copy = str(tmp_path / "neuron_copy.swc")
+    shutil.copyfile(path, copy)
+    results = ng.batch_swc2ugx([path, copy, path], outdir, 2)
+    print(f"\n[blue] TEST {fn}:[/] [yellow] results:[/] {results}")
+    assert [r.input for r in results] == [path, copy, path]
+    assert results[0].ok and results[1].ok
+    assert not results[2].ok and "already written" in results[2].error
+
+    outputs = [outdir + "/neuron.ugx", outdir + "/neuron_copy.ugx"]
+    graphs = ng.batch_load(outputs, 2)
+    for loaded in graphs:
+        assert loaded.numberOfNodes() == graph.numberOfNodes()
+
+    nodes = graph.getNodes()
+    levels = ng.batch_generate_refinements([nodes, nodes], 12.0, 2, "linear", 2)
+    assert len(levels) == 2 and len(levels[0]) == len(levels[1])
+
+def test_spatial_queries(graph):
+    """
+    Test the BVH based spatial queries.
+
+    Every node is its own nearest node at distance zero, a radius around a
+    node finds it, a radius spanning the neuron finds every node, and rays
+    report the first segment they hit or -1 on a miss. Repeated queries,
+    served by the index built on first use, return the same rows.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    xyz = graph.coordinates()
+    rows, dist = graph.nearestNodes(xyz[:20], 2)
+    print(f"\n[blue] TEST {fn}:[/] [yellow] rows:[/] {rows[:5]}, [yellow] distances:[/] {dist[:5]}")
+    assert rows.shape == (20,) and dist.shape == (20,)
+    assert (dist == 0).all()
+    assert (xyz[rows] == xyz[:20]).all()
+    again, _ = graph.nearestNodes(xyz[:20], 1)
+    assert (again == rows).all()
+
+    x, y, z = (float(c) for c in xyz[5])
+    assert 5 in graph.nodesWithin(x, y, z, 1e-9)
+    assert len(graph.nodesWithin(x, y, z, 1e9)) == graph.numberOfNodes()
+
+    row, distance = graph.pickNode((x - 1000.0, y, z), (1.0, 0.0, 0.0))
+    assert row >= 0 and 0.0 <= distance <= 1000.0
+    row, distance = graph.pickNode((float(xyz[:, 0].max()) + 100.0, y, z), (1.0, 0.0, 0.0))
+    assert row == -1 and distance == float("inf")
+
+def test_mesh_surface(graph):
+    """
+    Test the whole-neuron surface mesh.
+
+    Checks the shapes and index ranges of the returned arrays, that the
+    mesh encloses every node of the test neuron, and that meshing on two
+    threads returns the same arrays as meshing serially.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    mesh = graph.meshSurface(8)
+    vertices, faces, edges, radii = mesh["vertices"], mesh["faces"], mesh["edges"], mesh["radii"]
+    print(f"\n[blue] TEST {fn}:[/] [yellow] vertices:[/] {vertices.shape}, [yellow] faces:[/] {faces.shape}")
+    assert vertices.shape[1] == 3 and vertices.dtype == np.float64
+    assert radii.shape == (len(vertices),)
+    assert faces.shape[1] == 3 and edges.shape[1] == 2
+    assert faces.min() >= 0 and faces.max() < len(vertices)
+    assert edges.min() >= 0 and edges.max() < len(vertices)
+
+    xyz = graph.coordinates()
+    assert (vertices.min(axis=0) <= xyz.min(axis=0)).all()
+    assert (vertices.max(axis=0) >= xyz.max(axis=0)).all()
+
+    parallel = graph.meshSurface(8, threads=2)
+    assert np.array_equal(parallel["vertices"], vertices)
+    assert np.array_equal(parallel["faces"], faces)
+
+def test_cached_results(graph, tmp_path):
+    """
+    Test the result cache bindings.
+
+    The first call of cached_generate_refinements() and cached_mesh_surface()
+    computes the same arrays as the graph methods and stores them; the
+    second call is a cache hit and returns identical arrays.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+        tmp_path: pytest's per-test temporary directory.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    path = get_test_data_path("neuron.swc")
+    cache = str(tmp_path / "cache")
+    ng.set_metrics_enabled(True)
+    ng.reset_metrics()
+
+    levels = ng.cached_generate_refinements(path, 12.0, 2, "linear", cache)
+    direct = graph.generateRefinementArrays(12.0, 2, "linear")
+    assert len(levels) == 2
+    assert all(np.array_equal(a, b) for a, b in zip(levels, direct))
+    cached = ng.cached_generate_refinements(path, 12.0, 2, "linear", cache)
+    assert all(np.array_equal(a, b) for a, b in zip(levels, cached))
+
+    mesh = ng.cached_mesh_surface(path, cache, 8)
+    assert np.array_equal(mesh["vertices"], graph.meshSurface(8)["vertices"])
+    again = ng.cached_mesh_surface(path, cache, 8)
+    for name in ("vertices", "radii", "edges", "faces"):
+        assert np.array_equal(again[name], mesh[name])
+
+    counters = ng.metrics()["counters"]
+    ng.set_metrics_enabled(False)
+    print(f"\n[blue] TEST {fn}:[/] [yellow] levels:[/] {[len(level) for level in levels]}, [yellow] counters:[/] {counters}")
+    assert counters.get("cache.hits") == 2
+    assert counters.get("cache.stores") == 2
+
+def test_generate_morphology():
+    """
+    Test the synthetic morphology generator.
+
+    A generated tree has the requested size and ids, the same seed gives
+    the same nodes and another seed different ones, and without tortuosity
+    and branching every neurite is a chain of unit steps.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    nodes = ng.generate_morphology(nodes=1000, seed=3, soma="three-point")
+    print(f"\n[blue] TEST {fn}:[/] [yellow] nodes:[/] {len(nodes)}")
+    assert sorted(nodes.keys()) == list(range(1, 1001))
+    assert [nodes[i].type for i in (1, 2, 3)] == [1, 1, 1]
+    assert all(n.pid == -1 or 1 <= n.pid < n.id for n in nodes.values())
+
+    key = lambda ns: [(n.pid, n.type, n.x, n.y, n.z, n.radius) for n in ns.values()]
+    assert key(ng.generate_morphology(nodes=1000, seed=3, soma="three-point")) == key(nodes)
+    assert key(ng.generate_morphology(nodes=1000, seed=4, soma="three-point")) != key(nodes)
+    assert ng.NeuronGraph(nodes).numberOfNodes() == 1000
+
+    straight = ng.generate_morphology(nodes=401, branch_probability=0.0, tortuosity=0.0)
+    for n in straight.values():
+        if n.pid > 1:
+            p = straight[n.pid]
+            assert ((n.x - p.x) ** 2 + (n.y - p.y) ** 2 + (n.z - p.z) ** 2) ** 0.5 == pytest.approx(1.0)
+    with pytest.raises(ValueError):
+        ng.generate_morphology(nodes=10, soma="sphere")
+
+def test_storage_precision(graph, tmp_path):
+    """
+    Test single precision storage of binary files and mesh arrays.
+
+    A Float32 binary file is smaller than a Float64 one and reads back the
+    test neuron to single precision; meshSurface() with Float32 precision
+    returns float32 vertices matching the double precision mesh.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+        tmp_path: pytest's per-test temporary directory.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    path64, path32 = str(tmp_path / "neuron64.bin"), str(tmp_path / "neuron32.bin")
+    graph.writeToFileBIN(path64)
+    graph.writeToFileBIN(path32, ng.StoragePrecision.Float32)
+    size64, size32 = os.path.getsize(path64), os.path.getsize(path32)
+    print(f"\n[blue] TEST {fn}:[/] [yellow] Float64:[/] {size64} bytes, [yellow] Float32:[/] {size32} bytes")
+    assert size32 < size64
+
+    single = ng.NeuronGraph()
+    single.readFromFileBIN(path32)
+    assert single.numberOfNodes() == graph.numberOfNodes()
+    assert (single.ids() == graph.ids()).all()
+    assert (single.coordinates() == graph.coordinates().astype(np.float32)).all()
+
+    mesh64 = graph.meshSurface(8)
+    mesh32 = graph.meshSurface(8, precision=ng.StoragePrecision.Float32)
+    assert mesh32["vertices"].dtype == np.float32 and mesh32["radii"].dtype == np.float32
+    assert np.array_equal(mesh32["faces"], mesh64["faces"])
+    assert np.array_equal(mesh32["vertices"], mesh64["vertices"].astype(np.float32))
+
+def test_trunk_tube_buffers(graph):
+    """
+    Test the render buffers of the trunk tubes.
+
+    Every trunk of n >= 2 nodes contributes n rings of segments vertices
+    and 2 (n - 1) segments triangles; the buffers are float32 and uint32
+    and do not depend on the thread count.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    segments = 8
+    buffers = graph.trunkTubeBuffers(segments)
+    vertices, triangles = buffers["vertices"], buffers["triangles"]
+    print(f"\n[blue] TEST {fn}:[/] [yellow] vertices:[/] {vertices.shape}, [yellow] triangles:[/] {triangles.shape}")
+    assert vertices.dtype == np.float32 and triangles.dtype == np.uint32
+    assert vertices.shape[1] == 3 and triangles.shape[1] == 3
+
+    offsets = graph.trunkArrays(False)["offsets"]
+    lengths = [n for n in np.diff(offsets) if n >= 2]
+    assert len(vertices) == sum(n * segments for n in lengths)
+    assert len(triangles) == sum(2 * (n - 1) * segments for n in lengths)
+    assert triangles.max() < len(vertices)
+
+    parallel = graph.trunkTubeBuffers(segments, threads=2)
+    assert np.array_equal(parallel["vertices"], vertices)
+    assert np.array_equal(parallel["triangles"], triangles)
+
+def test_morphometrics(graph):
+    """
+    Test the native morphometrics against values computed from getNodes().
+
+    Per-node segment lengths, the total length, and the tip, branch point
+    and stem counts of the test neuron are recomputed in Python; the
+    result must not depend on the thread count.
+
+    Args:
+        graph: A fixture providing a neuron graph object.
+    """
+    fn = inspect.currentframe().f_code.co_name
+    m = graph.morphometrics(10.0)
+    nodes = graph.getNodes()
+    n = len(nodes)
+    print(f"\n[blue] TEST {fn}:[/] [yellow] total length:[/] {m['totalLength']}, [yellow] tips:[/] {m['tips']}")
+    for name in ("segmentLength", "pathDistance", "branchOrder"):
+        assert m[name].shape == (n,)
+    assert m["sectionOffsets"][-1] == n and len(m["sectionRows"]) == n
+    assert len(m["shollRadii"]) == len(m["shollIntersections"])
+
+    lengths = []
+    children = {}
+    for node in nodes.values():
+        parent = nodes.get(node.pid)
+        lengths.append(0.0 if parent is None else
+                       ((node.x - parent.x) ** 2 + (node.y - parent.y) ** 2 + (node.z - parent.z) ** 2) ** 0.5)
+        children[node.pid] = children.get(node.pid, 0) + 1
+    assert np.allclose(m["segmentLength"], lengths)
+    assert m["totalLength"] == pytest.approx(sum(lengths))
+    assert m["lengthByType"].sum() == pytest.approx(sum(lengths))
+
+    neurites = [node for node in nodes.values() if node.type != 1]
+    assert m["tips"] == sum(1 for node in neurites if children.get(node.id, 0) == 0)
+    assert m["branchPoints"] == sum(1 for node in neurites if children.get(node.id, 0) >= 2)
+    assert m["stems"] == sum(1 for node in neurites if node.pid in nodes and nodes[node.pid].type == 1)
+
+    parallel = graph.morphometrics(10.0, 2)
+    assert parallel["totalLength"] == m["totalLength"]
+    assert np.array_equal(parallel["pathDistance"], m["pathDistance"])
+    assert np.array_equal(parallel["shollIntersections"], m["shollIntersections"])
@@ -18,6 +18,7 @@
 #include "callbacks.h"
 #include "opgl_utils.h"
 #include "globals.h"
+#include "refinement_service.h"
 
 #include "renderhelpwindow.cpp"
 
@@ -52,6 +53,7 @@ int main(int argc, char** argv) {
     static std::vector<SWCNode> nodes = loadSWC(argv[1]);
     currentLoadedFile = argv[1];
     currentNodes = nodes;
+    refinementService.setSource(nodes);
 
     static double minX, maxX, minY, maxY, minZ, maxZ, centerX, centerY, centerZ, radius;
     computeBounds(nodes, minX, maxX, minY, maxY, minZ, maxZ, centerX, centerY, centerZ, radius);
@@ -85,11 +87,13 @@ int main(int argc, char** argv) {
     glEnable(GL_NORMALIZE);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     setupLighting();
+    uploadSWC(nodes);
 
     while (!glfwWindowShouldClose(window)) {
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         glViewport(0, 0, width, height);
+        pollRefinement(window);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         setupCamera(centerX, centerY, centerZ, radius, width, height);
@@ -1,34 +1,18 @@
 #include "neurongraph.h"
+#include "resultcache.h"
 #include "ugxobject.h"
 #include "utils.h"
+#include "batch.h"
+#include "shard.h"
+#include "compression.h"
 #include <chrono>
+#include <filesystem>
 #include <functional> // for std::hash
 #include <sstream>
+#include <stdexcept>
 
-int main(int argc, char* argv[]){
-
-    if (argc < 2 ) {
-        std::cerr << "Usage: " << argv[0] << " <input.swc>\n";
-        return 1;
-    }
-
-    std::cout << "Hello user!" << std::endl;
-
-    // example of declaring the variable
-    NeuronGraph graph;
-
-    // example of reading a file
-    graph.readFromFile(argv[1]);
-    auto nodes = graph.removeSomaSegment();
-    graph.setNodes(nodes);
-
-    std::cout << "Neuron has " << graph.numberOfNodes() << " nodes\n";
-    std::cout << "Neuron has " << graph.numberOfEdges() << " edges\n";
-
-    bool resetIndex = true;
-    auto trunks = graph.getTrunks(resetIndex);  
-    
-    std::string filename = argv[1];
+// base name of the input file, or a timestamp-based name if it is not an .swc file
+static std::string outputBaseName(const std::string& filename){
     size_t pos = filename.rfind(".swc");  // Finds the last occurrence of ".swc"
 
     std::string base ="";
@@ -38,7 +22,7 @@ int main(int argc, char* argv[]){
         std::cout << "Base name: " << base << std::endl;
     } else {
         std::cout << "No .swc extension found." << std::endl;
-        
+
         // Generate a timestamp-based hash
         auto now = std::chrono::system_clock::now().time_since_epoch().count();
         std::size_t hash = std::hash<long long>{}(now);
@@ -47,54 +31,115 @@ int main(int argc, char* argv[]){
         oss << "neuron_" << std::hex << hash;
         base = oss.str();
     }
+    return base;
+}
+
+// read -> remove soma segment -> extract trunks -> resample and mesh each trunk
+// pftFolder is where the per-trunk geometries go; empty means <base>_pft_geometries
+static void extractNeuronTrunks(const std::string& filename, std::string pftFolder){
+    // example of declaring the variable
+    NeuronGraph graph;
+
+    // example of reading a file
+    graph.readFromFile(filename);
+    if (graph.numberOfNodes() == 0) {
+        throw std::runtime_error("no nodes read from " + filename);
+    }
+    auto nodes = graph.removeSomaSegment();
+    graph.setNodes(nodes);
+
+    std::cout << "Neuron has " << graph.numberOfNodes() << " nodes\n";
+    std::cout << "Neuron has " << graph.numberOfEdges() << " edges\n";
+
+    bool resetIndex = true;
+    auto trunks = graph.getTrunks(resetIndex);
+
+    std::string base = outputBaseName(filename);
 
     std::string execDir = getExecutableDir();
     std::string outputfolder = execDir + "/../output/" + base + "_trunks";
     checkFolder(outputfolder);
 
     for(auto& [id,trunk] : trunks){
-        graph.writeToFile(trunk,outputfolder + "/trunk_"+std::to_string(id)+".swc");
+        graph.writeToFile(trunk,outputfolder + "/trunk_"+std::to_string(id)+".swc"+outputCompressionSuffix());
     }
 
-    std::string inputtrunk = outputfolder + "/trunk_4.swc";
     NeuronGraph atrunk;
-    outputfolder = execDir + "/../output/main_pft_geometries";
+    if (pftFolder.empty()) pftFolder = base + "_pft_geometries";
+    outputfolder = execDir + "/../output/" + pftFolder;
     checkFolder(outputfolder);
     double delta = 0.75;
 
-    UgxGeometry combined;
-    UgxObject tempObj;
+    DenseUgxGeometry combined;
 
+    // tubes are compacted before writing: shared ring edges are stored once and
+    // coincident vertices (where trunks meet with matching rings) are welded
     for(auto& [id, path] : trunks){
         path = atrunk.cubicSplineResampleTrunk(path,delta);
-        auto pft = atrunk.pftFromPath(path,16);
-        combined = tempObj.addUGXGeometry(combined,pft.getGeometry()); 
-        pft.writeUGX(outputfolder+"/pft_"+std::to_string(id)+".ugx");
+        auto pft = NeuronGraph::pftDenseFromPath(path,16);
+        combined.append(pft);
+        pft.compact();
+        UgxObject::writeDenseUGX(pft, outputfolder+"/pft_"+std::to_string(id)+".ugx"+outputCompressionSuffix());
+    }
+
+    combined.compact();
+    UgxObject::writeDenseUGX(combined, outputfolder+"/ugxcombinedtest.ugx"+outputCompressionSuffix());
+
+    // whole neuron in one piece: trunk tubes and branch point junctions welded together,
+    // cached by the file contents and the mesh parameters
+    SurfaceMeshOptions options;
+    options.delta = delta;
+    ResultCache cache = ResultCache::fromEnvironment();
+    std::string key = ResultCache::key(ResultCache::hashFile(filename), "removeSomaSegment+meshSurface",
+                                       {double(options.segments), options.insetFactor, double(options.bezierPoints),
+                                        options.delta, double(options.capTips)});
+    DenseUgxGeometry surface;
+    if (!cache.loadGeometry(key, surface)) {
+        surface = graph.meshSurface(options);
+        cache.storeGeometry(key, surface);
+    }
+    UgxObject::writeDenseUGX(surface, outputfolder+"/surface.ugx"+outputCompressionSuffix());
+}
+
+int main(int argc, char* argv[]){
+
+    if (argc < 2 ) {
+        std::cerr << "Usage: " << argv[0] << " <input.swc | directory | manifest.txt> [threads]"
+                  << " [--distributed <state-folder>]\n";
+        return 1;
     }
 
-    //UgxObject g1(outputfolder+"/pft_"+std::to_string(1)+".ugx");
-    //UgxObject g2(outputfolder+"/pft_"+std::to_string(2)+".ugx");
-    //auto combined = g1.addUGXGeometry(g1.getGeometry(),g2.getGeometry());
+    std::cout << "Hello user!" << std::endl;
+
+    // a directory or a manifest of files runs in batch mode
+    std::string input = argv[1];
+    if (!std::filesystem::is_directory(input) && std::filesystem::path(input).extension() != ".txt") {
+        try {
+            extractNeuronTrunks(input, "main_pft_geometries");
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
-    tempObj.setGeometry(combined);
-    tempObj.writeUGX(outputfolder+"/ugxcombinedtest.ugx");
+    BatchOptions options;
+    std::string stateFolder;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--distributed" && i + 1 < argc) stateFolder = argv[++i];
+        else options.threads = std::stoul(arg);
+    }
 
-    /*
-    UgxGeometry combinedBezierObj;
-    UgxObject tempBezierObj;
+    // each neuron gets its own geometry folder so jobs do not overwrite each other
+    auto job = [](const std::string& file) { extractNeuronTrunks(file, ""); };
 
-    std::string inputBezier = execDir +  "/../output/test_bezier_subgraphs";
-    const auto fileNames = listFilesInDirectory(inputBezier);
-    for(auto f : fileNames)
-    {
-        NeuronGraph bezierPath(f);
-        auto pft = bezierPath.pftFromPath(bezierPath.getNodes(), 16);
-        combinedBezierObj = tempBezierObj.addUGXGeometry(combinedBezierObj,pft.getGeometry());    
+    // one shard of the data set per process, resumable from the state folder
+    if (!stateFolder.empty()) {
+        ShardSession session(argc, argv);
+        return runDistributedDriver(input, job, session, stateFolder, options);
     }
 
-    outputfolder = execDir + "/../output";
-    tempBezierObj.setGeometry(combinedBezierObj);
-    tempBezierObj.writeUGX(outputfolder+"/branchBezierCombined.ugx");
-*/
-    return 0;
+    auto results = runBatch(collectBatchInputs(input), job, options);
+    return printBatchReport(results) == 0 ? 0 : 1;
 }
@@ -0,0 +1,47 @@
+#include "neurongraph.h"
+#include "synthetic.h"
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// writes a reproducible random neuron; the extension of the output picks the format
+int main(int argc, char* argv[]){
+
+    if (argc < 2 ) {
+        std::cerr << "Usage: " << argv[0] << " <output.swc | output.ugx | output.bin>"
+                  << " [--nodes N] [--seed S] [--branching B] [--branch-probability P]"
+                  << " [--tortuosity T] [--stems K] [--soma none|point|three-point|cylinder]\n";
+        return 1;
+    }
+
+    std::string output = argv[1];
+    SyntheticMorphologyOptions options;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string flag = argv[i];
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for " + flag);
+            std::string value = argv[++i];
+            if (flag == "--nodes") options.nodes = std::stoi(value);
+            else if (flag == "--seed") options.seed = static_cast<std::uint32_t>(std::stoul(value));
+            else if (flag == "--branching") options.branchingFactor = std::stoi(value);
+            else if (flag == "--branch-probability") options.branchProbability = std::stod(value);
+            else if (flag == "--tortuosity") options.tortuosity = std::stod(value);
+            else if (flag == "--stems") options.stems = std::stoi(value);
+            else if (flag == "--soma") options.soma = syntheticSomaFromString(value);
+            else throw std::invalid_argument("unknown option " + flag);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    NeuronGraph graph(generateMorphology(options));
+    std::cout << "Generated " << graph.numberOfNodes() << " nodes (seed " << options.seed << ")\n";
+
+    std::string extension = std::filesystem::path(output).extension().string();
+    if (extension == ".ugx") graph.writeToFileUGX(output);
+    else if (extension == ".bin") graph.writeToFileBIN(output);
+    else graph.writeToFile(output);
+    return 0;
+}
@@ -1,27 +1,56 @@
 #include "neurongraph.h"
+#include "asyncio.h"
 #include "utils.h"
+#include <filesystem>
+#include <future>
+#include <memory>
 
 int main(int argc, char* argv[]){
 
     if (argc < 2 ) {
-        std::cerr << "Usage: " << argv[0] << " <input.swc>\n";
+        std::cerr << "Usage: " << argv[0] << " <input.swc> [more.swc ...]\n";
         return 1;
     }
 
     std::cout << "Hello user!" << std::endl;
 
-    // example of declaring the variable
-    NeuronGraph graph;
-
-    // example of reading a file
-    graph.readFromFile(argv[1]);
-    std::cout << "Neuron has " << graph.numberOfNodes() << " nodes\n";
-    std::cout << "Neuron has " << graph.numberOfEdges() << " edges\n";
-
-    // example of writing to a file
     std::string execDir = getExecutableDir();
     std::string outputfolder = execDir + "/../output/main_output/";
-    graph.writeToFile(graph.getNodes(),outputfolder+"examplewrite.swc");    
-    
-    return 0;
+    std::vector<std::string> inputs(argv + 1, argv + argc);
+
+    // example of reading files: the next file is read while the current one is handled
+    ReadAhead<NeuronGraph> reader(inputs, [](const std::string& filename) {
+        NeuronGraph graph;
+        graph.readFromFile(filename);
+        return graph;
+    });
+
+    // example of writing files: an I/O thread writes while the next file is handled
+    IoService writer(1, 2);
+    std::vector<std::future<void>> writes;
+
+    while (!reader.done()) {
+        std::string input = reader.nextInput();
+        NeuronGraph graph = reader.next();
+        std::cout << "Neuron has " << graph.numberOfNodes() << " nodes\n";
+        std::cout << "Neuron has " << graph.numberOfEdges() << " edges\n";
+
+        std::string name = inputs.size() == 1 ? "examplewrite.swc"
+                                              : std::filesystem::path(input).stem().string() + "_write.swc";
+        auto nodes = std::make_shared<const std::map<int, SWCNode>>(graph.getNodes());
+        writes.push_back(writer.submit([nodes, path = outputfolder + name] {
+            NeuronGraph().writeToFile(*nodes, path);
+        }));
+    }
+
+    int status = 0;
+    for (auto& w : writes) {
+        try {
+            w.get();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            status = 1;
+        }
+    }
+    return status;
 }
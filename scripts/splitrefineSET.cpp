@@ -1,34 +1,21 @@
 #include "neurongraph.h"
+#include "asyncio.h"
+#include "resultcache.h"
 #include "utils.h"
+#include "batch.h"
+#include "shard.h"
+#include "compression.h"
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
 #include <functional> // for std::hash
+#include <future>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 
-int main(int argc, char* argv[]){
-
-    if (argc < 2 ) {
-        std::cerr << "Usage: " << argv[0] << " <input.swc>\n";
-        return 1;
-    }
-
-    std::cout << "Hello user!" << std::endl;
-
-    // example of declaring the variable
-    NeuronGraph graph;
-
-    // example of reading a file
-    graph.readFromFile(argv[1]);
-    auto nodes = graph.removeSomaSegment();
-    graph.setNodes(nodes);
-
-    std::cout << "Neuron has " << graph.numberOfNodes() << " nodes\n";
-    std::cout << "Neuron has " << graph.numberOfEdges() << " edges\n";
-
-    // refine the geometry
-    int N = 6;
-    auto splitset = graph.splitEdgesN(N);
-    
-    std::string filename = argv[1];
+// base name of the input file, or a timestamp-based name if it is not an .swc file
+static std::string outputBaseName(const std::string& filename){
     size_t pos = filename.rfind(".swc");  // Finds the last occurrence of ".swc"
 
     std::string base ="";
@@ -38,7 +25,7 @@ int main(int argc, char* argv[]){
         std::cout << "Base name: " << base << std::endl;
     } else {
         std::cout << "No .swc extension found." << std::endl;
-        
+
         // Generate a timestamp-based hash
         auto now = std::chrono::system_clock::now().time_since_epoch().count();
         std::size_t hash = std::hash<long long>{}(now);
@@ -47,16 +34,116 @@ int main(int argc, char* argv[]){
         oss << "neuron_" << std::hex << hash;
         base = oss.str();
     }
+    return base;
+}
+
+// read -> remove soma segment -> refine -> write for a single neuron
+// the levels are cached by the file contents, so a repeated run only writes them;
+// every level is written on an I/O thread while the next one is computed
+static void refineNeuron(const std::string& filename){
+    int N = 6;
+    std::string base = outputBaseName(filename);
 
     std::string execDir = getExecutableDir();
     std::string outputfolder = execDir + "/../output/" + base + "_refinements";
     checkFolder(outputfolder);
 
-    int i = 1;
-    for(auto& refinement : splitset){
-        graph.writeToFile(refinement, outputfolder +"/refinement_"+std::to_string(i)+".swc");
-        graph.writeToFileUGX(refinement, outputfolder +"/refinement_"+std::to_string(i)+".ugx");
-        i++;
+    // the writes share a copy of the level, the splitter moves on to the next one
+    using Level = std::shared_ptr<const std::map<int, SWCNode>>;
+    auto writeLevel = [outputfolder](int i, const Level& refinement, const std::string& cacheFolder){
+        NeuronGraph writer;
+        writer.writeToFile(*refinement, outputfolder +"/refinement_"+std::to_string(i+1)+".swc"+outputCompressionSuffix());
+        writer.writeToFileUGX(*refinement, outputfolder +"/refinement_"+std::to_string(i+1)+".ugx"+outputCompressionSuffix());
+        if (!cacheFolder.empty()) writer.writeToFileBIN(*refinement, ResultCache::levelPath(cacheFolder, i));
+    };
+    // waits for every write; get() rethrows the first failure
+    auto finish = [](std::vector<std::future<void>>& writes){
+        for (auto& w : writes) w.get();
+    };
+
+    ResultCache cache = ResultCache::fromEnvironment();
+    std::string key = ResultCache::key(ResultCache::hashFile(filename), "removeSomaSegment+splitEdgesN", {double(N)});
+    std::map<int, std::map<int, SWCNode>> cached;
+    if (cache.loadLevels(key, cached)) {
+        std::cout << "Refinements of " << filename << " found in the cache\n";
+        IoService io(1, 4);
+        std::vector<std::future<void>> writes;
+        for (auto& [i, refinement] : cached) {
+            Level level = std::make_shared<const std::map<int, SWCNode>>(std::move(refinement));
+            writes.push_back(io.submit([=] { writeLevel(i, level, ""); }));
+        }
+        finish(writes);
+        return;
     }
-    return 0;
+
+    // example of declaring the variable
+    NeuronGraph graph;
+
+    // example of reading a file
+    graph.readFromFile(filename);
+    if (graph.numberOfNodes() == 0) {
+        throw std::runtime_error("no nodes read from " + filename);
+    }
+    auto nodes = graph.removeSomaSegment();
+    graph.setNodes(nodes);
+
+    std::cout << "Neuron has " << graph.numberOfNodes() << " nodes\n";
+    std::cout << "Neuron has " << graph.numberOfEdges() << " edges\n";
+
+    // refine the geometry, handing each level (and its cache copy) to the writer as soon
+    // as it is produced; the entry is committed once all of its levels are on disk
+    auto entry = cache.prepare(key);
+    std::vector<std::future<void>> writes;
+    int levels = 0;
+    {
+        IoService io(1, 4);   // destroyed before the entry, so no write outlives its folder
+        graph.splitEdgesN(graph.getNodes(), N, [&](int i, const std::map<int, SWCNode>& refinement){
+            Level level = std::make_shared<const std::map<int, SWCNode>>(refinement);
+            std::string cacheFolder = entry.folder();
+            writes.push_back(io.submit([=] { writeLevel(i, level, cacheFolder); }));
+            levels = std::max(levels, i + 1);
+        });
+        finish(writes);
+    }
+    if (!entry.folder().empty() && levels > 0 && ResultCache::writeLevelCount(entry.folder(), levels)) entry.commit();
+}
+
+int main(int argc, char* argv[]){
+
+    if (argc < 2 ) {
+        std::cerr << "Usage: " << argv[0] << " <input.swc | directory | manifest.txt> [threads]"
+                  << " [--distributed <state-folder>]\n";
+        return 1;
+    }
+
+    std::cout << "Hello user!" << std::endl;
+
+    // a directory or a manifest of files runs in batch mode
+    std::string input = argv[1];
+    if (!std::filesystem::is_directory(input) && std::filesystem::path(input).extension() != ".txt") {
+        try {
+            refineNeuron(input);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    BatchOptions options;
+    std::string stateFolder;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--distributed" && i + 1 < argc) stateFolder = argv[++i];
+        else options.threads = std::stoul(arg);
+    }
+
+    // one shard of the data set per process, resumable from the state folder
+    if (!stateFolder.empty()) {
+        ShardSession session(argc, argv);
+        return runDistributedDriver(input, refineNeuron, session, stateFolder, options);
+    }
+
+    auto results = runBatch(collectBatchInputs(input), refineNeuron, options);
+    return printBatchReport(results) == 0 ? 0 : 1;
 }
@@ -24,6 +24,7 @@ void printHelpText() {
 }
 
 int renderMode = 1;
+int sceneVersion = 0; // bumped whenever the rendered nodes are replaced
 
 float rotateX = 0.0f, rotateY = 0.0f, zoom = 1.0f;
 float panX = 0.0f, panY = 0.0f;
@@ -85,6 +86,7 @@ void openNeuronFile(std::vector<SWCNode>& nodes, float& minX, float& maxX, float
     if (file) {
         std::cout << "Loading: " << file << "\n";
         nodes = loadSWC(file);
+        ++sceneVersion;
         computeBounds(nodes, minX, maxX, minY, maxY, minZ, maxZ, centerX, centerY, centerZ, radius);
     }
 }
@@ -101,12 +103,20 @@ void setColorByType(int type) {
         glColor3f(1.0f, 1.0f, 1.0f);
 }
 
+// one quadric for every primitive instead of one per primitive per frame
+GLUquadric* sharedQuadric() {
+    static GLUquadric* quad = [] {
+        GLUquadric* q = gluNewQuadric();
+        gluQuadricNormals(q, GLU_SMOOTH);
+        return q;
+    }();
+    return quad;
+}
+
 void drawSimpleSphere(const SWCNode& node, float size = 0.5f) {
     glPushMatrix();
     glTranslatef(node.x, node.y, node.z);
-    GLUquadric* quad = gluNewQuadric();
-    gluSphere(quad, size, 8, 8);
-    gluDeleteQuadric(quad);
+    gluSphere(sharedQuadric(), size, 8, 8);
     glPopMatrix();
 }
 
@@ -120,10 +130,7 @@ void drawSimpleLine(const SWCNode& a, const SWCNode& b) {
 void drawSphere(const SWCNode& node, int slices = 6, int stacks = 6) {
     glPushMatrix();
     glTranslatef(node.x, node.y, node.z);
-    GLUquadric* quad = gluNewQuadric();
-    gluQuadricNormals(quad, GLU_SMOOTH);
-    gluSphere(quad, node.radius, slices, stacks);
-    gluDeleteQuadric(quad);
+    gluSphere(sharedQuadric(), node.radius, slices, stacks);
     glPopMatrix();
 }
 
@@ -140,10 +147,7 @@ void drawCylinder(const SWCNode& a, const SWCNode& b, int segments = 6) {
     glTranslatef(a.x, a.y, a.z);
     glRotatef(ax, rx, ry, 0.0f);
 
-    GLUquadric* quad = gluNewQuadric();
-    gluQuadricNormals(quad, GLU_SMOOTH);
-    gluCylinder(quad, a.radius, b.radius, len, segments, 1);
-    gluDeleteQuadric(quad);
+    gluCylinder(sharedQuadric(), a.radius, b.radius, len, segments, 1);
 
     glPopMatrix();
 }
@@ -166,32 +170,67 @@ void drawBoundingBox(float minX, float maxX, float minY, float maxY, float minZ,
     glEnd();
 }
 
-void renderSWC(const std::vector<SWCNode>& nodes) {
+void drawMode(int mode, const std::vector<SWCNode>& nodes, const std::vector<int>& parentIndex) {
     for (const auto& node : nodes) {
-        if (renderMode == 3) {
+        if (mode == 3) {
             glColor3f(1, 0.8f, 0);
             drawSimpleSphere(node);
-        } else if (renderMode == 4) {
+        } else if (mode == 4) {
             glColor3f(0.6f, 0.4f, 1.0f);
             drawSphere(node);
-        } else if (renderMode == 2 || renderMode == 6) {
+        } else if (mode == 2 || mode == 6) {
             setColorByType(node.type);
             drawSphere(node);
         }
     }
-    for (const auto& node : nodes) {
-        if (node.parent == -1) continue;
-        auto it = std::find_if(nodes.begin(), nodes.end(), [&](const SWCNode& n) { return n.id == node.parent; });
-        if (it != nodes.end()) {
-            if (renderMode == 1 || renderMode == 2) {
-                glColor3f(1, 1, 1);
-                drawSimpleLine(*it, node);
-            } else if (renderMode == 5 || renderMode == 6) {
-                setColorByType(node.type);
-                drawCylinder(*it, node);
-            }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (parentIndex[i] < 0) continue;
+        const SWCNode& parent = nodes[parentIndex[i]];
+        if (mode == 1 || mode == 2) {
+            glColor3f(1, 1, 1);
+            drawSimpleLine(parent, nodes[i]);
+        } else if (mode == 5 || mode == 6) {
+            setColorByType(nodes[i].type);
+            drawCylinder(parent, nodes[i]);
+        }
+    }
+}
+
+// Parents are resolved once per scene and each render mode is compiled into a
+// display list on first use, so a frame is a single glCallList
+void renderSWC(const std::vector<SWCNode>& nodes) {
+    static int cachedVersion = -1;
+    static std::vector<int> parentIndex;
+    static std::array<GLuint, 7> modeLists{};
+
+    if (cachedVersion != sceneVersion || parentIndex.size() != nodes.size()) {
+        for (auto& list : modeLists) {
+            if (list != 0) glDeleteLists(list, 1);
+            list = 0;
+        }
+        std::map<int, int> indexOfId;
+        for (size_t i = 0; i < nodes.size(); ++i) indexOfId[nodes[i].id] = static_cast<int>(i);
+        parentIndex.assign(nodes.size(), -1);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            auto it = indexOfId.find(nodes[i].parent);
+            if (nodes[i].parent != -1 && it != indexOfId.end()) parentIndex[i] = it->second;
+        }
+        cachedVersion = sceneVersion;
+    }
+    if (renderMode < 1 || renderMode > 6) return;
+
+    GLuint& list = modeLists[renderMode];
+    if (list == 0) {
+        list = glGenLists(1);
+        if (list == 0) {
+            drawMode(renderMode, nodes, parentIndex);
+            return;
         }
+        glNewList(list, GL_COMPILE);
+        drawMode(renderMode, nodes, parentIndex);
+        glEndList();
     }
+    glCallList(list);
 }
 
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
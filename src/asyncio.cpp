@@ -0,0 +1,77 @@
+/**
+ * @file asyncio.cpp
+ * @brief Implementation of the I/O service behind the async writers and loaders
+ *
+ * One mutex guards the queue and the running count; the three condition
+ * variables wake I/O threads, blocked producers and drain() respectively.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "asyncio.h"
+
+#include "instrumentation.h"
+
+IoService::IoService(std::size_t threads, std::size_t capacity) : maxQueued(capacity < 1 ? 1 : capacity) {
+    if (threads < 1) threads = 1;
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) workers.emplace_back(&IoService::workerLoop, this);
+}
+
+IoService::~IoService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void IoService::push(std::function<void()> task) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.size() >= maxQueued) {
+            NM_COUNT("io.producer.waits", 1);
+            spaceAvailable.wait(lock, [this] { return queue.size() < maxQueued; });
+        }
+        queue.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void IoService::drain() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return queue.empty() && running == 0; });
+}
+
+std::size_t IoService::pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size() + running;
+}
+
+// the destructor stops the threads only once the queue is empty, so no operation is dropped
+void IoService::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            task = std::move(queue.front());
+            queue.pop_front();
+            ++running;
+        }
+        spaceAvailable.notify_one();
+
+        task();   // a packaged_task stores its exception in the future
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            if (queue.empty() && running == 0) idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * @file batch.cpp
+ * @brief Implementation of the parallel batch driver
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "batch.h"
+#include "threadpool.h"
+#include "utils.h"
+#include "compression.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> collectBatchInputs(const std::string& source, const std::string& extension) {
+    std::vector<std::string> inputs;
+
+    std::error_code ec;
+    if (fs::is_directory(source, ec)) {
+        for (const auto& f : listFilesInDirectory(source)) {
+            fs::path path(f);
+            if (compressionFromFilename(f) != Compression::None) path = path.stem();
+            if (extension.empty() || path.extension() == extension) inputs.push_back(f);
+        }
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    std::ifstream manifest(source);
+    if (!manifest) {
+        std::cerr << "Failed to open batch input: " << source << std::endl;
+        return inputs;
+    }
+
+    const fs::path base = fs::path(source).parent_path();
+    std::string line;
+    while (std::getline(manifest, line)) {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        auto last = line.find_last_not_of(" \t\r");
+        fs::path p = line.substr(first, last - first + 1);
+        inputs.push_back(p.is_absolute() ? p.string() : (base / p).string());
+    }
+    return inputs;
+}
+
+std::vector<BatchResult> runBatch(const std::vector<std::string>& inputs,
+                                  const BatchJob& job,
+                                  const BatchOptions& options) {
+    std::vector<BatchResult> results(inputs.size());
+    if (inputs.empty()) return results;
+
+    std::size_t threads = options.threads ? options.threads : ThreadPool::defaultThreadCount();
+    threads = std::min(threads, inputs.size());
+    const std::size_t maxJobs = options.maxInFlight ? options.maxInFlight : 2 * threads;
+
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    std::size_t jobsInFlight = 0;
+    std::uintmax_t bytesInFlight = 0;
+
+    ThreadPool pool(threads);
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        std::error_code ec;
+        std::uintmax_t bytes = fs::file_size(inputs[i], ec);
+        if (ec) bytes = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFreed.wait(lock, [&] {
+                if (jobsInFlight == 0) return true;
+                if (jobsInFlight >= maxJobs) return false;
+                return options.maxInFlightBytes == 0 || bytesInFlight + bytes <= options.maxInFlightBytes;
+            });
+            ++jobsInFlight;
+            bytesInFlight += bytes;
+        }
+
+        pool.submit([&, i, bytes] {
+            BatchResult& r = results[i];
+            r.input = inputs[i];
+            auto start = std::chrono::steady_clock::now();
+            try {
+                job(inputs[i]);
+                r.ok = true;
+            } catch (const std::exception& e) {
+                r.error = e.what();
+            } catch (...) {
+                r.error = "unknown error";
+            }
+            r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --jobsInFlight;
+                bytesInFlight -= bytes;
+            }
+            slotFreed.notify_one();
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+std::size_t printBatchReport(const std::vector<BatchResult>& results, std::ostream& out) {
+    std::size_t failed = 0;
+    double total = 0.0;
+
+    out << "Batch report:\n";
+    for (const auto& r : results) {
+        total += r.seconds;
+        out << (r.ok ? "  [OK]     " : "  [FAILED] ") << r.input
+            << " (" << std::fixed << std::setprecision(3) << r.seconds << " s)";
+        if (!r.ok) {
+            out << ": " << r.error;
+            ++failed;
+        }
+        out << "\n";
+    }
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+    out << results.size() - failed << " of " << results.size() << " files succeeded, "
+        << failed << " failed, " << total << " s of job time\n";
+    return failed;
+}
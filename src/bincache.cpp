@@ -0,0 +1,135 @@
+/**
+ * @file bincache.cpp
+ * @brief Implementation of the binary morphology/mesh cache container
+ *
+ * Writing lays out the header, the section table and each payload at a
+ * 64-byte aligned offset. Reading maps the file with MappedFile and checks
+ * the magic, version, byte order and every section's bounds before any
+ * section view is handed out.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "bincache.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+constexpr char kBinaryCacheMagic[8] = {'N', 'M', 'B', 'C', 'A', 'C', 'H', 'E'};
+constexpr std::uint32_t kByteOrderMark = 0x01020304u;
+
+std::uint64_t alignUp(std::uint64_t value) {
+    return (value + kBinaryCacheAlignment - 1) / kBinaryCacheAlignment * kBinaryCacheAlignment;
+}
+}
+
+bool BinaryCacheWriter::write(const std::string& filename, BinaryCacheKind kind) const {
+    std::vector<BinarySectionEntry> table;
+    table.reserve(sections.size());
+
+    std::uint64_t offset = alignUp(sizeof(BinaryCacheHeader) + sections.size() * sizeof(BinarySectionEntry));
+    for (const auto& s : sections) {
+        BinarySectionEntry e;
+        e.id          = static_cast<std::uint32_t>(s.id);
+        e.elementSize = static_cast<std::uint32_t>(s.elementSize);
+        e.offset      = offset;
+        e.count       = s.count;
+        table.push_back(e);
+        offset = alignUp(offset + s.elementSize * s.count);
+    }
+
+    BinaryCacheHeader header{};
+    std::memcpy(header.magic, kBinaryCacheMagic, sizeof(header.magic));
+    header.version      = kBinaryCacheVersion;
+    header.kind         = static_cast<std::uint32_t>(kind);
+    header.byteOrder    = kByteOrderMark;
+    header.sectionCount = static_cast<std::uint32_t>(table.size());
+    header.fileSize     = offset;
+
+    std::FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) return false;
+
+    static const char padding[kBinaryCacheAlignment] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+    if (!table.empty())
+        ok = ok && std::fwrite(table.data(), sizeof(BinarySectionEntry), table.size(), f) == table.size();
+
+    std::uint64_t pos = sizeof(header) + table.size() * sizeof(BinarySectionEntry);
+    for (std::size_t i = 0; ok && i < sections.size(); ++i) {
+        ok = std::fwrite(padding, 1, table[i].offset - pos, f) == table[i].offset - pos;
+        std::size_t bytes = sections[i].elementSize * sections[i].count;
+        if (ok && bytes > 0) ok = std::fwrite(sections[i].data, 1, bytes, f) == bytes;
+        pos = table[i].offset + bytes;
+    }
+    if (ok && pos < header.fileSize) {
+        ok = std::fwrite(padding, 1, header.fileSize - pos, f) == header.fileSize - pos;
+    }
+
+    if (std::fclose(f) != 0) ok = false;
+    return ok;
+}
+
+bool BinaryCacheFile::open(const std::string& filename) {
+    entries.clear();
+    error.clear();
+
+    if (!file.open(filename)) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    if (file.size() < sizeof(BinaryCacheHeader)) {
+        error = "file too small for a binary cache header";
+        return false;
+    }
+
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kBinaryCacheMagic, sizeof(header.magic)) != 0) {
+        error = "not a binary cache file";
+        return false;
+    }
+    if (header.byteOrder != kByteOrderMark) {
+        error = "binary cache was written with a different byte order";
+        return false;
+    }
+    if (header.version != kBinaryCacheVersion) {
+        error = "unsupported binary cache version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.fileSize != file.size()) {
+        error = "binary cache is truncated";
+        return false;
+    }
+
+    const std::uint64_t tableEnd = sizeof(BinaryCacheHeader) +
+                                   std::uint64_t(header.sectionCount) * sizeof(BinarySectionEntry);
+    if (tableEnd > file.size()) {
+        error = "section table exceeds file size";
+        return false;
+    }
+
+    entries.resize(header.sectionCount);
+    if (header.sectionCount > 0) {
+        std::memcpy(entries.data(), file.data() + sizeof(BinaryCacheHeader),
+                    header.sectionCount * sizeof(BinarySectionEntry));
+    }
+
+    for (const auto& e : entries) {
+        if (e.offset % kBinaryCacheAlignment != 0 || e.offset < tableEnd || e.offset > file.size() ||
+            e.elementSize == 0 || e.count > (file.size() - e.offset) / e.elementSize) {
+            error = "corrupt section " + std::to_string(e.id);
+            entries.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+const BinarySectionEntry* BinaryCacheFile::find(BinarySection id) const {
+    for (const auto& e : entries) {
+        if (e.id == static_cast<std::uint32_t>(id)) return &e;
+    }
+    return nullptr;
+}
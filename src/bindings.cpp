@@ -9,6 +9,19 @@
  * The bindings expose all major operations including file I/O, morphology analysis,
  * preprocessing, mesh operations, and trunk analysis.
  * 
+ * Besides the dictionary based API, which converts every node to a Python
+ * object, the module offers NumPy accessors: copies of the graph's node
+ * columns, structured arrays of SWCNode records, and
+ * array-in/array-out variants of trunk resampling and PFT meshing. They
+ * never build a Python object per node.
+ *
+ * Every NeuronGraph method releases the GIL while it runs and holds the
+ * graph's accessMutex(): shared for const methods, exclusively for methods
+ * that may change the nodes. Python threads thus work on different graphs
+ * in parallel, read one graph in parallel, and never see a graph half
+ * modified. The batch_* functions process whole lists of files or node sets
+ * on native threads.
+ *
  * The Python module can be imported as:
  * @code{.py}
  * import neurongraph
@@ -20,10 +33,238 @@
  */
 
  #include <pybind11/pybind11.h>
+ #include <pybind11/numpy.h>
  #include <pybind11/stl.h>
+ #include <filesystem>
+ #include <map>
+ #include <mutex>
+ #include <set>
+ #include <shared_mutex>
+ #include <stdexcept>
+ #include "batch.h"
+ #include "compression.h"
  #include "neurongraph.h"
+ #include "refinement.h"
+ #include "resultcache.h"
+ #include "synthetic.h"
+ #include "threadpool.h"
+ #include "trunkbatch.h"
  
  namespace py = pybind11;
+
+ namespace {
+
+ /// Releases the GIL while the bound C++ call runs (arguments and results are converted with it held)
+ using nogil = py::call_guard<py::gil_scoped_release>;
+
+ /**
+  * @brief Runs @p f on a graph with the GIL released and the graph locked for reading
+  *
+  * Only for const calls; any number of them may run on one graph at once.
+  * The lock is released before the GIL is taken back, and @p f must not
+  * touch Python objects.
+  */
+ template <typename F>
+ auto readGraph(const NeuronGraph& g, F&& f) {
+     py::gil_scoped_release release;
+     std::shared_lock<std::shared_mutex> lock(g.accessMutex());
+     return f();
+ }
+
+ /**
+  * @brief Runs @p f on a graph with the GIL released and the graph locked exclusively
+  *
+  * For every non-const call, which may replace the nodes or build the
+  * topology while no other call runs on the graph.
+  */
+ template <typename F>
+ auto writeGraph(NeuronGraph& g, F&& f) {
+     py::gil_scoped_release release;
+     std::unique_lock<std::shared_mutex> lock(g.accessMutex());
+     return f();
+ }
+
+ /// Binds a const member function through readGraph()
+ template <typename R, typename... A>
+ auto reading(R (NeuronGraph::*method)(A...) const) {
+     return [method](const NeuronGraph& g, A... args) -> R {
+         return readGraph(g, [&]() -> R { return (g.*method)(std::forward<A>(args)...); });
+     };
+ }
+
+ /// Binds a non-const member function through writeGraph()
+ template <typename R, typename... A>
+ auto writing(R (NeuronGraph::*method)(A...)) {
+     return [method](NeuronGraph& g, A... args) -> R {
+         return writeGraph(g, [&]() -> R { return (g.*method)(std::forward<A>(args)...); });
+     };
+ }
+
+ /**
+  * @brief Converts every input file into @p outDir on native threads
+  * @param inputs Input files
+  * @param outDir Output folder, created if missing
+  * @param extension Extension of the output files, which keep the input stem
+  *        (without a `.gz`/`.zst` suffix and the input extension)
+  * @param threads Worker threads (0 = all cores)
+  * @param convert Conversion run by each job on its own NeuronGraph
+  * @return One result per input; a job fails if no output was written
+  *
+  * Inputs are mapped to their outputs before anything runs. Only the first
+  * input of each output file is converted; any later input with the same
+  * output (the same stem in another folder, or a repeated path) fails
+  * without being run, so no two jobs write the same file.
+  */
+ std::vector<BatchResult> convertBatch(const std::vector<std::string>& inputs, const std::string& outDir,
+                                       const std::string& extension, std::size_t threads,
+                                       void (NeuronGraph::*convert)(const std::string&, const std::string&)) {
+     std::filesystem::create_directories(outDir);
+     auto outputOf = [&](const std::string& input) {
+         std::filesystem::path name = std::filesystem::path(input).filename();
+         if (compressionFromFilename(input) != Compression::None) name = name.stem();
+         std::filesystem::path output = std::filesystem::path(outDir) / name.stem();
+         output += extension;
+         return output.string();
+     };
+
+     std::map<std::string, std::string> writer;   // output -> the input converted into it
+     std::vector<std::string> unique;
+     for (const std::string& input : inputs)
+         if (writer.emplace(outputOf(input), input).second) unique.push_back(input);
+
+     BatchOptions options;
+     options.threads = threads;
+     auto job = [&](const std::string& input) {
+         std::string output = outputOf(input);
+         NeuronGraph graph;
+         (graph.*convert)(input, output);
+         if (!std::filesystem::exists(output)) throw std::runtime_error("no output written to " + output);
+     };
+     std::vector<BatchResult> ran = runBatch(unique, job, options);
+
+     std::vector<BatchResult> results;
+     results.reserve(inputs.size());
+     auto next = ran.begin();
+     std::set<std::string> claimed;
+     for (const std::string& input : inputs) {
+         std::string output = outputOf(input);
+         if (claimed.insert(output).second) {
+             results.push_back(std::move(*next++));
+             continue;
+         }
+         BatchResult duplicate;
+         duplicate.input = input;
+         duplicate.error = "output " + output + " is already written by " + writer[output];
+         results.push_back(std::move(duplicate));
+     }
+     return results;
+ }
+
+ /**
+  * @brief Moves a vector into a NumPy array without copying its elements
+  * @tparam T Scalar type of the array
+  * @tparam E Element type of the vector (T or a fixed-size group of T)
+  * @param values Data handed over to the array
+  * @param shape Array shape; its product must match the number of scalars
+  */
+ template <typename T, typename E>
+ py::array_t<T> adoptVector(std::vector<E>&& values, std::vector<py::ssize_t> shape) {
+     static_assert(sizeof(E) % sizeof(T) == 0, "element must be a group of scalars");
+     auto* owned = new std::vector<E>(std::move(values));
+     py::capsule release(owned, [](void* p) { delete static_cast<std::vector<E>*>(p); });
+     return py::array_t<T>(shape, reinterpret_cast<const T*>(owned->data()), release);
+ }
+
+ /**
+  * @brief NumPy copy of a native column of the graph
+  *
+  * The column is copied under the graph's lock and the array owns the copy,
+  * so it stays valid when the graph's nodes change later.
+  */
+ template <typename T>
+ py::array_t<T> columnCopy(NeuronGraph& g, std::vector<T> Morphology::*column) {
+     std::vector<T> values = writeGraph(g, [&] { return g.getMorphology().*column; });
+     auto n = static_cast<py::ssize_t>(values.size());
+     return adoptVector<T>(std::move(values), {n});
+ }
+
+ /** @brief Structured SWCNode array of a node sequence, in the given order */
+ template <typename Nodes>
+ py::array_t<SWCNode> nodeRecords(const Nodes& nodes) {
+     std::vector<SWCNode> records;
+     records.reserve(nodes.size());
+     for (const auto& entry : nodes) records.push_back(entry.second);
+     return adoptVector<SWCNode>(std::move(records), {static_cast<py::ssize_t>(nodes.size())});
+ }
+
+ /**
+  * @brief Builds a trunk path from coordinate and radius arrays
+  * @param coords N x 3 coordinates along the path
+  * @param radii N radii
+  * @param type SWC type given to every node
+  * @return Nodes with ids 1..N, each the parent of the next
+  */
+ std::map<int, SWCNode> pathFromArrays(const py::array_t<double, py::array::c_style | py::array::forcecast>& coords,
+                                       const py::array_t<double, py::array::c_style | py::array::forcecast>& radii,
+                                       int type) {
+     if (coords.ndim() != 2 || coords.shape(1) != 3)
+         throw std::invalid_argument("coords must have shape (N, 3)");
+     if (radii.ndim() != 1 || radii.shape(0) != coords.shape(0))
+         throw std::invalid_argument("radii must have shape (N,)");
+
+     auto c = coords.unchecked<2>();
+     auto r = radii.unchecked<1>();
+     std::map<int, SWCNode> path;
+     for (py::ssize_t i = 0; i < coords.shape(0); ++i) {
+         int id = static_cast<int>(i) + 1;
+         path.emplace_hint(path.end(), id, SWCNode{id, id == 1 ? -1 : id - 1, type, c(i, 0), c(i, 1), c(i, 2), r(i)});
+     }
+     return path;
+ }
+
+ /** @brief Query points of an N x 3 array */
+ std::vector<Point3> pointsFromArray(const py::array_t<double, py::array::c_style | py::array::forcecast>& points) {
+     if (points.ndim() != 2 || points.shape(1) != 3)
+         throw std::invalid_argument("points must have shape (N, 3)");
+     auto p = points.unchecked<2>();
+     std::vector<Point3> out(static_cast<std::size_t>(points.shape(0)));
+     for (py::ssize_t i = 0; i < points.shape(0); ++i) out[i] = {p(i, 0), p(i, 1), p(i, 2)};
+     return out;
+ }
+
+ /** @brief Coordinates (N x 3) and radii (N) of a node map, in id order */
+ py::tuple pathToArrays(const std::map<int, SWCNode>& path) {
+     std::vector<double> coords, radii;
+     coords.reserve(3 * path.size());
+     radii.reserve(path.size());
+     for (const auto& [id, node] : path) {
+         coords.insert(coords.end(), {node.x, node.y, node.z});
+         radii.push_back(node.radius);
+     }
+     auto n = static_cast<py::ssize_t>(path.size());
+     return py::make_tuple(adoptVector<double>(std::move(coords), {n, 3}), adoptVector<double>(std::move(radii), {n}));
+ }
+
+ /** @brief Vertices, radii, edges and faces of a dense geometry, moved into arrays */
+ template <typename Scalar>
+ py::dict geometryToArrays(BasicDenseUgxGeometry<Scalar>&& g) {
+     static_assert(sizeof(BasicCoordinates<Scalar>) == 3 * sizeof(Scalar), "points must be packed");
+     static_assert(sizeof(std::pair<int, int>) == 2 * sizeof(int), "edges must be packed");
+     static_assert(sizeof(std::array<int, 3>) == 3 * sizeof(int), "faces must be packed");
+
+     auto nv = static_cast<py::ssize_t>(g.points.size());
+     auto ne = static_cast<py::ssize_t>(g.edges.size());
+     auto nf = static_cast<py::ssize_t>(g.faces.size());
+     if (g.radii.empty()) g.radii.assign(g.points.size(), Scalar(0));
+     py::dict out;
+     out["vertices"] = adoptVector<Scalar>(std::move(g.points), {nv, 3});
+     out["radii"] = adoptVector<Scalar>(std::move(g.radii), {nv});
+     out["edges"] = adoptVector<int>(std::move(g.edges), {ne, 2});
+     out["faces"] = adoptVector<int>(std::move(g.faces), {nf, 3});
+     return out;
+ }
+
+ } // namespace
  
  /**
   * @brief Python module definition for neurongraph
@@ -38,6 +279,14 @@
   * conversion handled by pybind11 for standard types (int, double, string, maps, vectors).
   */
  PYBIND11_MODULE(neurongraph, m){
+     // NumPy record layout of SWCNode, used by the structured array accessors
+     PYBIND11_NUMPY_DTYPE(SWCNode, id, pid, type, x, y, z, radius);
+
+     // storage type of binary files and mesh arrays; computation stays in double
+     py::enum_<StoragePrecision>(m, "StoragePrecision")
+         .value("Float64", StoragePrecision::Float64)
+         .value("Float32", StoragePrecision::Float32);
+
      /**
       * @brief Python binding for SWCNode structure
       * 
@@ -89,75 +338,497 @@
       * @endcode
       */
      py::class_<NeuronGraph>(m, "NeuronGraph")
+         // the new graph is not visible to other threads yet, so loading needs no lock
          .def(py::init<>(), "Default constructor creating an empty NeuronGraph")
-         .def(py::init<std::string>(), "Constructor that loads neuron data from file", py::arg("filename"))
+         .def(py::init<std::string>(), "Constructor that loads neuron data from file", py::arg("filename"), nogil())
          .def(py::init<const std::map<int, SWCNode>&>(), "Constructor from node dictionary", py::arg("nodeSet"))
  
          // Core node manipulation methods
-         .def("addNode", &NeuronGraph::addNode, "Add a single node to the graph", py::arg("node"))
-         .def("setNodes", &NeuronGraph::setNodes, "Replace all nodes with new node set", py::arg("nodeSet"))
-         .def("getNodes", &NeuronGraph::getNodes, "Get all nodes as a dictionary")
+         .def("addNode", writing(&NeuronGraph::addNode), "Add a single node to the graph", py::arg("node"))
+         .def("setNodes", writing(&NeuronGraph::setNodes), "Replace all nodes with new node set", py::arg("nodeSet"))
+         .def("getNodes", reading(&NeuronGraph::getNodes), "Get all nodes as a dictionary")
  
          // File I/O methods
-         .def("readFromFile", &NeuronGraph::readFromFile, "Load neuron data from SWC file", py::arg("filename"))
-         .def("writeToFile", py::overload_cast<const std::map<int, SWCNode>&, const std::string&>(&NeuronGraph::writeToFile),
+         .def("readFromFile", writing(&NeuronGraph::readFromFile), "Load neuron data from SWC file", py::arg("filename"))
+         .def("writeToFile", writing(py::overload_cast<const std::map<int, SWCNode>&, const std::string&>(&NeuronGraph::writeToFile)),
               "Write node set to SWC file", py::arg("nodeSet"), py::arg("filename"))
-         .def("writeToFile", py::overload_cast<const std::string&>(&NeuronGraph::writeToFile),
+         .def("writeToFile", writing(py::overload_cast<const std::string&>(&NeuronGraph::writeToFile)),
               "Write current graph to SWC file", py::arg("filename"))
-         .def("readFromFileUGX", &NeuronGraph::readFromFileUGX, "Load neuron data from UGX file", py::arg("filename"))
-         .def("readFromFileUGXorSWC", &NeuronGraph::readFromFileUGXorSWC, 
+         .def("readFromFileUGX", writing(&NeuronGraph::readFromFileUGX), "Load neuron data from UGX file", py::arg("filename"))
+         .def("readFromFileUGXorSWC", writing(&NeuronGraph::readFromFileUGXorSWC),
               "Auto-detect format and load from SWC or UGX file", py::arg("filename"))
-         .def("writeToFileUGX", py::overload_cast<const std::map<int, SWCNode>&, const std::string&>(&NeuronGraph::writeToFileUGX),
+         .def("writeToFileUGX", writing(py::overload_cast<const std::map<int, SWCNode>&, const std::string&>(&NeuronGraph::writeToFileUGX)),
               "Write node set to UGX file", py::arg("nodeSet"), py::arg("filename"))
-         .def("writeToFileUGX", py::overload_cast<const std::string&>(&NeuronGraph::writeToFileUGX),
+         .def("writeToFileUGX", writing(py::overload_cast<const std::string&>(&NeuronGraph::writeToFileUGX)),
               "Write current graph to UGX file", py::arg("filename"))
  
+         .def("writeToFileBIN",
+              writing(py::overload_cast<const std::map<int, SWCNode>&, const std::string&, StoragePrecision>(&NeuronGraph::writeToFileBIN)),
+              "Write node set to binary cache file", py::arg("nodeSet"), py::arg("filename"),
+              py::arg("precision") = StoragePrecision::Float64)
+         .def("writeToFileBIN", writing(py::overload_cast<const std::string&, StoragePrecision>(&NeuronGraph::writeToFileBIN)),
+              "Write current graph to binary cache file", py::arg("filename"),
+              py::arg("precision") = StoragePrecision::Float64)
+         .def("readFromFileBIN", writing(&NeuronGraph::readFromFileBIN), "Load neuron data from binary cache file", py::arg("filename"))
+
          // Format conversion utilities
-         .def("swc2ugx", &NeuronGraph::swc2ugx, "Convert SWC file to UGX format", 
+         .def("swc2ugx", writing(&NeuronGraph::swc2ugx), "Convert SWC file to UGX format", 
+              py::arg("inputfile"), py::arg("outputfile"))
+         .def("ugx2swc", writing(&NeuronGraph::ugx2swc), "Convert UGX file to SWC format", 
               py::arg("inputfile"), py::arg("outputfile"))
-         .def("ugx2swc", &NeuronGraph::ugx2swc, "Convert UGX file to SWC format", 
+         .def("swc2bin", writing(&NeuronGraph::swc2bin), "Convert SWC file to binary cache format",
+              py::arg("inputfile"), py::arg("outputfile"))
+         .def("ugx2bin", writing(&NeuronGraph::ugx2bin), "Convert UGX file to binary cache format",
               py::arg("inputfile"), py::arg("outputfile"))
  
          // Graph analysis methods
-         .def("numberOfNodes", &NeuronGraph::numberOfNodes, "Get total number of nodes in the graph")
-         .def("numberOfEdges", &NeuronGraph::numberOfEdges, "Get total number of edges in the graph")
+         .def("numberOfNodes", reading(&NeuronGraph::numberOfNodes), "Get total number of nodes in the graph")
+         .def("numberOfEdges", reading(&NeuronGraph::numberOfEdges), "Get total number of edges in the graph")
  
          // Topology validation and correction methods
-         .def("isTopologicallySorted", py::overload_cast<>(&NeuronGraph::isTopologicallySorted, py::const_),
+         .def("isTopologicallySorted", reading(py::overload_cast<>(&NeuronGraph::isTopologicallySorted, py::const_)),
               "Check if nodes are topologically sorted (parents have smaller IDs than children)")
-         .def("topologicalSort", py::overload_cast<>(&NeuronGraph::topologicalSort, py::const_),
+         .def("topologicalSort", reading(py::overload_cast<>(&NeuronGraph::topologicalSort, py::const_)),
               "Sort nodes topologically ensuring proper parent-child ID ordering")
          
          // Soma analysis and correction methods
-         .def("hasSomaSegment", py::overload_cast<>(&NeuronGraph::hasSomaSegment, py::const_),
+         .def("hasSomaSegment", reading(py::overload_cast<>(&NeuronGraph::hasSomaSegment, py::const_)),
               "Check if neuron has multiple soma nodes (soma segment)")
-         .def("isSomaMissing", py::overload_cast<>(&NeuronGraph::isSomaMissing, py::const_),
+         .def("isSomaMissing", reading(py::overload_cast<>(&NeuronGraph::isSomaMissing, py::const_)),
               "Check if neuron is missing a soma node")
-         .def("removeSomaSegment", py::overload_cast<>(&NeuronGraph::removeSomaSegment, py::const_),
+         .def("removeSomaSegment", reading(py::overload_cast<>(&NeuronGraph::removeSomaSegment, py::const_)),
               "Remove soma segments by consolidating multiple soma nodes into one")
-         .def("setSoma", py::overload_cast<>(&NeuronGraph::setSoma, py::const_),
+         .def("setSoma", reading(py::overload_cast<>(&NeuronGraph::setSoma, py::const_)),
               "Assign soma to neuron by converting first root node to soma type")
-         .def("preprocess", &NeuronGraph::preprocess, 
+         .def("preprocess", reading(&NeuronGraph::preprocess), 
               "Preprocess neuron data (fix soma issues, ensure topological sorting)", py::arg("nodeSet"))
  
          // Mesh refinement operations
-         .def("splitEdges", py::overload_cast<>(&NeuronGraph::splitEdges, py::const_),
+         .def("splitEdges", reading(py::overload_cast<>(&NeuronGraph::splitEdges, py::const_)),
               "Split all edges by inserting midpoint nodes for mesh refinement")
-         .def("splitEdgesN", py::overload_cast<int>(&NeuronGraph::splitEdgesN, py::const_),
+         .def("splitEdgesN", reading(py::overload_cast<int>(&NeuronGraph::splitEdgesN, py::const_)),
               "Perform N iterations of edge splitting for progressive refinement", py::arg("N"))
  
-         .def("getTrunks", py::overload_cast<bool>(&NeuronGraph::getTrunks, py::const_))
-         .def("getTrunkParentMap", &NeuronGraph::getTrunkParentMap)
-         .def("assembleTrunks", py::overload_cast<const std::map<int, std::map<int, SWCNode>>&>(&NeuronGraph::assembleTrunks, py::const_))
-         .def("assembleTrunks", py::overload_cast<const std::map<int, std::map<int, SWCNode>>&, const std::map<int, int>&>(&NeuronGraph::assembleTrunks))
+         .def("getTrunks", reading(py::overload_cast<bool>(&NeuronGraph::getTrunks, py::const_)))
+         .def("getTrunkParentMap", reading(py::overload_cast<const std::map<int, SWCNode>&, const std::map<int, std::map<int, SWCNode>>&>(&NeuronGraph::getTrunkParentMap, py::const_)))
+         .def("getTrunkParentMap", reading(py::overload_cast<>(&NeuronGraph::getTrunkParentMap, py::const_)))
+         .def("assembleTrunks", reading(py::overload_cast<const std::map<int, std::map<int, SWCNode>>&>(&NeuronGraph::assembleTrunks, py::const_)))
+         .def("assembleTrunks", writing(py::overload_cast<const std::map<int, std::map<int, SWCNode>>&, const std::map<int, int>&>(&NeuronGraph::assembleTrunks)))
+         .def("assembleTrunksDense", reading(&NeuronGraph::assembleTrunksDense),
+      py::arg("resampledTrunks"), py::arg("trunkParentMap"), py::arg("threads") = 1)
  
-         .def("linearSplineResampleTrunk", &NeuronGraph::linearSplineResampleTrunk)
-         .def("allLinearSplineResampledTrunks", &NeuronGraph::allLinearSplineResampledTrunks)
-         .def("cubicSplineResampleTrunk", &NeuronGraph::cubicSplineResampleTrunk)
-         .def("allCubicSplineResampledTrunks", &NeuronGraph::allCubicSplineResampledTrunks)
-         .def("generateRefinements",py::overload_cast<const std::map<int, SWCNode>&, double&, int&, std::string&>(&NeuronGraph::generateRefinements),
-      py::arg("nodeSet"), py::arg("delta"), py::arg("N"), py::arg("method"))
-         .def("generateRefinements",py::overload_cast<double&, int&, std::string&>(&NeuronGraph::generateRefinements),
-      py::arg("delta"), py::arg("N"), py::arg("method"));
+         .def("linearSplineResampleTrunk", reading(&NeuronGraph::linearSplineResampleTrunk))
+         .def("allLinearSplineResampledTrunks", reading(&NeuronGraph::allLinearSplineResampledTrunks),
+      py::arg("trunks"), py::arg("delta"), py::arg("threads") = 1)
+         .def("cubicSplineResampleTrunk", reading(&NeuronGraph::cubicSplineResampleTrunk))
+         .def("adaptiveSplineResampleTrunk", reading(&NeuronGraph::adaptiveSplineResampleTrunk),
+              py::arg("trunk"), py::arg("tolerance"), py::arg("maxSpacing"))
+         .def("allCubicSplineResampledTrunks", reading(&NeuronGraph::allCubicSplineResampledTrunks),
+      py::arg("trunks"), py::arg("delta"), py::arg("threads") = 1)
+         .def("generateRefinements",writing(py::overload_cast<const std::map<int, SWCNode>&, double&, int&, std::string&, std::size_t>(&NeuronGraph::generateRefinements)),
+      py::arg("nodeSet"), py::arg("delta"), py::arg("N"), py::arg("method"), py::arg("threads") = 1)
+         .def("generateRefinements",writing(py::overload_cast<double&, int&, std::string&, std::size_t>(&NeuronGraph::generateRefinements)),
+      py::arg("delta"), py::arg("N"), py::arg("method"), py::arg("threads") = 1)
+         .def("writeRefinements", writing(&NeuronGraph::writeRefinements),
+      "Generate refinement levels and write each one to disk as it is produced",
+      py::arg("nodeSet"), py::arg("delta"), py::arg("N"), py::arg("method"), py::arg("outputFolder"), py::arg("threads") = 1)
+
+         // NumPy accessors: copies of the native columns
+         .def("ids", [](NeuronGraph& g) { return columnCopy(g, &Morphology::id); },
+              "Node ids in row order")
+         .def("parentIds", [](NeuronGraph& g) { return columnCopy(g, &Morphology::pid); },
+              "Parent ids in row order")
+         .def("parentIndices", [](NeuronGraph& g) { return columnCopy(g, &Morphology::parent); },
+              "Row of each node's parent, -1 for roots")
+         .def("types", [](NeuronGraph& g) { return columnCopy(g, &Morphology::type); },
+              "Node types in row order")
+         .def("radii", [](NeuronGraph& g) { return columnCopy(g, &Morphology::radius); },
+              "Node radii in row order")
+         .def("coordinates", [](NeuronGraph& g) {
+                  std::vector<double> xyz = writeGraph(g, [&] {
+                      const Morphology& morph = g.getMorphology();
+                      std::vector<double> packed(3 * morph.size());
+                      for (std::size_t i = 0; i < morph.size(); ++i) {
+                          packed[3 * i] = morph.x[i];
+                          packed[3 * i + 1] = morph.y[i];
+                          packed[3 * i + 2] = morph.z[i];
+                      }
+                      return packed;
+                  });
+                  auto n = static_cast<py::ssize_t>(xyz.size() / 3);
+                  return adoptVector<double>(std::move(xyz), {n, 3});
+              },
+              "Node coordinates in row order as an N x 3 array")
+         .def("nodeArray", [](const NeuronGraph& g) { return nodeRecords(readGraph(g, [&] { return g.getNodes(); })); },
+              "All nodes as a structured array with the SWCNode fields")
+         .def("trunkArrays", [](const NeuronGraph& g, bool resetIndex) {
+                  TrunkSpans spans = readGraph(g, [&] { return g.getTrunkSpans(resetIndex); });
+                  auto nodes = static_cast<py::ssize_t>(spans.nodes.size());
+                  auto trunks = static_cast<py::ssize_t>(spans.parentTrunk.size());
+                  py::dict out;
+                  out["nodes"] = adoptVector<SWCNode>(std::move(spans.nodes), {nodes});
+                  out["offsets"] = adoptVector<int>(std::move(spans.offsets), {static_cast<py::ssize_t>(trunks + 1)});
+                  out["parentTrunk"] = adoptVector<int>(std::move(spans.parentTrunk), {trunks});
+                  return out;
+              },
+              "Trunks as one structured node array split by offsets, with the parent of every trunk",
+              py::arg("resetIndex") = false)
+         .def("generateRefinementArrays", [](NeuronGraph& g, double delta, int N, std::string method, std::size_t threads) {
+                  auto refinements = writeGraph(g, [&] { return g.generateRefinements(delta, N, method, threads); });
+                  py::list levels;
+                  for (const auto& [level, nodes] : refinements) levels.append(nodeRecords(nodes));
+                  return levels;
+              },
+              "Refinement levels of the current graph as structured node arrays",
+              py::arg("delta"), py::arg("N"), py::arg("method"), py::arg("threads") = 1)
+         .def("resampleTrunkArrays",
+              [](const NeuronGraph& g, const py::array_t<double, py::array::c_style | py::array::forcecast>& coords,
+                 const py::array_t<double, py::array::c_style | py::array::forcecast>& radii, double delta,
+                 const std::string& method) {
+                  if (method != "linear" && method != "cubic" && method != "adaptive")
+                      throw std::invalid_argument("method must be 'linear', 'cubic' or 'adaptive'");
+                  auto path = pathFromArrays(coords, radii, 0);
+                  auto resampled = readGraph(g, [&] {
+                      return method == "cubic"      ? g.cubicSplineResampleTrunk(path, delta)
+                             : method == "adaptive" ? g.adaptiveSplineResampleTrunk(path, adaptiveToleranceRatio * delta,
+                                                                                    adaptiveSpacingRatio * delta)
+                                                    : g.linearSplineResampleTrunk(path, delta);
+                  });
+                  return pathToArrays(resampled);
+              },
+              "Resample a trunk given as N x 3 coordinates and N radii; returns (coords, radii)",
+              py::arg("coords"), py::arg("radii"), py::arg("delta"), py::arg("method") = "linear")
+         .def("pftFromArrays",
+              [](NeuronGraph&, const py::array_t<double, py::array::c_style | py::array::forcecast>& coords,
+                 const py::array_t<double, py::array::c_style | py::array::forcecast>& radii, int segments) {
+                  return geometryToArrays(NeuronGraph::pftDenseFromPath(pathFromArrays(coords, radii, 3), segments));
+              },
+              "Tube surface around a path given as N x 3 coordinates and N radii; returns vertices, radii, edges and faces",
+              py::arg("coords"), py::arg("radii"), py::arg("segments") = 8)
+         .def("meshSurface",
+              [](const NeuronGraph& g, int segments, double insetFactor, int bezierPoints, double delta,
+                 std::size_t threads, StoragePrecision precision) {
+                  SurfaceMeshOptions options;
+                  options.segments = segments;
+                  options.insetFactor = insetFactor;
+                  options.bezierPoints = bezierPoints;
+                  options.delta = delta;
+                  options.threads = threads;
+                  DenseUgxGeometry surface = readGraph(g, [&] { return g.meshSurface(options); });
+                  if (precision == StoragePrecision::Float32) {
+                      DenseUgxGeometry32 narrowed = surface.convert<float>();
+                      surface = DenseUgxGeometry();
+                      return geometryToArrays(std::move(narrowed));
+                  }
+                  return geometryToArrays(std::move(surface));
+              },
+              "Connected surface of the whole neuron (trunk tubes and junctions); returns vertices, radii, edges and faces "
+              "(float32 vertices and radii with precision=StoragePrecision.Float32)",
+              py::arg("segments") = 16, py::arg("insetFactor") = 0.25, py::arg("bezierPoints") = 8,
+              py::arg("delta") = 0.0, py::arg("threads") = 1, py::arg("precision") = StoragePrecision::Float64)
+         .def("trunkTubeBuffers",
+              [](const NeuronGraph& g, int segments, double delta, std::size_t threads) {
+                  TubeBuffers buffers = readGraph(g, [&] {
+                      TrunkBatch batch = TrunkBatch::fromSpans(g.getTrunkSpans(false));
+                      if (delta > 0) batch = resampleTrunkBatchCubic(batch, delta, threads);
+                      return meshTubeBatch(batch, segments, threads);
+                  });
+                  auto vertices = static_cast<py::ssize_t>(buffers.vertices.size() / 3);
+                  auto triangles = static_cast<py::ssize_t>(buffers.triangles.size() / 3);
+                  py::dict out;
+                  out["vertices"] = adoptVector<float>(std::move(buffers.vertices), {vertices, 3});
+                  out["triangles"] = adoptVector<std::uint32_t>(std::move(buffers.triangles), {triangles, 3});
+                  return out;
+              },
+              "Unwelded tube of every trunk as render buffers: float32 V x 3 vertices and uint32 T x 3 triangles "
+              "(trunks cubic-resampled at delta first if delta > 0)",
+              py::arg("segments") = 16, py::arg("delta") = 0.0, py::arg("threads") = 1)
+         .def("nearestNodes",
+              [](const NeuronGraph& g, const py::array_t<double, py::array::c_style | py::array::forcecast>& points,
+                 std::size_t threads) {
+                  auto queries = pointsFromArray(points);
+                  std::vector<int> rows(queries.size());
+                  std::vector<double> distances(queries.size());
+                  readGraph(g, [&] {
+                      auto hits = g.segmentIndex()->nearestNodes(queries, threads);
+                      for (std::size_t i = 0; i < hits.size(); ++i) {
+                          rows[i] = hits[i].index;
+                          distances[i] = hits[i].distance;
+                      }
+                  });
+                  auto n = static_cast<py::ssize_t>(queries.size());
+                  return py::make_tuple(adoptVector<int>(std::move(rows), {n}), adoptVector<double>(std::move(distances), {n}));
+              },
+              "Row of the closest node to every point of an N x 3 array; returns (rows, distances)",
+              py::arg("points"), py::arg("threads") = 1)
+         .def("nodesWithin",
+              [](const NeuronGraph& g, double x, double y, double z, double radius) {
+                  std::vector<int> rows = readGraph(g, [&] { return g.segmentIndex()->nodesWithin({x, y, z}, radius); });
+                  auto n = static_cast<py::ssize_t>(rows.size());
+                  return adoptVector<int>(std::move(rows), {n});
+              },
+              "Rows of the nodes within radius of a point, in increasing order",
+              py::arg("x"), py::arg("y"), py::arg("z"), py::arg("radius"))
+         .def("pickNode",
+              [](const NeuronGraph& g, const Point3& origin, const Point3& direction) {
+                  SpatialHit hit = readGraph(g, [&] { return g.segmentIndex()->raycast(origin, direction); });
+                  return py::make_tuple(hit.index, hit.distance);
+              },
+              "First segment hit by a ray; returns (row, distance) with row -1 on a miss",
+              py::arg("origin"), py::arg("direction"))
+         .def("segmentIntersections",
+              [](const NeuronGraph& g, int hops) {
+                  auto pairs = readGraph(g, [&] { return g.segmentIndex()->intersections(hops); });
+                  auto n = static_cast<py::ssize_t>(pairs.size());
+                  return adoptVector<int>(std::move(pairs), {n, 2});
+              },
+              "Row pairs (K x 2) of overlapping segments more than hops edges apart in the tree",
+              py::arg("hops") = 0)
+         .def("morphometrics",
+              [](const NeuronGraph& g, double shollStep, std::size_t threads) {
+                  Morphometrics m = readGraph(g, [&] { return g.morphometrics({shollStep, threads}); });
+                  auto vector1d = [](auto&& values) {
+                      using T = typename std::decay_t<decltype(values)>::value_type;
+                      auto n = static_cast<py::ssize_t>(values.size());
+                      return adoptVector<T>(std::move(values), {n});
+                  };
+                  py::dict out;
+                  out["totalLength"] = m.totalLength;
+                  out["totalArea"] = m.totalArea;
+                  out["totalVolume"] = m.totalVolume;
+                  out["branchPoints"] = m.branchPoints;
+                  out["tips"] = m.tips;
+                  out["stems"] = m.stems;
+                  out["maxBranchOrder"] = m.maxBranchOrder;
+                  out["maxPathDistance"] = m.maxPathDistance;
+                  out["lengthByType"] = vector1d(std::move(m.lengthByType));
+                  out["areaByType"] = vector1d(std::move(m.areaByType));
+                  out["volumeByType"] = vector1d(std::move(m.volumeByType));
+                  out["segmentLength"] = vector1d(std::move(m.segmentLength));
+                  out["pathDistance"] = vector1d(std::move(m.pathDistance));
+                  out["branchOrder"] = vector1d(std::move(m.branchOrder));
+                  out["sectionRows"] = vector1d(std::move(m.sectionRows));
+                  out["sectionOffsets"] = vector1d(std::move(m.sectionOffsets));
+                  out["sectionParent"] = vector1d(std::move(m.sectionParent));
+                  out["sectionOrder"] = vector1d(std::move(m.sectionOrder));
+                  out["sectionLength"] = vector1d(std::move(m.sectionLength));
+                  out["sectionTortuosity"] = vector1d(std::move(m.sectionTortuosity));
+                  out["shollCenter"] = py::make_tuple(m.shollCenter[0], m.shollCenter[1], m.shollCenter[2]);
+                  out["shollRadii"] = vector1d(std::move(m.shollRadii));
+                  out["shollIntersections"] = vector1d(std::move(m.shollIntersections));
+                  return out;
+              },
+              "Morphometrics of the neuron in one native pass: totals, per-type length/area/volume, per-node "
+              "segment length, path distance and branch order (morphology row order), sections with their "
+              "length and tortuosity, and the Sholl profile",
+              py::arg("shollStep") = 10.0, py::arg("threads") = 1);
+
+     /**
+      * @brief Python binding for BatchResult
+      *
+      * Outcome of one file processed by the batch_* functions.
+      */
+     py::class_<BatchResult>(m, "BatchResult")
+         .def_readonly("input", &BatchResult::input, "Input file the job was run on")
+         .def_readonly("ok", &BatchResult::ok, "True if the job succeeded")
+         .def_readonly("error", &BatchResult::error, "Error message if the job failed")
+         .def_readonly("seconds", &BatchResult::seconds, "Wall-clock run time of the job")
+         .def("__repr__", [](const BatchResult& r) {
+             return "<BatchResult " + r.input + (r.ok ? " ok" : " failed: " + r.error) + ">";
+         });
+
+     /**
+      * @brief Batch entry points
+      *
+      * Each function processes all of its inputs inside C++ on native threads
+      * with the GIL released, so a single call scales across cores.
+      *
+      * Python usage:
+      * @code{.py}
+      * results = neurongraph.batch_swc2ugx(paths, "out/ugx", threads=8)
+      * failed = [r.input for r in results if not r.ok]
+      * @endcode
+      */
+     m.def("batch_swc2ugx",
+           [](const std::vector<std::string>& paths, const std::string& outDir, std::size_t threads) {
+               return convertBatch(paths, outDir, ".ugx", threads, &NeuronGraph::swc2ugx);
+           },
+           "Convert SWC files to UGX files in out_dir on native threads",
+           py::arg("paths"), py::arg("out_dir"), py::arg("threads") = 0, nogil());
+     m.def("batch_swc2bin",
+           [](const std::vector<std::string>& paths, const std::string& outDir, std::size_t threads) {
+               return convertBatch(paths, outDir, ".bin", threads, &NeuronGraph::swc2bin);
+           },
+           "Convert SWC files to binary cache files in out_dir on native threads",
+           py::arg("paths"), py::arg("out_dir"), py::arg("threads") = 0, nogil());
+     m.def("batch_ugx2swc",
+           [](const std::vector<std::string>& paths, const std::string& outDir, std::size_t threads) {
+               return convertBatch(paths, outDir, ".swc", threads, &NeuronGraph::ugx2swc);
+           },
+           "Convert UGX files to SWC files in out_dir on native threads",
+           py::arg("paths"), py::arg("out_dir"), py::arg("threads") = 0, nogil());
+     m.def("batch_load",
+           [](const std::vector<std::string>& paths, std::size_t threads) {
+               std::vector<NeuronGraph> graphs(paths.size());
+               parallelFor(paths.size(), threads, [&](std::size_t i) { graphs[i].readFromFileUGXorSWC(paths[i]); });
+               return graphs;
+           },
+           "Load SWC or UGX files into NeuronGraph objects on native threads",
+           py::arg("paths"), py::arg("threads") = 0, nogil());
+     m.def("cached_generate_refinements",
+           [](const std::string& filename, double delta, int N, const std::string& method, const std::string& cacheDir,
+              std::size_t threads, std::uint64_t maxMB) {
+               std::map<int, std::map<int, SWCNode>> levels;
+               {
+                   py::gil_scoped_release release;
+                   ResultCache cache(cacheDir, maxMB << 20);
+                   std::string key = ResultCache::key(ResultCache::hashFile(filename), "generateRefinements",
+                                                      {delta, double(N)}, method);
+                   if (!cache.loadLevels(key, levels)) {
+                       NeuronGraph g(filename);
+                       std::string how = method;
+                       levels = g.generateRefinements(delta, N, how, threads);
+                       cache.storeLevels(key, levels);
+                   }
+               }
+               py::list arrays;
+               for (const auto& [level, nodes] : levels) arrays.append(nodeRecords(nodes));
+               return arrays;
+           },
+           "Refinement levels of an SWC file as structured node arrays, served from cache_dir when the same "
+           "file contents were refined with the same parameters",
+           py::arg("filename"), py::arg("delta"), py::arg("N"), py::arg("method"), py::arg("cache_dir"),
+           py::arg("threads") = 1, py::arg("max_mb") = 1024);
+     m.def("cached_mesh_surface",
+           [](const std::string& filename, const std::string& cacheDir, int segments, double delta, std::size_t threads,
+              std::uint64_t maxMB) {
+               DenseUgxGeometry surface;
+               {
+                   py::gil_scoped_release release;
+                   ResultCache cache(cacheDir, maxMB << 20);
+                   SurfaceMeshOptions options;
+                   options.segments = segments;
+                   options.delta = delta;
+                   options.threads = threads;
+                   std::string key = ResultCache::key(ResultCache::hashFile(filename), "meshSurface",
+                                                      {double(options.segments), options.insetFactor,
+                                                       double(options.bezierPoints), options.delta, double(options.capTips)});
+                   if (!cache.loadGeometry(key, surface)) {
+                       surface = NeuronGraph(filename).meshSurface(options);
+                       cache.storeGeometry(key, surface);
+                   }
+               }
+               return geometryToArrays(std::move(surface));
+           },
+           "meshSurface() of an SWC file, served from cache_dir when the same file contents were meshed "
+           "with the same parameters",
+           py::arg("filename"), py::arg("cache_dir"), py::arg("segments") = 16, py::arg("delta") = 0.0,
+           py::arg("threads") = 1, py::arg("max_mb") = 1024);
+     m.def("batch_generate_refinements",
+           [](const std::vector<std::map<int, SWCNode>>& nodeSets, double delta, int N, const std::string& method,
+              std::size_t threads) {
+               std::vector<std::map<int, std::map<int, SWCNode>>> levels(nodeSets.size());
+               parallelFor(nodeSets.size(), threads, [&](std::size_t i) {
+                   double d = delta;
+                   int n = N;
+                   std::string how = method;
+                   levels[i] = NeuronGraph().generateRefinements(nodeSets[i], d, n, how);
+               });
+               return levels;
+           },
+           "Generate refinement levels of many node sets on native threads",
+           py::arg("node_sets"), py::arg("delta"), py::arg("N"), py::arg("method"), py::arg("threads") = 0, nogil());
+
+     /**
+      * @brief Reproducible random neurons for scaling experiments
+      *
+      * Python usage:
+      * @code{.py}
+      * nodes = neurongraph.generate_morphology(nodes=100000, seed=3, soma="three-point")
+      * g = neurongraph.NeuronGraph(nodes)
+      * @endcode
+      */
+     m.def("generate_morphology",
+           [](int nodes, std::uint32_t seed, int branchingFactor, double branchProbability, double tortuosity,
+              int stems, const std::string& soma) {
+               SyntheticMorphologyOptions options;
+               options.nodes = nodes;
+               options.seed = seed;
+               options.branchingFactor = branchingFactor;
+               options.branchProbability = branchProbability;
+               options.tortuosity = tortuosity;
+               options.stems = stems;
+               options.soma = syntheticSomaFromString(soma);
+               py::gil_scoped_release release;
+               return generateMorphology(options);
+           },
+           "Generate a reproducible random neuron tree of the given size",
+           py::arg("nodes") = 10000, py::arg("seed") = 1, py::arg("branching_factor") = 2,
+           py::arg("branch_probability") = 0.02, py::arg("tortuosity") = 0.3, py::arg("stems") = 4,
+           py::arg("soma") = "point");
+
+     /**
+      * @brief Console verbosity and stage metrics
+      *
+      * Python usage:
+      * @code{.py}
+      * neurongraph.set_log_level(neurongraph.LogLevel.Quiet)
+      * neurongraph.set_metrics_enabled(True)
+      * g = neurongraph.NeuronGraph("neuron.swc")
+      * print(neurongraph.metrics()["stages"]["readSWC"])
+      * @endcode
+      */
+     py::enum_<LogLevel>(m, "LogLevel")
+         .value("Quiet", LogLevel::Quiet)
+         .value("Error", LogLevel::Error)
+         .value("Info", LogLevel::Info)
+         .value("Debug", LogLevel::Debug);
+     m.def("set_log_level", &setLogLevel, "Set the console verbosity of the library", py::arg("level"));
+     m.def("log_level", &logLevel, "Current console verbosity of the library");
+     m.def("set_metrics_enabled", [](bool on) { Metrics::instance().setEnabled(on); },
+           "Start or stop collecting stage timings and counters", py::arg("enabled"));
+     m.def("set_tracing", [](bool on) { Metrics::instance().setTracing(on); },
+           "Also keep one trace event per timed stage (enables collection)", py::arg("enabled"));
+     m.def("metrics",
+           []() {
+               py::dict stages;
+               for (const auto& [name, s] : Metrics::instance().stages()) {
+                   py::dict d;
+                   d["calls"] = s.calls;
+                   d["total_seconds"] = s.totalSeconds;
+                   d["max_seconds"] = s.maxSeconds;
+                   stages[py::str(name)] = d;
+               }
+               py::dict out;
+               out["stages"] = stages;
+               out["counters"] = Metrics::instance().counters();
+               return out;
+           },
+           "Stage timings and counters collected so far");
+     m.def("reset_metrics", []() { Metrics::instance().reset(); }, "Clear the collected timings, counters and trace");
+     m.def("write_chrome_trace", [](const std::string& filename) { return Metrics::instance().writeChromeTrace(filename); },
+           "Write the trace events in the Chrome trace format; returns False on failure", py::arg("filename"));
+     /**
+      * @brief Compressed (.gz, .zst) output
+      *
+      * Python usage:
+      * @code{.py}
+      * neurongraph.set_compression_options(level=9, threads=8)
+      * g.writeToFileUGX("neuron.ugx.gz")
+      * @endcode
+      */
+     m.def("set_compression_options",
+           [](int level, std::size_t threads) {
+               CompressionOptions options;
+               options.level = level;
+               options.threads = threads;
+               setCompressionOptions(options);
+           },
+           "Set the level (negative = codec default) and threads (0 = all cores) of compressed writers",
+           py::arg("level") = -1, py::arg("threads") = 1);
+     m.def("compression_available",
+           [](const std::string& filename) { return compressionAvailable(compressionFromFilename(filename)); },
+           "True if files with the compression of this name (.gz, .zst) can be read and written",
+           py::arg("filename"));
  }
  
\ No newline at end of file
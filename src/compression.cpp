@@ -0,0 +1,483 @@
+/**
+ * @file compression.cpp
+ * @brief Implementation of the gzip and zstd file codecs
+ *
+ * gzip output is a sequence of independent members of up to one block each.
+ * Deflate only looks 32 KiB back, so cutting the stream at 1 MiB costs a
+ * negligible amount of ratio and lets the blocks be compressed in parallel.
+ * zstd output is a single frame from one streaming context; its worker
+ * threads (ZSTD_c_nbWorkers) are used when the library was built with them.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "compression.h"
+#include "asyncio.h"
+#include "instrumentation.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef NEURONMESHER_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef NEURONMESHER_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+std::mutex compressionOptionsMutex;
+
+CompressionOptions& activeCompressionOptions() {
+    static CompressionOptions options = CompressionOptions::fromEnvironment();
+    return options;
+}
+
+bool endsWith(const std::string& s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+const char* codecName(Compression compression) {
+    return compression == Compression::Gzip ? "gzip (zlib)" : "zstd";
+}
+
+#ifdef NEURONMESHER_WITH_ZLIB
+// one complete gzip member
+std::string gzipMember(const std::string& input, int level) {
+    z_stream zs{};
+    if (deflateInit2(&zs, level < 0 ? Z_DEFAULT_COMPRESSION : std::min(level, 9), Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+    std::string out(deflateBound(&zs, static_cast<uLong>(input.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    zs.avail_in = static_cast<uInt>(input.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    int result = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    if (result != Z_STREAM_END) throw std::runtime_error("deflate failed");
+    return out;
+}
+
+bool gunzip(std::string_view input, std::vector<char>& output, std::string& error) {
+    z_stream zs{};
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+        error = "inflateInit2 failed";
+        return false;
+    }
+
+    const char* next = input.data();
+    std::size_t remaining = input.size();
+    std::size_t produced = 0;
+    output.resize(std::max<std::size_t>(input.size() * 4, 1 << 16));
+
+    bool done = false;
+    while (!done) {
+        if (zs.avail_in == 0 && remaining > 0) {
+            uInt n = static_cast<uInt>(std::min<std::size_t>(remaining, 1u << 30));
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(next));
+            zs.avail_in = n;
+            next += n;
+            remaining -= n;
+        }
+        if (produced == output.size()) output.resize(output.size() * 2);
+        zs.next_out = reinterpret_cast<Bytef*>(output.data() + produced);
+        zs.avail_out = static_cast<uInt>(std::min<std::size_t>(output.size() - produced, 1u << 30));
+        const uInt before = zs.avail_out;
+
+        int result = inflate(&zs, Z_NO_FLUSH);
+        produced += before - zs.avail_out;
+
+        if (result == Z_STREAM_END) {
+            if (zs.avail_in == 0 && remaining == 0) done = true;
+            else inflateReset(&zs);   // the next gzip member follows
+        } else if (result == Z_BUF_ERROR && zs.avail_in == 0 && remaining == 0) {
+            error = "unexpected end of gzip data";
+            break;
+        } else if (result != Z_OK && result != Z_BUF_ERROR) {
+            error = zs.msg ? zs.msg : "corrupt gzip data";
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    output.resize(produced);
+    return done;
+}
+#endif
+
+#ifdef NEURONMESHER_WITH_ZSTD
+bool unzstd(std::string_view input, std::vector<char>& output, std::string& error) {
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    if (!context) {
+        error = "ZSTD_createDCtx failed";
+        return false;
+    }
+
+    ZSTD_inBuffer in{input.data(), input.size(), 0};
+    std::size_t produced = 0;
+    std::size_t pending = 1;   // non-zero while a frame is incomplete
+    output.resize(std::max<std::size_t>(input.size() * 4, 1 << 16));
+
+    bool done = true;
+    while (done && (in.pos < in.size || pending != 0)) {
+        if (produced == output.size()) output.resize(output.size() * 2);
+        ZSTD_outBuffer out{output.data() + produced, output.size() - produced, 0};
+        const std::size_t consumed = in.pos;
+        pending = ZSTD_decompressStream(context, &out, &in);
+        produced += out.pos;
+        if (ZSTD_isError(pending)) {
+            error = ZSTD_getErrorName(pending);
+            done = false;
+        } else if (pending != 0 && out.pos == 0 && in.pos == consumed) {
+            error = "unexpected end of zstd data";
+            done = false;
+        }
+    }
+    ZSTD_freeDCtx(context);
+    output.resize(produced);
+    return done;
+}
+#endif
+
+} // namespace
+
+Compression compressionFromFilename(const std::string& filename) {
+    if (endsWith(filename, ".gz")) return Compression::Gzip;
+    if (endsWith(filename, ".zst")) return Compression::Zstd;
+    return Compression::None;
+}
+
+bool compressionAvailable(Compression compression) {
+    switch (compression) {
+#ifdef NEURONMESHER_WITH_ZLIB
+        case Compression::Gzip: return true;
+#endif
+#ifdef NEURONMESHER_WITH_ZSTD
+        case Compression::Zstd: return true;
+#endif
+        case Compression::None: return true;
+        default: return false;
+    }
+}
+
+CompressionOptions CompressionOptions::fromEnvironment() {
+    CompressionOptions options;
+    if (const char* env = std::getenv("NEURONMESHER_COMPRESSION_LEVEL")) {
+        char* end = nullptr;
+        long level = std::strtol(env, &end, 10);
+        if (end != env) options.level = static_cast<int>(level);
+    }
+    if (const char* env = std::getenv("NEURONMESHER_COMPRESSION_THREADS")) {
+        char* end = nullptr;
+        unsigned long threads = std::strtoul(env, &end, 10);
+        if (end != env) options.threads = threads;
+    }
+    return options;
+}
+
+void setCompressionOptions(const CompressionOptions& options) {
+    std::lock_guard<std::mutex> lock(compressionOptionsMutex);
+    activeCompressionOptions() = options;
+}
+
+CompressionOptions getCompressionOptions() {
+    std::lock_guard<std::mutex> lock(compressionOptionsMutex);
+    return activeCompressionOptions();
+}
+
+std::string outputCompressionSuffix() {
+    const char* env = std::getenv("NEURONMESHER_COMPRESS");
+    if (!env) return "";
+    std::string codec = env;
+    if (codec == "gz" || codec == "gzip") return ".gz";
+    if (codec == "zst" || codec == "zstd") return ".zst";
+    return "";
+}
+
+bool decompressBuffer(Compression compression, std::string_view input, std::vector<char>& output,
+                      std::string& error) {
+    NM_SCOPED_TIMER("decompress");
+    output.clear();
+    bool ok = false;
+    switch (compression) {
+        case Compression::None:
+            output.assign(input.begin(), input.end());
+            return true;
+        case Compression::Gzip:
+#ifdef NEURONMESHER_WITH_ZLIB
+            ok = gunzip(input, output, error);
+#else
+            error = "built without gzip (zlib) support";
+#endif
+            break;
+        case Compression::Zstd:
+#ifdef NEURONMESHER_WITH_ZSTD
+            ok = unzstd(input, output, error);
+#else
+            error = "built without zstd support";
+#endif
+            break;
+    }
+    if (ok) NM_COUNT("bytes.decompressed", output.size());
+    return ok;
+}
+
+// ============================================================================
+// CompressedFileWriter
+// ============================================================================
+
+struct CompressedFileWriter::Codec {
+    static constexpr std::size_t blockSize = std::size_t{1} << 20;
+
+    CompressionOptions options;
+    std::size_t threads = 1;
+    std::uint64_t bytesIn = 0;
+
+    // gzip: input of the next member, and members being compressed in order
+    std::string block;
+    bool anyMember = false;
+    std::deque<std::future<std::string>> members;
+    std::unique_ptr<IoService> workers;   // only with more than one thread
+
+#ifdef NEURONMESHER_WITH_ZSTD
+    ZSTD_CCtx* zstd = nullptr;
+    std::vector<char> out;
+    ~Codec() { ZSTD_freeCCtx(zstd); }
+#endif
+};
+
+CompressedFileWriter::CompressedFileWriter() = default;
+
+CompressedFileWriter::~CompressedFileWriter() {
+    close();
+}
+
+bool CompressedFileWriter::isOpen() const {
+    return file != nullptr;
+}
+
+bool CompressedFileWriter::open(const std::string& filename, const CompressionOptions& options) {
+    close();
+    ok = true;
+    error.clear();
+    format = compressionFromFilename(filename);
+    if (!compressionAvailable(format)) {
+        error = std::string("built without ") + codecName(format) + " support";
+        std::cerr << "Cannot write " << filename << ": " << error << std::endl;
+        ok = false;
+        return false;
+    }
+
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        error = "cannot create " + filename;
+        ok = false;
+        return false;
+    }
+    if (format == Compression::None) return true;
+
+    codec = std::make_unique<Codec>();
+    codec->options = options;
+    codec->threads = options.threads ? options.threads : ThreadPool::defaultThreadCount();
+
+#ifdef NEURONMESHER_WITH_ZLIB
+    if (format == Compression::Gzip) {
+        codec->block.reserve(Codec::blockSize);
+        if (codec->threads > 1) codec->workers = std::make_unique<IoService>(codec->threads, codec->threads);
+    }
+#endif
+#ifdef NEURONMESHER_WITH_ZSTD
+    if (format == Compression::Zstd) {
+        codec->zstd = ZSTD_createCCtx();
+        codec->out.resize(ZSTD_CStreamOutSize());
+        ZSTD_CCtx_setParameter(codec->zstd, ZSTD_c_compressionLevel,
+                               options.level < 0 ? ZSTD_CLEVEL_DEFAULT : options.level);
+        // fails harmlessly (single-threaded) if libzstd was built without threads
+        if (codec->threads > 1) {
+            ZSTD_CCtx_setParameter(codec->zstd, ZSTD_c_nbWorkers, static_cast<int>(codec->threads));
+        }
+    }
+#endif
+    return true;
+}
+
+bool CompressedFileWriter::writeRaw(const char* data, std::size_t size) {
+    if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+        if (ok) error = "write failed";
+        ok = false;
+    }
+    return ok;
+}
+
+bool CompressedFileWriter::write(const char* data, std::size_t size) {
+    if (!file) return false;
+    if (format == Compression::None) return writeRaw(data, size);
+    codec->bytesIn += size;
+
+#ifdef NEURONMESHER_WITH_ZLIB
+    if (format == Compression::Gzip) {
+        // hands the full block to a worker (or compresses it here) and writes finished members in order
+        auto emitBlock = [this] {
+            Codec& c = *codec;
+            c.anyMember = true;
+            if (!c.workers) {
+                std::string member = gzipMember(c.block, c.options.level);
+                c.block.clear();
+                return writeRaw(member.data(), member.size());
+            }
+            c.members.push_back(c.workers->submit([input = std::move(c.block), level = c.options.level] {
+                return gzipMember(input, level);
+            }));
+            c.block = std::string();
+            c.block.reserve(Codec::blockSize);
+            while (c.members.size() > 2 * c.threads) {
+                std::string member = c.members.front().get();
+                c.members.pop_front();
+                writeRaw(member.data(), member.size());
+            }
+            return ok;
+        };
+
+        try {
+            while (size > 0) {
+                std::size_t n = std::min(size, Codec::blockSize - codec->block.size());
+                codec->block.append(data, n);
+                data += n;
+                size -= n;
+                if (codec->block.size() == Codec::blockSize) emitBlock();
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+            ok = false;
+        }
+        return ok;
+    }
+#endif
+
+#ifdef NEURONMESHER_WITH_ZSTD
+    if (format == Compression::Zstd) {
+        ZSTD_inBuffer in{data, size, 0};
+        while (in.pos < in.size) {
+            ZSTD_outBuffer out{codec->out.data(), codec->out.size(), 0};
+            std::size_t result = ZSTD_compressStream2(codec->zstd, &out, &in, ZSTD_e_continue);
+            if (ZSTD_isError(result)) {
+                error = ZSTD_getErrorName(result);
+                ok = false;
+                return false;
+            }
+            writeRaw(codec->out.data(), out.pos);
+        }
+        return ok;
+    }
+#endif
+    return ok;
+}
+
+bool CompressedFileWriter::close() {
+    if (!file) return false;
+
+    if (codec) {
+#ifdef NEURONMESHER_WITH_ZLIB
+        if (format == Compression::Gzip) {
+            try {
+                for (auto& member : codec->members) {
+                    std::string bytes = member.get();
+                    writeRaw(bytes.data(), bytes.size());
+                }
+                // an empty file still gets one (empty) member, so it is valid gzip
+                if (!codec->block.empty() || !codec->anyMember) {
+                    std::string bytes = gzipMember(codec->block, codec->options.level);
+                    writeRaw(bytes.data(), bytes.size());
+                }
+            } catch (const std::exception& e) {
+                if (ok) error = e.what();
+                ok = false;
+            }
+            codec->members.clear();
+            codec->workers.reset();
+        }
+#endif
+#ifdef NEURONMESHER_WITH_ZSTD
+        if (format == Compression::Zstd) {
+            ZSTD_inBuffer in{nullptr, 0, 0};
+            for (;;) {
+                ZSTD_outBuffer out{codec->out.data(), codec->out.size(), 0};
+                std::size_t remaining = ZSTD_compressStream2(codec->zstd, &out, &in, ZSTD_e_end);
+                if (ZSTD_isError(remaining)) {
+                    error = ZSTD_getErrorName(remaining);
+                    ok = false;
+                    break;
+                }
+                writeRaw(codec->out.data(), out.pos);
+                if (remaining == 0) break;
+            }
+        }
+#endif
+        NM_COUNT("bytes.compressed.in", codec->bytesIn);
+        NM_COUNT("bytes.compressed.out", static_cast<std::uint64_t>(std::ftell(file)));
+        codec.reset();
+    }
+
+    if (std::fclose(file) != 0) {
+        if (ok) error = "close failed";
+        ok = false;
+    }
+    file = nullptr;
+    return ok;
+}
+
+// ============================================================================
+// CompressedOutputStream
+// ============================================================================
+
+CompressedOutputStream::Buffer::Buffer(CompressedFileWriter& writer) : writer(writer), storage(1 << 16) {
+    setp(storage.data(), storage.data() + storage.size());
+}
+
+CompressedOutputStream::Buffer::int_type CompressedOutputStream::Buffer::overflow(int_type c) {
+    if (sync() != 0) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int CompressedOutputStream::Buffer::sync() {
+    std::size_t n = static_cast<std::size_t>(pptr() - pbase());
+    bool written = writer.write(pbase(), n);
+    setp(storage.data(), storage.data() + storage.size());
+    return written ? 0 : -1;
+}
+
+CompressedOutputStream::CompressedOutputStream(const std::string& filename, const CompressionOptions& options)
+    : std::ostream(nullptr), buffer(writer) {
+    if (writer.open(filename, options)) rdbuf(&buffer);
+    else setstate(std::ios::failbit);
+}
+
+CompressedOutputStream::~CompressedOutputStream() {
+    close();
+}
+
+bool CompressedOutputStream::close() {
+    if (!writer.isOpen()) return false;
+    flush();
+    bool closed = writer.close();
+    if (!closed) setstate(std::ios::badbit);
+    return closed && !fail();
+}
@@ -0,0 +1,256 @@
+/**
+ * @file morphology.cpp
+ * @brief Implementation of the flat structure-of-arrays morphology storage
+ *
+ * This file implements the Morphology container used by NeuronGraph as its
+ * internal node storage. Nodes live in parallel, contiguous arrays sorted by
+ * SWC id, and parent/child relationships are resolved to dense row indices
+ * so traversals avoid map lookups and per-node allocations.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include <atomic>
+#include "morphology.h"
+#include "neurongraph.h"
+
+/**
+ * @brief Hands out revision stamps
+ * @return A stamp that is unique within the process
+ */
+std::uint64_t Morphology::nextRevision() {
+    static std::atomic<std::uint64_t> counter{0};
+    return ++counter;
+}
+
+/**
+ * @brief Removes all nodes and the derived topology
+ */
+void Morphology::clear() {
+    id.clear();
+    pid.clear();
+    type.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+    parent.clear();
+    childOffsets.clear();
+    children.clear();
+    topologyValid = false;
+    stamp = nextRevision();
+}
+
+/**
+ * @brief Reserves storage for a number of nodes
+ * @param n Number of nodes to reserve space for
+ */
+void Morphology::reserve(std::size_t n) {
+    id.reserve(n);
+    pid.reserve(n);
+    type.reserve(n);
+    x.reserve(n);
+    y.reserve(n);
+    z.reserve(n);
+    radius.reserve(n);
+}
+
+/**
+ * @brief Looks up the dense row of an SWC id
+ * @param nodeId The SWC id to look up
+ * @return The row index, or -1 if the id is not stored
+ *
+ * Most SWC files number their nodes 1..n, in which case the row is found by
+ * a single subtraction. Sparse id ranges fall back to a binary search.
+ */
+int Morphology::indexOf(int nodeId) const {
+    if (id.empty()) return -1;
+
+    const int first = id.front();
+    const int last  = id.back();
+    if (nodeId < first || nodeId > last) return -1;
+
+    if (static_cast<std::size_t>(last - first) + 1 == id.size()) {
+        return nodeId - first;
+    }
+
+    auto it = std::lower_bound(id.begin(), id.end(), nodeId);
+    if (it != id.end() && *it == nodeId) {
+        return static_cast<int>(it - id.begin());
+    }
+    return -1;
+}
+
+/**
+ * @brief Appends a node at the end of every column
+ * @param node The node to append
+ */
+void Morphology::appendRow(const SWCNode& node) {
+    id.push_back(node.id);
+    pid.push_back(node.pid);
+    type.push_back(node.type);
+    x.push_back(node.x);
+    y.push_back(node.y);
+    z.push_back(node.z);
+    radius.push_back(node.radius);
+}
+
+/**
+ * @brief Inserts or overwrites a node while keeping rows sorted by id
+ * @param node The node to store
+ * @return The row index at which the node is stored
+ *
+ * This mirrors the semantics of `nodes[node.id] = node` on a std::map: an
+ * existing id is overwritten in place, a new id is inserted at its sorted
+ * position. The derived topology is invalidated.
+ */
+int Morphology::setNode(const SWCNode& node) {
+    topologyValid = false;
+    stamp = nextRevision();
+
+    if (id.empty() || node.id > id.back()) {
+        appendRow(node);
+        return static_cast<int>(id.size()) - 1;
+    }
+
+    auto it = std::lower_bound(id.begin(), id.end(), node.id);
+    std::size_t row = static_cast<std::size_t>(it - id.begin());
+
+    if (it != id.end() && *it == node.id) {
+        pid[row]    = node.pid;
+        type[row]   = node.type;
+        x[row]      = node.x;
+        y[row]      = node.y;
+        z[row]      = node.z;
+        radius[row] = node.radius;
+        return static_cast<int>(row);
+    }
+
+    id.insert(id.begin() + row, node.id);
+    pid.insert(pid.begin() + row, node.pid);
+    type.insert(type.begin() + row, node.type);
+    x.insert(x.begin() + row, node.x);
+    y.insert(y.begin() + row, node.y);
+    z.insert(z.begin() + row, node.z);
+    radius.insert(radius.begin() + row, node.radius);
+    return static_cast<int>(row);
+}
+
+/**
+ * @brief Returns a row as an SWCNode
+ * @param i The row index
+ * @return The node stored at row i
+ */
+SWCNode Morphology::node(std::size_t i) const {
+    SWCNode n;
+    n.id     = id[i];
+    n.pid    = pid[i];
+    n.type   = type[i];
+    n.x      = x[i];
+    n.y      = y[i];
+    n.z      = z[i];
+    n.radius = radius[i];
+    return n;
+}
+
+/**
+ * @brief Resolves dense parent indices and builds the CSR child lists
+ *
+ * The build is two linear passes: the first resolves every parent id to a row
+ * and counts children per row, the second scatters child rows into place.
+ * Because rows are visited in increasing order, each child list is sorted.
+ */
+void Morphology::buildTopology() {
+    const std::size_t n = size();
+    parent.assign(n, -1);
+    childOffsets.assign(n + 1, 0);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        if (pid[i] == -1) continue;
+        int p = indexOf(pid[i]);
+        parent[i] = p;
+        if (p != -1) ++childOffsets[p + 1];
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        childOffsets[i + 1] += childOffsets[i];
+    }
+
+    children.assign(childOffsets[n], 0);
+    std::vector<int> cursor(childOffsets.begin(), childOffsets.end() - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (parent[i] != -1) children[cursor[parent[i]]++] = static_cast<int>(i);
+    }
+
+    topologyValid = true;
+    stamp = nextRevision();
+}
+
+/**
+ * @brief Adopts parent indices and CSR child lists computed elsewhere
+ * @param parentRows Dense parent row of every node
+ * @param offsets CSR offsets into childRows
+ * @param childRows CSR child rows
+ * @return true if the arrays were valid and adopted
+ *
+ * The arrays are range checked in one linear pass, which keeps loading a
+ * cached topology safe against truncated or foreign files.
+ */
+bool Morphology::assignTopology(std::vector<int> parentRows, std::vector<int> offsets, std::vector<int> childRows) {
+    const std::size_t n = size();
+    bool valid = parentRows.size() == n && offsets.size() == n + 1 &&
+                 offsets.front() == 0 && static_cast<std::size_t>(offsets.back()) == childRows.size();
+    for (std::size_t i = 0; valid && i < n; ++i) {
+        valid = parentRows[i] >= -1 && parentRows[i] < static_cast<int>(n) && offsets[i] <= offsets[i + 1];
+    }
+    for (std::size_t i = 0; valid && i < childRows.size(); ++i) {
+        valid = childRows[i] >= 0 && childRows[i] < static_cast<int>(n);
+    }
+
+    if (!valid) {
+        buildTopology();
+        return false;
+    }
+
+    parent = std::move(parentRows);
+    childOffsets = std::move(offsets);
+    children = std::move(childRows);
+    topologyValid = true;
+    stamp = nextRevision();
+    return true;
+}
+
+/**
+ * @brief Builds a flat morphology from a node map
+ * @param nodeSet Map of SWC nodes indexed by id
+ * @return A Morphology with resolved topology
+ *
+ * Nodes are stored under their own id (as addNode() does). Map iteration is
+ * ordered by key, so for the usual key == id case every node is appended in O(1).
+ */
+Morphology Morphology::fromNodes(const std::map<int, SWCNode>& nodeSet) {
+    Morphology m;
+    m.reserve(nodeSet.size());
+    for (const auto& [_, node] : nodeSet) {
+        m.setNode(node);
+    }
+    m.buildTopology();
+    return m;
+}
+
+/**
+ * @brief Converts the flat storage back into a node map
+ * @return Map of SWC nodes indexed by id
+ *
+ * Rows are emitted in id order, so every insertion uses an end hint.
+ */
+std::map<int, SWCNode> Morphology::toNodes() const {
+    std::map<int, SWCNode> nodeSet;
+    for (std::size_t i = 0; i < size(); ++i) {
+        nodeSet.emplace_hint(nodeSet.end(), id[i], node(i));
+    }
+    return nodeSet;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file morphometrics.cpp
+ * @brief Implementation of the single-pass morphometrics engine
+ *
+ * Work is split into fixed-size blocks of rows and into sections, never by
+ * thread, and partial sums are reduced in block or section order, which
+ * keeps floating point results independent of the thread count.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "morphometrics.h"
+#include "instrumentation.h"
+#include "threadpool.h"
+
+namespace {
+
+constexpr std::size_t morphometricsBlockRows = std::size_t{1} << 14;
+constexpr int somaType = 1;
+
+// Sums of one block of rows
+struct BlockSums {
+    std::vector<double> length, area, volume;   // per type
+    std::vector<int> shollDiff;                 // difference array over the Sholl shells
+    double totalLength = 0.0, totalArea = 0.0, totalVolume = 0.0;
+};
+
+} // namespace
+
+Morphometrics computeMorphometrics(const Morphology& morph, const MorphometricsOptions& options) {
+    NM_SCOPED_TIMER("morphometrics");
+    if (!(options.shollStep > 0)) throw std::invalid_argument("shollStep must be positive");
+
+    Morphometrics m;
+    const std::size_t n = morph.size();
+    m.sectionOffsets.push_back(0);
+    if (n == 0) return m;
+
+    // Parent rows and the child lists
+    std::vector<int> parentRows(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        int p = morph.pid[i] == -1 ? -1 : morph.hasTopology() ? morph.parent[i] : morph.indexOf(morph.pid[i]);
+        parentRows[i] = p == static_cast<int>(i) ? -1 : p;
+    }
+    std::vector<int> childOffsets(n + 1, 0), children;
+    for (int p : parentRows)
+        if (p >= 0) ++childOffsets[p + 1];
+    for (std::size_t i = 0; i < n; ++i) childOffsets[i + 1] += childOffsets[i];
+    children.resize(childOffsets[n]);
+    {
+        std::vector<int> fill(childOffsets.begin(), childOffsets.end() - 1);
+        for (std::size_t i = 0; i < n; ++i)
+            if (parentRows[i] >= 0) children[fill[parentRows[i]]++] = static_cast<int>(i);
+    }
+    auto childCount = [&](int row) { return childOffsets[row + 1] - childOffsets[row]; };
+
+    int maxType = 0;
+    std::size_t somaNodes = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        maxType = std::max(maxType, morph.type[i]);
+        if (morph.type[i] == somaType) {
+            m.shollCenter[0] += morph.x[i];
+            m.shollCenter[1] += morph.y[i];
+            m.shollCenter[2] += morph.z[i];
+            ++somaNodes;
+        }
+        const bool soma = morph.type[i] == somaType;
+        const int c = childCount(static_cast<int>(i));
+        if (!soma && c >= 2) ++m.branchPoints;
+        if (!soma && c == 0) ++m.tips;
+        if (!soma && parentRows[i] >= 0 && morph.type[parentRows[i]] == somaType) ++m.stems;
+    }
+    if (somaNodes > 0) {
+        for (double& c : m.shollCenter) c /= static_cast<double>(somaNodes);
+    } else {
+        std::size_t root = 0;
+        while (root + 1 < n && parentRows[root] != -1) ++root;
+        m.shollCenter = {morph.x[root], morph.y[root], morph.z[root]};
+    }
+    const std::size_t types = static_cast<std::size_t>(maxType) + 1;
+
+    const std::size_t blocks = (n + morphometricsBlockRows - 1) / morphometricsBlockRows;
+    auto blockRange = [&](std::size_t b) {
+        return std::make_pair(b * morphometricsBlockRows, std::min(n, (b + 1) * morphometricsBlockRows));
+    };
+
+    // Pass 1: distance of every node from the Sholl center (contiguous, vectorizable)
+    std::vector<double> centerDistance(n);
+    std::vector<double> blockMax(blocks, 0.0);
+    parallelFor(blocks, options.threads, [&](std::size_t b) {
+        auto [begin, end] = blockRange(b);
+        const double cx = m.shollCenter[0], cy = m.shollCenter[1], cz = m.shollCenter[2];
+        const double* x = morph.x.data();
+        const double* y = morph.y.data();
+        const double* z = morph.z.data();
+        double* d = centerDistance.data();
+        double furthest = 0.0;
+        for (std::size_t i = begin; i < end; ++i) {
+            double dx = x[i] - cx, dy = y[i] - cy, dz = z[i] - cz;
+            d[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+            furthest = std::max(furthest, d[i]);
+        }
+        blockMax[b] = furthest;
+    });
+    const double farthest = *std::max_element(blockMax.begin(), blockMax.end());
+    const std::size_t shells = static_cast<std::size_t>(std::ceil(farthest / options.shollStep));
+
+    // Pass 2: segments, per-type sums and Sholl crossings per block
+    m.segmentLength.assign(n, 0.0);
+    std::vector<BlockSums> sums(blocks);
+    parallelFor(blocks, options.threads, [&](std::size_t b) {
+        auto [begin, end] = blockRange(b);
+        const std::size_t count = end - begin;
+        thread_local std::vector<double> px, py, pz, pr, area, volume;
+        px.resize(count); py.resize(count); pz.resize(count); pr.resize(count);
+        area.resize(count); volume.resize(count);
+
+        // gather the parent of every row (a root is its own parent: zero length)
+        for (std::size_t k = 0; k < count; ++k) {
+            const int p = parentRows[begin + k];
+            const std::size_t q = p < 0 ? begin + k : static_cast<std::size_t>(p);
+            px[k] = morph.x[q];
+            py[k] = morph.y[q];
+            pz[k] = morph.z[q];
+            pr[k] = morph.radius[q];
+        }
+
+        // branch-free over contiguous arrays, so the compiler vectorizes it
+        const double* x = morph.x.data() + begin;
+        const double* y = morph.y.data() + begin;
+        const double* z = morph.z.data() + begin;
+        const double* r = morph.radius.data() + begin;
+        double* length = m.segmentLength.data() + begin;
+        for (std::size_t k = 0; k < count; ++k) {
+            const double dx = x[k] - px[k], dy = y[k] - py[k], dz = z[k] - pz[k];
+            const double l = std::sqrt(dx * dx + dy * dy + dz * dz);
+            const double dr = r[k] - pr[k];
+            length[k] = l;
+            area[k] = M_PI * (r[k] + pr[k]) * std::sqrt(l * l + dr * dr);
+            volume[k] = M_PI * l * (r[k] * r[k] + r[k] * pr[k] + pr[k] * pr[k]) / 3.0;
+        }
+
+        BlockSums& s = sums[b];
+        s.length.assign(types, 0.0);
+        s.area.assign(types, 0.0);
+        s.volume.assign(types, 0.0);
+        s.shollDiff.assign(shells + 2, 0);
+        for (std::size_t k = 0; k < count; ++k) {
+            const std::size_t i = begin + k;
+            s.totalLength += length[k];
+            s.totalArea += area[k];
+            s.totalVolume += volume[k];
+            if (morph.type[i] >= 0) {
+                s.length[morph.type[i]] += length[k];
+                s.area[morph.type[i]] += area[k];
+                s.volume[morph.type[i]] += volume[k];
+            }
+
+            // the segment crosses the spheres of radius j * step with lo < j * step <= hi
+            const int p = parentRows[i];
+            if (p < 0 || (morph.type[i] == somaType && morph.type[p] == somaType)) continue;
+            const double lo = std::min(centerDistance[i], centerDistance[p]);
+            const double hi = std::max(centerDistance[i], centerDistance[p]);
+            const std::size_t first = static_cast<std::size_t>(std::floor(lo / options.shollStep)) + 1;
+            const std::size_t last = std::min(shells, static_cast<std::size_t>(std::floor(hi / options.shollStep)));
+            if (first <= last) {
+                ++s.shollDiff[first];
+                --s.shollDiff[last + 1];
+            }
+        }
+    });
+
+    m.lengthByType.assign(types, 0.0);
+    m.areaByType.assign(types, 0.0);
+    m.volumeByType.assign(types, 0.0);
+    std::vector<int> shollDiff(shells + 2, 0);
+    for (const BlockSums& s : sums) {
+        m.totalLength += s.totalLength;
+        m.totalArea += s.totalArea;
+        m.totalVolume += s.totalVolume;
+        for (std::size_t t = 0; t < types; ++t) {
+            m.lengthByType[t] += s.length[t];
+            m.areaByType[t] += s.area[t];
+            m.volumeByType[t] += s.volume[t];
+        }
+        for (std::size_t j = 0; j < shollDiff.size(); ++j) shollDiff[j] += s.shollDiff[j];
+    }
+    m.shollRadii.resize(shells);
+    m.shollIntersections.resize(shells);
+    int crossing = 0;
+    for (std::size_t j = 1; j <= shells; ++j) {
+        crossing += shollDiff[j];
+        m.shollRadii[j - 1] = static_cast<double>(j) * options.shollStep;
+        m.shollIntersections[j - 1] = crossing;
+    }
+
+    // Sections in depth-first order from the roots
+    std::vector<std::pair<int, int>> stack;   // first row, parent section
+    for (std::size_t i = n; i-- > 0;)
+        if (parentRows[i] == -1) stack.emplace_back(static_cast<int>(i), -1);
+    m.sectionRows.reserve(n);
+    while (!stack.empty()) {
+        auto [row, parentSection] = stack.back();
+        stack.pop_back();
+        const int section = static_cast<int>(m.sectionParent.size());
+        m.sectionParent.push_back(parentSection);
+        for (;;) {
+            m.sectionRows.push_back(row);
+            if (childCount(row) != 1) break;
+            row = children[childOffsets[row]];
+        }
+        m.sectionOffsets.push_back(static_cast<int>(m.sectionRows.size()));
+        for (int c = childOffsets[row + 1]; c-- > childOffsets[row];) stack.emplace_back(children[c], section);
+    }
+    const std::size_t sections = m.sectionParent.size();
+
+    // Pass 3: per section, its length, tortuosity and the path length within it
+    m.pathDistance.assign(n, 0.0);
+    m.sectionLength.resize(sections);
+    m.sectionTortuosity.resize(sections);
+    parallelFor(sections, options.threads, [&](std::size_t s) {
+        const int* rows = m.sectionRows.data() + m.sectionOffsets[s];
+        const int count = m.sectionOffsets[s + 1] - m.sectionOffsets[s];
+        double walked = 0.0;
+        for (int k = 0; k < count; ++k) {
+            walked += m.segmentLength[rows[k]];
+            m.pathDistance[rows[k]] = walked;
+        }
+        const int from = parentRows[rows[0]] >= 0 ? parentRows[rows[0]] : rows[0];
+        const int to = rows[count - 1];
+        const double dx = morph.x[to] - morph.x[from], dy = morph.y[to] - morph.y[from], dz = morph.z[to] - morph.z[from];
+        const double chord = std::sqrt(dx * dx + dy * dy + dz * dz);
+        m.sectionLength[s] = walked;
+        m.sectionTortuosity[s] = chord > 0.0 ? walked / chord : 1.0;
+    });
+
+    // Link the sections: start distance and branch order from the parent section
+    std::vector<double> sectionStart(sections, 0.0);
+    m.sectionOrder.assign(sections, 0);
+    for (std::size_t s = 0; s < sections; ++s) {
+        const int p = m.sectionParent[s];
+        if (p < 0) continue;
+        const int branchRow = m.sectionRows[m.sectionOffsets[p + 1] - 1];
+        sectionStart[s] = sectionStart[p] + m.sectionLength[p];
+        m.sectionOrder[s] = m.sectionOrder[p] + (morph.type[branchRow] == somaType ? 0 : 1);
+    }
+
+    // Pass 4: node values of every section
+    m.branchOrder.assign(n, -1);
+    parallelFor(sections, options.threads, [&](std::size_t s) {
+        for (int k = m.sectionOffsets[s]; k < m.sectionOffsets[s + 1]; ++k) {
+            const int row = m.sectionRows[k];
+            m.pathDistance[row] += sectionStart[s];
+            m.branchOrder[row] = m.sectionOrder[s];
+        }
+    });
+
+    for (std::size_t s = 0; s < sections; ++s) {
+        m.maxBranchOrder = std::max(m.maxBranchOrder, m.sectionOrder[s]);
+        m.maxPathDistance = std::max(m.maxPathDistance, sectionStart[s] + m.sectionLength[s]);
+    }
+
+    NM_COUNT("morphometrics.nodes", n);
+    NM_COUNT("morphometrics.sections", sections);
+    return m;
+}
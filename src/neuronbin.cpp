@@ -0,0 +1,188 @@
+/**
+ * @file neuronbin.cpp
+ * @brief Binary cache support for neuron morphologies
+ *
+ * This file implements writing NeuronGraph nodes to the binary cache
+ * container described in bincache.h and loading them back from a
+ * memory-mapped file. The cache stores the flat Morphology columns together
+ * with the resolved parent indices and CSR child lists, so a load is a
+ * handful of bulk copies instead of a text parse and a topology rebuild.
+ *
+ * Typical use is converting a data set once with swc2bin()/ugx2bin() and
+ * pointing later runs at the .bin files.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "neurongraph.h"
+#include "bincache.h"
+
+static_assert(sizeof(int) == sizeof(std::int32_t), "binary cache stores int columns as int32");
+
+/**
+ * @brief Writes a morphology to a binary cache file
+ * @param m Morphology with up-to-date topology
+ * @param filename Output path
+ * @param precision Storage type of the coordinate and radius columns
+ * @return true on success
+ */
+static bool writeMorphologyBinary(const Morphology& m, const std::string& filename, StoragePrecision precision) {
+    BinaryCacheWriter writer;
+    writer.addSection(BinarySection::NodeId,          m.id);
+    writer.addSection(BinarySection::NodeParentId,    m.pid);
+    writer.addSection(BinarySection::NodeType,        m.type);
+
+    // single precision columns are narrowed copies that live until write() returns
+    std::vector<float> narrowed[4];
+    const std::vector<double>* columns[4] = {&m.x, &m.y, &m.z, &m.radius};
+    const BinarySection ids[4] = {BinarySection::NodeX, BinarySection::NodeY, BinarySection::NodeZ,
+                                  BinarySection::NodeRadius};
+    for (int c = 0; c < 4; ++c) {
+        if (precision == StoragePrecision::Float32) {
+            narrowed[c].assign(columns[c]->begin(), columns[c]->end());
+            writer.addSection(ids[c], narrowed[c]);
+        } else {
+            writer.addSection(ids[c], *columns[c]);
+        }
+    }
+    writer.addSection(BinarySection::NodeParentIndex, m.parent);
+    writer.addSection(BinarySection::ChildOffsets,    m.childOffsets);
+    writer.addSection(BinarySection::Children,        m.children);
+    return writer.write(filename, BinaryCacheKind::Morphology);
+}
+
+/**
+ * @brief Writes a set of nodes to a binary cache file
+ * @param nodeSet Map of SWC nodes to write
+ * @param filename Output path (conventionally with a .bin extension)
+ * @param precision Storage type of coordinates and radii
+ *
+ * @see readFromFileBIN() for loading the file back
+ */
+void NeuronGraph::writeToFileBIN(const std::map<int, SWCNode>& nodeSet, const std::string& filename,
+                                 StoragePrecision precision) {
+    NM_SCOPED_TIMER("writeBIN");
+    if (!writeMorphologyBinary(Morphology::fromNodes(nodeSet), filename, precision)) {
+        std::cerr << "Failed to write BIN file: " << filename << std::endl;
+    } else {
+        NM_COUNT("nodes.written", nodeSet.size());
+        NM_LOG(Info) << "WriteBIN ..." << filename << std::endl;
+    }
+}
+
+/**
+ * @brief Writes the graph's own nodes to a binary cache file
+ * @param filename Output path
+ * @param precision Storage type of coordinates and radii
+ *
+ * The internal flat storage is written directly, without going through a
+ * node map.
+ */
+void NeuronGraph::writeToFileBIN(const std::string& filename, StoragePrecision precision) {
+    NM_SCOPED_TIMER("writeBIN");
+    if (!writeMorphologyBinary(getMorphology(), filename, precision)) {
+        std::cerr << "Failed to write BIN file: " << filename << std::endl;
+    } else {
+        NM_COUNT("nodes.written", morph.size());
+        NM_LOG(Info) << "WriteBIN ..." << filename << std::endl;
+    }
+}
+
+/**
+ * @brief Loads neuron nodes from a binary cache file
+ * @param filename Path to a file written by writeToFileBIN()
+ *
+ * The file is memory-mapped and each column is copied into the flat storage
+ * with a single bulk copy; single precision columns are widened to double.
+ * A stored topology is validated and adopted; if it is missing or
+ * inconsistent it is rebuilt.
+ *
+ * @note Clears existing graph data before loading
+ * @warning Files of another kind, version or byte order are rejected with an
+ *          error message and leave the graph empty
+ */
+void NeuronGraph::readFromFileBIN(const std::string& filename) {
+    NM_SCOPED_TIMER("readBIN");
+    morph.clear();
+
+    BinaryCacheFile file;
+    if (!file.open(filename)) {
+        std::cerr << "[BIN Error] Failed to load " << filename << ": " << file.errorMessage() << std::endl;
+        return;
+    }
+    if (file.kind() != BinaryCacheKind::Morphology) {
+        std::cerr << "[BIN Error] " << filename << " does not contain a morphology\n";
+        return;
+    }
+
+    auto id     = file.section<int>(BinarySection::NodeId);
+    auto pid    = file.section<int>(BinarySection::NodeParentId);
+    auto type   = file.section<int>(BinarySection::NodeType);
+    const std::size_t n = id.size;
+
+    // a float64 or float32 column of n values, widened into the flat storage
+    auto loadColumn = [&file, n](BinarySection section, std::vector<double>& target) {
+        auto wide = file.section<double>(section);
+        auto narrow = file.section<float>(section);
+        if (wide.size == n) target.assign(wide.begin(), wide.end());
+        else if (narrow.size == n) target.assign(narrow.begin(), narrow.end());
+        else return false;
+        return true;
+    };
+
+    const bool idsIncreasing =
+        std::adjacent_find(id.begin(), id.end(), [](int a, int b) { return a >= b; }) == id.end();
+    if (pid.size != n || type.size != n || !idsIncreasing || !loadColumn(BinarySection::NodeX, morph.x) ||
+        !loadColumn(BinarySection::NodeY, morph.y) || !loadColumn(BinarySection::NodeZ, morph.z) ||
+        !loadColumn(BinarySection::NodeRadius, morph.radius)) {
+        morph.clear();
+        std::cerr << "[BIN Error] Inconsistent node columns in " << filename << std::endl;
+        return;
+    }
+
+    morph.id.assign(id.begin(), id.end());
+    morph.pid.assign(pid.begin(), pid.end());
+    morph.type.assign(type.begin(), type.end());
+
+    auto parent   = file.section<int>(BinarySection::NodeParentIndex);
+    auto offsets  = file.section<int>(BinarySection::ChildOffsets);
+    auto children = file.section<int>(BinarySection::Children);
+    morph.assignTopology(std::vector<int>(parent.begin(), parent.end()),
+                         std::vector<int>(offsets.begin(), offsets.end()),
+                         std::vector<int>(children.begin(), children.end()));
+
+    NM_COUNT("nodes.read", morph.size());
+    NM_COUNT("bytes.read", file.size());
+    NM_LOG(Info) << "Read BIN ... " << filename << " with " << morph.size() << " nodes.\n";
+}
+
+/**
+ * @brief Converts an SWC file to the binary cache format
+ * @param inputfile Path to the input SWC file
+ * @param outputfile Path to the output .bin file
+ *
+ * @see swc2ugx() for the analogous UGX conversion
+ */
+void NeuronGraph::swc2bin(const std::string& inputfile, const std::string& outputfile)
+{
+	NeuronGraph graph;
+	graph.readFromFile(inputfile);
+	graph.writeToFileBIN(outputfile);
+}
+
+/**
+ * @brief Converts a UGX neuron file to the binary cache format
+ * @param inputfile Path to the input UGX file
+ * @param outputfile Path to the output .bin file
+ *
+ * @see ugx2swc() for the analogous SWC conversion
+ */
+void NeuronGraph::ugx2bin(const std::string& inputfile, const std::string& outputfile)
+{
+	NeuronGraph graph;
+	graph.readFromFileUGX(inputfile);
+	graph.writeToFileBIN(outputfile);
+}
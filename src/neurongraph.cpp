@@ -10,10 +10,27 @@
  */
 
 #include "neurongraph.h"
+#include "morphology.cpp"
+#include "topology.cpp"
+#include "compression.cpp"
+#include "mappedfile.cpp"
+#include "ugxstream.cpp"
+#include "bincache.cpp"
+#include "threadpool.cpp"
+#include "asyncio.cpp"
 #include "neuronugx.cpp"
 #include "neuronoperations.cpp"
 #include "neurontrunks.cpp"
+#include "refinement.cpp"
+#include "trunkbatch.cpp"
+#include "morphometrics.cpp"
+#include "neuronbin.cpp"
+#include "spatialindex.cpp"
+#include "synthetic.cpp"
+#include "instrumentation.cpp"
 #include <tinyxml2.h>
+#include <charconv>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
@@ -28,6 +45,36 @@ namespace fs = std::filesystem;
 
 Vec3 operator*(double s, const Vec3& v) {return v * s;}
 
+/**
+ * @brief Tests whether a character is SWC field whitespace
+ * @param c Character to test
+ * @return true for the characters std::istream treats as blanks
+ */
+static inline bool isSWCBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+/**
+ * @brief Parses one whitespace-separated SWC column in place
+ * @tparam T Field type (int or double)
+ * @param[in,out] p Current read position, advanced past the parsed value
+ * @param end End of the line
+ * @param[out] value Parsed value
+ * @return true if a value was parsed, false on a missing or malformed field
+ *
+ * Accepts an optional leading '+', which std::from_chars rejects but the
+ * stream extraction used by earlier versions of the reader allowed.
+ */
+template <typename T>
+static inline bool parseSWCField(const char*& p, const char* end, T& value) {
+    while (p < end && isSWCBlank(*p)) ++p;
+    if (p < end && *p == '+') ++p;
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc()) return false;
+    p = ptr;
+    return true;
+}
+
 /**
  * @brief Constructor that initializes a NeuronGraph from a set of SWC nodes
  * @param nodeSet A map containing SWC nodes indexed by their IDs
@@ -40,12 +87,17 @@ Vec3 operator*(double s, const Vec3& v) {return v * s;}
  * @see addNode(const SWCNode& node)
  */
 NeuronGraph::NeuronGraph(const std::map<int, SWCNode>& nodeSet){
-	nodes.clear();
-	edges.clear();
+	setNodes(nodeSet);
+}
 
-	for(auto& [_,node] : nodeSet){
-		addNode(node);
-	}
+/**
+ * @brief Constructor that initializes a NeuronGraph from flat morphology storage
+ * @param morphology Structure-of-arrays morphology to adopt
+ *
+ * @see setMorphology(const Morphology& morphology)
+ */
+NeuronGraph::NeuronGraph(const Morphology& morphology){
+	setMorphology(morphology);
 }
 
 /**
@@ -59,30 +111,63 @@ NeuronGraph::NeuronGraph(const std::map<int, SWCNode>& nodeSet){
  * @see addNode(const SWCNode& node)
  */
 void NeuronGraph::setNodes(const std::map<int,SWCNode>& nodeSet){
-	nodes.clear();
-	edges.clear();
+	morph = Morphology::fromNodes(nodeSet);
+}
+
+/**
+ * @brief Replaces the nodes of the graph with flat morphology storage
+ * @param morphology Structure-of-arrays morphology to adopt
+ *
+ * The parent indices and child lists are rebuilt if the given morphology
+ * does not carry an up-to-date topology.
+ */
+void NeuronGraph::setMorphology(const Morphology& morphology){
+	morph = morphology;
+	if (!morph.hasTopology()) morph.buildTopology();
+}
+
+/**
+ * @brief Returns the flat morphology storage of the graph
+ * @return Reference to the internal Morphology
+ *
+ * Nodes added one at a time through addNode() only invalidate the topology;
+ * it is rebuilt here on first access.
+ */
+const Morphology& NeuronGraph::getMorphology(){
+	if (!morph.hasTopology()) morph.buildTopology();
+	return morph;
+}
 
-	for(auto& [_,node] : nodeSet){
-		addNode(node);
+/**
+ * @brief Counts the edges of the graph
+ * @return Number of distinct parent ids referenced by the nodes
+ *
+ * Each parent id contributes one entry, regardless of how many children it
+ * has, which matches the parent-keyed adjacency list earlier versions kept.
+ */
+int NeuronGraph::numberOfEdges() const {
+	std::vector<int> parents;
+	parents.reserve(morph.size());
+	for (int p : morph.pid) {
+		if (p != -1) parents.push_back(p);
 	}
+	std::sort(parents.begin(), parents.end());
+	return static_cast<int>(std::unique(parents.begin(), parents.end()) - parents.begin());
 }
 
 /**
  * @brief Adds a single node to the graph and updates edge relationships
  * @param node The SWCNode to be added to the graph
  * 
- * This method adds a node to the internal nodes map and automatically
- * creates the parent-child edge relationship if the node has a valid parent
- * (pid != -1). Root nodes (pid == -1) are added without creating edges.
+ * This method stores the node in the flat morphology storage. Parent-child
+ * relationships are resolved lazily: the derived topology is invalidated and
+ * rebuilt the next time it is needed, so adding n nodes stays linear.
  * 
  * @note This method assumes node IDs are unique and will overwrite existing nodes
  * @see SWCNode structure for node data format
  */
 void NeuronGraph::addNode(const SWCNode& node){
-	nodes[node.id] = node;
-	if(node.pid != -1) {
-	   edges[node.pid].push_back(node.id);
-	}
+	morph.setNode(node);
 }
 
 /**
@@ -121,6 +206,10 @@ std::map<int, SWCNode> NeuronGraph::preprocess(const std::map<int, SWCNode> & no
  * This method parses an SWC (Standardized Morphology Format) file and populates
  * the graph with neuron nodes. The SWC format contains one node per line with
  * the following columns: ID, type, x, y, z, radius, parent_ID.
+ *
+ * The file is memory-mapped and scanned in place: numbers are converted with
+ * std::from_chars directly from the mapped bytes and stored straight into the
+ * flat morphology, so no per-line strings or streams are created.
  * 
  * The parser handles:
  * - Comment lines (starting with #)
@@ -136,63 +225,67 @@ std::map<int, SWCNode> NeuronGraph::preprocess(const std::map<int, SWCNode> & no
  * @see addNode(const SWCNode& node) for individual node processing
  */
 void NeuronGraph::readFromFile(const std::string& filename) {
-    nodes.clear();
-    edges.clear();
+    NM_SCOPED_TIMER("readSWC");
+    morph.clear();
 
-    std::ifstream infile(filename);
-    if (!infile.is_open()) {
+    MappedFile file(filename);
+    if (!file.isOpen()) {
         std::cerr << "Failed to open file: " << filename << std::endl;
         return;
     }
 
-    std::string line;
+    const char* cur = file.data();
+    const char* const eof = cur + file.size();
+    morph.reserve(static_cast<std::size_t>(std::count(cur, eof, '\n')) + 1);
+
     int lineNum = 0;
-    while (std::getline(infile, line)) {
+    while (cur < eof) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cur, '\n', eof - cur));
+        if (!lineEnd) lineEnd = eof;
+        const char* b = cur;
+        const char* e = lineEnd;
+        cur = (lineEnd < eof) ? lineEnd + 1 : eof;
         ++lineNum;
 
         // Skip empty or comment-only lines
-        if (line.empty() || line[0] == '#') continue;
+        if (b == e || *b == '#') continue;
 
         // Strip inline comments
-        auto commentPos = line.find('#');
-        if (commentPos != std::string::npos)
-            line = line.substr(0, commentPos);
+        const char* commentPos = static_cast<const char*>(std::memchr(b, '#', e - b));
+        if (commentPos) e = commentPos;
 
         // Trim leading/trailing whitespace
-        // Trim leading whitespace
-		line.erase(0, line.find_first_not_of(" \t\r\n"));
-
-		// Trim trailing whitespace only if line is not empty
-		if (!line.empty()) {
-			size_t end = line.find_last_not_of(" \t\r\n");
-			if (end != std::string::npos)
-				line.erase(end + 1);
-		}
+        while (b < e && isSWCBlank(*b)) ++b;
+        while (e > b && isSWCBlank(*(e - 1))) --e;
 
-		// Replace tabs with spaces
-		std::replace(line.begin(), line.end(), '\t', ' ');
+        if (b == e) continue;  // was all comment or whitespace
 
-        if (line.empty()) continue;  // was all comment or whitespace
-
-        std::istringstream iss(line);
         SWCNode node;
-
-        if (!(iss >> node.id >> node.type >> node.x >> node.y >> node.z >> node.radius >> node.pid)) {
+        const char* p = b;
+        if (!(parseSWCField(p, e, node.id) && parseSWCField(p, e, node.type) &&
+              parseSWCField(p, e, node.x) && parseSWCField(p, e, node.y) &&
+              parseSWCField(p, e, node.z) && parseSWCField(p, e, node.radius) &&
+              parseSWCField(p, e, node.pid))) {
+            std::string line(b, e);
+            std::replace(line.begin(), line.end(), '\t', ' ');
             std::cerr << "[Parse Error] Line " << lineNum << ": '" << line << "'\n";
             continue;
         }
 
         addNode(node);
     }
+    morph.buildTopology();
 
-    std::cout << "Read SWC ... " << filename << " with " << nodes.size() << " nodes.\n";
+    NM_COUNT("nodes.read", morph.size());
+    NM_COUNT("bytes.read", file.size());
+    NM_LOG(Info) << "Read SWC ... " << filename << " with " << morph.size() << " nodes.\n";
 }
 
 
 /**
  * @brief Writes neuron morphology data to an SWC format file
  * @param nodeSet Map of SWC nodes to write to file
- * @param filename Output file path for the SWC data
+ * @param filename Output file path for the SWC data; a name ending in .gz or .zst is compressed
  * 
  * This method exports neuron morphology data in the standard SWC format.
  * Nodes are written in sorted order by ID to ensure consistent output.
@@ -208,7 +301,8 @@ void NeuronGraph::readFromFile(const std::string& filename) {
  */
 void NeuronGraph::writeToFile(const std::map<int, SWCNode> & nodeSet,
 		              const std::string& filename){
-	std::ofstream outfile(filename);
+	NM_SCOPED_TIMER("writeSWC");
+	CompressedOutputStream outfile(filename);
 	if(!outfile.is_open()){
 		std::cerr << "Failed to open output file: " << filename << std::endl;
 		return;
@@ -229,7 +323,8 @@ void NeuronGraph::writeToFile(const std::map<int, SWCNode> & nodeSet,
 			<< node.radius << " "
 			<< node.pid    << "\n";
 	}
-	std::cout << "WriteSWC ..." << filename << std::endl;
+	NM_COUNT("nodes.written", nodeSet.size());
+	NM_LOG(Info) << "WriteSWC ..." << filename << std::endl;
 }
 
 /**
@@ -240,6 +335,7 @@ void NeuronGraph::writeToFile(const std::map<int, SWCNode> & nodeSet,
  * extension and calls the appropriate reader method:
  * - .swc files are read using readFromFile()
  * - .ugx files are read using readFromFileUGX()
+ * - .bin files are read using readFromFileBIN()
  * 
  * This provides a convenient unified interface for loading neuron data
  * regardless of the input format.
@@ -251,12 +347,15 @@ void NeuronGraph::writeToFile(const std::map<int, SWCNode> & nodeSet,
  */
 void NeuronGraph::readFromFileUGXorSWC(const std::string& filename) {
     std::filesystem::path path(filename);
+    if (compressionFromFilename(filename) != Compression::None) path = path.stem();   // neuron.swc.gz -> .swc
     std::string ext = path.extension().string();
 
     if (ext == ".swc") {
         readFromFile(filename);  // your SWC reader
     } else if (ext == ".ugx") {
         readFromFileUGX(filename);  // your UGX reader
+    } else if (ext == ".bin") {
+        readFromFileBIN(filename);
     } else {
         std::cerr << "Unsupported file format: " << ext << "\n";
     }
@@ -331,6 +430,19 @@ bool NeuronGraph::isTopologicallySorted(const std::map<int, SWCNode>& nodeSet) c
     return true;
 }
 
+/**
+ * @brief Checks if the graph's own nodes are topologically sorted
+ * @return true if every parent id is smaller than its child id
+ *
+ * Scans the flat id/pid columns directly without building a node map.
+ */
+bool NeuronGraph::isTopologicallySorted() const {
+    for (std::size_t i = 0; i < morph.size(); ++i) {
+        if (morph.pid[i] != -1 && morph.pid[i] >= morph.id[i]) return false;
+    }
+    return true;
+}
+
 /**
  * @brief Checks if the neuron has multiple soma nodes (soma segment)
  * @param nodeSet Map of SWC nodes to check
@@ -361,6 +473,14 @@ bool NeuronGraph::hasSomaSegment(const std::map<int, SWCNode>& nodeSet) const {
     return false;
 }
 
+/**
+ * @brief Checks if the graph's own nodes contain a soma segment
+ * @return true if more than one node has type 1
+ */
+bool NeuronGraph::hasSomaSegment() const {
+    return topology()->somaRows.size() > 1;
+}
+
 /**
  * @brief Checks if the neuron is missing a soma node
  * @param nodeSet Map of SWC nodes to check
@@ -389,11 +509,19 @@ bool NeuronGraph::isSomaMissing(const std::map<int, SWCNode>& nodeSet) const {
     return true; // No node of type 1 found
 }
 
+/**
+ * @brief Checks if the graph's own nodes are missing a soma
+ * @return true if no node has type 1
+ */
+bool NeuronGraph::isSomaMissing() const {
+    return topology()->somaRows.empty();
+}
+
 std::map<int, std::vector<int>> NeuronGraph::getNeighborMap(const std::map<int, SWCNode>& nodeSet){
     std::map<int, std::vector<int>> neighbors;
 
     for (const auto& [id, node] : nodeSet) {
-        if (node.pid != -1 && nodes.count(node.pid)) {
+        if (node.pid != -1 && morph.contains(node.pid)) {
             neighbors[id].push_back(node.pid);
             neighbors[node.pid].push_back(id);
         }
@@ -402,11 +530,24 @@ std::map<int, std::vector<int>> NeuronGraph::getNeighborMap(const std::map<int,
     return neighbors;
 }
 
-std::map<int, std::map<int, SWCNode>> NeuronGraph::extractBranchSubgraphs(const std::map<int, SWCNode>& nodeSet) {
-    std::map<int, std::map<int, SWCNode>> subgraphs;
+std::map<int, std::vector<int>> NeuronGraph::getNeighborMap(){
+    auto index = topology();
+    std::map<int, std::vector<int>> neighbors;
+    for (std::size_t i = 0; i < morph.size(); ++i) {
+        if (index->degree(i) == 0) continue;
+        std::vector<int> ids;
+        ids.reserve(index->degree(i));
+        for (int k = index->neighborOffsets[i]; k < index->neighborOffsets[i + 1]; ++k)
+            ids.push_back(morph.id[index->neighbors[k]]);
+        neighbors.emplace_hint(neighbors.end(), morph.id[i], std::move(ids));
+    }
+    return neighbors;
+}
 
-    // Use the class method to get the neighbor map
-    std::map<int, std::vector<int>> neighbors = getNeighborMap(nodeSet);
+// Star subgraph around every branch point and soma node of nodeSet
+static std::map<int, std::map<int, SWCNode>> branchSubgraphs(const std::map<int, SWCNode>& nodeSet,
+                                                             const std::map<int, std::vector<int>>& neighbors) {
+    std::map<int, std::map<int, SWCNode>> subgraphs;
 
     // Identify branch points and soma
     for (const auto& [id, nbrs] : neighbors) {
@@ -439,6 +580,15 @@ std::map<int, std::map<int, SWCNode>> NeuronGraph::extractBranchSubgraphs(const
     return subgraphs;
 }
 
+std::map<int, std::map<int, SWCNode>> NeuronGraph::extractBranchSubgraphs(const std::map<int, SWCNode>& nodeSet) {
+    return branchSubgraphs(nodeSet, getNeighborMap(nodeSet));
+}
+
+std::map<int, std::map<int, SWCNode>> NeuronGraph::extractBranchSubgraphs() {
+    // the cached adjacency replaces a rebuild from the node map
+    return branchSubgraphs(getNodes(), getNeighborMap());
+}
+
 std::map<int, std::map<int, SWCNode>> NeuronGraph::smoothBranchWithBezier(
     const std::map<int, SWCNode>& nodeSet,
     double insetFactor,
@@ -459,15 +609,24 @@ std::map<int, std::map<int, SWCNode>> NeuronGraph::smoothBranchWithBezier(
     }
     if (centerId == -1) return {};  // No valid center found
 
-    Vec3 O{nodeSet.at(centerId).x, nodeSet.at(centerId).y, nodeSet.at(centerId).z};
-    const auto& centerNeighbors = neighborMap.at(centerId);
+    std::vector<SWCNode> neighbours;
+    for (int id : neighborMap.at(centerId)) neighbours.push_back(nodeSet.at(id));
 
-    for (size_t i = 0; i < centerNeighbors.size(); ++i) {
-        int id1 = centerNeighbors[i];
-        int id2 = centerNeighbors[(i + 1) % centerNeighbors.size()];
+    auto curves = junctionBezierCurves(nodeSet.at(centerId), neighbours, insetFactor, numberOfBezierPoints);
+    for (size_t i = 0; i < curves.size(); ++i) bezierBranches[i] = std::move(curves[i]);
+    return bezierBranches;
+}
+
+std::vector<std::map<int, SWCNode>> NeuronGraph::junctionBezierCurves(const SWCNode& center,
+                                                                      const std::vector<SWCNode>& neighbours,
+                                                                      double insetFactor, int numberOfBezierPoints) {
+    std::vector<std::map<int, SWCNode>> curves;
+    curves.reserve(neighbours.size());
+    Vec3 O{center.x, center.y, center.z};
 
-        const SWCNode& n1 = nodeSet.at(id1);
-        const SWCNode& n2 = nodeSet.at(id2);
+    for (size_t i = 0; i < neighbours.size(); ++i) {
+        const SWCNode& n1 = neighbours[i];
+        const SWCNode& n2 = neighbours[(i + 1) % neighbours.size()];
         Vec3 W1{n1.x, n1.y, n1.z};
         Vec3 W2{n2.x, n2.y, n2.z};
         double r1 = n1.radius;
@@ -497,12 +656,12 @@ std::map<int, std::map<int, SWCNode>> NeuronGraph::smoothBranchWithBezier(
             node.radius = radius;
             node.type = type;
 
-            newNodes[nextId] = node;
+            newNodes.emplace_hint(newNodes.end(), nextId, node);
             parentId = nextId++;
         }
 
-        bezierBranches[i] = std::move(newNodes);
+        curves.push_back(std::move(newNodes));
     }
 
-    return bezierBranches;
+    return curves;
 }
@@ -1,322 +1,443 @@
-/**
- * @file neuronoperations.cpp
- * @brief Implementation of neuron morphology operations and transformations
- * @author CPPNeuronMesher Project
- * @date 2024
- * 
- * This file contains advanced operations for neuron morphology processing,
- * including soma segment handling, edge splitting, topological sorting,
- * and soma assignment operations.
- */
-
-#include <unordered_map>
-#include "neurongraph.h"
-
-/**
- * @brief Removes multiple soma nodes and replaces them with a single averaged soma
- * @param inputNodes The input map of SWC nodes containing multiple soma nodes
- * @return A new map of SWC nodes with a single soma node at ID 1
- * 
- * This method processes neuron morphologies that have multiple soma nodes (soma segments)
- * and consolidates them into a single soma node. The process involves:
- * 1. Identifying all soma nodes (type == 1)
- * 2. Computing the average position and radius of all soma nodes
- * 3. Creating a new soma node with ID 1 at the averaged location
- * 4. Reassigning all non-soma nodes with new sequential IDs starting from 2
- * 5. Updating parent-child relationships to connect to the new soma
- * 6. Ensuring topological sorting of the result
- * 
- * @note If no soma nodes are found, returns the input unchanged
- * @note The resulting soma always has ID 1 and parent ID -1 (root)
- * @note All nodes originally connected to any soma will be connected to the new soma
- * 
- * @see hasSomaSegment() to detect if soma segments exist
- * @see topologicalSort() for ensuring proper node ordering
- */
-std::map<int, SWCNode> NeuronGraph::removeSomaSegment(const std::map<int, SWCNode>& inputNodes) const {
-    std::vector<int> somaIds;
-    for (const auto& [id, node] : inputNodes) {
-        if (node.type == 1) somaIds.push_back(id);
-    }
-
-    if (somaIds.empty()) return inputNodes;
-
-    double x = 0, y = 0, z = 0, r = 0;
-    for (int id : somaIds) {
-        const SWCNode& n = inputNodes.at(id);
-        x += n.x;
-        y += n.y;
-        z += n.z;
-        r += n.radius;
-    }
-    x /= somaIds.size();
-    y /= somaIds.size();
-    z /= somaIds.size();
-    r /= somaIds.size();
-
-    SWCNode soma;
-    soma.id = 1;
-    soma.pid = -1;
-    soma.type = 1;
-    soma.x = x;
-    soma.y = y;
-    soma.z = z;
-    soma.radius = r;
-
-    std::map<int, SWCNode> newNodes;
-    newNodes[1] = soma;
-
-    int nextId = 2;
-    std::unordered_map<int, int> idMap;
-
-    for (const auto& [id, node] : inputNodes) {
-        if (node.type == 1) continue;
-        SWCNode newNode = node;
-        newNode.id = nextId;
-        idMap[id] = nextId;
-        newNodes[nextId++] = newNode;
-    }
-
-    for (auto& [id, node] : newNodes) {
-        if (id == 1) continue;
-        if (inputNodes.at(node.pid).type == 1 || node.pid == 1) {
-            node.pid = 1;
-        } else {
-            node.pid = idMap[node.pid];
-        }
-    }
-	
-	if (!isTopologicallySorted(newNodes)) {
-		newNodes = topologicalSort(newNodes);
-	}
-
-    return newNodes;
-}
-
-/**
- * @brief Splits all edges in the neuron by inserting midpoint nodes
- * @param nodeSet The input map of SWC nodes to process
- * @return A new map of SWC nodes with midpoint nodes inserted on all edges
- * 
- * This method performs edge subdivision by inserting a new node at the midpoint
- * of every parent-child edge in the neuron morphology. The process involves:
- * 1. Creating a midpoint node for each parent-child relationship
- * 2. Positioning the midpoint at the average coordinates of parent and child
- * 3. Setting the midpoint radius as the average of parent and child radii
- * 4. Updating the topology so child nodes connect through their midpoints
- * 5. Ensuring topological sorting of the final result
- * 
- * This operation effectively doubles the resolution of the neuron morphology,
- * which is useful for:
- * - Mesh refinement operations
- * - Improved geometric accuracy in simulations
- * - Smoother interpolation between neuron segments
- * 
- * @note New node IDs are assigned sequentially starting from the highest existing ID + 1
- * @note Midpoint nodes inherit the type of their child node
- * @note Root nodes (pid == -1) are not affected by this operation
- * 
- * @see splitEdgesN() for performing multiple iterations of edge splitting
- * @see topologicalSort() for ensuring proper node ordering
- */
-std::map<int, SWCNode> NeuronGraph::splitEdges(const std::map<int, SWCNode>& nodeSet) const {
-    std::map<int, SWCNode> newNodes;
-
-    // Efficiently get next available ID from the last (largest) key in the sorted map
-    int nextId = nodeSet.rbegin()->first + 1;
-
-    for (const auto& [id, node] : nodeSet) {
-        newNodes[id] = node;
-
-        if (node.pid != -1 && nodeSet.count(node.pid)) {
-            const SWCNode& parentNode = nodeSet.at(node.pid);
-            const SWCNode& childNode = node;
-
-            // Create midpoint node
-            SWCNode midNode;
-            midNode.id = nextId;
-            midNode.pid = parentNode.id;
-            midNode.type = childNode.type;
-            midNode.x = (parentNode.x + childNode.x) / 2.0;
-            midNode.y = (parentNode.y + childNode.y) / 2.0;
-            midNode.z = (parentNode.z + childNode.z) / 2.0;
-            midNode.radius = (parentNode.radius + childNode.radius) / 2.0;
-
-            newNodes[nextId] = midNode;
-
-            // Update child node to have midpoint as parent
-            SWCNode updatedChild = childNode;
-            updatedChild.pid = nextId;
-            newNodes[childNode.id] = updatedChild;
-
-            ++nextId;
-        }
-    }
-
-    // Ensure topological sort on the final new node set
-    if (!isTopologicallySorted(newNodes)) {
-        newNodes = topologicalSort(newNodes);
-    }
-
-    return newNodes;
-}
-
-/**
- * @brief Performs N iterations of edge splitting on the neuron morphology
- * @param nodeSet The input map of SWC nodes to process
- * @param N The number of edge splitting iterations to perform
- * @return A vector containing the node sets after each iteration of splitting
- * 
- * This method applies the splitEdges() operation N times in sequence, where each
- * iteration uses the result of the previous iteration as input. This creates
- * progressively finer subdivisions of the neuron morphology.
- * 
- * The returned vector contains N maps, where:
- * - splits[0] contains the result after 1 iteration
- * - splits[1] contains the result after 2 iterations
- * - splits[N-1] contains the result after N iterations
- * 
- * After N iterations, the number of nodes grows exponentially, with each
- * iteration approximately doubling the number of edges (and thus nodes).
- * 
- * Use cases:
- * - Progressive mesh refinement for adaptive simulations
- * - Creating multiple levels of detail for the same neuron
- * - Analyzing convergence properties of numerical methods
- * 
- * @note Each iteration significantly increases the number of nodes
- * @note Memory usage grows exponentially with N
- * @note Consider memory constraints when choosing large values of N
- * 
- * @see splitEdges() for single iteration edge splitting
- */
-std::vector<std::map<int, SWCNode>> NeuronGraph::splitEdgesN(const std::map<int, SWCNode>& nodeSet, int N) const {
-    std::vector<std::map<int, SWCNode>> splits;
-    std::map<int, SWCNode> currentSet = nodeSet;
-
-    for (int i = 0; i < N; ++i) {
-        currentSet = this->splitEdges(currentSet);
-        splits.push_back(currentSet);
-    }
-
-    return splits;
-}
-
-/**
- * @brief Performs topological sorting of neuron nodes to ensure proper parent-child ordering
- * @param nodeSet The input map of SWC nodes to sort
- * @return A new map of SWC nodes with reassigned IDs in topological order
- * 
- * This method implements Kahn's algorithm for topological sorting to ensure that
- * all parent nodes have smaller IDs than their children. The algorithm:
- * 1. Builds an adjacency list and calculates in-degrees for all nodes
- * 2. Starts with nodes having zero in-degree (root nodes)
- * 3. Processes nodes in breadth-first order, updating in-degrees
- * 4. Reassigns node IDs sequentially (1, 2, 3, ...) based on topological order
- * 5. Updates parent IDs to maintain correct relationships
- * 
- * Topological sorting is essential for:
- * - Ensuring proper tree traversal algorithms work correctly
- * - Maintaining consistency in neuron analysis operations
- * - Enabling efficient parent-to-child processing
- * - Supporting mesh generation algorithms that rely on ordered traversal
- * 
- * The resulting neuron will have:
- * - Root nodes (soma) with the smallest IDs
- * - All parent nodes having IDs smaller than their children
- * - Sequential ID numbering starting from 1
- * 
- * @note This method creates entirely new node IDs while preserving topology
- * @note The original node IDs are completely replaced
- * @note Parent-child relationships are preserved but with new ID mappings
- * 
- * @see isTopologicallySorted() to check if sorting is needed
- */
-std::map<int, SWCNode> NeuronGraph::topologicalSort(const std::map<int, SWCNode>& nodeSet) const {
-    std::map<int, std::vector<int>> adj;
-    std::map<int, int> inDegree;
-    std::vector<int> sortedOrder;
-    std::map<int, SWCNode> sortedNodes;
-
-    for (const auto& [id, node] : nodeSet) {
-        if (node.pid != -1 && nodeSet.count(node.pid)) {
-            adj[node.pid].push_back(id);
-            inDegree[id]++;
-        } else {
-            inDegree[id]; // ensure all nodes are in inDegree
-        }
-    }
-
-    std::queue<int> q;
-    for (const auto& [id, deg] : inDegree)
-        if (deg == 0) q.push(id);
-
-    while (!q.empty()) {
-        int id = q.front(); q.pop();
-        sortedOrder.push_back(id);
-        for (int child : adj[id])
-            if (--inDegree[child] == 0) q.push(child);
-    }
-
-    std::map<int, int> oldToNewId;
-    for (size_t i = 0; i < sortedOrder.size(); ++i)
-        oldToNewId[sortedOrder[i]] = static_cast<int>(i) + 1;
-
-    for (int oldId : sortedOrder) {
-        SWCNode node = nodeSet.at(oldId);
-        node.id = oldToNewId[oldId];
-        node.pid = (node.pid == -1) ? -1 : oldToNewId[node.pid];
-        sortedNodes[node.id] = node;
-    }
-
-    return sortedNodes;
-}
-
-/**
- * @brief Assigns a soma node to a neuron morphology that lacks one
- * @param nodeSet The input map of SWC nodes missing a soma
- * @return A new map of SWC nodes with a soma node assigned
- * 
- * This method addresses neuron morphologies that are missing a soma (cell body)
- * by converting the first root node found (pid == -1) into a soma node (type = 1).
- * 
- * The method follows this logic:
- * 1. First checks if a soma already exists using isSomaMissing()
- * 2. If soma is present, returns the input unchanged
- * 3. If soma is missing, searches for the first root node (pid == -1)
- * 4. Converts the root node's type to 1 (soma type)
- * 5. Prints a confirmation message with the assigned node ID
- * 
- * This operation is essential for:
- * - Ensuring every neuron has exactly one soma for proper analysis
- * - Correcting incomplete neuron reconstructions
- * - Preparing neuron data for mesh generation algorithms
- * - Maintaining consistency with neuron morphology standards
- * 
- * @note If no root node is found, prints a warning and returns input unchanged
- * @note Only the first root node encountered is converted to soma
- * @note The node's position and other properties remain unchanged
- * 
- * @warning If multiple root nodes exist, only the first one becomes the soma
- * 
- * @see isSomaMissing() to detect if soma assignment is needed
- * @see preprocess() which automatically calls this method when needed
- */
-std::map<int, SWCNode> NeuronGraph::setSoma(const std::map<int, SWCNode>& nodeSet) const {
-    if (!isSomaMissing(nodeSet)) {
-        return nodeSet; // Soma already present
-    }
-
-    std::map<int, SWCNode> modified = nodeSet;
-
-    for (auto& [id, node] : modified) {
-        if (node.pid == -1) {
-            node.type = 1; // Set as soma
-            std::cout << "Assigned node ID " << id << " as soma (type 1).\n";
-            return modified;
-        }
-    }
-
-    std::cerr << "Warning: Soma is missing and no root node (pid = -1) found to assign.\n";
-    return modified;
-}
+/**
+ * @file neuronoperations.cpp
+ * @brief Implementation of neuron morphology operations and transformations
+ * @author CPPNeuronMesher Project
+ * @date 2024
+ * 
+ * This file contains advanced operations for neuron morphology processing,
+ * including soma segment handling, edge splitting, topological sorting,
+ * and soma assignment operations.
+ */
+
+#include <unordered_map>
+#include "neurongraph.h"
+
+/**
+ * @brief Copies a node map into rows in id order with the row of each parent
+ * @param[in] nodeSet Nodes to copy
+ * @param[out] nodes Nodes in increasing id order
+ * @param[out] parentRow Row of each node's parent, -1 if the parent is not stored
+ */
+static void toDenseRows(const std::map<int, SWCNode>& nodeSet, std::vector<SWCNode>& nodes, std::vector<int>& parentRow) {
+    nodes.clear();
+    nodes.reserve(nodeSet.size());
+    for (const auto& [id, node] : nodeSet) nodes.push_back(node);
+
+    parentRow.assign(nodes.size(), -1);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].pid == -1) continue;
+        auto it = std::lower_bound(nodes.begin(), nodes.end(), nodes[i].pid,
+                                   [](const SWCNode& n, int id) { return n.id < id; });
+        if (it != nodes.end() && it->id == nodes[i].pid) parentRow[i] = static_cast<int>(it - nodes.begin());
+    }
+}
+
+/**
+ * @brief Breadth-first order of a forest given by parent rows (Kahn's algorithm)
+ * @param[in] parentRow Row of each node's parent, -1 for roots
+ * @param[out] order Reachable rows: roots in row order, then children level by level
+ * @param[out] levelEnd End of every level in @p order
+ *
+ * Children are bucketed by a counting sort, so every node sees its children
+ * in row order, as the map-based adjacency lists did. Rows on a parent cycle
+ * are never reached and are left out.
+ */
+static void denseBreadthFirst(const std::vector<int>& parentRow, std::vector<int>& order, std::vector<int>& levelEnd) {
+    const std::size_t n = parentRow.size();
+    std::vector<int> childOffsets(n + 1, 0);
+    for (std::size_t i = 0; i < n; ++i)
+        if (parentRow[i] != -1) ++childOffsets[parentRow[i] + 1];
+    for (std::size_t i = 0; i < n; ++i) childOffsets[i + 1] += childOffsets[i];
+
+    std::vector<int> children(childOffsets[n]);
+    std::vector<int> cursor(childOffsets.begin(), childOffsets.end() - 1);
+    for (std::size_t i = 0; i < n; ++i)
+        if (parentRow[i] != -1) children[cursor[parentRow[i]]++] = static_cast<int>(i);
+
+    order.clear();
+    order.reserve(n);
+    levelEnd.clear();
+    for (std::size_t i = 0; i < n; ++i)
+        if (parentRow[i] == -1) order.push_back(static_cast<int>(i));
+
+    // order doubles as the queue
+    std::size_t head = 0;
+    while (head < order.size()) {
+        std::size_t end = order.size();
+        for (; head < end; ++head) {
+            int row = order[head];
+            order.insert(order.end(), children.begin() + childOffsets[row], children.begin() + childOffsets[row + 1]);
+        }
+        levelEnd.push_back(static_cast<int>(end));
+    }
+}
+
+/**
+ * @brief Inserts the midpoint of every edge and numbers the result topologically
+ * @param[in] nodes Nodes of one level
+ * @param[in] parentRow Row of each node's parent, -1 if none
+ * @param[out] out Split nodes in their final order, ids 1..n
+ * @param[out] outParent Row of each split node's parent
+ * @return false if there was no edge to split (outputs untouched)
+ *
+ * In the breadth-first order of the split tree every level of the input is
+ * preceded by the midpoints above it, in the same order. The split nodes are
+ * therefore written directly in the order topologicalSort() gives them.
+ */
+static bool splitDenseRows(const std::vector<SWCNode>& nodes, const std::vector<int>& parentRow,
+                           std::vector<SWCNode>& out, std::vector<int>& outParent) {
+    std::size_t edges = 0;
+    for (int p : parentRow) edges += (p != -1);
+    if (edges == 0) return false;
+
+    std::vector<int> order, levelEnd;
+    denseBreadthFirst(parentRow, order, levelEnd);
+
+    out.clear();
+    outParent.clear();
+    out.reserve(order.size() + edges);
+    outParent.reserve(order.size() + edges);
+    std::vector<int> newRow(nodes.size(), -1);
+
+    int first = 0;
+    for (int end : levelEnd) {
+        const std::size_t midFirst = out.size();
+
+        // midpoints of the edges into this level
+        for (int k = first; k < end; ++k) {
+            int row = order[k], p = parentRow[row];
+            if (p == -1) continue;
+            const SWCNode& parentNode = nodes[p];
+            const SWCNode& childNode = nodes[row];
+
+            SWCNode midNode;
+            midNode.id = static_cast<int>(out.size()) + 1;
+            midNode.pid = newRow[p] + 1;
+            midNode.type = childNode.type;
+            midNode.x = (parentNode.x + childNode.x) / 2.0;
+            midNode.y = (parentNode.y + childNode.y) / 2.0;
+            midNode.z = (parentNode.z + childNode.z) / 2.0;
+            midNode.radius = (parentNode.radius + childNode.radius) / 2.0;
+            out.push_back(midNode);
+            outParent.push_back(newRow[p]);
+        }
+
+        std::size_t mid = midFirst;
+        for (int k = first; k < end; ++k) {
+            int row = order[k];
+            SWCNode node = nodes[row];
+            node.id = static_cast<int>(out.size()) + 1;
+            if (parentRow[row] != -1) {
+                outParent.push_back(static_cast<int>(mid));
+                node.pid = static_cast<int>(mid++) + 1;
+            } else {
+                // a parent that is not stored maps to 0, as in topologicalSort()
+                outParent.push_back(-1);
+                node.pid = (node.pid == -1) ? -1 : 0;
+            }
+            newRow[row] = static_cast<int>(out.size());
+            out.push_back(node);
+        }
+        first = end;
+    }
+    return true;
+}
+
+/**
+ * @brief Builds a node map from nodes already in increasing id order
+ */
+static std::map<int, SWCNode> denseRowsToMap(const std::vector<SWCNode>& nodes) {
+    std::map<int, SWCNode> nodeSet;
+    for (const auto& node : nodes) nodeSet.emplace_hint(nodeSet.end(), node.id, node);
+    return nodeSet;
+}
+
+/**
+ * @brief Removes multiple soma nodes and replaces them with a single averaged soma
+ * @param inputNodes The input map of SWC nodes containing multiple soma nodes
+ * @return A new map of SWC nodes with a single soma node at ID 1
+ * 
+ * This method processes neuron morphologies that have multiple soma nodes (soma segments)
+ * and consolidates them into a single soma node. The process involves:
+ * 1. Identifying all soma nodes (type == 1)
+ * 2. Computing the average position and radius of all soma nodes
+ * 3. Creating a new soma node with ID 1 at the averaged location
+ * 4. Reassigning all non-soma nodes with new sequential IDs starting from 2
+ * 5. Updating parent-child relationships to connect to the new soma
+ * 6. Ensuring topological sorting of the result
+ * 
+ * @note If no soma nodes are found, returns the input unchanged
+ * @note The resulting soma always has ID 1 and parent ID -1 (root)
+ * @note All nodes originally connected to any soma will be connected to the new soma
+ * 
+ * @see hasSomaSegment() to detect if soma segments exist
+ * @see topologicalSort() for ensuring proper node ordering
+ */
+std::map<int, SWCNode> NeuronGraph::removeSomaSegment(const std::map<int, SWCNode>& inputNodes) const {
+    std::vector<int> somaIds;
+    for (const auto& [id, node] : inputNodes) {
+        if (node.type == 1) somaIds.push_back(id);
+    }
+
+    if (somaIds.empty()) return inputNodes;
+
+    double x = 0, y = 0, z = 0, r = 0;
+    for (int id : somaIds) {
+        const SWCNode& n = inputNodes.at(id);
+        x += n.x;
+        y += n.y;
+        z += n.z;
+        r += n.radius;
+    }
+    x /= somaIds.size();
+    y /= somaIds.size();
+    z /= somaIds.size();
+    r /= somaIds.size();
+
+    SWCNode soma;
+    soma.id = 1;
+    soma.pid = -1;
+    soma.type = 1;
+    soma.x = x;
+    soma.y = y;
+    soma.z = z;
+    soma.radius = r;
+
+    std::map<int, SWCNode> newNodes;
+    newNodes[1] = soma;
+
+    int nextId = 2;
+    std::unordered_map<int, int> idMap;
+
+    for (const auto& [id, node] : inputNodes) {
+        if (node.type == 1) continue;
+        SWCNode newNode = node;
+        newNode.id = nextId;
+        idMap[id] = nextId;
+        newNodes[nextId++] = newNode;
+    }
+
+    for (auto& [id, node] : newNodes) {
+        if (id == 1) continue;
+        if (inputNodes.at(node.pid).type == 1 || node.pid == 1) {
+            node.pid = 1;
+        } else {
+            node.pid = idMap[node.pid];
+        }
+    }
+	
+	if (!isTopologicallySorted(newNodes)) {
+		newNodes = topologicalSort(newNodes);
+	}
+
+    return newNodes;
+}
+
+/**
+ * @brief Splits all edges in the neuron by inserting midpoint nodes
+ * @param nodeSet The input map of SWC nodes to process
+ * @return A new map of SWC nodes with midpoint nodes inserted on all edges
+ * 
+ * This method performs edge subdivision by inserting a new node at the midpoint
+ * of every parent-child edge in the neuron morphology. The process involves:
+ * 1. Creating a midpoint node for each parent-child relationship
+ * 2. Positioning the midpoint at the average coordinates of parent and child
+ * 3. Setting the midpoint radius as the average of parent and child radii
+ * 4. Updating the topology so child nodes connect through their midpoints
+ * 5. Numbering the result in topological order
+ *
+ * The split is done in one breadth-first pass over dense rows that writes
+ * the nodes in their final order, so no separate topologicalSort() is run.
+ * 
+ * This operation effectively doubles the resolution of the neuron morphology,
+ * which is useful for:
+ * - Mesh refinement operations
+ * - Improved geometric accuracy in simulations
+ * - Smoother interpolation between neuron segments
+ * 
+ * @note All node IDs are reassigned sequentially, exactly as topologicalSort() would
+ * @note Midpoint nodes inherit the type of their child node
+ * @note Root nodes (pid == -1) are not affected by this operation
+ * 
+ * @see splitEdgesN() for performing multiple iterations of edge splitting
+ * @see topologicalSort() for ensuring proper node ordering
+ */
+std::map<int, SWCNode> NeuronGraph::splitEdges(const std::map<int, SWCNode>& nodeSet) const {
+    std::vector<SWCNode> nodes, split;
+    std::vector<int> parentRow, splitParent;
+    toDenseRows(nodeSet, nodes, parentRow);
+    if (splitDenseRows(nodes, parentRow, split, splitParent)) return denseRowsToMap(split);
+
+    // Nothing to split
+    if (!isTopologicallySorted(nodeSet)) return topologicalSort(nodeSet);
+    return nodeSet;
+}
+
+/**
+ * @brief Performs N iterations of edge splitting on the neuron morphology
+ * @param nodeSet The input map of SWC nodes to process
+ * @param N The number of edge splitting iterations to perform
+ * @return A vector containing the node sets after each iteration of splitting
+ * 
+ * This method applies the splitEdges() operation N times in sequence, where each
+ * iteration uses the result of the previous iteration as input. This creates
+ * progressively finer subdivisions of the neuron morphology.
+ * 
+ * The returned vector contains N maps, where:
+ * - splits[0] contains the result after 1 iteration
+ * - splits[1] contains the result after 2 iterations
+ * - splits[N-1] contains the result after N iterations
+ * 
+ * After N iterations, the number of nodes grows exponentially, with each
+ * iteration approximately doubling the number of edges (and thus nodes).
+ * 
+ * Use cases:
+ * - Progressive mesh refinement for adaptive simulations
+ * - Creating multiple levels of detail for the same neuron
+ * - Analyzing convergence properties of numerical methods
+ * 
+ * @note Each iteration significantly increases the number of nodes
+ * @note Memory usage grows exponentially with N
+ * @note Consider memory constraints when choosing large values of N
+ * 
+ * @see splitEdges() for single iteration edge splitting
+ */
+std::vector<std::map<int, SWCNode>> NeuronGraph::splitEdgesN(const std::map<int, SWCNode>& nodeSet, int N) const {
+    std::vector<std::map<int, SWCNode>> splits;
+    splits.reserve(N > 0 ? N : 0);
+    splitEdgesN(nodeSet, N, [&splits](int, const std::map<int, SWCNode>& level) { splits.push_back(level); });
+    return splits;
+}
+
+/**
+ * @brief Applies edge splitting N times and streams each level to a callback
+ * @param nodeSet The input map of SWC nodes to refine
+ * @param N Number of splitting iterations
+ * @param onLevel Callback receiving the level index (0 to N-1) and its nodes
+ *
+ * Unlike the vector-returning overload this keeps only the current level
+ * alive; the input is not copied, the first split reads it directly.
+ *
+ * @see splitEdgesN(const std::map<int, SWCNode>&, int) const
+ */
+void NeuronGraph::splitEdgesN(const std::map<int, SWCNode>& nodeSet, int N,
+                              const std::function<void(int, const std::map<int, SWCNode>&)>& onLevel) const {
+    if (N <= 0) return;
+
+    // Levels stay in dense rows between splits; only the delivered map is built
+    std::vector<SWCNode> nodes, split;
+    std::vector<int> parentRow, splitParent;
+    toDenseRows(nodeSet, nodes, parentRow);
+    for (int i = 0; i < N; ++i) {
+        if (splitDenseRows(nodes, parentRow, split, splitParent)) {
+            nodes.swap(split);
+            parentRow.swap(splitParent);
+            onLevel(i, denseRowsToMap(nodes));
+        } else {
+            std::map<int, SWCNode> currentSet = this->splitEdges(denseRowsToMap(nodes));
+            onLevel(i, currentSet);
+            toDenseRows(currentSet, nodes, parentRow);
+        }
+    }
+}
+
+/**
+ * @brief Performs topological sorting of neuron nodes to ensure proper parent-child ordering
+ * @param nodeSet The input map of SWC nodes to sort
+ * @return A new map of SWC nodes with reassigned IDs in topological order
+ * 
+ * This method implements Kahn's algorithm for topological sorting to ensure that
+ * all parent nodes have smaller IDs than their children. The algorithm:
+ * 1. Buckets the children of every row with a counting sort
+ * 2. Starts with nodes having zero in-degree (root nodes)
+ * 3. Processes nodes in breadth-first order into a preallocated queue
+ * 4. Reassigns node IDs sequentially (1, 2, 3, ...) based on topological order
+ * 5. Updates parent IDs to maintain correct relationships
+ * 
+ * Topological sorting is essential for:
+ * - Ensuring proper tree traversal algorithms work correctly
+ * - Maintaining consistency in neuron analysis operations
+ * - Enabling efficient parent-to-child processing
+ * - Supporting mesh generation algorithms that rely on ordered traversal
+ * 
+ * The resulting neuron will have:
+ * - Root nodes (soma) with the smallest IDs
+ * - All parent nodes having IDs smaller than their children
+ * - Sequential ID numbering starting from 1
+ * 
+ * @note This method creates entirely new node IDs while preserving topology
+ * @note The original node IDs are completely replaced
+ * @note Parent-child relationships are preserved but with new ID mappings
+ * 
+ * @see isTopologicallySorted() to check if sorting is needed
+ */
+std::map<int, SWCNode> NeuronGraph::topologicalSort(const std::map<int, SWCNode>& nodeSet) const {
+    std::vector<SWCNode> nodes;
+    std::vector<int> parentRow, sortedOrder, levelEnd;
+    toDenseRows(nodeSet, nodes, parentRow);
+    denseBreadthFirst(parentRow, sortedOrder, levelEnd);
+
+    std::vector<int> newId(nodes.size(), 0);
+    for (std::size_t i = 0; i < sortedOrder.size(); ++i)
+        newId[sortedOrder[i]] = static_cast<int>(i) + 1;
+
+    // New ids ascend along sortedOrder, so every insert lands at the end
+    std::map<int, SWCNode> sortedNodes;
+    for (int row : sortedOrder) {
+        SWCNode node = nodes[row];
+        node.id = newId[row];
+        if (node.pid != -1) node.pid = parentRow[row] == -1 ? 0 : newId[parentRow[row]];
+        sortedNodes.emplace_hint(sortedNodes.end(), node.id, node);
+    }
+
+    return sortedNodes;
+}
+
+/**
+ * @brief Assigns a soma node to a neuron morphology that lacks one
+ * @param nodeSet The input map of SWC nodes missing a soma
+ * @return A new map of SWC nodes with a soma node assigned
+ * 
+ * This method addresses neuron morphologies that are missing a soma (cell body)
+ * by converting the first root node found (pid == -1) into a soma node (type = 1).
+ * 
+ * The method follows this logic:
+ * 1. First checks if a soma already exists using isSomaMissing()
+ * 2. If soma is present, returns the input unchanged
+ * 3. If soma is missing, searches for the first root node (pid == -1)
+ * 4. Converts the root node's type to 1 (soma type)
+ * 5. Prints a confirmation message with the assigned node ID
+ * 
+ * This operation is essential for:
+ * - Ensuring every neuron has exactly one soma for proper analysis
+ * - Correcting incomplete neuron reconstructions
+ * - Preparing neuron data for mesh generation algorithms
+ * - Maintaining consistency with neuron morphology standards
+ * 
+ * @note If no root node is found, prints a warning and returns input unchanged
+ * @note Only the first root node encountered is converted to soma
+ * @note The node's position and other properties remain unchanged
+ * 
+ * @warning If multiple root nodes exist, only the first one becomes the soma
+ * 
+ * @see isSomaMissing() to detect if soma assignment is needed
+ * @see preprocess() which automatically calls this method when needed
+ */
+std::map<int, SWCNode> NeuronGraph::setSoma(const std::map<int, SWCNode>& nodeSet) const {
+    if (!isSomaMissing(nodeSet)) {
+        return nodeSet; // Soma already present
+    }
+
+    std::map<int, SWCNode> modified = nodeSet;
+
+    for (auto& [id, node] : modified) {
+        if (node.pid == -1) {
+            node.type = 1; // Set as soma
+            NM_LOG(Info) << "Assigned node ID " << id << " as soma (type 1).\n";
+            return modified;
+        }
+    }
+
+    std::cerr << "Warning: Soma is missing and no root node (pid = -1) found to assign.\n";
+    return modified;
+}
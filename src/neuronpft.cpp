@@ -1,145 +1,548 @@
-#include "ugxobject.h"
-#include "neurongraph.h"
-#include <vector>
-#include <tuple>
-#include <cmath>
-#include <map>
-
-struct Vec3 {
-    double x, y, z;
-
-    Vec3 operator+(const Vec3& other) const { return {x + other.x, y + other.y, z + other.z}; }
-    Vec3 operator-(const Vec3& other) const { return {x - other.x, y - other.y, z - other.z}; }
-    Vec3 operator*(double s) const { return {x * s, y * s, z * s}; }
-    Vec3 operator/(double s) const { return {x / s, y / s, z / s}; }
-
-    double norm() const {
-        return std::sqrt(x * x + y * y + z * z);
-    }
-
-    Vec3 normalize() const {
-        double n = this->norm();
-        if (n < 1e-10) return {0, 0, 0};  // prevent division by zero
-        return *this / n;
-    }
-
-    Vec3 cross(const Vec3& other) const {
-        return {
-            y * other.z - z * other.y,
-            z * other.x - x * other.z,
-            x * other.y - y * other.x
-        };
-    }
-};
-
-inline Vec3 operator*(double s, const Vec3& v) { return v * s; }
-
-struct Node {
-    Vec3 pos;
-    double radius;
-    int type;
-};
-
-std::vector<std::tuple<Vec3, Vec3, Vec3>> computePTF(const std::vector<Node>& nodes) {
-    std::vector<std::tuple<Vec3, Vec3, Vec3>> frames;
-    if (nodes.size() < 2) return frames;
-
-    Vec3 t0 = (nodes[1].pos - nodes[0].pos).normalize();
-    Vec3 n0 = {0, 1, 0};
-    if (std::abs(t0.cross(n0).norm()) < 1e-3) n0 = {1, 0, 0};
-    Vec3 b0 = t0.cross(n0).normalize();
-    n0 = b0.cross(t0).normalize();
-    frames.emplace_back(t0, n0, b0);
-
-    for (size_t i = 1; i < nodes.size(); ++i) {
-        Vec3 t = (nodes[i].pos - nodes[i - 1].pos).normalize();
-        Vec3 b_prev = std::get<2>(frames.back());
-        Vec3 n = b_prev.cross(t).normalize();
-        Vec3 b = t.cross(n).normalize();
-        frames.emplace_back(t, n, b);
-    }
-    return frames;
-}
-
-// Main method
-UgxObject NeuronGraph::pftFromPath(const std::map<int, SWCNode>& path, int segments) {
-    std::vector<Node> nodes;
-    for (const auto& [_, swc] : path) {
-        nodes.push_back({{swc.x, swc.y, swc.z}, swc.radius, swc.type});
-    }
-
-    auto frames = computePTF(nodes);
-    UgxGeometry geom;
-    int vid = 0;
-
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        const auto& [T, N, B] = frames[i];
-        const Vec3& P = nodes[i].pos;
-        double r = nodes[i].radius;
-
-        for (int j = 0; j < segments; ++j) {
-            double theta = 2.0 * M_PI * j / segments;
-            Vec3 circ = std::cos(theta) * N + std::sin(theta) * B;
-            Vec3 v = P + circ * r;
-
-            geom.points[vid] = {v.x, v.y, v.z};
-            geom.radii[vid] = r;
-            geom.vertexSubsets[vid] = nodes[i].type;
-            ++vid;
-        }
-    }
-
-    int numRings = nodes.size();
-    for (int i = 0; i < numRings - 1; ++i) {
-        for (int j = 0; j < segments; ++j) {
-            int a = i * segments + j;
-            int b = i * segments + (j + 1) % segments;
-            int c = (i + 1) * segments + j;
-            int d = (i + 1) * segments + (j + 1) % segments;
-
-            geom.edges.push_back({a, c});
-            geom.edges.push_back({a, b});
-            geom.edges.push_back({c, d});
-            geom.edges.push_back({b, c}); // ← new diagonal edge
-
-            geom.faces.push_back({a, b, c});
-            geom.faces.push_back({b, d, c});
-
-            geom.edgeSubsets[geom.edges.size() - 4] = nodes[i].type;
-            geom.edgeSubsets[geom.edges.size() - 3] = nodes[i].type;
-            geom.edgeSubsets[geom.edges.size() - 2] = nodes[i].type;
-            geom.edgeSubsets[geom.edges.size() - 1] = nodes[i].type;
-
-            geom.faceSubsets[geom.faces.size() - 2] = nodes[i].type;
-            geom.faceSubsets[geom.faces.size() - 1] = nodes[i].type;
-        }
-    }
-
-    // Assign subset names
-    std::map<int, std::string> subsetTypeNames = {
-        {1, "Soma"},
-        {2, "Axon"},
-        {3, "Dendrite"},
-        {4, "ApicalDendrite"},
-        {5, "ForkPoint"},
-        {6, "EndPoint"},
-        {7, "Custom"}
-    };
-
-    std::set<int> usedTypes;
-    for (const auto& [_, node] : path) {
-        usedTypes.insert(node.type);
-    }
-
-    for (int typeId : usedTypes) {
-        if (subsetTypeNames.count(typeId))
-            geom.subsetNames[typeId] = subsetTypeNames[typeId];
-        else
-            geom.subsetNames[typeId] = "UnknownType_" + std::to_string(typeId);
-    }
-
-    UgxObject obj;
-    obj.setGeometry(geom);
-
-    return obj;
-}
\ No newline at end of file
+#include "ugxobject.h"
+#include "neurongraph.h"
+#include "threadpool.h"
+#include "trunkbatch.h"
+#include <array>
+#include <vector>
+#include <tuple>
+#include <cmath>
+#include <map>
+#include <optional>
+
+struct Vec3 {
+    double x, y, z;
+
+    Vec3 operator+(const Vec3& other) const { return {x + other.x, y + other.y, z + other.z}; }
+    Vec3 operator-(const Vec3& other) const { return {x - other.x, y - other.y, z - other.z}; }
+    Vec3 operator*(double s) const { return {x * s, y * s, z * s}; }
+    Vec3 operator/(double s) const { return {x / s, y / s, z / s}; }
+
+    double norm() const {
+        return std::sqrt(x * x + y * y + z * z);
+    }
+
+    Vec3 normalize() const {
+        double n = this->norm();
+        if (n < 1e-10) return {0, 0, 0};  // prevent division by zero
+        return *this / n;
+    }
+
+    Vec3 cross(const Vec3& other) const {
+        return {
+            y * other.z - z * other.y,
+            z * other.x - x * other.z,
+            x * other.y - y * other.x
+        };
+    }
+};
+
+inline Vec3 operator*(double s, const Vec3& v) { return v * s; }
+
+struct Node {
+    Vec3 pos;
+    double radius;
+    int type;
+};
+
+std::vector<std::tuple<Vec3, Vec3, Vec3>> computePTF(const std::vector<Node>& nodes) {
+    std::vector<std::tuple<Vec3, Vec3, Vec3>> frames;
+    if (nodes.size() < 2) return frames;
+    frames.reserve(nodes.size());
+
+    Vec3 t0 = (nodes[1].pos - nodes[0].pos).normalize();
+    Vec3 n0 = {0, 1, 0};
+    if (std::abs(t0.cross(n0).norm()) < 1e-3) n0 = {1, 0, 0};
+    Vec3 b0 = t0.cross(n0).normalize();
+    n0 = b0.cross(t0).normalize();
+    frames.emplace_back(t0, n0, b0);
+
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        Vec3 t = (nodes[i].pos - nodes[i - 1].pos).normalize();
+        Vec3 b_prev = std::get<2>(frames.back());
+        Vec3 n = b_prev.cross(t).normalize();
+        Vec3 b = t.cross(n).normalize();
+        frames.emplace_back(t, n, b);
+    }
+    return frames;
+}
+
+// cos/sin of the ring angles; identical for every ring of a tube
+struct RingTable {
+    std::vector<double> cosTheta, sinTheta;
+
+    explicit RingTable(int segments) : cosTheta(segments), sinTheta(segments) {
+        for (int j = 0; j < segments; ++j) {
+            double theta = 2.0 * M_PI * j / segments;
+            cosTheta[j] = std::cos(theta);
+            sinTheta[j] = std::sin(theta);
+        }
+    }
+};
+
+// sin of x in [-pi, pi] by its Taylor series, usable in constant expressions
+constexpr double constexprSin(double x) {
+    double term = x, sum = x;
+    for (int k = 1; k < 30; ++k) {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// The ring table of a fixed resolution, computed by the compiler
+template <int Segments>
+struct FixedRingTable {
+    static constexpr std::array<double, Segments> table(bool cosine) {
+        std::array<double, Segments> values{};
+        for (int j = 0; j < Segments; ++j) {
+            double theta = 2.0 * M_PI * j / Segments;
+            if (cosine) theta += M_PI / 2;          // cos t = sin(t + pi/2)
+            if (theta > M_PI) theta -= 2.0 * M_PI;
+            values[j] = constexprSin(theta);
+        }
+        return values;
+    }
+    static constexpr std::array<double, Segments> cosTheta = table(true);
+    static constexpr std::array<double, Segments> sinTheta = table(false);
+};
+
+// Ring vertices P + (cos N + sin B) r into structure-of-arrays buffers.
+// The loop has no branches or cross-iteration dependencies so the compiler
+// can vectorize it for the target (SSE/AVX/NEON); with Segments > 0 the trip
+// count is a constant and the loop can be fully unrolled.
+template <int Segments>
+static void ringVertices(const double* __restrict__ c, const double* __restrict__ s, int runtimeSegments,
+                         const Vec3& P, const Vec3& N, const Vec3& B, double r,
+                         double* __restrict__ xs, double* __restrict__ ys, double* __restrict__ zs) {
+    const int segments = Segments > 0 ? Segments : runtimeSegments;
+    for (int j = 0; j < segments; ++j) {
+        xs[j] = P.x + (c[j] * N.x + s[j] * B.x) * r;
+        ys[j] = P.y + (c[j] * N.y + s[j] * B.y) * r;
+        zs[j] = P.z + (c[j] * N.z + s[j] * B.z) * r;
+    }
+}
+
+// Tube around consecutive nodes, built directly in dense form one ring after the other.
+// Segments > 0 fixes the ring resolution at compile time (constexpr angle table,
+// constant loop bounds); Segments == 0 takes it from `runtimeSegments`.
+template <int Segments>
+static DenseUgxGeometry tubeKernel(const std::vector<Node>& nodes, int runtimeSegments) {
+    auto frames = computePTF(nodes);
+    DenseUgxGeometry geom;
+    const int segments = Segments > 0 ? Segments : runtimeSegments;
+
+    const double* cosTheta;
+    const double* sinTheta;
+    std::optional<RingTable> runtimeRing;
+    if constexpr (Segments > 0) {
+        cosTheta = FixedRingTable<Segments>::cosTheta.data();
+        sinTheta = FixedRingTable<Segments>::sinTheta.data();
+    } else {
+        runtimeRing.emplace(segments);
+        cosTheta = runtimeRing->cosTheta.data();
+        sinTheta = runtimeRing->sinTheta.data();
+    }
+
+    const std::size_t numVertices = frames.size() * segments;
+    std::vector<double> xs(numVertices), ys(numVertices), zs(numVertices);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const auto& [T, N, B] = frames[i];
+        const std::size_t base = i * segments;
+        ringVertices<Segments>(cosTheta, sinTheta, segments, nodes[i].pos, N, B, nodes[i].radius,
+                               &xs[base], &ys[base], &zs[base]);
+    }
+
+    geom.points.resize(numVertices);
+    geom.radii.resize(numVertices);
+    geom.vertexSubsets.resize(numVertices);
+    for (std::size_t v = 0; v < numVertices; ++v) {
+        const Node& node = nodes[v / segments];
+        geom.points[v] = {xs[v], ys[v], zs[v]};
+        geom.radii[v] = node.radius;
+        geom.vertexSubsets[v] = node.type;
+    }
+
+    int numRings = frames.size();
+    if (numRings > 1) {
+        const std::size_t quads = static_cast<std::size_t>(numRings - 1) * segments;
+        geom.edges.reserve(4 * quads);
+        geom.faces.reserve(2 * quads);
+        geom.edgeSubsets.reserve(4 * quads);
+        geom.faceSubsets.reserve(2 * quads);
+    }
+    for (int i = 0; i < numRings - 1; ++i) {
+        const int type = nodes[i].type;
+        for (int j = 0; j < segments; ++j) {
+            int jn = (j + 1 == segments) ? 0 : j + 1;
+            int a = i * segments + j;
+            int b = i * segments + jn;
+            int c = (i + 1) * segments + j;
+            int d = (i + 1) * segments + jn;
+
+            geom.edges.push_back({a, c});
+            geom.edges.push_back({a, b});
+            geom.edges.push_back({c, d});
+            geom.edges.push_back({b, c}); // ← new diagonal edge
+
+            geom.faces.push_back({a, b, c});
+            geom.faces.push_back({b, d, c});
+
+            geom.edgeSubsets.insert(geom.edgeSubsets.end(), 4, type);
+            geom.faceSubsets.insert(geom.faceSubsets.end(), 2, type);
+        }
+    }
+
+    NM_COUNT("pft.vertices", numVertices);
+    NM_COUNT("pft.faces", geom.faces.size());
+
+    // Assign subset names
+    std::map<int, std::string> subsetTypeNames = {
+        {1, "Soma"},
+        {2, "Axon"},
+        {3, "Dendrite"},
+        {4, "ApicalDendrite"},
+        {5, "ForkPoint"},
+        {6, "EndPoint"},
+        {7, "Custom"}
+    };
+
+    std::set<int> usedTypes;
+    for (const Node& node : nodes) {
+        usedTypes.insert(node.type);
+    }
+
+    for (int typeId : usedTypes) {
+        if (subsetTypeNames.count(typeId))
+            geom.subsetNames[typeId] = subsetTypeNames[typeId];
+        else
+            geom.subsetNames[typeId] = "UnknownType_" + std::to_string(typeId);
+    }
+
+    return geom;
+}
+
+// The ring resolutions used in practice get their own kernel; any other falls back to the generic one
+static DenseUgxGeometry tubeFromNodes(const std::vector<Node>& nodes, int segments) {
+    switch (segments) {
+        case 8: return tubeKernel<8>(nodes, segments);
+        case 16: return tubeKernel<16>(nodes, segments);
+        case 32: return tubeKernel<32>(nodes, segments);
+        default: return tubeKernel<0>(nodes, segments);
+    }
+}
+
+// Main method: the path's nodes in id order become the rings of the tube
+DenseUgxGeometry NeuronGraph::pftDenseFromPath(const std::map<int, SWCNode>& path, int segments) {
+    NM_SCOPED_TIMER("pftFromPath");
+    std::vector<Node> nodes;
+    nodes.reserve(path.size());
+    for (const auto& [_, swc] : path) {
+        nodes.push_back({{swc.x, swc.y, swc.z}, swc.radius, swc.type});
+    }
+    return tubeFromNodes(nodes, segments);
+}
+
+UgxObject NeuronGraph::pftFromPath(const std::map<int, SWCNode>& path, int segments) {
+    return UgxObject(pftDenseFromPath(path, segments).toGeometry());
+}
+
+TubeBatchLayout tubeBatchLayout(const TrunkBatch& batch, int segments) {
+    TubeBatchLayout layout;
+    layout.vertexOffsets.resize(batch.size() + 1, 0);
+    layout.triangleOffsets.resize(batch.size() + 1, 0);
+    for (std::size_t t = 0; t < batch.size(); ++t) {
+        const std::size_t n = batch.length(t);
+        const std::size_t rings = n < 2 ? 0 : n;
+        layout.vertexOffsets[t + 1] = layout.vertexOffsets[t] + rings * segments;
+        layout.triangleOffsets[t + 1] = layout.triangleOffsets[t] + (rings ? 2 * (n - 1) * segments : 0);
+    }
+    return layout;
+}
+
+// One trunk of a batch written as tubeKernel() builds it, at the trunk's offsets in the buffers
+template <int Segments>
+static void tubeBatchKernel(const TrunkBatch& batch, std::size_t t, const double* cosTheta, const double* sinTheta,
+                            int runtimeSegments, const TubeBatchLayout& layout, float* vertices,
+                            std::uint32_t* triangles) {
+    const std::size_t n = batch.length(t);
+    if (n < 2) return;
+    const int segments = Segments > 0 ? Segments : runtimeSegments;
+
+    thread_local std::vector<Node> nodes;
+    thread_local std::vector<double> xs, ys, zs;
+    nodes.clear();
+    for (std::size_t row = batch.offsets[t]; row < batch.offsets[t + 1]; ++row) {
+        const double* v = &batch.xyzr[4 * row];
+        nodes.push_back({{v[0], v[1], v[2]}, v[3], batch.types[row]});
+    }
+    auto frames = computePTF(nodes);
+    xs.resize(segments);
+    ys.resize(segments);
+    zs.resize(segments);
+
+    const std::size_t base = layout.vertexOffsets[t];
+    float* out = vertices + 3 * base;
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        const auto& [T, N, B] = frames[i];
+        ringVertices<Segments>(cosTheta, sinTheta, segments, nodes[i].pos, N, B, nodes[i].radius,
+                               xs.data(), ys.data(), zs.data());
+        for (int j = 0; j < segments; ++j, out += 3) {
+            out[0] = static_cast<float>(xs[j]);
+            out[1] = static_cast<float>(ys[j]);
+            out[2] = static_cast<float>(zs[j]);
+        }
+    }
+
+    std::uint32_t* tri = triangles + 3 * layout.triangleOffsets[t];
+    for (std::size_t i = 0; i + 1 < frames.size(); ++i) {
+        for (int j = 0; j < segments; ++j, tri += 6) {
+            int jn = (j + 1 == segments) ? 0 : j + 1;
+            auto a = static_cast<std::uint32_t>(base + i * segments + j);
+            auto b = static_cast<std::uint32_t>(base + i * segments + jn);
+            auto c = static_cast<std::uint32_t>(base + (i + 1) * segments + j);
+            auto d = static_cast<std::uint32_t>(base + (i + 1) * segments + jn);
+            tri[0] = a; tri[1] = b; tri[2] = c;
+            tri[3] = b; tri[4] = d; tri[5] = c;
+        }
+    }
+}
+
+template <int Segments>
+static void tubeBatch(const TrunkBatch& batch, int segments, const TubeBatchLayout& layout, float* vertices,
+                      std::uint32_t* triangles, std::size_t threads) {
+    const double* cosTheta;
+    const double* sinTheta;
+    std::optional<RingTable> runtimeRing;
+    if constexpr (Segments > 0) {
+        cosTheta = FixedRingTable<Segments>::cosTheta.data();
+        sinTheta = FixedRingTable<Segments>::sinTheta.data();
+    } else {
+        runtimeRing.emplace(segments);
+        cosTheta = runtimeRing->cosTheta.data();
+        sinTheta = runtimeRing->sinTheta.data();
+    }
+    parallelFor(batch.size(), threads, [&](std::size_t t) {
+        tubeBatchKernel<Segments>(batch, t, cosTheta, sinTheta, segments, layout, vertices, triangles);
+    });
+}
+
+void writeTubeBatch(const TrunkBatch& batch, int segments, const TubeBatchLayout& layout, float* vertices,
+                    std::uint32_t* triangles, std::size_t threads) {
+    NM_SCOPED_TIMER("tubeBatch");
+    switch (segments) {
+        case 8: tubeBatch<8>(batch, segments, layout, vertices, triangles, threads); break;
+        case 16: tubeBatch<16>(batch, segments, layout, vertices, triangles, threads); break;
+        case 32: tubeBatch<32>(batch, segments, layout, vertices, triangles, threads); break;
+        default: tubeBatch<0>(batch, segments, layout, vertices, triangles, threads); break;
+    }
+    NM_COUNT("pft.vertices", layout.vertices());
+    NM_COUNT("pft.faces", layout.triangles());
+}
+
+TubeBuffers meshTubeBatch(const TrunkBatch& batch, int segments, std::size_t threads) {
+    TubeBatchLayout layout = tubeBatchLayout(batch, segments);
+    TubeBuffers buffers;
+    buffers.vertices.resize(3 * layout.vertices());
+    buffers.triangles.resize(3 * layout.triangles());
+    writeTubeBatch(batch, segments, layout, buffers.vertices.data(), buffers.triangles.data(), threads);
+    return buffers;
+}
+
+namespace {
+
+// One tube of a surface and the rows its end rings are centred on
+struct SurfacePart {
+    std::vector<Node> nodes;
+    int firstRow = -1, lastRow = -1;
+};
+
+Node surfaceNode(const SWCNode& n) { return {{n.x, n.y, n.z}, n.radius, n.type}; }
+
+// Rotation (and direction) of ring `ring` that best matches ring `canonical`;
+// every vertex of `ring` is remapped to its partner in `canonical`
+void weldRing(const DenseUgxGeometry& g, int canonical, int ring, int segments, std::vector<int>& remap) {
+    auto dist2 = [&g](int a, int b) {
+        const Coordinates& p = g.points[a];
+        const Coordinates& q = g.points[b];
+        return (p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y) + (p.z - q.z) * (p.z - q.z);
+    };
+    double best = std::numeric_limits<double>::infinity();
+    int bestShift = 0, bestDir = 1;
+    for (int dir : {1, -1}) {
+        for (int shift = 0; shift < segments; ++shift) {
+            double cost = 0.0;
+            for (int j = 0; j < segments && cost < best; ++j)
+                cost += dist2(ring + j, canonical + ((shift + dir * j) % segments + segments) % segments);
+            if (cost < best) {
+                best = cost;
+                bestShift = shift;
+                bestDir = dir;
+            }
+        }
+    }
+    for (int j = 0; j < segments; ++j)
+        remap[ring + j] = canonical + ((bestShift + bestDir * j) % segments + segments) % segments;
+}
+
+// Clipped trunks and junction curves of a morphology, in a fixed order
+std::vector<SurfacePart> surfaceParts(const NeuronGraph& graph, const Morphology& morph, const TopologyIndex& index,
+                                      const TrunkDecomposition& trunks, const SurfaceMeshOptions& options) {
+    std::vector<SurfacePart> parts(trunks.size());
+
+    // A trunk ends at a branch point; the junction curves cover the last edge, so the
+    // tube stops at the neighbour. A single edge between two branch points stays whole
+    // to join the two junctions.
+    parallelFor(trunks.size(), options.threads, [&](std::size_t t) {
+        int first = trunks.offsets[t], last = trunks.offsets[t + 1] - 1;
+        if (last - first > 1) {
+            if (index.degree(trunks.rows[first]) > 2) ++first;
+            if (index.degree(trunks.rows[last]) > 2) --last;
+        }
+        if (last <= first) return;
+
+        SurfacePart& part = parts[t];
+        part.firstRow = trunks.rows[first];
+        part.lastRow = trunks.rows[last];
+        if (options.delta > 0.0) {
+            std::map<int, SWCNode> path;
+            for (int k = first; k <= last; ++k) {
+                SWCNode n = morph.node(trunks.rows[k]);
+                n.id = k - first + 1;
+                n.pid = k == first ? -1 : n.id - 1;
+                path.emplace_hint(path.end(), n.id, n);
+            }
+            double delta = options.delta;
+            for (const auto& [_, n] : graph.cubicSplineResampleTrunk(path, delta)) part.nodes.push_back(surfaceNode(n));
+        } else {
+            for (int k = first; k <= last; ++k) part.nodes.push_back(surfaceNode(morph.node(trunks.rows[k])));
+        }
+    });
+
+    // junction curves, k per branch point of degree k
+    std::vector<std::size_t> junctionOffset(index.branchPoints.size() + 1, parts.size());
+    for (std::size_t b = 0; b < index.branchPoints.size(); ++b)
+        junctionOffset[b + 1] = junctionOffset[b] + index.degree(index.branchPoints[b]);
+    parts.resize(junctionOffset.back());
+    parallelFor(index.branchPoints.size(), options.threads, [&](std::size_t b) {
+        const int center = index.branchPoints[b];
+        std::vector<int> rows(index.neighbors.begin() + index.neighborOffsets[center],
+                              index.neighbors.begin() + index.neighborOffsets[center + 1]);
+        std::vector<SWCNode> neighbours;
+        for (int row : rows) neighbours.push_back(morph.node(row));
+        auto curves = NeuronGraph::junctionBezierCurves(morph.node(center), neighbours, options.insetFactor,
+                                                        options.bezierPoints);
+        for (std::size_t i = 0; i < curves.size(); ++i) {
+            SurfacePart& part = parts[junctionOffset[b] + i];
+            part.firstRow = rows[i];
+            part.lastRow = rows[(i + 1) % rows.size()];
+            for (const auto& [_, n] : curves[i]) part.nodes.push_back(surfaceNode(n));
+        }
+    });
+    return parts;
+}
+
+// Meshes, merges and welds the parts; see NeuronGraph::meshSurface()
+DenseUgxGeometry meshSurfaceParts(const Morphology& morph, const TopologyIndex& index,
+                                  const std::vector<SurfacePart>& parts, const SurfaceMeshOptions& options) {
+    const int segments = options.segments;
+    std::vector<DenseUgxGeometry> tubes(parts.size());
+    parallelFor(parts.size(), options.threads, [&](std::size_t p) {
+        if (parts[p].nodes.size() >= 2) tubes[p] = tubeFromNodes(parts[p].nodes, segments);
+    });
+
+    DenseUgxGeometry merged;
+    merged.appendAll(tubes, options.threads);
+    NM_COUNT("surface.parts", parts.size());
+
+    // The first ring placed on a node is kept; later rings on the same node are
+    // welded onto it. Parts come in a fixed order, so the result does not depend
+    // on the thread count.
+    const int numVertices = static_cast<int>(merged.points.size());
+    std::vector<int> remap(numVertices);
+    std::iota(remap.begin(), remap.end(), 0);
+    std::vector<int> canonical(morph.size(), -1);   // first ring on every row
+    int offset = 0;
+    for (std::size_t p = 0; p < parts.size(); ++p) {
+        const int size = static_cast<int>(tubes[p].points.size());
+        if (size == 0) continue;
+        const std::pair<int, int> ends[2] = {{parts[p].firstRow, offset}, {parts[p].lastRow, offset + size - segments}};
+        for (const auto& [row, ring] : ends) {
+            if (canonical[row] == -1) {
+                canonical[row] = ring;
+                continue;
+            }
+            weldRing(merged, canonical[row], ring, segments, remap);
+        }
+        offset += size;
+    }
+
+    // Welded vertices take the index of their partner, which always comes earlier
+    std::vector<int> newIndex(numVertices);
+    DenseUgxGeometry surface;
+    surface.subsetNames = merged.subsetNames;
+    for (int v = 0; v < numVertices; ++v) {
+        if (remap[v] != v) {
+            newIndex[v] = newIndex[remap[v]];
+            continue;
+        }
+        newIndex[v] = static_cast<int>(surface.points.size());
+        surface.points.push_back(merged.points[v]);
+        surface.radii.push_back(merged.radii[v]);
+        surface.vertexSubsets.push_back(merged.vertexSubsets[v]);
+    }
+    surface.edges.resize(merged.edges.size());
+    parallelFor(merged.edges.size(), options.threads, [&](std::size_t e) {
+        surface.edges[e] = {newIndex[merged.edges[e].first], newIndex[merged.edges[e].second]};
+    });
+    surface.edgeSubsets = std::move(merged.edgeSubsets);
+    surface.faces.resize(merged.faces.size());
+    parallelFor(merged.faces.size(), options.threads, [&](std::size_t f) {
+        const auto& face = merged.faces[f];
+        surface.faces[f] = {newIndex[face[0]], newIndex[face[1]], newIndex[face[2]]};
+    });
+    surface.faceSubsets = std::move(merged.faceSubsets);
+
+    // a fan around a centre vertex closes the ring of every terminal node
+    if (options.capTips) {
+        for (std::size_t row = 0; row < morph.size(); ++row) {
+            if (canonical[row] == -1 || index.degree(row) != 1) continue;
+            const int centre = static_cast<int>(surface.points.size());
+            const int ring = newIndex[canonical[row]];
+            const int subset = surface.vertexSubsets[ring];
+            surface.points.push_back({morph.x[row], morph.y[row], morph.z[row]});
+            surface.radii.push_back(morph.radius[row]);
+            surface.vertexSubsets.push_back(subset);
+            for (int j = 0; j < segments; ++j) {
+                const int jn = (j + 1 == segments) ? 0 : j + 1;
+                surface.edges.emplace_back(centre, ring + j);
+                surface.edgeSubsets.push_back(subset);
+                surface.faces.push_back({centre, ring + jn, ring + j});
+                surface.faceSubsets.push_back(subset);
+            }
+        }
+    }
+
+    // ring edges repeat between neighbouring quads and on welded rings
+    surface.compact(0.0);
+
+    NM_COUNT("surface.vertices", surface.points.size());
+    NM_COUNT("surface.faces", surface.faces.size());
+    return surface;
+}
+
+} // namespace
+
+DenseUgxGeometry NeuronGraph::meshSurface(const std::map<int, SWCNode>& nodeSet, const SurfaceMeshOptions& options) const {
+    NM_SCOPED_TIMER("meshSurface");
+    Morphology nodes = Morphology::fromNodes(nodeSet);
+    TopologyIndex index = TopologyIndex::build(nodes, &morph);
+    TrunkDecomposition trunks = TrunkDecomposition::build(nodes, index);
+    return meshSurfaceParts(nodes, index, surfaceParts(*this, nodes, index, trunks, options), options);
+}
+
+DenseUgxGeometry NeuronGraph::meshSurface(const SurfaceMeshOptions& options) const {
+    NM_SCOPED_TIMER("meshSurface");
+    auto index = topology();
+    auto trunks = trunkDecomposition();
+    return meshSurfaceParts(morph, *index, surfaceParts(*this, morph, *index, *trunks, options), options);
+}
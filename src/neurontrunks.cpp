@@ -24,6 +24,36 @@
  */
 
 #include "neurongraph.h"
+#include "threadpool.h"
+#include "refinement.h"
+#include "trunkbatch.h"
+
+/**
+ * @brief Resamples every trunk independently, optionally in parallel
+ * @param trunks Map of trunk IDs to their nodes
+ * @param threads Thread count (0 = hardware concurrency, 1 = serial)
+ * @param resample Single-trunk resampler
+ * @return Resampled trunks keyed like the input
+ *
+ * Each trunk writes into its own result slot and the output map is built in
+ * key order afterwards, so the result does not depend on the thread count.
+ */
+template <typename Resample>
+static std::map<int, std::map<int, SWCNode>> resampleTrunks(const std::map<int, std::map<int, SWCNode>>& trunks,
+                                                            std::size_t threads, const Resample& resample) {
+    std::vector<std::map<int, std::map<int, SWCNode>>::const_iterator> items;
+    items.reserve(trunks.size());
+    for (auto it = trunks.begin(); it != trunks.end(); ++it) items.push_back(it);
+
+    std::vector<std::map<int, SWCNode>> results(items.size());
+    parallelFor(items.size(), threads, [&](std::size_t i) { results[i] = resample(items[i]->second); });
+
+    std::map<int, std::map<int, SWCNode>> resampledTrunks;
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        resampledTrunks.emplace_hint(resampledTrunks.end(), items[i]->first, std::move(results[i]));
+    }
+    return resampledTrunks;
+}
 
 /**
  * @brief Builds an adjacency list representing the connectivity between nodes in a neuron morphology
@@ -47,7 +77,7 @@ std::map<int, std::vector<int>> NeuronGraph::getNeighborMap(const std::map<int,
     std::map<int, std::vector<int>> neighbors;
 
     for (const auto& [id, node] : nodeSet) {
-        if (node.pid != -1 && nodes.count(node.pid)) {
+        if (node.pid != -1 && morph.contains(node.pid)) {
             neighbors[id].push_back(node.pid);
             neighbors[node.pid].push_back(id);
         }
@@ -70,77 +100,68 @@ std::map<int, std::vector<int>> NeuronGraph::getNeighborMap(const std::map<int,
  * 1. Builds a neighbor map to represent the neuron's connectivity
  * 2. Identifies branch points (nodes with >2 neighbors)
  * 3. For each branch point, traverses to connected nodes to extract linear segments
- * 4. Uses canonical representation to avoid duplicate trunks
+ * 4. Skips the second discovery of an edge joining two branch points
  * 5. Optionally renumbers node IDs sequentially within each trunk
  *
  * The method handles both directed and undirected traversal of the neuron morphology.
  *
  * @note When resetIndex is true, node IDs within each trunk will be renumbered sequentially starting from 1,
  *       with parent IDs adjusted accordingly. The first node in each trunk will have pid = -1.
- * @note The method uses a canonical representation to ensure each trunk is only included once,
- *       regardless of traversal direction.
+ * @note Each trunk is only included once, regardless of traversal direction.
+ * @see getTrunkSpans() for the same trunks without the per-trunk maps
  * @see getNeighborMap() for the graph representation used internally
  * @see getTrunkParentMap() for establishing relationships between trunks
  */
 std::map<int, std::map<int, SWCNode>> NeuronGraph::getTrunks(const std::map<int, SWCNode>& nodeSet, bool resetIndex) const {
-    std::map<int, std::map<int, SWCNode>> trunkNodeSets;
-    std::map<int, std::vector<int>> neighborMap = getNeighborMap(nodeSet);
-    std::set<int> visited;
-    std::set<std::string> seen;
-    int trunkId = 0;
-
-    auto canonicalKey = [](const std::vector<int>& v) {
-        std::vector<int> fwd = v, rev = v;
-        std::reverse(rev.begin(), rev.end());
-        const auto& best = (fwd < rev) ? fwd : rev;
-        std::ostringstream oss;
-        for (int n : best) oss << n << ",";
-        return oss.str();
-    };
+    return trunkSpansToMaps(getTrunkSpans(nodeSet, resetIndex));
+}
 
-    for (const auto& [id, neighbors] : neighborMap) {
-        if (neighbors.size() > 2) {
-            for (int nbr : neighbors) {
-                if (visited.count(nbr)) continue;
-
-                std::vector<int> trunk = {id};
-                int prev = id, curr = nbr;
-
-                while (neighborMap[curr].size() == 2 && !visited.count(curr)) {
-                    trunk.push_back(curr);
-                    visited.insert(curr);
-
-                    const auto& nexts = neighborMap[curr];
-                    curr = (nexts[0] == prev) ? nexts[1] : nexts[0];
-                    prev = trunk.back();
-                }
-
-                trunk.push_back(curr);
-                std::string key = canonicalKey(trunk);
-                if (seen.count(key)) continue;
-
-                seen.insert(key);
-
-                std::map<int, SWCNode> newNodeSet;
-                if (resetIndex) {
-                    int localId = 1;
-                    for (size_t i = 0; i < trunk.size(); ++i) {
-                        SWCNode n = nodeSet.at(trunk[i]);
-                        n.id = localId;
-                        n.pid = (i == 0) ? -1 : localId - 1;
-                        newNodeSet[n.id] = n;
-                        ++localId;
-                    }
-                } else {
-                    for (int nid : trunk) {
-                        newNodeSet[nid] = nodeSet.at(nid);
-                    }
-                }
-                trunkNodeSets[trunkId++] = std::move(newNodeSet);
-            }
-        }
-    }
+/**
+ * @brief Extracts trunk segments as spans of one node array
+ * @param nodeSet Map of SWC nodes where key is node ID and value is the SWCNode object
+ * @param resetIndex If true, renumbers node IDs sequentially within each trunk
+ * @return Trunks in the numbering of getTrunks(), each a span of nodes in path order,
+ *         together with the parent trunk of each (as getTrunkParentMap())
+ *
+ * The node set is indexed densely once; the traversal then works on row
+ * indices with bit-vector visit marks, and no per-trunk containers are built.
+ * As in getNeighborMap(), an edge is only followed if the parent is also
+ * stored in this graph.
+ */
+TrunkSpans NeuronGraph::getTrunkSpans(const std::map<int, SWCNode>& nodeSet, bool resetIndex) const {
+    NM_SCOPED_TIMER("getTrunks");
+    Morphology nodes = Morphology::fromNodes(nodeSet);
+    TopologyIndex index = TopologyIndex::build(nodes, &morph);
+    TrunkSpans spans = TrunkSpans::fromDecomposition(nodes, TrunkDecomposition::build(nodes, index), resetIndex);
+    NM_COUNT("trunks", spans.size());
+    return spans;
+}
+
+/**
+ * @brief Extracts the trunks of the graph's own nodes as spans
+ * @param resetIndex If true, renumbers node IDs sequentially within each trunk
+ * @return Spans copied from the cached trunk decomposition
+ */
+TrunkSpans NeuronGraph::getTrunkSpans(bool resetIndex) const {
+    NM_SCOPED_TIMER("getTrunks");
+    TrunkSpans spans = TrunkSpans::fromDecomposition(morph, *trunkDecomposition(), resetIndex);
+    NM_COUNT("trunks", spans.size());
+    return spans;
+}
 
+/**
+ * @brief Converts trunk spans into the map-of-maps form returned by getTrunks()
+ * @param spans Trunk spans
+ * @return Map from trunk id to the trunk's nodes keyed by node id
+ */
+std::map<int, std::map<int, SWCNode>> NeuronGraph::trunkSpansToMaps(const TrunkSpans& spans) {
+    std::map<int, std::map<int, SWCNode>> trunkNodeSets;
+    for (std::size_t t = 0; t < spans.size(); ++t) {
+        std::map<int, SWCNode> newNodeSet;
+        const SWCNode* first = spans.begin(t);
+        for (const SWCNode* n = first; n != first + spans.length(t); ++n) newNodeSet.emplace(n->id, *n);
+        trunkNodeSets.emplace_hint(trunkNodeSets.end(), static_cast<int>(t), std::move(newNodeSet));
+    }
     return trunkNodeSets;
 }
 
@@ -200,6 +221,81 @@ std::map<int, int> NeuronGraph::getTrunkParentMap(const std::map<int, SWCNode>&
     return trunkParentMap;
 }
 
+/**
+ * @brief Returns the cached adjacency index of the graph's own nodes
+ * @return Shared index for the current morphology revision
+ *
+ * The index is rebuilt only when the morphology changed since the last
+ * build (addNode(), setNodes(), reading a file, ...). Concurrent callers may
+ * build it twice, but always see a complete index.
+ */
+std::shared_ptr<const TopologyIndex> NeuronGraph::topology() const {
+    auto cached = std::atomic_load(&topologyCache);
+    if (cached && cached->revision == morph.revision()) return cached;
+
+    auto built = std::make_shared<const TopologyIndex>(TopologyIndex::build(morph));
+    std::atomic_store(&topologyCache, built);
+    return built;
+}
+
+/**
+ * @brief Returns the cached trunk decomposition of the graph's own nodes
+ * @return Shared decomposition for the current morphology revision
+ */
+std::shared_ptr<const TrunkDecomposition> NeuronGraph::trunkDecomposition() const {
+    auto cached = std::atomic_load(&trunkCache);
+    if (cached && cached->revision == morph.revision()) return cached;
+
+    auto built = std::make_shared<const TrunkDecomposition>(TrunkDecomposition::build(morph, *topology()));
+    std::atomic_store(&trunkCache, built);
+    return built;
+}
+
+/**
+ * @brief Returns the cached segment index of the graph's own nodes
+ * @return Shared index for the current morphology revision
+ *
+ * Built on all cores; the hierarchy does not depend on the thread count.
+ */
+std::shared_ptr<const SegmentIndex> NeuronGraph::segmentIndex() const {
+    auto cached = std::atomic_load(&segmentCache);
+    if (cached && cached->revision == morph.revision()) return cached;
+
+    auto built = std::make_shared<const SegmentIndex>(SegmentIndex::build(morph, 0));
+    std::atomic_store(&segmentCache, built);
+    return built;
+}
+
+/**
+ * @brief Morphometrics of the graph's own nodes
+ * @param options Sholl step and threads
+ * @return Result of computeMorphometrics() on the morphology
+ */
+Morphometrics NeuronGraph::morphometrics(const MorphometricsOptions& options) const {
+    return computeMorphometrics(morph, options);
+}
+
+/**
+ * @brief Extracts the trunks of the graph's own nodes
+ * @param resetIndex If true, renumbers node IDs sequentially within each trunk
+ * @return Same result as getTrunks(getNodes(), resetIndex), read from the cached decomposition
+ */
+std::map<int, std::map<int, SWCNode>> NeuronGraph::getTrunks(bool resetIndex) const {
+    return trunkSpansToMaps(getTrunkSpans(resetIndex));
+}
+
+/**
+ * @brief Parent trunk of every trunk of the graph's own nodes
+ * @return Same result as getTrunkParentMap(getNodes(), getTrunks()), without rebuilding the reverse lookup
+ */
+std::map<int, int> NeuronGraph::getTrunkParentMap() const {
+    auto trunks = trunkDecomposition();
+    std::map<int, int> trunkParentMap;
+    for (std::size_t t = 0; t < trunks->size(); ++t)
+        trunkParentMap.emplace_hint(trunkParentMap.end(), static_cast<int>(t), trunks->parentTrunk[t]);
+    return trunkParentMap;
+}
+
 /**
  * @brief Combines multiple trunk segments into a single neuron representation with sequential node IDs
  * @param trunkNodeSets Map of trunk segments where each key is a trunk ID and value is a map of node IDs to SWCNodes
@@ -226,6 +322,7 @@ std::map<int, int> NeuronGraph::getTrunkParentMap(const std::map<int, SWCNode>&
  *      for the version that handles parent-child relationships between trunks
  */
 std::map<int, SWCNode> NeuronGraph::assembleTrunks(const std::map<int, std::map<int, SWCNode>>& trunkNodeSets) const {
+    NM_SCOPED_TIMER("assembleTrunks");
     std::map<int, SWCNode> newNodes;
     std::map<int, int> remap;
     int newId = 1;
@@ -257,6 +354,7 @@ std::map<int, SWCNode> NeuronGraph::assembleTrunks(const std::map<int, std::map<
  * @brief Applies linear spline resampling to all trunk segments in a neuron morphology
  * @param trunks Map of trunk segments where each key is a trunk ID and value is a map of node IDs to SWCNodes
  * @param delta Target distance between consecutive nodes in the resampled trunks (in microns)
+ * @param threads Number of threads to resample with (0 = all cores, 1 = serial)
  * @return std::map<int, std::map<int, SWCNode>> Map of resampled trunks with the same structure as input
  * 
  * This method processes each trunk segment in the input map and applies linear spline resampling
@@ -275,24 +373,25 @@ std::map<int, SWCNode> NeuronGraph::assembleTrunks(const std::map<int, std::map<
  *
  * @note The actual spacing may vary slightly to ensure the start and end points are preserved exactly
  * @note This method is typically used as a preprocessing step before mesh generation
+ * @note Trunks are resampled independently, so the result is the same for any thread count
  * @see linearSplineResampleTrunk() for the single-trunk implementation
  * @see allCubicSplineResampledTrunks() for a smoother but more computationally intensive alternative
  */
-std::map<int, std::map<int, SWCNode>> NeuronGraph::allLinearSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta) const {
-    std::map<int, std::map<int, SWCNode>> resampledTrunks;
-    resampledTrunks.clear();
-
-    for(auto& [id,trunk] : trunks){
-            resampledTrunks[id] = linearSplineResampleTrunk(trunk, delta);
-    }
-
-    return resampledTrunks;
+std::map<int, std::map<int, SWCNode>> NeuronGraph::allLinearSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta,
+                                                                                   std::size_t threads) const {
+    NM_SCOPED_TIMER("linearResample");
+    auto resampled = resampleTrunks(trunks, threads, [this, &delta](const std::map<int, SWCNode>& trunk) {
+        return linearSplineResampleTrunk(trunk, delta);
+    });
+    NM_COUNT("trunks.resampled", resampled.size());
+    return resampled;
 }
 
 /**
  * @brief Applies cubic spline resampling to all trunk segments in a neuron morphology
  * @param trunks Map of trunk segments where each key is a trunk ID and value is a map of node IDs to SWCNodes
  * @param delta Target distance between consecutive nodes in the resampled trunks (in microns)
+ * @param threads Number of threads to resample with (0 = all cores, 1 = serial)
  * @return std::map<int, std::map<int, SWCNode>> Map of resampled trunks with the same structure as input
  * 
  * This method processes each trunk segment in the input map and applies cubic spline resampling
@@ -312,18 +411,21 @@ std::map<int, std::map<int, SWCNode>> NeuronGraph::allLinearSplineResampledTrunk
  *
  * @note This method produces smoother results than linear interpolation but is more computationally intensive
  * @note The actual spacing may vary slightly to ensure the curve is sampled properly
+ * @note Trunks are resampled independently, so the result is the same for any thread count
+ * @note The trunks are resampled as one flat batch (resampleTrunkBatchCubic()), which gives the
+ *       same nodes as cubicSplineResampleTrunk() on every trunk
  * @see cubicSplineResampleTrunk() for the single-trunk implementation
  * @see allLinearSplineResampledTrunks() for a faster but less smooth alternative
  */
-std::map<int, std::map<int, SWCNode>> NeuronGraph::allCubicSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta) const {
-    std::map<int, std::map<int, SWCNode>> resampledTrunks;
-    resampledTrunks.clear();
-
-    for(auto& [id,trunk] : trunks){
-            resampledTrunks[id] = cubicSplineResampleTrunk(trunk, delta);
-    }
-
-    return resampledTrunks;
+std::map<int, std::map<int, SWCNode>> NeuronGraph::allCubicSplineResampledTrunks(std::map<int, std::map<int, SWCNode>>& trunks, double& delta,
+                                                                                  std::size_t threads) const {
+    NM_SCOPED_TIMER("cubicResample");
+    TrunkBatch batch = resampleTrunkBatchCubic(TrunkBatch::fromTrunks(trunks), delta, threads);
+    std::map<int, std::map<int, SWCNode>> resampled;
+    std::size_t t = 0;
+    for (const auto& [tid, trunk] : trunks) resampled.emplace_hint(resampled.end(), tid, batch.trunk(t++));
+    NM_COUNT("trunks.resampled", resampled.size());
+    return resampled;
 }
 
 /**
@@ -358,69 +460,7 @@ std::map<int, std::map<int, SWCNode>> NeuronGraph::allCubicSplineResampledTrunks
  * @see cubicSplineResampleTrunk() for a smoother but more computationally intensive alternative
  */
 std::map<int, SWCNode> NeuronGraph::linearSplineResampleTrunk(const std::map<int, SWCNode>& trunk, double& delta) const {
-    std::map<int, SWCNode> newNodes;
-    std::vector<SWCNode> sampledNodes;
-    std::map<int, int> typeCount;
-
-    // Convert trunk map to ordered vector of nodes
-    for (const auto& [id, node] : trunk) {
-        sampledNodes.push_back(node);
-        typeCount[node.type]++;
-    }
-
-    if (sampledNodes.size() < 2) return newNodes;
-
-    // Determine the dominant type
-    int dominantType = sampledNodes[0].type;
-    int maxCount = 0;
-    for (const auto& [type, count] : typeCount) {
-        if (count > maxCount) {
-            dominantType = type;
-            maxCount = count;
-        }
-    }
-
-    // Compute total arc length
-    double totalLength = 0.0;
-    for (size_t i = 1; i < sampledNodes.size(); ++i) {
-        double dx = sampledNodes[i].x - sampledNodes[i - 1].x;
-        double dy = sampledNodes[i].y - sampledNodes[i - 1].y;
-        double dz = sampledNodes[i].z - sampledNodes[i - 1].z;
-        totalLength += std::sqrt(dx * dx + dy * dy + dz * dz);
-    }
-
-    int N =  static_cast<int>(std::round(totalLength / delta));
-    if (N <= 3) N = 4;
-
-    int newId = 1;
-    for (int j = 0; j < N; ++j) {
-        double t = static_cast<double>(j) / (N - 1);
-        size_t seg = static_cast<size_t>(t * (sampledNodes.size() - 1));
-        size_t next = std::min(seg + 1, sampledNodes.size() - 1);
-        double alpha = t * (sampledNodes.size() - 1) - seg;
-
-        SWCNode interp;
-
-        if (j == 0 || j == N - 1) {
-            interp = sampledNodes[j == 0 ? 0 : sampledNodes.size() - 1];
-            interp.id = newId;
-            interp.pid = (j == 0) ? -1 : newId - 1;
-        } else {
-            auto lerp = [](double a, double b, double alpha) {return (1 - alpha) * a + alpha * b;};
-
-            interp.id = newId;
-            interp.pid = newId - 1;
-            interp.type = dominantType;
-            interp.x = lerp(sampledNodes[seg].x, sampledNodes[next].x, alpha);
-            interp.y = lerp(sampledNodes[seg].y, sampledNodes[next].y, alpha);
-            interp.z = lerp(sampledNodes[seg].z, sampledNodes[next].z, alpha);
-            interp.radius = std::abs(lerp(sampledNodes[seg].radius, sampledNodes[next].radius, alpha));
-        }
-
-        newNodes[newId++] = interp;
-    }
-
-    return newNodes;
+    return sampleTrunkLinear(prepareTrunk(trunk, false), delta);
 }
 
 /**
@@ -435,7 +475,7 @@ std::map<int, SWCNode> NeuronGraph::linearSplineResampleTrunk(const std::map<int
  *
  * Key features:
  * - Preserves the first and last nodes of the original trunk exactly
- * - Fits natural cubic splines to x, y, and z coordinates separately
+ * - Fits one natural cubic spline through x, y, z and radius (shared factorization)
  * - Parameterizes the spline by arc length for uniform sampling
  * - Maintains the dominant node type throughout the resampled trunk
  * - Handles 3D coordinates and radii with appropriate interpolation
@@ -444,9 +484,10 @@ std::map<int, SWCNode> NeuronGraph::linearSplineResampleTrunk(const std::map<int
  * The algorithm works as follows:
  * 1. Converts the input trunk to an ordered vector of nodes
  * 2. Determines the dominant node type in the trunk
- * 3. Fits natural cubic splines to x, y, and z coordinates
+ * 3. Fits natural cubic splines to x, y, z and radius with a single tridiagonal factorization
  * 4. Parameterizes the spline by arc length
- * 5. Samples new points at approximately 'delta' intervals along the curve
+ * 5. Samples new points at approximately 'delta' intervals along the curve, locating
+ *    each sample's segment with a moving cursor (linear in nodes + samples)
  * 6. Ensures the first and last nodes match the original exactly
  *
  * @note This method produces smoother results than linear interpolation but is more computationally intensive
@@ -456,206 +497,160 @@ std::map<int, SWCNode> NeuronGraph::linearSplineResampleTrunk(const std::map<int
  * @see linearSplineResampleTrunk() for a faster but less smooth alternative
  */
 std::map<int, SWCNode> NeuronGraph::cubicSplineResampleTrunk(const std::map<int, SWCNode>& trunk, double& delta) const {
-    std::vector<SWCNode> sampledNodes;
-    std::map<int, SWCNode> newNodes;
-    std::map<int, int> typeCount;
-
-    // Convert trunk map to ordered vector of nodes
-    for (const auto& [id, node] : trunk) {
-        sampledNodes.push_back(node);
-        typeCount[node.type]++;
-    }
-
-    if (sampledNodes.size() < 2) return newNodes;
-
-    int dominantType = sampledNodes[0].type;
-    int maxCount = 0;
-    for (const auto& [type, count] : typeCount) {
-        if (count > maxCount) {
-            dominantType = type;
-            maxCount = count;
-        }
-    }
-
-    std::vector<double> arcLength = {0.0};
-    for (size_t i = 1; i < sampledNodes.size(); ++i) {
-        double dx = sampledNodes[i].x - sampledNodes[i - 1].x;
-        double dy = sampledNodes[i].y - sampledNodes[i - 1].y;
-        double dz = sampledNodes[i].z - sampledNodes[i - 1].z;
-        arcLength.push_back(arcLength.back() + std::sqrt(dx * dx + dy * dy + dz * dz));
-    }
-    double totalLength = arcLength.back();
-
-    int N =  static_cast<int>(std::round(totalLength / delta));
-    if (N <= 3) N = 4;
-
-    std::vector<double> ts(N);
-    for (int i = 0; i < N; ++i) ts[i] = i * totalLength / (N - 1);
-
-    auto cubicSpline = [](const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& ts) {
-        int n = x.size();
-        std::vector<double> h(n - 1), alpha(n - 1), l(n), mu(n), z(n);
-        std::vector<double> b(n - 1), c(n), d(n - 1);
-
-        for (int i = 0; i < n - 1; ++i)
-            h[i] = x[i + 1] - x[i];
-
-        for (int i = 1; i < n - 1; ++i)
-            alpha[i] = (3.0 / h[i]) * (y[i + 1] - y[i]) - (3.0 / h[i - 1]) * (y[i] - y[i - 1]);
-
-        l[0] = 1; mu[0] = z[0] = 0;
-        for (int i = 1; i < n - 1; ++i) {
-            l[i] = 2 * (x[i + 1] - x[i - 1]) - h[i - 1] * mu[i - 1];
-            mu[i] = h[i] / l[i];
-            z[i] = (alpha[i] - h[i - 1] * z[i - 1]) / l[i];
-        }
-        l[n - 1] = 1; z[n - 1] = c[n - 1] = 0;
-
-        for (int j = n - 2; j >= 0; --j) {
-            c[j] = z[j] - mu[j] * c[j + 1];
-            b[j] = (y[j + 1] - y[j]) / h[j] - h[j] * (c[j + 1] + 2 * c[j]) / 3.0;
-            d[j] = (c[j + 1] - c[j]) / (3.0 * h[j]);
-        }
-
-        std::vector<double> result;
-        for (double xq : ts) {
-            int i = 0;
-            while (i < n - 2 && xq > x[i + 1]) ++i;
-            double dx = xq - x[i];
-            result.push_back(y[i] + b[i] * dx + c[i] * dx * dx + d[i] * dx * dx * dx);
-        }
-        return result;
-    };
-
-    std::vector<double> xs, ys, zs, rs;
-    for (const auto& p : sampledNodes) {
-        xs.push_back(p.x);
-        ys.push_back(p.y);
-        zs.push_back(p.z);
-        rs.push_back(p.radius);
-    }
-
-    auto xNew = cubicSpline(arcLength, xs, ts);
-    auto yNew = cubicSpline(arcLength, ys, ts);
-    auto zNew = cubicSpline(arcLength, zs, ts);
-    auto rNew = cubicSpline(arcLength, rs, ts);
-
-    //double avgRadius = std::accumulate(rs.begin(), rs.end(), 0.0) / rs.size();
-    double minRadius = *std::min_element(rs.begin(), rs.end());
-    double clampRadius = 1.05 * minRadius;
-
-    int newId = 1;
-    for (int i = 0; i < N; ++i) {
-        SWCNode node;
-        if (i == 0 || i == N - 1) {
-            node = sampledNodes[i == 0 ? 0 : sampledNodes.size() - 1];
-            node.id = newId;
-            node.pid = (i == 0) ? -1 : newId - 1;
-        } else {
-            node.id = newId;
-            node.pid = newId - 1;
-            node.type = dominantType;
-            node.x = xNew[i];
-            node.y = yNew[i];
-            node.z = zNew[i];
-            node.radius = std::max(std::abs(rNew[i]), clampRadius);
-        }
-        newNodes[newId++] = node;
-    }
+    return sampleTrunkCubic(prepareTrunk(trunk, true), delta);
+}
 
-    return newNodes;
+/**
+ * @brief Resamples a single trunk along a cubic spline, placing samples where the shape needs them
+ * @param trunk Map of node IDs to SWCNode objects representing the trunk to be resampled
+ * @param tolerance Largest distance between the spline and the chord of two consecutive samples,
+ *                  also used as the largest radius error of linear interpolation between them
+ * @param maxSpacing Largest arc length between consecutive samples
+ * @return std::map<int, SWCNode> Resampled trunk with ids 1..N
+ *
+ * Uses the same spline fit as cubicSplineResampleTrunk() but bisects the trunk
+ * only where the curve bends or the radius changes, so straight dendrites of
+ * constant radius keep far fewer nodes at the same geometric error.
+ *
+ * @note The first and last nodes match the original exactly and at least 4 nodes are kept
+ * @see sampleTrunkAdaptive() for the sampling rule
+ */
+std::map<int, SWCNode> NeuronGraph::adaptiveSplineResampleTrunk(const std::map<int, SWCNode>& trunk, double tolerance,
+                                                                double maxSpacing) const {
+    return sampleTrunkAdaptive(prepareTrunk(trunk, true), tolerance, maxSpacing);
 }
 
+/**
+ * @brief Combines resampled trunks into one neuron, reconnecting them through their parent trunks
+ * @param resampledTrunks Map of trunk IDs to resampled trunks (ids 1..N, node 1 the root of the trunk)
+ * @param trunkParentMap Parent trunk of every trunk that does not contain the soma
+ * @return std::map<int, SWCNode> The assembled neuron with ids 1..M
+ *
+ * Serial form of assembleTrunksDense(); see there for the numbering.
+ */
 std::map<int, SWCNode> NeuronGraph::assembleTrunks(const std::map<int, std::map<int, SWCNode>>& resampledTrunks,
 									               const std::map<int,int>& trunkParentMap){
+    std::vector<SWCNode> dense = assembleTrunksDense(resampledTrunks, trunkParentMap, 1);
     std::map<int, SWCNode> finalNodes;
-    // a new variable that stores (trunkid,startid,endid) startid and end id are the globalId numbers
-    std::map<int,std::vector<int>> trunkEnds;
-    std::vector<int> doneTrunks;
-    SWCNode somaNode;                                    
-
-    // Find the trunks that have soma point, and make first node of finalNodes
-    for(auto& [trunkId, trunk] : resampledTrunks){
-        for(auto& [ _ , node] : trunk){
-            if(node.type == 1){
-                doneTrunks.push_back(trunkId);
-                somaNode = node;
-                break;
-            }
-        }
+    for (const auto& node : dense) finalNodes.emplace_hint(finalNodes.end(), node.id, node);
+    return finalNodes;
+}
+
+/**
+ * @brief Combines resampled trunks into one dense node array, in parallel over the trunks
+ * @param resampledTrunks Map of trunk IDs to resampled trunks (ids 1..N, node 1 the root of the trunk)
+ * @param trunkParentMap Parent trunk of every trunk that does not contain the soma
+ * @param threads Number of threads (0 = all cores, 1 = serial)
+ * @return std::vector<SWCNode> The assembled neuron; element i has id i + 1
+ *
+ * The soma node gets id 1. Every trunk then contributes its nodes except its
+ * first one, which coincides with the branch point it starts from: first the
+ * trunks that contain the soma, then the others, each group in trunk id
+ * order. The first node of a soma trunk hangs off the soma; the first node
+ * of any other trunk hangs off the end of its parent trunk that is closer.
+ *
+ * Each trunk's id range is known from an exclusive prefix sum over the trunk
+ * lengths, so the trunks are copied into the preallocated array independently
+ * and the links between trunks are patched in a second pass. The result does
+ * not depend on the thread count.
+ *
+ * @throws std::out_of_range if a trunk without soma has no entry in @p trunkParentMap
+ */
+std::vector<SWCNode> NeuronGraph::assembleTrunksDense(const std::map<int, std::map<int, SWCNode>>& resampledTrunks,
+                                                      const std::map<int,int>& trunkParentMap,
+                                                      std::size_t threads) const {
+    NM_SCOPED_TIMER("assembleTrunks");
+    const std::size_t T = resampledTrunks.size();
+
+    std::vector<const std::map<int, SWCNode>*> trunks;
+    std::vector<int> trunkIds;
+    trunks.reserve(T);
+    trunkIds.reserve(T);
+    for (const auto& [trunkId, trunk] : resampledTrunks) {
+        trunkIds.push_back(trunkId);
+        trunks.push_back(&trunk);
     }
 
-    // initialize soma node
-    somaNode.id = 1; somaNode.pid = -1;
-    // set the first node in final nodes
-    finalNodes[somaNode.id] = somaNode;
-
-    int globalId = 1;
-    //Now we iterate the doneTrunks and add all trunks that are connected to soma
-    for(auto& trunkId : doneTrunks){
-        trunkEnds[trunkId].push_back(1); // this captures the new id of the endpoint (startId)
-        for(auto& [_ , node]: resampledTrunks.at(trunkId) ){
-            if (node.pid != -1){
-                auto newNode = node;
-                newNode.id = globalId+1;
-                if(node.id == 2) newNode.pid = 1;
-                if(node.id>2) newNode.pid = globalId;
-
-                finalNodes[newNode.id]=newNode;
-                globalId = globalId + 1;
-            }
+    // pass 1: length of every trunk (nodes that have a parent) and its first soma node
+    std::vector<std::size_t> length(T, 0);
+    std::vector<const SWCNode*> soma(T, nullptr);
+    parallelFor(T, threads, [&](std::size_t t) {
+        for (const auto& [_, node] : *trunks[t]) {
+            if (node.pid != -1) ++length[t];
+            if (node.type == 1 && !soma[t]) soma[t] = &node;
         }
-        trunkEnds[trunkId].push_back(globalId); // this captures the new id of the endpoint (endId)
+    });
+
+    // soma trunks come first; exclusive prefix sum over the lengths gives each trunk's ids
+    std::vector<std::size_t> order;
+    order.reserve(T);
+    for (std::size_t t = 0; t < T; ++t) if (soma[t]) order.push_back(t);
+    const std::size_t somaTrunks = order.size();
+    for (std::size_t t = 0; t < T; ++t) if (!soma[t]) order.push_back(t);
+
+    std::vector<std::size_t> base(T);
+    std::size_t total = 1;
+    for (std::size_t t : order) {
+        base[t] = total;   // id of the node before the trunk's first one
+        total += length[t];
     }
 
-    for(auto& [trunkId, trunk]  : resampledTrunks){
-        
-        trunkEnds[trunkId].push_back(globalId); // this captures the new id of the endpoint (startId)
-        if (std::find(doneTrunks.begin(), doneTrunks.end(), trunkId) != doneTrunks.end()) {
-            continue;
+    // the trunk that continues each trunk, as an index; throws before any work is done
+    std::vector<std::size_t> parent(T, T);
+    for (std::size_t k = somaTrunks; k < T; ++k) {
+        std::size_t t = order[k];
+        int parentId = trunkParentMap.at(trunkIds[t]);
+        auto it = std::lower_bound(trunkIds.begin(), trunkIds.end(), parentId);
+        if (it == trunkIds.end() || *it != parentId) {
+            throw std::out_of_range("assembleTrunks: parent trunk " + std::to_string(parentId) + " is missing");
         }
-        else {
-            for(auto& [_ , node] : resampledTrunks.at(trunkId)) {
-                if (node.pid != -1){
-                    auto newNode = node;
-                    newNode.id = globalId+1;
-                
-                    if(node.id >2) newNode.pid = globalId;
-                    else newNode.pid = -1;
-                    finalNodes[newNode.id]=newNode;
-                    globalId = globalId + 1;
-                }
-            }
-        }
-        trunkEnds[trunkId].push_back(globalId); // this captures the new id of the endpoint (endId)
+        parent[t] = static_cast<std::size_t>(it - trunkIds.begin());
     }
 
+    std::vector<SWCNode> finalNodes(total);
+    SWCNode somaNode{};
+    if (somaTrunks > 0) somaNode = *soma[order[somaTrunks - 1]];
+    somaNode.id = 1;
+    somaNode.pid = -1;
+    finalNodes[0] = somaNode;
+
+    // pass 2: copy every trunk into its own id range
+    parallelFor(T, threads, [&](std::size_t t) {
+        const bool somaTrunk = soma[t] != nullptr;
+        int id = static_cast<int>(base[t]);
+        for (const auto& [_, node] : *trunks[t]) {
+            if (node.pid == -1) continue;
+            SWCNode newNode = node;
+            newNode.id = ++id;
+            if (node.id > 2) newNode.pid = id - 1;
+            else if (!somaTrunk) newNode.pid = -1;
+            else if (node.id == 2) newNode.pid = 1;
+            finalNodes[id - 1] = newNode;
+        }
+    });
+    NM_COUNT("assemble.nodes", total);
+
     // Lambda to compute Euclidean distance between nodes
     auto distance = [](const SWCNode& a, const SWCNode& b) -> double {
         double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
         return std::sqrt(dx * dx + dy * dy + dz * dz);
     };
 
-    // now go back and connect the branches correctly
-    for(auto& [trunkId, _] : resampledTrunks){
-        if (std::find(doneTrunks.begin(), doneTrunks.end(), trunkId) != doneTrunks.end()) {
-            continue;
-        }
-       
-        int parentTrunkId = trunkParentMap.at(trunkId);
-        int parentStartId = trunkEnds[parentTrunkId][0];
-        int parentEndId   = trunkEnds[parentTrunkId][1];
-        int childStartId  = trunkEnds[trunkId][0];
-
-        const SWCNode& parentStart = finalNodes[parentStartId];
-        const SWCNode& parentEnd   = finalNodes[parentEndId];
-        const SWCNode& childStart  = finalNodes[childStartId+1];
-
-        finalNodes[childStartId+1].pid = (distance(childStart, parentEnd) < distance(childStart, parentStart))
+    // pass 3: attach the first node of every other trunk to the closer end of its parent trunk;
+    // a soma trunk starts at the soma, any other trunk right after the previous trunk's last node
+    parallelFor(T - somaTrunks, threads, [&](std::size_t k) {
+        std::size_t t = order[somaTrunks + k];
+        if (length[t] == 0) return;
+        std::size_t p = parent[t];
+        int parentStartId = soma[p] ? 1 : static_cast<int>(base[p]);
+        int parentEndId = static_cast<int>(base[p] + length[p]);
+
+        SWCNode& childStart = finalNodes[base[t]];
+        childStart.pid = (distance(childStart, finalNodes[parentEndId - 1]) <
+                          distance(childStart, finalNodes[parentStartId - 1]))
             ? parentEndId
             : parentStartId;
-
-    }
+    });
 
     return finalNodes;
 }
@@ -665,7 +660,8 @@ std::map<int, SWCNode> NeuronGraph::assembleTrunks(const std::map<int, std::map<
  * @param nodeSet Map of SWC nodes representing the input neuron morphology
  * @param delta Initial target spacing between nodes (in microns). This value is halved in each refinement level.
  * @param N Number of refinement levels to generate
- * @param method Interpolation method to use ("linear" or "cubic")
+ * @param method Interpolation method to use ("linear", "cubic" or "adaptive")
+ * @param threads Number of threads used to resample the trunks of each level (0 = all cores, 1 = serial)
  * @return std::map<int, std::map<int, SWCNode>> Map where each key is the refinement level (0 to N-1)
  *         and the value is the resampled neuron at that refinement level
  * 
@@ -674,17 +670,19 @@ std::map<int, SWCNode> NeuronGraph::assembleTrunks(const std::map<int, std::map<
  * representation of the neuron that can be used for progressive rendering or adaptive meshing.
  *
  * Key features:
- * - Supports both linear and cubic spline interpolation methods
+ * - Supports linear and cubic spline interpolation, and "adaptive" cubic sampling
+ *   whose tolerance (adaptiveToleranceRatio x delta) halves with each level
  * - Progressively refines the mesh by halving 'delta' at each level
  * - Maintains topological relationships between nodes
  * - Preserves branch points and overall neuron structure
  * - Returns all refinement levels for comparison or progressive loading
  *
  * The refinement process works as follows:
- * 1. Extracts trunk segments from the input neuron
+ * 1. Extracts trunk segments from the input neuron (once, in a RefinementHierarchy)
  * 2. Determines parent-child relationships between trunks
- * 3. For each refinement level i (0 to N-1):
- *    a. Resamples all trunks using the specified method with spacing delta/(2^i)
+ * 3. Caches per-trunk arc lengths and spline coefficients
+ * 4. For each refinement level i (0 to N-1):
+ *    a. Resamples all cached trunks using the specified method with spacing delta/(2^i)
  *    b. Reassembles the neuron from the resampled trunks
  *    c. Stores the result in the output map
  *
@@ -693,25 +691,18 @@ std::map<int, SWCNode> NeuronGraph::assembleTrunks(const std::map<int, std::map<
  * @note The first refinement level (i=0) uses the initial delta value
  * @see allLinearSplineResampledTrunks() for the linear interpolation implementation
  * @see allCubicSplineResampledTrunks() for the cubic spline implementation
+ * @see adaptiveSplineResampleTrunk() for the adaptive sampling
+ * @see writeRefinements() to stream the levels to disk instead of keeping them all
  */
 std::map<int, std::map<int,SWCNode>> NeuronGraph::generateRefinements(const std::map<int,SWCNode>& nodeSet, 
-                                                                     double& delta, int& N, std::string& method){
-    bool resetIndex = false;
-    auto trunks = getTrunks(nodeSet,resetIndex);
-    auto trunkParentMap = getTrunkParentMap(nodeSet,trunks);
+                                                                     double& delta, int& N, std::string& method,
+                                                                     std::size_t threads){
+    NM_SCOPED_TIMER("generateRefinements");
+    RefinementHierarchy hierarchy(*this, nodeSet, method, threads);
     std::map<int,std::map<int,SWCNode>> refinements;
-    std::map<int,std::map<int, SWCNode>> resampledTrunks;
 
     for(int i=0; i < N; ++i){
-        if (method == "cubic"){
-            resampledTrunks = allCubicSplineResampledTrunks(trunks,delta);
-        } else if (method == "linear") {
-            resampledTrunks = allLinearSplineResampledTrunks(trunks,delta);
-        } else {
-            resampledTrunks = allLinearSplineResampledTrunks(trunks,delta);
-        }
-        auto newNodes = assembleTrunks(resampledTrunks,trunkParentMap);
-        refinements[i]=newNodes;
+        refinements[i] = hierarchy.level(delta);
         delta = delta/2;
     }
 
@@ -26,10 +26,150 @@
 #include <array>
 #include "neurongraph.h"
 #include <numeric>
+#include <deque>
+#include <optional>
 #include <tinyxml2.h>
 
 using namespace tinyxml2;
 
+namespace {
+
+/**
+ * @brief Element text of a UGX neuron file, as located by either UGX backend
+ *
+ * Each view refers to the text of the corresponding element (the tinyxml2
+ * document or the memory-mapped file owns the bytes). An empty optional
+ * means the element is missing or has no text, i.e. GetText() returned null.
+ */
+struct UgxNeuronText {
+    /** @brief A <subset> of the <subset_handler> */
+    struct Subset {
+        std::optional<std::string_view> name;
+        bool hasVertices = false;
+        std::optional<std::string_view> vertices;
+    };
+
+    bool hasVertices = false;
+    std::optional<std::string_view> vertices;
+    std::optional<std::string_view> diameter;
+    std::optional<std::string_view> edges;
+    std::vector<Subset> subsets;
+};
+
+/** @brief Wraps a possibly null C string from tinyxml2 */
+std::optional<std::string_view> optionalText(const char* text) {
+    if (!text) return std::nullopt;
+    return std::string_view(text);
+}
+
+/**
+ * @brief Maps a UGX subset name to an SWC type code
+ */
+int ugxSubsetType(std::string_view name) {
+    if      (name == "soma")  return 1;
+    else if (name == "axon")  return 2;
+    else if (name == "dend")  return 3;
+    else if (name == "apic")  return 4;
+    else if (name == "fork")  return 5;
+    else if (name == "end")   return 6;
+    return 7; // unknown but labeled
+}
+
+/**
+ * @brief Converts located UGX element text into flat morphology storage
+ * @param text Element text found by the DOM or streaming reader
+ * @param morph Morphology to fill (expected to be empty)
+ * @return false if the file has no vertex data
+ *
+ * Numbers are parsed in place with UgxTextScanner, which follows the same
+ * rules as the stream extraction used by earlier versions of this reader.
+ */
+bool buildMorphologyFromUGX(const UgxNeuronText& text, Morphology& morph) {
+    // --- 1. Extract coordinates ---
+    if (!text.hasVertices || !text.vertices) {
+        std::cerr << "[UGX Warning] No vertex data found.\n";
+        return false;
+    }
+
+    std::vector<std::array<double, 3>> positions;
+    UgxTextScanner coordScanner(*text.vertices);
+    double x, y, z;
+    while (coordScanner.next(x) && coordScanner.next(y) && coordScanner.next(z)) {
+        positions.push_back({x, y, z});
+    }
+    int numVertices = static_cast<int>(positions.size());
+    NM_LOG(Debug) << "[UGX] Parsed " << numVertices << " vertices.\n";
+
+    // --- 2. Extract diameters ---
+    std::vector<double> diameters(numVertices, 1.0);  // fallback default
+    if (text.diameter) {
+        UgxTextScanner dScanner(*text.diameter);
+        for (int i = 0; i < numVertices && !dScanner.done(); ++i) {
+            if (!dScanner.next(diameters[i])) {
+                diameters[i] = 0.0;  // a malformed token reads as zero
+                break;
+            }
+        }
+        NM_LOG(Debug) << "[UGX] Parsed diameter values.\n";
+    }
+
+    // --- 3. Extract edges ---
+    std::vector<std::pair<int, int>> edgeList;
+    if (text.edges) {
+        UgxTextScanner edgeScanner(*text.edges);
+        int from, to;
+        while (edgeScanner.next(from) && edgeScanner.next(to)) {
+            edgeList.emplace_back(from, to);
+        }
+        NM_LOG(Debug) << "[UGX] Parsed " << edgeList.size() << " edges.\n";
+    } else {
+        NM_LOG(Debug) << "[UGX] No edge list found.\n";
+    }
+
+    // --- 4. Extract subset types ---
+    std::vector<int> types(numVertices, 0);  // default type 0 (undefined)
+    for (const auto& subset : text.subsets) {
+        int typeCode = subset.name ? ugxSubsetType(*subset.name) : 0;
+        if (!subset.vertices) continue;
+
+        UgxTextScanner vs(*subset.vertices);
+        int vi;
+        while (vs.next(vi)) {
+            if (vi >= 0 && vi < numVertices)
+                types[vi] = typeCode;
+            else
+                std::cerr << "[UGX Warning] Invalid vertex index in subset: " << vi << "\n";
+        }
+    }
+
+    // --- 5. Create SWCNodes (vertex i becomes row i with id i+1) ---
+    morph.reserve(numVertices);
+    for (int i = 0; i < numVertices; ++i) {
+        SWCNode node;
+        node.id     = i + 1;
+        node.type   = types[i];
+        node.x      = positions[i][0];
+        node.y      = positions[i][1];
+        node.z      = positions[i][2];
+        node.radius = diameters[i];
+        node.pid    = -1;
+        morph.setNode(node);
+    }
+
+    // --- 6. Build edges + set parents ---
+    for (const auto& [from, to] : edgeList) {
+        if (from >= 0 && from < numVertices && to >= 0 && to < numVertices) {
+            morph.pid[to] = from + 1;
+        } else {
+            std::cerr << "[UGX Warning] Invalid edge (" << from << " → " << to << ")\n";
+        }
+    }
+    morph.buildTopology();
+    return true;
+}
+
+} // namespace
+
 /**
  * @brief Writes neuron morphology data to a UGX file format
  * @param nodeSet Map of SWC nodes to be written, where key is node ID and value is SWCNode object
@@ -60,6 +200,12 @@ using namespace tinyxml2;
  */
 void NeuronGraph::writeToFileUGX(const std::map<int, SWCNode>& nodeSet,
                                const std::string& filename) {
+    NM_SCOPED_TIMER("writeUGX");
+    if (useUgxStreaming(filename)) {
+        writeToFileUGXStream(nodeSet, filename);
+        return;
+    }
+
     std::vector<std::array<double, 3>> positions;
     std::vector<double> diameters;
     std::vector<std::pair<int, int>> edges;
@@ -210,7 +356,153 @@ void NeuronGraph::writeToFileUGX(const std::map<int, SWCNode>& nodeSet,
     if (doc.SaveFile(filename.c_str()) != XML_SUCCESS) {
         std::cerr << "Failed to write UGX file: " << filename << std::endl;
     } else {
-        std::cout << "WriteUGX ..." << filename << std::endl;
+        NM_COUNT("nodes.written", nodeSet.size());
+        NM_LOG(Info) << "WriteUGX ..." << filename << std::endl;
+    }
+}
+
+/**
+ * @brief Writes neuron morphology data to a UGX file with the streaming writer
+ * @param nodeSet Map of SWC nodes to be written, where key is node ID and value is SWCNode object
+ * @param filename Path to the output UGX file
+ *
+ * Produces exactly the bytes writeToFileUGX() writes through tinyxml2, but
+ * without building a document or intermediate strings. Vertex and edge
+ * subsets are bucketed by type in a single pass instead of rescanning the
+ * edge list once per subset.
+ *
+ * @see writeToFileUGX() for the DOM based writer
+ * @see setUgxBackend() to make writeToFileUGX() use this writer
+ */
+void NeuronGraph::writeToFileUGXStream(const std::map<int, SWCNode>& nodeSet,
+                                       const std::string& filename) {
+    NM_SCOPED_TIMER("writeUGXStream");
+    std::vector<int> ids;
+    ids.reserve(nodeSet.size());
+    for (const auto& [id, node] : nodeSet) ids.push_back(id);
+
+    // Edges as (parent index, child index), plus vertex/edge indices per type
+    std::vector<std::pair<int, int>> edges;
+    std::map<int, std::vector<int>> vertexSubsets;
+    std::map<int, std::vector<int>> edgeSubsets;
+
+    int index = 0;
+    for (const auto& [id, node] : nodeSet) {
+        vertexSubsets[node.type].push_back(index);
+        auto parent = std::lower_bound(ids.begin(), ids.end(), node.pid);
+        if (node.pid != -1 && parent != ids.end() && *parent == node.pid) {
+            edgeSubsets[node.type].push_back(static_cast<int>(edges.size()));
+            edges.emplace_back(static_cast<int>(parent - ids.begin()), index);
+        }
+        ++index;
+    }
+
+    UgxStreamWriter w;
+    if (!w.open(filename)) {
+        std::cerr << "Failed to write UGX file: " << filename << std::endl;
+        return;
+    }
+
+    w.declaration(R"(xml version="1.0" encoding="utf-8")");
+    w.openElement("grid");
+    w.attribute("name", "defGrid");
+
+    // <vertices coords="3">x y z ...</vertices>
+    w.openElement("vertices");
+    w.attribute("coords", "3");
+    w.beginText();
+    for (const auto& [id, node] : nodeSet) {
+        w.number(node.x);
+        w.number(node.y);
+        w.number(node.z);
+    }
+    w.closeElement();
+
+    // <edges>i j i j ...</edges>
+    w.openElement("edges");
+    w.beginText();
+    for (const auto& [p, c] : edges) {
+        w.number(p);
+        w.number(c);
+    }
+    w.closeElement();
+
+    // <vertex_attachment name="diameter">
+    w.openElement("vertex_attachment");
+    w.attribute("name", "diameter");
+    w.attribute("type", "double");
+    w.attribute("passOn", "0");
+    w.attribute("global", "1");
+    w.beginText();
+    for (const auto& [id, node] : nodeSet) w.number(node.radius);
+    w.closeElement();
+
+    // <subset_handler>
+    w.openElement("subset_handler");
+    w.attribute("name", "defSH");
+
+    if (vertexSubsets.empty()) {
+        w.openElement("subset");
+        w.attribute("name", "neurite");
+        w.attribute("color", "0.5 0.5 0.5");
+        w.attribute("state", "0");
+        w.openElement("vertices");
+        w.beginText();
+        w.closeElement();
+        w.openElement("edges");
+        w.beginText();
+        w.closeElement();
+        w.closeElement();
+    } else {
+        for (const auto& [type, vertices] : vertexSubsets) {
+            const char* name = "neurite";
+            if (type == 1) name = "soma";
+            else if (type == 2) name = "axon";
+            else if (type == 3) name = "dend";
+            else if (type == 4) name = "apic";
+            else if (type == 5) name = "fork";
+            else if (type == 6) name = "end";
+
+            w.openElement("subset");
+            w.attribute("name", name);
+            w.attribute("color", "0.7 0.7 0.2");
+            w.attribute("state", "0");
+
+            w.openElement("vertices");
+            w.beginText();
+            for (int v : vertices) w.number(v);
+            w.closeElement();
+
+            w.openElement("edges");
+            w.beginText();
+            auto it = edgeSubsets.find(type);
+            if (it != edgeSubsets.end()) {
+                for (int e : it->second) w.number(e);
+            }
+            w.closeElement();
+
+            w.closeElement();
+        }
+    }
+    w.closeElement();
+
+    // <projection_handler>
+    w.openElement("projection_handler");
+    w.attribute("name", "defPH");
+    w.attribute("subset_handler", "0");
+    w.openElement("default");
+    w.attribute("type", "default");
+    w.text("0 0");
+    w.closeElement();
+    w.closeElement();
+
+    w.closeElement();  // </grid>
+
+    if (!w.close()) {
+        std::cerr << "Failed to write UGX file: " << filename << std::endl;
+    } else {
+        NM_COUNT("nodes.written", nodeSet.size());
+        NM_LOG(Info) << "WriteUGX ..." << filename << std::endl;
     }
 }
 
@@ -243,8 +535,13 @@ void NeuronGraph::writeToFileUGX(const std::map<int, SWCNode>& nodeSet,
  */
 void NeuronGraph::readFromFileUGX(const std::string& filename)
 {
-    nodes.clear();
-    edges.clear();
+    NM_SCOPED_TIMER("readUGX");
+    if (useUgxStreaming(filename)) {
+        readFromFileUGXStream(filename);
+        return;
+    }
+
+    morph.clear();
 
     XMLDocument doc;
     if (doc.LoadFile(filename.c_str()) != XML_SUCCESS) {
@@ -258,111 +555,156 @@ void NeuronGraph::readFromFileUGX(const std::string& filename)
         return;
     }
 
-    // --- 1. Extract coordinates ---
-    std::vector<std::array<double, 3>> positions;
-    XMLElement* vertsElem = root->FirstChildElement("vertices");
-    if (!vertsElem || !vertsElem->GetText()) {
-        std::cerr << "[UGX Warning] No vertex data found.\n";
-        return;
-    }
-
-    std::istringstream coordStream(vertsElem->GetText());
-    double x, y, z;
-    while (coordStream >> x >> y >> z) {
-        positions.push_back({x, y, z});
+    UgxNeuronText text;
+    if (XMLElement* vertsElem = root->FirstChildElement("vertices")) {
+        text.hasVertices = true;
+        text.vertices = optionalText(vertsElem->GetText());
     }
-    int numVertices = static_cast<int>(positions.size());
-    std::cout << "[UGX] Parsed " << numVertices << " vertices.\n";
-
-    // --- 2. Extract diameters ---
-    std::vector<double> diameters(numVertices, 1.0);  // fallback default
     for (XMLElement* va = root->FirstChildElement("vertex_attachment"); va; va = va->NextSiblingElement("vertex_attachment")) {
         const char* name = va->Attribute("name");
         if (name && std::string(name) == "diameter") {
-            const char* dText = va->GetText();
-            if (dText) {
-                std::istringstream dStream(dText);
-                for (int i = 0; i < numVertices && dStream; ++i)
-                    dStream >> diameters[i];
-                std::cout << "[UGX] Parsed diameter values.\n";
-            }
+            text.diameter = optionalText(va->GetText());
             break;
         }
     }
-
-    // --- 3. Extract edges ---
-    std::vector<std::pair<int, int>> edgeList;
-    XMLElement* edgesElem = root->FirstChildElement("edges");
-    if (edgesElem && edgesElem->GetText()) {
-        std::istringstream edgeStream(edgesElem->GetText());
-        int from, to;
-        while (edgeStream >> from >> to) {
-            edgeList.emplace_back(from, to);
-        }
-        std::cout << "[UGX] Parsed " << edgeList.size() << " edges.\n";
-    } else {
-        std::cout << "[UGX] No edge list found.\n";
+    if (XMLElement* edgesElem = root->FirstChildElement("edges")) {
+        text.edges = optionalText(edgesElem->GetText());
     }
-
-    // --- 4. Extract subset types ---
-    std::vector<int> types(numVertices, 0);  // default type 0 (undefined)
-    XMLElement* subsetHandler = root->FirstChildElement("subset_handler");
-    if (subsetHandler) {
+    if (XMLElement* subsetHandler = root->FirstChildElement("subset_handler")) {
         for (XMLElement* subset = subsetHandler->FirstChildElement("subset"); subset; subset = subset->NextSiblingElement("subset")) {
-            const char* name = subset->Attribute("name");
-            int typeCode = 0;
-            if (name) {
-                std::string sname(name);
-                if      (sname == "soma")  typeCode = 1;
-                else if (sname == "axon")  typeCode = 2;
-                else if (sname == "dend")  typeCode = 3;
-                else if (sname == "apic")  typeCode = 4;
-                else if (sname == "fork")  typeCode = 5;
-                else if (sname == "end")   typeCode = 6;
-                else                       typeCode = 7; // unknown but labeled
+            UgxNeuronText::Subset entry;
+            entry.name = optionalText(subset->Attribute("name"));
+            if (XMLElement* vElem = subset->FirstChildElement("vertices")) {
+                entry.hasVertices = true;
+                entry.vertices = optionalText(vElem->GetText());
             }
+            text.subsets.push_back(entry);
+        }
+    }
 
-            XMLElement* vElem = subset->FirstChildElement("vertices");
-            if (vElem && vElem->GetText()) {
-                std::istringstream vs(vElem->GetText());
-                int vi;
-                while (vs >> vi) {
-                    if (vi >= 0 && vi < numVertices)
-                        types[vi] = typeCode;
-                    else
-                        std::cerr << "[UGX Warning] Invalid vertex index in subset: " << vi << "\n";
+    if (!buildMorphologyFromUGX(text, morph)) return;
+
+    NM_COUNT("nodes.read", morph.size());
+    NM_LOG(Info) << "Read UGX ... " << filename << " with "
+              << morph.size() << " nodes and "
+              << numberOfEdges() << " parent entries.\n";
+}
+
+/**
+ * @brief Reads neuron morphology data from a UGX file without building a DOM
+ * @param filename Path to the input UGX file to read
+ *
+ * The file is memory-mapped and walked once with UgxPullParser. Only the
+ * elements readFromFileUGX() looks at are recorded, as views into the
+ * mapping, and are then parsed by the same code as the DOM path, so both
+ * backends produce identical graphs and console output.
+ *
+ * @see readFromFileUGX() for the DOM based reader
+ * @see setUgxBackend() to make readFromFileUGX() use this reader
+ */
+void NeuronGraph::readFromFileUGXStream(const std::string& filename)
+{
+    NM_SCOPED_TIMER("readUGXStream");
+    morph.clear();
+
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cerr << "[UGX Error] Failed to load: " << filename << std::endl;
+        return;
+    }
+
+    // Which part of the UGX structure each open element corresponds to
+    enum class Role { Other, Grid, Vertices, Diameter, Edges, SubsetHandler, Subset, SubsetVertices };
+
+    UgxNeuronText text;
+    std::deque<std::string> ownedText;   // decoded text that does not live in the mapping
+    std::vector<Role> roles;
+    std::optional<std::string_view>* textTarget = nullptr;
+    bool gridFound = false, diameterFound = false, edgesFound = false, subsetHandlerFound = false;
+
+    UgxPullParser parser(file.view());
+    for (auto ev = parser.next(); ev != UgxPullParser::Event::End; ev = parser.next()) {
+        if (ev == UgxPullParser::Event::Error) {
+            std::cerr << "[UGX Error] Failed to load: " << filename << std::endl;
+            return;
+        }
+
+        // Element text is only taken from the first child, like XMLElement::GetText()
+        std::optional<std::string_view>* target = textTarget;
+        textTarget = nullptr;
+
+        if (ev == UgxPullParser::Event::Text) {
+            if (target) {
+                std::string_view t = parser.text();
+                if (t.data() < file.data() || t.data() >= file.data() + file.size()) {
+                    ownedText.emplace_back(t);
+                    t = ownedText.back();
                 }
+                *target = t;
             }
+            continue;
         }
-    }
 
-    // --- 5. Create SWCNodes ---
-    for (int i = 0; i < numVertices; ++i) {
-        SWCNode node;
-        node.id     = i + 1;
-        node.type   = types[i];
-        node.x      = positions[i][0];
-        node.y      = positions[i][1];
-        node.z      = positions[i][2];
-        node.radius = diameters[i];
-        node.pid    = -1;
-        nodes[node.id] = node;
-    }
+        if (ev == UgxPullParser::Event::EndElement) {
+            roles.pop_back();
+            continue;
+        }
 
-    // --- 6. Build edges + set parents ---
-    for (const auto& [from, to] : edgeList) {
-        int parentId = from + 1;
-        int childId  = to + 1;
+        const std::string_view name = parser.name();
+        const Role parent = roles.empty() ? Role::Other : roles.back();
+        Role role = Role::Other;
 
-        if (nodes.count(childId) && nodes.count(parentId)) {
-            nodes[childId].pid = parentId;
-            edges[parentId].push_back(childId);
-        } else {
-            std::cerr << "[UGX Warning] Invalid edge (" << from << " → " << to << ")\n";
+        if (roles.empty()) {
+            if (name == "grid" && !gridFound) {
+                gridFound = true;
+                role = Role::Grid;
+            }
+        } else if (parent == Role::Grid) {
+            std::string_view attr;
+            if (name == "vertices" && !text.hasVertices) {
+                text.hasVertices = true;
+                role = Role::Vertices;
+                textTarget = &text.vertices;
+            } else if (name == "vertex_attachment" && !diameterFound &&
+                       parser.attribute("name", attr) && attr == "diameter") {
+                diameterFound = true;
+                role = Role::Diameter;
+                textTarget = &text.diameter;
+            } else if (name == "edges" && !edgesFound) {
+                edgesFound = true;
+                role = Role::Edges;
+                textTarget = &text.edges;
+            } else if (name == "subset_handler" && !subsetHandlerFound) {
+                subsetHandlerFound = true;
+                role = Role::SubsetHandler;
+            }
+        } else if (parent == Role::SubsetHandler && name == "subset") {
+            UgxNeuronText::Subset entry;
+            std::string_view attr;
+            if (parser.attribute("name", attr)) {
+                ownedText.emplace_back(attr);
+                entry.name = std::string_view(ownedText.back());
+            }
+            text.subsets.push_back(entry);
+            role = Role::Subset;
+        } else if (parent == Role::Subset && name == "vertices" && !text.subsets.back().hasVertices) {
+            text.subsets.back().hasVertices = true;
+            role = Role::SubsetVertices;
+            textTarget = &text.subsets.back().vertices;
         }
+
+        roles.push_back(role);
     }
 
-    std::cout << "Read UGX ... " << filename << " with "
-              << nodes.size() << " nodes and "
-              << edges.size() << " parent entries.\n";
-}
\ No newline at end of file
+    if (!gridFound) {
+        std::cerr << "[UGX Error] Missing <grid> root element.\n";
+        return;
+    }
+
+    if (!buildMorphologyFromUGX(text, morph)) return;
+
+    NM_COUNT("nodes.read", morph.size());
+    NM_LOG(Info) << "Read UGX ... " << filename << " with "
+              << morph.size() << " nodes and "
+              << numberOfEdges() << " parent entries.\n";
+}
@@ -0,0 +1,328 @@
+/**
+ * @file refinement.cpp
+ * @brief Implementation of trunk preparation, sampling and the refinement hierarchy
+ *
+ * The sampling functions are the bodies of NeuronGraph::linearSplineResampleTrunk()
+ * and NeuronGraph::cubicSplineResampleTrunk(), split so that the part that
+ * does not depend on the spacing is computed only once per trunk.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include <array>
+#include <atomic>
+#include <cmath>
+
+#include "neurongraph.h"
+#include "refinement.h"
+#include "threadpool.h"
+
+PreparedTrunk prepareTrunk(const std::map<int, SWCNode>& trunk, bool cubic) {
+    // Convert trunk map to ordered vector of nodes
+    std::vector<SWCNode> nodes;
+    nodes.reserve(trunk.size());
+    for (const auto& [id, node] : trunk) nodes.push_back(node);
+    return prepareTrunk(std::move(nodes), cubic);
+}
+
+PreparedTrunk prepareTrunk(std::vector<SWCNode> nodes, bool cubic) {
+    PreparedTrunk p;
+    std::map<int, int> typeCount;
+
+    p.nodes = std::move(nodes);
+    for (const auto& node : p.nodes) typeCount[node.type]++;
+
+    if (p.nodes.size() < 2) {
+        p.nodes.clear();
+        return p;
+    }
+
+    // Determine the dominant type
+    p.dominantType = p.nodes[0].type;
+    int maxCount = 0;
+    for (const auto& [type, count] : typeCount) {
+        if (count > maxCount) {
+            p.dominantType = type;
+            maxCount = count;
+        }
+    }
+
+    // Cumulative arc length
+    p.arcLength.reserve(p.nodes.size());
+    p.arcLength.push_back(0.0);
+    for (size_t i = 1; i < p.nodes.size(); ++i) {
+        double dx = p.nodes[i].x - p.nodes[i - 1].x;
+        double dy = p.nodes[i].y - p.nodes[i - 1].y;
+        double dz = p.nodes[i].z - p.nodes[i - 1].z;
+        p.arcLength.push_back(p.arcLength.back() + std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    if (cubic) {
+        // Fit x, y, z and radius together against arc length
+        std::vector<double> xyzr;
+        xyzr.reserve(4 * p.nodes.size());
+        double minRadius = p.nodes[0].radius;
+        for (const auto& n : p.nodes) {
+            xyzr.insert(xyzr.end(), {n.x, n.y, n.z, n.radius});
+            minRadius = std::min(minRadius, n.radius);
+        }
+        p.spline.fit(p.arcLength, xyzr.data());
+        p.clampRadius = 1.05 * minRadius;
+        p.cubic = true;
+    }
+    return p;
+}
+
+std::map<int, SWCNode> sampleTrunkLinear(const PreparedTrunk& trunk, double delta) {
+    std::map<int, SWCNode> newNodes;
+    const std::vector<SWCNode>& sampledNodes = trunk.nodes;
+    if (sampledNodes.size() < 2) return newNodes;
+
+    int N =  static_cast<int>(std::round(trunk.arcLength.back() / delta));
+    if (N <= 3) N = 4;
+
+    int newId = 1;
+    for (int j = 0; j < N; ++j) {
+        double t = static_cast<double>(j) / (N - 1);
+        size_t seg = static_cast<size_t>(t * (sampledNodes.size() - 1));
+        size_t next = std::min(seg + 1, sampledNodes.size() - 1);
+        double alpha = t * (sampledNodes.size() - 1) - seg;
+
+        SWCNode interp;
+
+        if (j == 0 || j == N - 1) {
+            interp = sampledNodes[j == 0 ? 0 : sampledNodes.size() - 1];
+            interp.id = newId;
+            interp.pid = (j == 0) ? -1 : newId - 1;
+        } else {
+            auto lerp = [](double a, double b, double alpha) {return (1 - alpha) * a + alpha * b;};
+
+            interp.id = newId;
+            interp.pid = newId - 1;
+            interp.type = trunk.dominantType;
+            interp.x = lerp(sampledNodes[seg].x, sampledNodes[next].x, alpha);
+            interp.y = lerp(sampledNodes[seg].y, sampledNodes[next].y, alpha);
+            interp.z = lerp(sampledNodes[seg].z, sampledNodes[next].z, alpha);
+            interp.radius = std::abs(lerp(sampledNodes[seg].radius, sampledNodes[next].radius, alpha));
+        }
+
+        newNodes.emplace_hint(newNodes.end(), newId++, interp);
+    }
+
+    return newNodes;
+}
+
+std::map<int, SWCNode> sampleTrunkCubic(const PreparedTrunk& trunk, double delta) {
+    std::map<int, SWCNode> newNodes;
+    const std::vector<SWCNode>& sampledNodes = trunk.nodes;
+    if (sampledNodes.size() < 2 || !trunk.cubic) return newNodes;
+
+    double totalLength = trunk.arcLength.back();
+    int N =  static_cast<int>(std::round(totalLength / delta));
+    if (N <= 3) N = 4;
+
+    std::vector<double> ts(N);
+    for (int i = 0; i < N; ++i) ts[i] = i * totalLength / (N - 1);
+
+    // Sweep the sorted samples along the cached spline
+    std::vector<double> samples(4 * ts.size());
+    trunk.spline.evaluate(ts, samples.data());
+
+    int newId = 1;
+    for (int i = 0; i < N; ++i) {
+        SWCNode node;
+        if (i == 0 || i == N - 1) {
+            node = sampledNodes[i == 0 ? 0 : sampledNodes.size() - 1];
+            node.id = newId;
+            node.pid = (i == 0) ? -1 : newId - 1;
+        } else {
+            node.id = newId;
+            node.pid = newId - 1;
+            node.type = trunk.dominantType;
+            node.x = samples[4 * i];
+            node.y = samples[4 * i + 1];
+            node.z = samples[4 * i + 2];
+            node.radius = std::max(std::abs(samples[4 * i + 3]), trunk.clampRadius);
+        }
+        newNodes.emplace_hint(newNodes.end(), newId++, node);
+    }
+
+    return newNodes;
+}
+
+std::map<int, SWCNode> sampleTrunkAdaptive(const PreparedTrunk& trunk, double tolerance, double maxSpacing) {
+    std::map<int, SWCNode> newNodes;
+    const std::vector<SWCNode>& sampledNodes = trunk.nodes;
+    if (sampledNodes.size() < 2 || !trunk.cubic) return newNodes;
+
+    const double totalLength = trunk.arcLength.back();
+    const double minSpacing = std::max(tolerance, 1e-9 * totalLength);
+    constexpr int maxDepth = 30;
+
+    // Arc length of every sample; a piece [a, b] is split while the spline leaves
+    // the chord (or the radius leaves its linear interpolation) by more than tolerance
+    std::vector<double> ts{0.0};
+    std::size_t cursor = 0;
+    auto at = [&](double t) {
+        std::array<double, 4> v;
+        trunk.spline.evaluate(t, v.data(), cursor);
+        return v;
+    };
+    auto deviates = [&](double a, double b, const std::array<double, 4>& pa, const std::array<double, 4>& pb) {
+        for (double f : {0.25, 0.5, 0.75}) {
+            std::array<double, 4> p = at(a + f * (b - a));
+            double d2 = 0.0;
+            for (int k = 0; k < 3; ++k) {
+                double e = p[k] - ((1 - f) * pa[k] + f * pb[k]);
+                d2 += e * e;
+            }
+            if (d2 > tolerance * tolerance || std::abs(p[3] - ((1 - f) * pa[3] + f * pb[3])) > tolerance) return true;
+        }
+        return false;
+    };
+    std::function<void(double, double, const std::array<double, 4>&, const std::array<double, 4>&, int)> refine =
+        [&](double a, double b, const std::array<double, 4>& pa, const std::array<double, 4>& pb, int depth) {
+            if (depth < maxDepth && b - a > 2 * minSpacing && deviates(a, b, pa, pb)) {
+                double m = 0.5 * (a + b);
+                std::array<double, 4> pm = at(m);
+                refine(a, m, pa, pm, depth + 1);
+                refine(m, b, pm, pb, depth + 1);
+                return;
+            }
+            ts.push_back(b);
+        };
+
+    int pieces = std::max(1, static_cast<int>(std::ceil(totalLength / maxSpacing)));
+    std::array<double, 4> prev = at(0.0);
+    for (int k = 1; k <= pieces; ++k) {
+        double a = ts.back(), b = totalLength * k / pieces;
+        std::array<double, 4> next = at(b);
+        refine(a, b, prev, next, 0);
+        prev = next;
+    }
+
+    // keep at least 4 nodes like the uniform sampling: split the longest pieces
+    while (ts.size() < 4) {
+        std::size_t longest = 1;
+        for (std::size_t i = 2; i < ts.size(); ++i)
+            if (ts[i] - ts[i - 1] > ts[longest] - ts[longest - 1]) longest = i;
+        ts.insert(ts.begin() + longest, 0.5 * (ts[longest - 1] + ts[longest]));
+    }
+
+    std::vector<double> samples(4 * ts.size());
+    trunk.spline.evaluate(ts, samples.data());
+
+    const int N = static_cast<int>(ts.size());
+    int newId = 1;
+    for (int i = 0; i < N; ++i) {
+        SWCNode node;
+        if (i == 0 || i == N - 1) {
+            node = sampledNodes[i == 0 ? 0 : sampledNodes.size() - 1];
+            node.id = newId;
+            node.pid = (i == 0) ? -1 : newId - 1;
+        } else {
+            node.id = newId;
+            node.pid = newId - 1;
+            node.type = trunk.dominantType;
+            node.x = samples[4 * i];
+            node.y = samples[4 * i + 1];
+            node.z = samples[4 * i + 2];
+            node.radius = std::max(std::abs(samples[4 * i + 3]), trunk.clampRadius);
+        }
+        newNodes.emplace_hint(newNodes.end(), newId++, node);
+    }
+
+    return newNodes;
+}
+
+RefinementHierarchy::RefinementHierarchy(const NeuronGraph& graph, const std::map<int, SWCNode>& nodeSet,
+                                         const std::string& method, std::size_t threads)
+    : sampling(method == "cubic" ? Sampling::Cubic : method == "adaptive" ? Sampling::Adaptive : Sampling::Linear),
+      threads(threads) {
+    bool resetIndex = false;
+    TrunkSpans spans = graph.getTrunkSpans(nodeSet, resetIndex);
+
+    trunkIds.resize(spans.size());
+    for (std::size_t t = 0; t < spans.size(); ++t) {
+        trunkIds[t] = static_cast<int>(t);
+        trunkParentMap.emplace_hint(trunkParentMap.end(), static_cast<int>(t), spans.parentTrunk[t]);
+    }
+
+    trunks.resize(spans.size());
+    parallelFor(spans.size(), threads, [&](std::size_t t) {
+        // trunks are resampled in id order, as the map form of getTrunks() lists them
+        std::vector<SWCNode> nodes(spans.begin(t), spans.begin(t) + spans.length(t));
+        std::sort(nodes.begin(), nodes.end(), [](const SWCNode& a, const SWCNode& b) { return a.id < b.id; });
+        nodes.erase(std::unique(nodes.begin(), nodes.end(), [](const SWCNode& a, const SWCNode& b) { return a.id == b.id; }),
+                    nodes.end());
+        trunks[t] = prepareTrunk(std::move(nodes), sampling != Sampling::Linear);
+    });
+}
+
+std::map<int, SWCNode> RefinementHierarchy::level(double delta) const {
+    return *level(delta, [] { return false; });
+}
+
+std::optional<std::map<int, SWCNode>> RefinementHierarchy::level(double delta, const CancelCheck& cancelled) const {
+    std::vector<std::map<int, SWCNode>> sampled(trunks.size());
+    std::atomic<bool> abandoned{false};
+    parallelFor(trunks.size(), threads, [&](std::size_t i) {
+        // the remaining trunks are skipped once the level is abandoned
+        if (abandoned.load(std::memory_order_relaxed)) return;
+        if (cancelled()) {
+            abandoned = true;
+            return;
+        }
+        switch (sampling) {
+            case Sampling::Cubic: sampled[i] = sampleTrunkCubic(trunks[i], delta); break;
+            case Sampling::Adaptive:
+                sampled[i] = sampleTrunkAdaptive(trunks[i], adaptiveToleranceRatio * delta, adaptiveSpacingRatio * delta);
+                break;
+            default: sampled[i] = sampleTrunkLinear(trunks[i], delta); break;
+        }
+    });
+    if (abandoned || cancelled()) return std::nullopt;
+
+    std::map<int, std::map<int, SWCNode>> resampledTrunks;
+    for (std::size_t i = 0; i < trunks.size(); ++i) {
+        resampledTrunks.emplace_hint(resampledTrunks.end(), trunkIds[i], std::move(sampled[i]));
+    }
+
+    NeuronGraph tools;
+    std::map<int, SWCNode> nodes;
+    for (auto& node : tools.assembleTrunksDense(resampledTrunks, trunkParentMap, threads)) {
+        nodes.emplace_hint(nodes.end(), node.id, node);
+    }
+    return nodes;
+}
+
+void RefinementHierarchy::generate(double delta, int N, const LevelCallback& onLevel) const {
+    for (int i = 0; i < N; ++i) {
+        onLevel(i, level(delta));
+        delta = delta / 2;
+    }
+}
+
+/**
+ * @brief Generates refinement levels and writes each one as soon as it is produced
+ * @param nodeSet Map of SWC nodes representing the input neuron morphology
+ * @param delta Spacing of level 0; halved at each level
+ * @param N Number of refinement levels
+ * @param method Interpolation method ("linear", "cubic" or "adaptive")
+ * @param outputFolder Folder receiving refinement_<i>.swc and refinement_<i>.ugx
+ * @param threads Number of threads used to resample trunks
+ *
+ * @see generateRefinements() for the in-memory variant
+ */
+void NeuronGraph::writeRefinements(const std::map<int,SWCNode>& nodeSet, double delta, int N,
+                                   const std::string& method, const std::string& outputFolder,
+                                   std::size_t threads) {
+    RefinementHierarchy hierarchy(*this, nodeSet, method, threads);
+    hierarchy.generate(delta, N, [&](int i, const std::map<int, SWCNode>& nodes) {
+        writeToFile(nodes, outputFolder + "/refinement_" + std::to_string(i) + ".swc");
+        writeToFileUGX(nodes, outputFolder + "/refinement_" + std::to_string(i) + ".ugx");
+    });
+}
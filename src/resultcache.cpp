@@ -0,0 +1,355 @@
+/**
+ * @file resultcache.cpp
+ * @brief Implementation of the content-addressed result cache
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "resultcache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "instrumentation.h"
+#include "mappedfile.h"
+#include "utils.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::uint64_t mix64(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Unique suffix of the pending and evicted folders of this process and thread
+std::string uniqueTag() {
+    static const std::uint64_t processSeed = (std::uint64_t(std::random_device{}()) << 32) ^ std::random_device{}();
+    static std::atomic<std::uint64_t> counter{0};
+    std::ostringstream oss;
+    oss << std::hex << mix64(processSeed + counter.fetch_add(1));
+    return oss.str();
+}
+
+std::uint64_t folderSize(const fs::path& folder) {
+    std::uint64_t bytes = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(folder, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code sizeError;
+        if (it->is_regular_file(sizeError)) {
+            auto size = it->file_size(sizeError);
+            if (!sizeError) bytes += size;
+        }
+    }
+    return bytes;
+}
+
+// Bytes of a published entry: the size recorded at commit, or a walk of an entry without one
+std::uint64_t entrySize(const fs::path& entry) {
+    std::ifstream recorded(entry / "size.txt");
+    std::uint64_t bytes = 0;
+    if (recorded >> bytes) return bytes;
+    return folderSize(entry);
+}
+
+// Renames an entry away, then deletes it; readers never see a half-deleted entry
+void removeEntry(const fs::path& entry, const std::string& root) {
+    std::error_code ec;
+    fs::path evicted = fs::path(root) / (".evicted-" + entry.filename().string() + "-" + uniqueTag());
+    fs::rename(entry, evicted, ec);
+    if (!ec) fs::remove_all(evicted, ec);
+}
+
+} // namespace
+
+ResultCache::PendingEntry::PendingEntry(PendingEntry&& other) noexcept
+    : cache(other.cache), entryKey(std::move(other.entryKey)), pendingFolder(std::move(other.pendingFolder)) {
+    other.pendingFolder.clear();
+}
+
+ResultCache::PendingEntry::~PendingEntry() {
+    if (pendingFolder.empty()) return;
+    std::error_code ec;
+    fs::remove_all(pendingFolder, ec);
+}
+
+bool ResultCache::PendingEntry::commit() {
+    if (pendingFolder.empty()) return false;
+    {
+        // measured once here, so trim() reads one number per entry instead of walking it
+        std::ofstream recorded(fs::path(pendingFolder) / "size.txt");
+        recorded << folderSize(pendingFolder) << '\n';
+    }
+    std::error_code ec;
+    fs::path entry = fs::path(cache->root) / entryKey;
+    fs::rename(pendingFolder, entry, ec);
+    if (ec) {
+        // another process published the same key first
+        fs::remove_all(pendingFolder, ec);
+        pendingFolder.clear();
+        return fs::is_directory(entry, ec);
+    }
+    pendingFolder.clear();
+    NM_COUNT("cache.stores", 1);
+    cache->trim();
+    return true;
+}
+
+ResultCache::ResultCache(std::string folder, std::uint64_t maxBytes) : root(std::move(folder)), maxBytes(maxBytes) {
+    if (root.empty()) return;
+    std::error_code ec;
+    fs::create_directories(root, ec);
+    if (ec) {
+        std::cerr << "[ResultCache] Cannot use " << root << ": " << ec.message() << "; caching disabled" << std::endl;
+        root.clear();
+    }
+}
+
+ResultCache ResultCache::fromEnvironment() {
+    std::string folder = getExecutableDir() + "/../output/cache";
+    std::uint64_t bytes = kDefaultResultCacheBytes;
+    if (const char* env = std::getenv("NEURONMESHER_CACHE_DIR")) {
+        folder = std::strcmp(env, "off") == 0 ? "" : env;
+    }
+    if (const char* env = std::getenv("NEURONMESHER_CACHE_MB")) {
+        char* end = nullptr;
+        unsigned long long mb = std::strtoull(env, &end, 10);
+        if (end != env) bytes = std::uint64_t(mb) << 20;
+    }
+    return ResultCache(folder, bytes);
+}
+
+// Two independent 64-bit lanes: FNV-1a over the bytes and a mixed chain over 8-byte words
+std::string ResultCache::hashBytes(const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t fnv = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        fnv ^= bytes[i];
+        fnv *= 0x100000001b3ull;
+    }
+    std::uint64_t chain = 0x9e3779b97f4a7c15ull ^ size;
+    for (std::size_t i = 0; i < size; i += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes + i, std::min<std::size_t>(8, size - i));
+        chain = mix64(chain ^ word) + 0x9e3779b97f4a7c15ull;
+    }
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0') << std::setw(16) << fnv << std::setw(16) << mix64(chain);
+    return oss.str();
+}
+
+std::string ResultCache::hashFile(const std::string& filename) {
+    MappedFile file(filename);
+    if (!file.isOpen()) return "";
+    return hashBytes(file.data(), file.size());
+}
+
+std::string ResultCache::key(const std::string& contentHash, const std::string& operation,
+                             std::initializer_list<double> numbers, const std::string& options) {
+    if (contentHash.empty()) return "";
+    std::ostringstream oss;
+    oss << "v" << kResultCacheVersion << '\n' << contentHash << '\n' << operation << '\n' << std::setprecision(17);
+    for (double n : numbers) oss << n << ' ';
+    oss << '\n' << options;
+    const std::string text = oss.str();
+    return hashBytes(text.data(), text.size());
+}
+
+std::string ResultCache::levelPath(const std::string& entryFolder, int level) {
+    return entryFolder + "/level_" + std::to_string(level) + ".bin";
+}
+
+bool ResultCache::writeLevelCount(const std::string& entryFolder, int levels) {
+    std::ofstream out(entryFolder + "/levels.txt");
+    out << levels << '\n';
+    return static_cast<bool>(out.flush());
+}
+
+std::optional<std::string> ResultCache::find(const std::string& key) const {
+    if (!enabled() || key.empty()) return std::nullopt;
+    std::error_code ec;
+    fs::path entry = fs::path(root) / key;
+    if (!fs::is_directory(entry, ec)) {
+        NM_COUNT("cache.misses", 1);
+        return std::nullopt;
+    }
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);   // least recently used order
+    NM_COUNT("cache.hits", 1);
+    return entry.string();
+}
+
+ResultCache::PendingEntry ResultCache::prepare(const std::string& key) const {
+    if (!enabled() || key.empty()) return PendingEntry(this, key, "");
+    std::string pending = root + "/.pending-" + key + "-" + uniqueTag();
+    std::error_code ec;
+    fs::create_directories(pending, ec);
+    return PendingEntry(this, key, ec ? "" : pending);
+}
+
+bool ResultCache::loadLevels(const std::string& key, std::map<int, std::map<int, SWCNode>>& levels) const {
+    NM_SCOPED_TIMER("ResultCache::loadLevels");
+    auto entry = find(key);
+    if (!entry) return false;
+
+    int count = 0;
+    {
+        std::ifstream manifest(*entry + "/levels.txt");
+        if (!(manifest >> count) || count <= 0) {
+            // evicted since find(), or written without a level count: never a hit
+            std::error_code ec;
+            if (fs::is_directory(*entry, ec)) removeEntry(*entry, root);
+            NM_COUNT("cache.shortReads", 1);
+            return false;
+        }
+    }
+
+    std::map<int, std::map<int, SWCNode>> loaded;
+    std::error_code ec;
+    for (int level = 0; level < count; ++level) {
+        if (!fs::exists(levelPath(*entry, level), ec)) break;
+        NeuronGraph graph;
+        graph.readFromFileBIN(levelPath(*entry, level));
+        if (graph.numberOfNodes() == 0) break;
+        loaded[level] = graph.getNodes();
+    }
+    if (static_cast<int>(loaded.size()) != count) {
+        // evicted or damaged while reading: a truncated set is a miss
+        NM_COUNT("cache.shortReads", 1);
+        return false;
+    }
+    levels = std::move(loaded);
+    return true;
+}
+
+void ResultCache::storeLevels(const std::string& key, const std::map<int, std::map<int, SWCNode>>& levels) const {
+    NM_SCOPED_TIMER("ResultCache::storeLevels");
+    if (levels.empty()) return;
+    PendingEntry entry = prepare(key);
+    if (entry.folder().empty()) return;
+    NeuronGraph writer;
+    int level = 0;
+    for (const auto& [_, nodes] : levels) writer.writeToFileBIN(nodes, levelPath(entry.folder(), level++));
+    if (writeLevelCount(entry.folder(), level)) entry.commit();
+}
+
+bool ResultCache::loadGeometry(const std::string& key, DenseUgxGeometry& geometry) const {
+    NM_SCOPED_TIMER("ResultCache::loadGeometry");
+    auto entry = find(key);
+    if (!entry) return false;
+
+    std::size_t points = 0, edges = 0, faces = 0;
+    {
+        std::ifstream manifest(*entry + "/geometry.txt");
+        if (!(manifest >> points >> edges >> faces)) {
+            // evicted since find(), or written without element counts: never a hit
+            std::error_code ec;
+            if (fs::is_directory(*entry, ec)) removeEntry(*entry, root);
+            NM_COUNT("cache.shortReads", 1);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    if (!fs::exists(*entry + "/geometry.bin", ec)) {
+        NM_COUNT("cache.shortReads", 1);
+        return false;
+    }
+    UgxObject object;
+    object.readBIN(*entry + "/geometry.bin");
+    DenseUgxGeometry loaded = object.getDenseGeometry();
+    if (loaded.points.size() != points || loaded.edges.size() != edges || loaded.faces.size() != faces) {
+        // evicted or damaged while reading; an empty mesh with matching counts is a hit
+        NM_COUNT("cache.shortReads", 1);
+        return false;
+    }
+    geometry = std::move(loaded);
+    return true;
+}
+
+void ResultCache::storeGeometry(const std::string& key, const DenseUgxGeometry& geometry) const {
+    NM_SCOPED_TIMER("ResultCache::storeGeometry");
+    PendingEntry entry = prepare(key);
+    if (entry.folder().empty()) return;
+    UgxObject(geometry.toGeometry()).writeBIN(entry.folder() + "/geometry.bin");
+    std::error_code ec;
+    if (!fs::exists(entry.folder() + "/geometry.bin", ec)) return;
+    bool written = false;
+    {
+        std::ofstream manifest(entry.folder() + "/geometry.txt");
+        manifest << geometry.points.size() << ' ' << geometry.edges.size() << ' ' << geometry.faces.size() << '\n';
+        written = static_cast<bool>(manifest.flush());
+    }
+    if (written) entry.commit();
+}
+
+std::uint64_t ResultCache::size() const {
+    if (!enabled()) return 0;
+    std::uint64_t bytes = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().filename().string().front() != '.') bytes += entrySize(it->path());
+    }
+    return bytes;
+}
+
+void ResultCache::trim() const {
+    if (!enabled()) return;
+    NM_SCOPED_TIMER("ResultCache::trim");
+    struct Entry {
+        fs::path path;
+        fs::file_time_type used;
+        std::uint64_t bytes;
+    };
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+    const auto staleBefore = fs::file_time_type::clock::now() - std::chrono::hours(1);
+
+    std::error_code ec;
+    for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code timeError;
+        auto used = fs::last_write_time(it->path(), timeError);
+        if (timeError) continue;
+        if (it->path().filename().string().front() == '.') {
+            // leftovers of processes that stopped while writing or evicting
+            if (used < staleBefore) fs::remove_all(it->path(), timeError);
+            continue;
+        }
+        entries.push_back({it->path(), used, entrySize(it->path())});
+        total += entries.back().bytes;
+    }
+    if (total <= maxBytes) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& e : entries) {
+        if (total <= maxBytes) break;
+        removeEntry(e.path, root);
+        total -= e.bytes;
+        NM_COUNT("cache.evictions", 1);
+    }
+}
+
+void ResultCache::clear() const {
+    if (!enabled()) return;
+    std::error_code ec;
+    std::vector<fs::path> entries;
+    for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) entries.push_back(it->path());
+    for (const auto& entry : entries) {
+        if (entry.filename().string().front() == '.') continue;
+        removeEntry(entry, root);
+    }
+}
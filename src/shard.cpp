@@ -0,0 +1,404 @@
+/**
+ * @file shard.cpp
+ * @brief Implementation of the distributed batch mode
+ *
+ * Every rank computes the same shard assignment from the same input list,
+ * so no input list is ever sent between ranks. With MPI the ranks agree on
+ * the finished inputs through a barrier after reading the checkpoint, and
+ * only the remaining inputs are sharded. Without MPI there is no barrier; a
+ * rank that starts late would see inputs the others finished meanwhile, so
+ * the whole list is sharded and finished inputs are skipped within a shard.
+ * For the same reason rank 0 polls for the other ranks' statistics files,
+ * which carry the run id so files left by earlier runs are not reported.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "shard.h"
+#include "bincache.h"
+#include "compression.h"
+#include "instrumentation.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <queue>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifdef NEURONMESHER_WITH_MPI
+#include <mpi.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// first variable pair the launcher set, e.g. SLURM_PROCID/SLURM_NTASKS
+bool rankFromEnvironment(int& rank, int& size) {
+    static const char* const variables[][2] = {
+        {"NEURONMESHER_RANK", "NEURONMESHER_RANKS"},
+        {"SLURM_PROCID", "SLURM_NTASKS"},
+        {"OMPI_COMM_WORLD_RANK", "OMPI_COMM_WORLD_SIZE"},
+        {"PMI_RANK", "PMI_SIZE"},
+    };
+    for (const auto& pair : variables) {
+        const char* r = std::getenv(pair[0]);
+        const char* s = std::getenv(pair[1]);
+        if (!r || !s) continue;
+        int parsedRank = std::atoi(r);
+        int parsedSize = std::atoi(s);
+        if (parsedSize < 1 || parsedRank < 0 || parsedRank >= parsedSize) continue;
+        rank = parsedRank;
+        size = parsedSize;
+        return true;
+    }
+    return false;
+}
+
+// first job id the launcher set; SLURM steps of one job are told apart by the step id
+std::string runIdFromEnvironment() {
+    if (const char* id = std::getenv("NEURONMESHER_RUN_ID")) return id;
+    if (const char* job = std::getenv("SLURM_JOB_ID")) {
+        const char* step = std::getenv("SLURM_STEP_ID");
+        return step ? std::string(job) + "." + step : std::string(job);
+    }
+    if (const char* job = std::getenv("PBS_JOBID")) return job;
+    return "";
+}
+
+std::string rankFile(const std::string& folder, const char* prefix, int rank) {
+    return (fs::path(folder) / (std::string(prefix) + std::to_string(rank) + ".txt")).string();
+}
+
+// statistics of rank r, if its file belongs to the given run
+bool readRankStats(const std::string& folder, int r, const std::string& runId, ShardStats& s) {
+    std::ifstream in(rankFile(folder, "stats_rank", r));
+    std::string run;
+    return in >> run && run == runId && in >> s.rank >> s.assigned >> s.succeeded >> s.failed >> s.skipped >> s.nodes >> s.seconds;
+}
+
+} // namespace
+
+ShardSession::ShardSession(int& argc, char**& argv) {
+#ifdef NEURONMESHER_WITH_MPI
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (!initialized) {
+        int provided = 0;
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+        ownsMpi = true;
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    mpi = true;
+#else
+    (void)argc;
+    (void)argv;
+    rankFromEnvironment(myRank, ranks);
+    run = runIdFromEnvironment();
+#endif
+}
+
+ShardSession::ShardSession(int rank, int size, std::string runId)
+    : myRank(rank), ranks(size < 1 ? 1 : size), run(std::move(runId)) {}
+
+ShardSession::~ShardSession() {
+#ifdef NEURONMESHER_WITH_MPI
+    if (ownsMpi) MPI_Finalize();
+#endif
+}
+
+void ShardSession::barrier() const {
+#ifdef NEURONMESHER_WITH_MPI
+    if (mpi) MPI_Barrier(MPI_COMM_WORLD);
+#endif
+}
+
+void ShardSession::sumAll(std::vector<std::uint64_t>& values) const {
+#ifdef NEURONMESHER_WITH_MPI
+    if (mpi && !values.empty()) {
+        MPI_Allreduce(MPI_IN_PLACE, values.data(), static_cast<int>(values.size()), MPI_UINT64_T, MPI_SUM,
+                      MPI_COMM_WORLD);
+    }
+#else
+    (void)values;
+#endif
+}
+
+std::uint64_t estimateNodeCount(const std::string& filename) {
+    fs::path path(filename);
+    if (compressionFromFilename(filename) != Compression::None) path = path.stem();
+    std::string extension = path.extension().string();
+
+    if (extension == ".bin") {
+        BinaryCacheFile file;
+        if (file.open(filename) && file.hasSection(BinarySection::NodeId)) {
+            return file.section<std::int32_t>(BinarySection::NodeId).size;
+        }
+        return 0;
+    }
+
+    if (extension == ".swc") {
+        MappedFile file(filename);
+        if (!file.isOpen()) return 0;
+        std::string_view text = file.view();
+        std::uint64_t lines = 0;
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            std::size_t end = text.find('\n', pos);
+            if (end == std::string_view::npos) end = text.size();
+            std::size_t first = text.find_first_not_of(" \t\r", pos);
+            if (first < end && text[first] != '#') ++lines;
+            pos = end + 1;
+        }
+        return lines;
+    }
+
+    // UGX and anything else: a vertex with its radius and edge takes roughly this much text
+    std::error_code ec;
+    std::uintmax_t bytes = fs::file_size(filename, ec);
+    return ec ? 0 : bytes / 40;
+}
+
+std::vector<int> assignShards(const std::vector<std::uint64_t>& costs, int shards) {
+    std::vector<int> owner(costs.size(), 0);
+    if (shards <= 1) return owner;
+
+    std::vector<std::size_t> order(costs.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return costs[a] > costs[b]; });
+
+    // min-heap of (load, shard): the least loaded shard, lower index on ties
+    using Load = std::pair<std::uint64_t, int>;
+    std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+    for (int s = 0; s < shards; ++s) loads.push({0, s});
+
+    for (std::size_t i : order) {
+        Load least = loads.top();
+        loads.pop();
+        owner[i] = least.second;
+        // an input without a cost estimate still counts, so empty files are spread too
+        least.first += std::max<std::uint64_t>(costs[i], 1);
+        loads.push(least);
+    }
+    return owner;
+}
+
+BatchCheckpoint::BatchCheckpoint(const std::string& folder, int rank) {
+    std::error_code ec;
+    fs::create_directories(folder, ec);
+    file = rankFile(folder, "done_rank", rank);
+
+    for (const auto& entry : fs::directory_iterator(folder, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("done_rank", 0) != 0 || entry.path().extension() != ".txt") continue;
+
+        std::ifstream in(entry.path());
+        std::string line;
+        // a line is only complete once its newline was written
+        while (std::getline(in, line)) {
+            if (in.eof()) break;
+            if (!line.empty()) finished.insert(line);
+        }
+    }
+    loaded = finished.size();
+}
+
+bool BatchCheckpoint::done(const std::string& input) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return finished.count(input) != 0;
+}
+
+void BatchCheckpoint::markDone(const std::string& input) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!finished.insert(input).second) return;
+    std::ofstream out(file, std::ios::app);
+    out << input << '\n';
+    out.flush();
+    if (!out) std::cerr << "Failed to record " << input << " in " << file << std::endl;
+}
+
+std::vector<BatchResult> runShardedBatch(const std::vector<std::string>& inputs, const BatchJob& job,
+                                         const ShardSession& session, const std::string& stateFolder,
+                                         const BatchOptions& options, ShardStats& stats) {
+    NM_SCOPED_TIMER("shard.batch");
+    auto start = std::chrono::steady_clock::now();
+
+    stats = ShardStats{};
+    stats.rank = session.rank();
+
+    BatchCheckpoint checkpoint(stateFolder, session.rank());
+    session.barrier();   // every rank has read the checkpoint before anyone adds to it
+
+    // with MPI the ranks agree on what is left; without, shard everything (see the file comment)
+    std::vector<std::string> candidates;
+    if (session.usesMpi()) {
+        for (const auto& input : inputs) {
+            if (!checkpoint.done(input)) candidates.push_back(input);
+        }
+        if (session.rank() == 0) stats.skipped = inputs.size() - candidates.size();
+    } else {
+        candidates = inputs;
+    }
+
+    // MPI ranks estimate a strided slice each and add the slices up
+    std::vector<std::uint64_t> costs(candidates.size(), 0);
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (!session.usesMpi() || static_cast<int>(i % session.size()) == session.rank()) {
+            costs[i] = estimateNodeCount(candidates[i]);
+        }
+    }
+    session.sumAll(costs);
+
+    std::vector<int> owner = assignShards(costs, session.size());
+    std::vector<std::string> mine;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (owner[i] != session.rank()) continue;
+        ++stats.assigned;
+        if (checkpoint.done(candidates[i])) {
+            ++stats.skipped;
+            continue;
+        }
+        stats.nodes += costs[i];
+        mine.push_back(candidates[i]);
+    }
+    NM_COUNT("shard.inputs", mine.size());
+
+    auto checkpointed = [&](const std::string& input) {
+        job(input);
+        checkpoint.markDone(input);
+    };
+    std::vector<BatchResult> results = runBatch(mine, checkpointed, options);
+
+    for (const auto& r : results) {
+        if (r.ok) ++stats.succeeded;
+        else ++stats.failed;
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return results;
+}
+
+std::vector<ShardStats> gatherShardStats(const ShardStats& local, const ShardSession& session,
+                                         const std::string& stateFolder, double waitSeconds) {
+    {
+        // written under a temporary name, so rank 0 never reads half a file
+        const std::string file = rankFile(stateFolder, "stats_rank", session.rank());
+        {
+            std::ofstream out(file + ".tmp");
+            out << (session.runId().empty() ? "-" : session.runId()) << ' ' << local.rank << ' ' << local.assigned
+                << ' ' << local.succeeded << ' ' << local.failed << ' ' << local.skipped << ' ' << local.nodes << ' '
+                << std::setprecision(17) << local.seconds << '\n';
+        }
+        std::error_code ec;
+        fs::rename(file + ".tmp", file, ec);
+    }
+
+    std::vector<ShardStats> all;
+
+#ifdef NEURONMESHER_WITH_MPI
+    if (session.usesMpi()) {
+        const double packed[7] = {double(local.rank), double(local.assigned), double(local.succeeded),
+                                  double(local.failed), double(local.skipped), double(local.nodes),
+                                  local.seconds};
+        std::vector<double> received(session.rank() == 0 ? 7 * session.size() : 0);
+        MPI_Gather(packed, 7, MPI_DOUBLE, received.data(), 7, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        if (session.rank() != 0) return all;
+        for (int r = 0; r < session.size(); ++r) {
+            const double* p = received.data() + 7 * r;
+            ShardStats s;
+            s.rank = static_cast<int>(p[0]);
+            s.assigned = static_cast<std::uint64_t>(p[1]);
+            s.succeeded = static_cast<std::uint64_t>(p[2]);
+            s.failed = static_cast<std::uint64_t>(p[3]);
+            s.skipped = static_cast<std::uint64_t>(p[4]);
+            s.nodes = static_cast<std::uint64_t>(p[5]);
+            s.seconds = p[6];
+            all.push_back(s);
+        }
+        return all;
+    }
+#endif
+
+    if (session.rank() != 0) return all;
+    if (session.size() > 1 && session.runId().empty()) {
+        std::cerr << "No run id (NEURONMESHER_RUN_ID, SLURM_JOB_ID or PBS_JOBID): the statistics of the other "
+                  << "ranks cannot be told from earlier runs, reporting rank 0 only" << std::endl;
+        return {local};
+    }
+
+    // the other ranks may still be running: poll until every file of this run is there
+    std::vector<ShardStats> received(session.size());
+    std::vector<bool> have(session.size(), false);
+    have[session.rank()] = true;
+    received[session.rank()] = local;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(waitSeconds);
+    for (;;) {
+        bool complete = true;
+        for (int r = 0; r < session.size(); ++r) {
+            if (!have[r]) have[r] = readRankStats(stateFolder, r, session.runId(), received[r]);
+            complete = complete && have[r];
+        }
+        if (complete || std::chrono::steady_clock::now() >= deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    for (int r = 0; r < session.size(); ++r) {
+        if (have[r]) all.push_back(received[r]);
+    }
+    return all;
+}
+
+std::uint64_t printShardReport(const std::vector<ShardStats>& stats, std::ostream& out, int ranks) {
+    ShardStats total;
+    double slowest = 0.0;
+
+    out << "Shard report:\n";
+    for (const auto& s : stats) {
+        out << "  rank " << s.rank << ": " << s.succeeded << " of " << s.assigned << " inputs succeeded, "
+            << s.failed << " failed, " << s.skipped << " skipped, ~" << s.nodes << " nodes, "
+            << std::fixed << std::setprecision(3) << s.seconds << " s\n";
+        out.unsetf(std::ios::floatfield);
+        out << std::setprecision(6);
+        total.assigned += s.assigned;
+        total.succeeded += s.succeeded;
+        total.failed += s.failed;
+        total.skipped += s.skipped;
+        total.nodes += s.nodes;
+        total.seconds += s.seconds;
+        slowest = std::max(slowest, s.seconds);
+    }
+    if (ranks > static_cast<int>(stats.size())) {
+        out << "  " << ranks - static_cast<int>(stats.size()) << " of " << ranks
+            << " ranks did not report for this run and are not counted\n";
+    }
+    out << stats.size() << " ranks: " << total.succeeded << " inputs succeeded, " << total.failed
+        << " failed, " << total.skipped << " skipped; slowest rank " << slowest << " s of "
+        << total.seconds << " s total\n";
+    return total.failed;
+}
+
+int runDistributedDriver(const std::string& source, const BatchJob& job, const ShardSession& session,
+                         const std::string& stateFolder, const BatchOptions& options) {
+    std::vector<std::string> inputs = collectBatchInputs(source);
+
+    ShardStats stats;
+    std::vector<BatchResult> results = runShardedBatch(inputs, job, session, stateFolder, options, stats);
+    std::size_t failed = printBatchReport(results);
+
+    // without MPI rank 0 waits for the others' statistics (NEURONMESHER_SHARD_WAIT seconds, default one hour)
+    double wait = 3600.0;
+    if (const char* env = std::getenv("NEURONMESHER_SHARD_WAIT")) wait = std::atof(env);
+    std::vector<ShardStats> all = gatherShardStats(stats, session, stateFolder, wait);
+    if (session.rank() == 0) printShardReport(all, std::cout, session.size());
+    return failed == 0 ? 0 : 1;
+}
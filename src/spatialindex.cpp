@@ -0,0 +1,495 @@
+/**
+ * @file spatialindex.cpp
+ * @brief BVH construction and the segment and triangle queries
+ *
+ * The hierarchy is built by splitting the top levels serially and handing
+ * the subtrees below to the thread pool; each subtree owns a disjoint range
+ * of the primitive order, so the workers never touch the same data. The
+ * subtree count does not depend on the thread count, which keeps the node
+ * layout identical for every thread count.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "spatialindex.h"
+#include "threadpool.h"
+#include "instrumentation.h"
+
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+/** @brief Serial split levels above the parallel subtrees (up to 2^levels subtrees) */
+constexpr int parallelSplitLevels = 6;
+
+Point3 sub(const Point3& a, const Point3& b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+double dot(const Point3& a, const Point3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+Point3 cross(const Point3& a, const Point3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+Point3 along(const Point3& a, const Point3& d, double t) { return {a[0] + t * d[0], a[1] + t * d[1], a[2] + t * d[2]}; }
+double pointDistance(const Point3& a, const Point3& b) { return std::sqrt(dot(sub(a, b), sub(a, b))); }
+
+/** @brief Unit vector of @p d, or false for a zero vector */
+bool normalised(const Point3& d, Point3& unit) {
+    double len = std::sqrt(dot(d, d));
+    if (!(len > 0.0)) return false;
+    unit = {d[0] / len, d[1] / len, d[2] / len};
+    return true;
+}
+
+/** @brief Squared distance between segments p0-p1 and q0-q1 (Ericson, Real-Time Collision Detection 5.1.9) */
+double segmentDistance2(const Point3& p0, const Point3& p1, const Point3& q0, const Point3& q1) {
+    const Point3 d1 = sub(p1, p0), d2 = sub(q1, q0), r = sub(p0, q0);
+    const double a = dot(d1, d1), e = dot(d2, d2), f = dot(d2, r);
+    double s = 0.0, t = 0.0;
+    if (a <= 0.0 && e <= 0.0) return dot(r, r);
+    if (a <= 0.0) {
+        t = std::clamp(f / e, 0.0, 1.0);
+    } else {
+        const double c = dot(d1, r);
+        if (e <= 0.0) {
+            s = std::clamp(-c / a, 0.0, 1.0);
+        } else {
+            const double b = dot(d1, d2), denom = a * e - b * b;
+            s = denom > 0.0 ? std::clamp((b * f - c * e) / denom, 0.0, 1.0) : 0.0;
+            t = (b * s + f) / e;
+            if (t < 0.0) {
+                t = 0.0;
+                s = std::clamp(-c / a, 0.0, 1.0);
+            } else if (t > 1.0) {
+                t = 1.0;
+                s = std::clamp((b - c) / a, 0.0, 1.0);
+            }
+        }
+    }
+    const Point3 gap = sub(along(p0, d1, s), along(q0, d2, t));
+    return dot(gap, gap);
+}
+
+/** @brief Distance from @p p to segment a-b */
+double pointSegmentDistance(const Point3& p, const Point3& a, const Point3& b) {
+    const Point3 ab = sub(b, a);
+    const double len2 = dot(ab, ab);
+    const double t = len2 > 0.0 ? std::clamp(dot(sub(p, a), ab) / len2, 0.0, 1.0) : 0.0;
+    return pointDistance(p, along(a, ab, t));
+}
+
+/** @brief First t >= 0 where origin + t * unit meets the sphere (0 inside) */
+double raySphere(const Point3& origin, const Point3& unit, const Point3& centre, double r) {
+    const Point3 m = sub(origin, centre);
+    const double b = dot(m, unit), c = dot(m, m) - r * r;
+    if (c <= 0.0) return 0.0;
+    if (b > 0.0) return std::numeric_limits<double>::infinity();
+    const double disc = b * b - c;
+    if (disc < 0.0) return std::numeric_limits<double>::infinity();
+    return -b - std::sqrt(disc);
+}
+
+/** @brief First t >= 0 where origin + t * unit meets the capsule a-b of radius r (0 inside) */
+double rayCapsule(const Point3& origin, const Point3& unit, const Point3& a, const Point3& b, double r) {
+    if (pointSegmentDistance(origin, a, b) <= r) return 0.0;
+    double best = std::min(raySphere(origin, unit, a, r), raySphere(origin, unit, b, r));
+
+    // Side of the cylinder, in the frame of the axis
+    const Point3 ab = sub(b, a), ao = sub(origin, a);
+    const double abab = dot(ab, ab);
+    if (abab <= 0.0) return best;
+    const double abd = dot(ab, unit), abao = dot(ab, ao);
+    const double qa = abab - abd * abd;
+    const double qb = abab * dot(ao, unit) - abao * abd;
+    const double qc = abab * dot(ao, ao) - abao * abao - r * r * abab;
+    if (qa <= 0.0) return best;
+    const double disc = qb * qb - qa * qc;
+    if (disc < 0.0) return best;
+    const double t = (-qb - std::sqrt(disc)) / qa;
+    const double y = abao + t * abd;
+    if (t >= 0.0 && y >= 0.0 && y <= abab) best = std::min(best, t);
+    return best;
+}
+
+/** @brief Closest point to @p p on triangle abc (Ericson 5.1.5) */
+Point3 closestOnTriangle(const Point3& p, const Point3& a, const Point3& b, const Point3& c) {
+    const Point3 ab = sub(b, a), ac = sub(c, a), ap = sub(p, a);
+    const double d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0) return a;
+    const Point3 bp = sub(p, b);
+    const double d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3) return b;
+    const double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) return along(a, ab, d1 / (d1 - d3));
+    const Point3 cp = sub(p, c);
+    const double d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6) return c;
+    const double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) return along(a, ac, d2 / (d2 - d6));
+    const double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+        return along(b, sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    const double denom = 1.0 / (va + vb + vc);
+    const double v = vb * denom, w = vc * denom;
+    return {a[0] + ab[0] * v + ac[0] * w, a[1] + ab[1] * v + ac[1] * w, a[2] + ab[2] * v + ac[2] * w};
+}
+
+/** @brief Ray parameter of triangle abc (Möller–Trumbore, both sides), infinity on a miss */
+double rayTriangle(const Point3& origin, const Point3& unit, const Point3& a, const Point3& b, const Point3& c) {
+    const Point3 e1 = sub(b, a), e2 = sub(c, a);
+    const Point3 pv = cross(unit, e2);
+    const double det = dot(e1, pv);
+    if (std::fabs(det) <= 1e-14 * (dot(e1, e1) + dot(e2, e2))) return std::numeric_limits<double>::infinity();
+    const double inv = 1.0 / det;
+    const Point3 tv = sub(origin, a);
+    const double u = dot(tv, pv) * inv;
+    if (u < 0.0 || u > 1.0) return std::numeric_limits<double>::infinity();
+    const Point3 qv = cross(tv, e1);
+    const double v = dot(unit, qv) * inv;
+    if (v < 0.0 || u + v > 1.0) return std::numeric_limits<double>::infinity();
+    const double t = dot(e2, qv) * inv;
+    return t >= 0.0 ? t : std::numeric_limits<double>::infinity();
+}
+
+/** @brief True unless @p axis separates the projections of the two triangles */
+bool overlapOnAxis(const Point3& axis, const Point3* s, const Point3* t, double tolerance) {
+    double s0 = dot(axis, s[0]), s1 = dot(axis, s[1]), s2 = dot(axis, s[2]);
+    double t0 = dot(axis, t[0]), t1 = dot(axis, t[1]), t2 = dot(axis, t[2]);
+    double slo = std::min({s0, s1, s2}), shi = std::max({s0, s1, s2});
+    double tlo = std::min({t0, t1, t2}), thi = std::max({t0, t1, t2});
+    return shi + tolerance >= tlo && thi + tolerance >= slo;
+}
+
+/**
+ * @brief Separating axis test of two triangles (touching counts as intersecting)
+ *
+ * The candidate axes are both normals, the nine edge cross products and, for
+ * coplanar triangles, the in-plane edge normals. Axes from (nearly)
+ * parallel vectors carry no direction and are skipped.
+ */
+bool trianglesIntersect(const Point3* s, const Point3* t) {
+    const Point3 se[3] = {sub(s[1], s[0]), sub(s[2], s[1]), sub(s[0], s[2])};
+    const Point3 te[3] = {sub(t[1], t[0]), sub(t[2], t[1]), sub(t[0], t[2])};
+    double scale = 0.0;
+    for (int k = 0; k < 3; ++k) scale = std::max({scale, dot(se[k], se[k]), dot(te[k], te[k])});
+    const double tolerance = 1e-12 * std::sqrt(scale);
+
+    // axis = u x v; its length relative to |u| |v| is the sine of their angle
+    auto separates = [&](const Point3& u, const Point3& v) {
+        const Point3 axis = cross(u, v);
+        const double len = std::sqrt(dot(axis, axis));
+        if (!(len > 1e-9 * std::sqrt(dot(u, u) * dot(v, v)))) return false;
+        return !overlapOnAxis(axis, s, t, tolerance * len);
+    };
+
+    const Point3 sn = cross(se[0], se[1]), tn = cross(te[0], te[1]);
+    if (separates(se[0], se[1]) || separates(te[0], te[1])) return false;
+    for (const Point3& a : se)
+        for (const Point3& b : te)
+            if (separates(a, b)) return false;
+    for (int k = 0; k < 3; ++k)
+        if (separates(sn, se[k]) || separates(tn, te[k])) return false;
+    return true;
+}
+
+/** @brief Top-down median split over order[begin, end) */
+class BvhBuilder {
+public:
+    struct Subtree {
+        int node, begin, end;
+    };
+
+    BvhBuilder(const std::vector<Aabb>& boxes, std::vector<int>& order, int leafSize)
+        : boxes(boxes), order(order), leafSize(std::max(1, leafSize)) {
+        centroids.resize(boxes.size());
+        for (std::size_t i = 0; i < boxes.size(); ++i)
+            for (int k = 0; k < 3; ++k) centroids[i][k] = 0.5 * (boxes[i].lo[k] + boxes[i].hi[k]);
+    }
+
+    /**
+     * @brief Appends the subtree over order[begin, end) to @p out
+     * @param[in] levels Split levels left before ranges go to @p deferred
+     * @param[out] deferred If set, ranges below @p levels become placeholder nodes listed here
+     * @return Index of the subtree root in @p out
+     */
+    int build(std::vector<Bvh::Node>& out, int begin, int end, int levels, std::vector<Subtree>* deferred) const {
+        const int index = static_cast<int>(out.size());
+        out.emplace_back();
+        Aabb box, centres;
+        for (int k = begin; k < end; ++k) {
+            box.expand(boxes[order[k]]);
+            centres.expand(centroids[order[k]]);
+        }
+        out[index].box = box;
+        if (end - begin <= leafSize) {
+            out[index].first = begin;
+            out[index].count = end - begin;
+            return index;
+        }
+        if (deferred && levels == 0) {
+            deferred->push_back({index, begin, end});
+            return index;
+        }
+
+        int axis = 0;
+        for (int k = 1; k < 3; ++k)
+            if (centres.hi[k] - centres.lo[k] > centres.hi[axis] - centres.lo[axis]) axis = k;
+        const int mid = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](int a, int b) {
+            double ca = centroids[a][axis], cb = centroids[b][axis];
+            return ca < cb || (ca == cb && a < b);
+        });
+        const int left = build(out, begin, mid, levels - 1, deferred);
+        const int right = build(out, mid, end, levels - 1, deferred);
+        out[index].left = left;
+        out[index].right = right;
+        return index;
+    }
+
+private:
+    const std::vector<Aabb>& boxes;
+    std::vector<int>& order;
+    std::vector<Point3> centroids;
+    int leafSize;
+};
+
+} // namespace
+
+double Aabb::distance(const Point3& p) const {
+    double d2 = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        double gap = std::max({lo[k] - p[k], 0.0, p[k] - hi[k]});
+        d2 += gap * gap;
+    }
+    return std::sqrt(d2);
+}
+
+double Aabb::rayEntry(const Point3& origin, const Point3& direction) const {
+    double tmin = 0.0, tmax = std::numeric_limits<double>::infinity();
+    for (int k = 0; k < 3; ++k) {
+        if (direction[k] == 0.0) {
+            if (origin[k] < lo[k] || origin[k] > hi[k]) return std::numeric_limits<double>::infinity();
+            continue;
+        }
+        double t1 = (lo[k] - origin[k]) / direction[k];
+        double t2 = (hi[k] - origin[k]) / direction[k];
+        if (t1 > t2) std::swap(t1, t2);
+        tmin = std::max(tmin, t1);
+        tmax = std::min(tmax, t2);
+        if (tmin > tmax) return std::numeric_limits<double>::infinity();
+    }
+    return tmin;
+}
+
+Bvh Bvh::build(const std::vector<Aabb>& boxes, std::size_t threads, int leafSize) {
+    NM_SCOPED_TIMER("bvhBuild");
+    Bvh bvh;
+    if (boxes.empty()) return bvh;
+    bvh.order.resize(boxes.size());
+    std::iota(bvh.order.begin(), bvh.order.end(), 0);
+
+    const BvhBuilder builder(boxes, bvh.order, leafSize);
+    std::vector<BvhBuilder::Subtree> deferred;
+    builder.build(bvh.nodes, 0, static_cast<int>(boxes.size()), parallelSplitLevels, &deferred);
+
+    std::vector<std::vector<Node>> subtrees(deferred.size());
+    parallelFor(deferred.size(), threads, [&](std::size_t i) {
+        builder.build(subtrees[i], deferred[i].begin, deferred[i].end, -1, nullptr);
+    });
+
+    // Splice: each subtree root replaces its placeholder, the rest is appended
+    for (std::size_t i = 0; i < deferred.size(); ++i) {
+        const int base = static_cast<int>(bvh.nodes.size()) - 1;
+        auto remap = [&](int local) { return local == 0 ? deferred[i].node : base + local; };
+        for (std::size_t k = 0; k < subtrees[i].size(); ++k) {
+            Node n = subtrees[i][k];
+            if (!n.count) {
+                n.left = remap(n.left);
+                n.right = remap(n.right);
+            }
+            if (k == 0) bvh.nodes[deferred[i].node] = n;
+            else bvh.nodes.push_back(n);
+        }
+    }
+    return bvh;
+}
+
+SegmentIndex SegmentIndex::build(const Morphology& morph, std::size_t threads) {
+    NM_SCOPED_TIMER("segmentIndex");
+    SegmentIndex index;
+    index.revision = morph.revision();
+
+    const std::size_t n = morph.size();
+    index.nodePoints.resize(n);
+    index.parentRows.assign(n, -1);
+    index.radii.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        index.nodePoints[i] = {morph.x[i], morph.y[i], morph.z[i]};
+        if (morph.pid[i] != -1) index.parentRows[i] = morph.hasTopology() ? morph.parent[i] : morph.indexOf(morph.pid[i]);
+    }
+
+    std::vector<Aabb> boxes(n);
+    parallelFor(n, threads, [&](std::size_t i) {
+        const int p = index.parentRows[i];
+        index.radii[i] = std::max(0.0, p == -1 ? morph.radius[i] : std::max(morph.radius[i], morph.radius[p]));
+        boxes[i].expand(index.nodePoints[i]);
+        if (p != -1) boxes[i].expand(index.nodePoints[p]);
+        boxes[i].inflate(index.radii[i]);
+    });
+    index.bvh = Bvh::build(boxes, threads);
+    return index;
+}
+
+SpatialHit SegmentIndex::nearestNode(const Point3& p) const {
+    auto [row, d] = bvh.nearest(p, [&](int i) { return pointDistance(p, nodePoints[i]); });
+    return {row, d};
+}
+
+SpatialHit SegmentIndex::nearestSegment(const Point3& p) const {
+    auto [row, d] = bvh.nearest(p, [&](int i) {
+        const int parent = parentRows[i];
+        const Point3& b = parent == -1 ? nodePoints[i] : nodePoints[parent];
+        return pointSegmentDistance(p, nodePoints[i], b) - radii[i];
+    });
+    return {row, d};
+}
+
+std::vector<int> SegmentIndex::nodesWithin(const Point3& p, double radius) const {
+    std::vector<int> rows;
+    Aabb query;
+    query.expand(p);
+    query.inflate(radius);
+    bvh.overlapping(query, [&](int i) {
+        if (pointDistance(p, nodePoints[i]) <= radius) rows.push_back(i);
+    });
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+std::vector<SpatialHit> SegmentIndex::nearestNodes(const std::vector<Point3>& points, std::size_t threads) const {
+    std::vector<SpatialHit> hits(points.size());
+    parallelFor(points.size(), threads, [&](std::size_t i) { hits[i] = nearestNode(points[i]); });
+    return hits;
+}
+
+SpatialHit SegmentIndex::raycast(const Point3& origin, const Point3& direction) const {
+    Point3 unit;
+    if (!normalised(direction, unit)) return {};
+    auto [row, t] = bvh.raycast(origin, unit, [&](int i) {
+        const int parent = parentRows[i];
+        return rayCapsule(origin, unit, nodePoints[i], parent == -1 ? nodePoints[i] : nodePoints[parent], radii[i]);
+    });
+    return {row, t};
+}
+
+std::vector<std::pair<int, int>> SegmentIndex::intersections(int hops) const {
+    NM_SCOPED_TIMER("segmentIntersections");
+    hops = std::max(0, hops);
+
+    // Rows i, parent(i), ... up to hops + 2 entries: enough to find every
+    // common ancestor closer than hops + 1 edges
+    auto chain = [&](int row, std::vector<int>& out) {
+        out.clear();
+        for (int r = row; r != -1 && static_cast<int>(out.size()) < hops + 2; r = parentRows[r]) out.push_back(r);
+    };
+    auto span = [&](int row) { return parentRows[row] == -1 ? 0 : 1; };
+
+    std::vector<std::pair<int, int>> pairs;
+    std::vector<int> ci, cj;
+    bvh.selfOverlaps([&](int i, int j) {
+        chain(i, ci);
+        chain(j, cj);
+        for (std::size_t a = 0; a < ci.size(); ++a) {
+            auto hit = std::find(cj.begin(), cj.end(), ci[a]);
+            if (hit == cj.end()) continue;
+            int b = static_cast<int>(hit - cj.begin());
+            int apart = std::max(0, static_cast<int>(a) - span(i)) + std::max(0, b - span(j));
+            if (apart <= hops) return;
+            break;
+        }
+        const Point3& ib = parentRows[i] == -1 ? nodePoints[i] : nodePoints[parentRows[i]];
+        const Point3& jb = parentRows[j] == -1 ? nodePoints[j] : nodePoints[parentRows[j]];
+        const double reach = radii[i] + radii[j];
+        if (segmentDistance2(nodePoints[i], ib, nodePoints[j], jb) <= reach * reach) pairs.push_back({i, j});
+    });
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+TriangleIndex TriangleIndex::build(const DenseUgxGeometry& geometry, std::size_t threads) {
+    NM_SCOPED_TIMER("triangleIndex");
+    TriangleIndex index;
+    const int n = static_cast<int>(geometry.points.size());
+    index.vertices.reserve(n);
+    for (const Coordinates& c : geometry.points) index.vertices.push_back({c.x, c.y, c.z});
+    for (std::size_t f = 0; f < geometry.faces.size(); ++f) {
+        const auto& face = geometry.faces[f];
+        if (std::all_of(face.begin(), face.end(), [n](int v) { return v >= 0 && v < n; })) {
+            index.faces.push_back(face);
+            index.faceIds.push_back(static_cast<int>(f));
+        }
+    }
+
+    std::vector<Aabb> boxes(index.faces.size());
+    parallelFor(boxes.size(), threads, [&](std::size_t i) {
+        for (int v : index.faces[i]) boxes[i].expand(index.vertices[v]);
+    });
+    index.bvh = Bvh::build(boxes, threads);
+    return index;
+}
+
+SpatialHit TriangleIndex::nearest(const Point3& p) const {
+    auto [prim, d] = bvh.nearest(p, [&](int i) {
+        const auto& f = faces[i];
+        return pointDistance(p, closestOnTriangle(p, vertices[f[0]], vertices[f[1]], vertices[f[2]]));
+    });
+    return {prim == -1 ? -1 : faceIds[prim], d};
+}
+
+std::vector<SpatialHit> TriangleIndex::nearest(const std::vector<Point3>& points, std::size_t threads) const {
+    std::vector<SpatialHit> hits(points.size());
+    parallelFor(points.size(), threads, [&](std::size_t i) { hits[i] = nearest(points[i]); });
+    return hits;
+}
+
+std::vector<int> TriangleIndex::facesWithin(const Point3& p, double radius) const {
+    std::vector<int> result;
+    Aabb query;
+    query.expand(p);
+    query.inflate(radius);
+    bvh.overlapping(query, [&](int i) {
+        const auto& f = faces[i];
+        if (pointDistance(p, closestOnTriangle(p, vertices[f[0]], vertices[f[1]], vertices[f[2]])) <= radius)
+            result.push_back(faceIds[i]);
+    });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+SpatialHit TriangleIndex::raycast(const Point3& origin, const Point3& direction) const {
+    Point3 unit;
+    if (!normalised(direction, unit)) return {};
+    auto [prim, t] = bvh.raycast(origin, unit, [&](int i) {
+        const auto& f = faces[i];
+        return rayTriangle(origin, unit, vertices[f[0]], vertices[f[1]], vertices[f[2]]);
+    });
+    return {prim == -1 ? -1 : faceIds[prim], t};
+}
+
+std::vector<std::pair<int, int>> TriangleIndex::selfIntersections() const {
+    NM_SCOPED_TIMER("triangleIntersections");
+    std::vector<std::pair<int, int>> pairs;
+    bvh.selfOverlaps([&](int i, int j) {
+        const auto& a = faces[i];
+        const auto& b = faces[j];
+        for (int u : a)
+            for (int v : b)
+                if (u == v) return;
+        const Point3 s[3] = {vertices[a[0]], vertices[a[1]], vertices[a[2]]};
+        const Point3 t[3] = {vertices[b[0]], vertices[b[1]], vertices[b[2]]};
+        if (trianglesIntersect(s, t)) pairs.push_back({faceIds[i], faceIds[j]});
+    });
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
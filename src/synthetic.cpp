@@ -0,0 +1,152 @@
+/**
+ * @file synthetic.cpp
+ * @brief Implementation of the synthetic neuron generator
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "synthetic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "instrumentation.h"
+
+namespace {
+
+// Doubles from the engine's raw output; std::uniform_real_distribution is not
+// specified exactly and would differ between standard libraries
+struct SyntheticRandom {
+    std::mt19937 engine;
+
+    double uniform() { return engine() * (1.0 / 4294967296.0); }   // [0, 1)
+    double symmetric() { return 2.0 * uniform() - 1.0; }           // [-1, 1)
+};
+
+struct Direction {
+    double x, y, z;
+};
+
+Direction normalized(const Direction& d, const Direction& fallback) {
+    double len = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+    if (len < 1e-12) return fallback;
+    return {d.x / len, d.y / len, d.z / len};
+}
+
+// A growing neurite end: the node it continues from and where it heads
+struct Tip {
+    int parent;
+    Direction direction;
+    double radius;
+    double nextStep;
+    int type;
+};
+
+} // namespace
+
+SyntheticSoma syntheticSomaFromString(const std::string& name) {
+    if (name == "none") return SyntheticSoma::None;
+    if (name == "point") return SyntheticSoma::Point;
+    if (name == "three-point") return SyntheticSoma::ThreePoint;
+    if (name == "cylinder") return SyntheticSoma::Cylinder;
+    throw std::invalid_argument("unknown soma configuration: " + name);
+}
+
+std::map<int, SWCNode> generateMorphology(const SyntheticMorphologyOptions& options) {
+    NM_SCOPED_TIMER("generateMorphology");
+    std::map<int, SWCNode> result;
+    const std::size_t total = options.nodes > 0 ? static_cast<std::size_t>(options.nodes) : 0;
+    if (total == 0) return result;
+
+    SyntheticRandom rng{std::mt19937(options.seed)};
+    std::vector<SWCNode> nodes;
+    nodes.reserve(total);
+    auto add = [&nodes](int pid, int type, double x, double y, double z, double radius) {
+        const int id = static_cast<int>(nodes.size()) + 1;
+        nodes.push_back(SWCNode{id, pid, type, x, y, z, radius});
+        return id;
+    };
+
+    // soma, or a dendrite root the stems start from
+    const double R = options.somaRadius;
+    int root = 1;
+    double stemOffset = R;
+    switch (options.soma) {
+        case SyntheticSoma::None:
+            add(-1, 3, 0.0, 0.0, 0.0, options.stemRadius);
+            stemOffset = 0.0;
+            break;
+        case SyntheticSoma::Point:
+            add(-1, 1, 0.0, 0.0, 0.0, R);
+            break;
+        case SyntheticSoma::ThreePoint:
+            add(-1, 1, 0.0, 0.0, 0.0, R);
+            if (nodes.size() < total) add(1, 1, 0.0, -R, 0.0, R);
+            if (nodes.size() < total) add(1, 1, 0.0, R, 0.0, R);
+            break;
+        case SyntheticSoma::Cylinder: {
+            const int m = std::max(1, options.somaNodes);
+            for (int k = 0; k < m && nodes.size() < total; ++k) {
+                double x = m == 1 ? 0.0 : -R + 2.0 * R * k / (m - 1);
+                add(k == 0 ? -1 : k, 1, x, 0.0, 0.0, R);
+            }
+            root = (static_cast<int>(nodes.size()) + 1) / 2;   // stems leave from the middle
+            break;
+        }
+    }
+
+    // stems spread evenly over the sphere (Fibonacci lattice), alternating axon and dendrite
+    std::vector<Tip> tips;
+    const int stems = std::max(1, options.stems);
+    for (int k = 0; k < stems; ++k) {
+        double z = 1.0 - 2.0 * (k + 0.5) / stems;
+        double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+        double phi = k * 2.399963229728653;   // golden angle
+        int type = options.soma == SyntheticSoma::None ? 3 : (k % 2 ? 3 : 2);
+        tips.push_back({root, {r * std::cos(phi), r * std::sin(phi), z}, options.stemRadius,
+                        stemOffset + options.stepLength, type});
+    }
+
+    while (nodes.size() < total) {
+        Tip& tip = tips[std::min(tips.size() - 1, static_cast<std::size_t>(rng.uniform() * tips.size()))];
+        const SWCNode parent = nodes[tip.parent - 1];
+
+        Direction d = tip.direction;
+        d.x += options.tortuosity * rng.symmetric();
+        d.y += options.tortuosity * rng.symmetric();
+        d.z += options.tortuosity * rng.symmetric();
+        tip.direction = normalized(d, tip.direction);
+
+        const double step = tip.nextStep;
+        const int id = add(tip.parent, tip.type, parent.x + step * tip.direction.x, parent.y + step * tip.direction.y,
+                           parent.z + step * tip.direction.z, std::max(options.minRadius, tip.radius));
+        tip.parent = id;
+        tip.nextStep = options.stepLength;
+        tip.radius = std::max(options.minRadius, tip.radius * options.taper);
+
+        // a branch point starts branchingFactor - 1 more tips, each turned 45 degrees
+        // away from the parent direction in a random plane
+        if (rng.uniform() < options.branchProbability) {
+            const Tip parentTip = tip;
+            for (int b = 1; b < options.branchingFactor; ++b) {
+                Direction r{rng.symmetric(), rng.symmetric(), rng.symmetric()};
+                const Direction& t = parentTip.direction;
+                double along = r.x * t.x + r.y * t.y + r.z * t.z;
+                Direction perp = normalized({r.x - along * t.x, r.y - along * t.y, r.z - along * t.z},
+                                            {t.y, -t.x, 0.0});
+                Direction turned = normalized({t.x + perp.x, t.y + perp.y, t.z + perp.z}, t);
+                tips.push_back({id, turned, parentTip.radius, options.stepLength, parentTip.type});
+            }
+        }
+    }
+
+    for (const SWCNode& n : nodes) result.emplace_hint(result.end(), n.id, n);
+    NM_COUNT("synthetic.nodes", result.size());
+    return result;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file threadpool.cpp
+ * @brief Implementation of the work-stealing thread pool
+ *
+ * The shared state mutex only guards the task counters used for sleeping
+ * and waiting; the deques themselves have their own locks so that workers
+ * popping their own tasks rarely contend with each other.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "threadpool.h"
+
+namespace {
+/** @brief Pool and deque index of the current worker thread, if any */
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local std::size_t currentWorker = 0;
+}
+
+std::size_t ThreadPool::defaultThreadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) threads = defaultThreadCount();
+    queues.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) queues.push_back(std::make_unique<TaskQueue>());
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        allDone.wait(lock, [this] { return pending == 0; });
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // Count the task before it becomes visible so a worker can never take it
+    // before the counters know about it.
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++queued;
+        ++pending;
+    }
+
+    std::size_t target = currentPool == this
+        ? currentWorker
+        : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pending == 0; });
+    if (firstError) {
+        std::exception_ptr e = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+bool ThreadPool::takeTask(std::size_t self, std::function<void()>& task) {
+    {
+        TaskQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t k = 1; k < queues.size(); ++k) {
+        TaskQueue& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(std::size_t self) {
+    currentPool = this;
+    currentWorker = self;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+
+        std::function<void()> task;
+        if (!takeTask(self, task)) {
+            // Counted but not pushed yet, or taken by another worker first.
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            --queued;
+        }
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (!firstError) firstError = std::current_exception();
+        }
+
+        bool finished;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            finished = --pending == 0;
+        }
+        if (finished) allDone.notify_all();
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * @file topology.cpp
+ * @brief Builders of the cached adjacency and trunk indices
+ *
+ * Both builders work on dense rows and visit nodes and neighbours in the
+ * order of the original map-based trunk extraction, so trunk numbering and
+ * path direction are unchanged.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "neurongraph.h"
+#include "topology.h"
+
+TopologyIndex TopologyIndex::build(const Morphology& morph, const Morphology* members) {
+    TopologyIndex index;
+    index.revision = morph.revision();
+
+    const std::size_t n = morph.size();
+    std::vector<int> parentRow(n, -1);
+    index.neighborOffsets.assign(n + 1, 0);
+
+    // Count phase: an edge needs both ends stored
+    for (std::size_t i = 0; i < n; ++i) {
+        if (morph.pid[i] == -1) continue;
+        int p = morph.hasTopology() ? morph.parent[i] : morph.indexOf(morph.pid[i]);
+        if (p == -1 || (members && !members->contains(morph.pid[i]))) continue;
+        parentRow[i] = p;
+        ++index.neighborOffsets[i + 1];
+        ++index.neighborOffsets[p + 1];
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        index.neighborOffsets[i + 1] += index.neighborOffsets[i];
+    }
+
+    // Scatter phase in row order: matches the push order of getNeighborMap()
+    index.neighbors.assign(index.neighborOffsets[n], 0);
+    std::vector<int> cursor(index.neighborOffsets.begin(), index.neighborOffsets.end() - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        int p = parentRow[i];
+        if (p == -1) continue;
+        index.neighbors[cursor[i]++] = p;
+        index.neighbors[cursor[p]++] = static_cast<int>(i);
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        if (index.degree(i) > 2) index.branchPoints.push_back(static_cast<int>(i));
+        if (morph.type[i] == 1) index.somaRows.push_back(static_cast<int>(i));
+    }
+    return index;
+}
+
+TrunkDecomposition TrunkDecomposition::build(const Morphology& morph, const TopologyIndex& index) {
+    TrunkDecomposition trunks;
+    trunks.revision = morph.revision();
+
+    const std::size_t n = morph.size();
+    std::vector<bool> visited(n, false);
+    std::vector<bool> branch(n, false);
+    for (int row : index.branchPoints) branch[row] = true;
+
+    // every row ends up in at most two trunk paths (branch points in more)
+    trunks.rows.reserve(n + index.neighbors.size() / 2);
+    trunks.offsets.reserve(index.neighbors.size() / 2 + 2);
+    trunks.offsets.push_back(0);
+
+    for (int row : index.branchPoints) {
+        const int first = index.neighborOffsets[row];
+        for (int k = first; k < index.neighborOffsets[row + 1]; ++k) {
+            int nbr = index.neighbors[k];
+            if (visited[nbr]) continue;
+
+            // A single edge between two branch points is found from both ends: it
+            // was already emitted from the lower row, or from an earlier copy of
+            // the same edge (self or mutual parents in malformed files)
+            if (branch[nbr] || nbr == row) {
+                if (nbr < row) continue;
+                auto done = index.neighbors.begin() + k;
+                if (std::find(index.neighbors.begin() + first, done, nbr) != done) continue;
+            }
+
+            trunks.rows.push_back(row);
+            int prev = row, curr = nbr;
+            while (index.degree(curr) == 2 && !visited[curr]) {
+                trunks.rows.push_back(curr);
+                visited[curr] = true;
+
+                const int* nexts = index.neighbors.data() + index.neighborOffsets[curr];
+                curr = (nexts[0] == prev) ? nexts[1] : nexts[0];
+                prev = trunks.rows.back();
+            }
+            trunks.rows.push_back(curr);
+            trunks.offsets.push_back(static_cast<int>(trunks.rows.size()));
+        }
+    }
+
+    // Parent trunk: the trunk holding the parent of each trunk's lowest row
+    // (the last trunk listing a row wins, as in getTrunkParentMap())
+    std::vector<int> trunkOfRow(n, -1);
+    for (std::size_t t = 0; t < trunks.size(); ++t)
+        for (int k = trunks.offsets[t]; k < trunks.offsets[t + 1]; ++k) trunkOfRow[trunks.rows[k]] = static_cast<int>(t);
+
+    trunks.parentTrunk.assign(trunks.size(), -1);
+    for (std::size_t t = 0; t < trunks.size(); ++t) {
+        auto first = trunks.rows.begin() + trunks.offsets[t];
+        auto last = trunks.rows.begin() + trunks.offsets[t + 1];
+        int lowest = *std::min_element(first, last);
+        int pid = morph.pid[lowest];
+        int p = pid == -1 ? -1 : morph.indexOf(pid);
+        if (p != -1) trunks.parentTrunk[t] = trunkOfRow[p];
+    }
+    return trunks;
+}
+
+const SWCNode* TrunkSpans::begin(std::size_t t) const {
+    return nodes.data() + offsets[t];
+}
+
+TrunkSpans TrunkSpans::fromDecomposition(const Morphology& morph, const TrunkDecomposition& trunks, bool resetIndex) {
+    TrunkSpans spans;
+    spans.offsets = trunks.offsets;
+    spans.parentTrunk = trunks.parentTrunk;
+    spans.nodes.reserve(trunks.rows.size());
+
+    for (std::size_t t = 0; t < trunks.size(); ++t) {
+        int localId = 1;
+        for (int k = trunks.offsets[t]; k < trunks.offsets[t + 1]; ++k) {
+            SWCNode node = morph.node(trunks.rows[k]);
+            if (resetIndex) {
+                node.id = localId;
+                node.pid = (k == trunks.offsets[t]) ? -1 : localId - 1;
+                ++localId;
+            }
+            spans.nodes.push_back(node);
+        }
+    }
+    return spans;
+}
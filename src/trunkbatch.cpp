@@ -0,0 +1,158 @@
+/**
+ * @file trunkbatch.cpp
+ * @brief Implementation of flat trunk batches and their batched cubic resampling
+ *
+ * The per-trunk arithmetic is that of prepareTrunk() and sampleTrunkCubic()
+ * (the spline fit is the shared NaturalCubicSpline::fitInto()), so a batch
+ * resamples to exactly the nodes of the map-based path. The tube emission
+ * lives next to the other tube kernels in neuronpft.cpp.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-15
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "trunkbatch.h"
+#include "instrumentation.h"
+#include "spline.h"
+#include "threadpool.h"
+
+void TrunkBatch::append(const std::map<int, SWCNode>& trunk) {
+    for (const auto& [id, node] : trunk) {
+        xyzr.insert(xyzr.end(), {node.x, node.y, node.z, node.radius});
+        types.push_back(node.type);
+    }
+    offsets.push_back(types.size());
+}
+
+TrunkBatch TrunkBatch::fromTrunks(const std::map<int, std::map<int, SWCNode>>& trunks) {
+    TrunkBatch batch;
+    std::size_t rows = 0;
+    for (const auto& [tid, trunk] : trunks) rows += trunk.size();
+    batch.offsets.reserve(trunks.size() + 1);
+    batch.xyzr.reserve(4 * rows);
+    batch.types.reserve(rows);
+    for (const auto& [tid, trunk] : trunks) batch.append(trunk);
+    return batch;
+}
+
+TrunkBatch TrunkBatch::fromSpans(const TrunkSpans& spans) {
+    TrunkBatch batch;
+    batch.offsets.reserve(spans.size() + 1);
+    batch.xyzr.reserve(4 * spans.nodes.size());
+    batch.types.reserve(spans.nodes.size());
+    for (std::size_t t = 0; t < spans.size(); ++t) {
+        const SWCNode* first = spans.begin(t);
+        for (const SWCNode* n = first; n != first + spans.length(t); ++n) {
+            batch.xyzr.insert(batch.xyzr.end(), {n->x, n->y, n->z, n->radius});
+            batch.types.push_back(n->type);
+        }
+        batch.offsets.push_back(batch.types.size());
+    }
+    return batch;
+}
+
+std::map<int, SWCNode> TrunkBatch::trunk(std::size_t t) const {
+    std::map<int, SWCNode> nodes;
+    int id = 1;
+    for (std::size_t row = offsets[t]; row < offsets[t + 1]; ++row, ++id) {
+        const double* v = &xyzr[4 * row];
+        nodes.emplace_hint(nodes.end(), id, SWCNode{id, id == 1 ? -1 : id - 1, types[row], v[0], v[1], v[2], v[3]});
+    }
+    return nodes;
+}
+
+namespace {
+
+// most frequent type of a trunk, the smallest on ties (as prepareTrunk() picks it)
+int dominantType(const int* types, std::size_t n, std::vector<int>& sorted) {
+    sorted.assign(types, types + n);
+    std::sort(sorted.begin(), sorted.end());
+    int best = sorted[0];
+    std::size_t bestCount = 0;
+    for (std::size_t i = 0; i < n;) {
+        std::size_t j = i;
+        while (j < n && sorted[j] == sorted[i]) ++j;
+        if (j - i > bestCount) {
+            best = sorted[i];
+            bestCount = j - i;
+        }
+        i = j;
+    }
+    return best;
+}
+
+} // namespace
+
+TrunkBatch resampleTrunkBatchCubic(const TrunkBatch& batch, double delta, std::size_t threads) {
+    NM_SCOPED_TIMER("cubicResampleBatch");
+    const std::size_t trunks = batch.size();
+
+    // Pass 1: arc length of every row and the sample count of every trunk
+    std::vector<double> arc(batch.rows());
+    std::vector<std::size_t> counts(trunks, 0);
+    parallelFor(trunks, threads, [&](std::size_t t) {
+        const std::size_t begin = batch.offsets[t], n = batch.length(t);
+        if (n < 2) return;
+        const double* p = &batch.xyzr[4 * begin];
+        double* s = &arc[begin];
+        s[0] = 0.0;
+        for (std::size_t i = 1; i < n; ++i) {
+            double dx = p[4 * i] - p[4 * (i - 1)];
+            double dy = p[4 * i + 1] - p[4 * (i - 1) + 1];
+            double dz = p[4 * i + 2] - p[4 * (i - 1) + 2];
+            s[i] = s[i - 1] + std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+        int N = static_cast<int>(std::round(s[n - 1] / delta));
+        if (N <= 3) N = 4;
+        counts[t] = static_cast<std::size_t>(N);
+    });
+
+    TrunkBatch out;
+    out.offsets.resize(trunks + 1);
+    out.offsets[0] = 0;
+    for (std::size_t t = 0; t < trunks; ++t) out.offsets[t + 1] = out.offsets[t] + counts[t];
+    out.xyzr.resize(4 * out.offsets.back());
+    out.types.resize(out.offsets.back());
+
+    // Pass 2: fit every trunk's spline and write its samples into its own rows
+    parallelFor(trunks, threads, [&](std::size_t t) {
+        const std::size_t begin = batch.offsets[t], n = batch.length(t);
+        if (n < 2) return;
+        thread_local std::vector<double> coeffs, scratch;
+        thread_local std::vector<int> sortedTypes;
+
+        const double* values = &batch.xyzr[4 * begin];
+        const double* knots = &arc[begin];
+        coeffs.resize((n - 1) * 16);
+        NaturalCubicSpline<4>::fitInto(knots, n, values, coeffs.data(), scratch);
+
+        double minRadius = values[3];
+        for (std::size_t i = 1; i < n; ++i) minRadius = std::min(minRadius, values[4 * i + 3]);
+        const double clampRadius = 1.05 * minRadius;
+        const int type = dominantType(&batch.types[begin], n, sortedTypes);
+
+        const std::size_t first = out.offsets[t];
+        const int N = static_cast<int>(counts[t]);
+        const double totalLength = knots[n - 1];
+        std::size_t cursor = 0;
+        for (int i = 0; i < N; ++i) {
+            double* row = &out.xyzr[4 * (first + i)];
+            if (i == 0 || i == N - 1) {
+                const std::size_t src = begin + (i == 0 ? 0 : n - 1);
+                std::copy_n(&batch.xyzr[4 * src], 4, row);
+                out.types[first + i] = batch.types[src];
+            } else {
+                NaturalCubicSpline<4>::evaluateAt(knots, n, coeffs.data(), i * totalLength / (N - 1), row, cursor);
+                row[3] = std::max(std::abs(row[3]), clampRadius);
+                out.types[first + i] = type;
+            }
+        }
+    });
+
+    return out;
+}
@@ -2,130 +2,298 @@
 #include "ugxobject.h"
 #include <tinyxml2.h>
 #include <iomanip> // for std::setprecision
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include "bincache.h"
+#include "threadpool.h"
 
 using namespace tinyxml2;
 
-void UgxObject::readUGX(const std::string& filename) {
-    ugxg.points.clear();
-    ugxg.edges.clear();
-    ugxg.faces.clear();
-
-    XMLDocument doc;
-    if (doc.LoadFile(filename.c_str()) != XML_SUCCESS) {
-        std::cerr << "[UGXObject Error] Failed to load: " << filename << std::endl;
-        return;
-    }
-
-    XMLElement* root = doc.FirstChildElement("grid");
-    if (!root) {
-        std::cerr << "[UGXObject Error] Missing <grid> root element in: " << filename << std::endl;
-        return;
-    }
+namespace {
+
+// element text of a ugx file, located by either the DOM or the streaming reader
+struct UgxObjectText {
+    struct Attachment {
+        std::string name;
+        std::string_view text;
+    };
+    struct Subset {
+        std::string name;
+        std::optional<std::string_view> vertices, edges, faces;
+    };
+
+    std::optional<std::string_view> vertices, edges, triangles;
+    std::vector<Attachment> attachments;   // diameter/radius attachments with text
+    bool hasSubsetHandler = false;
+    std::vector<Subset> subsets;
+};
+
+std::optional<std::string_view> optionalText(const char* text) {
+    if (!text) return std::nullopt;
+    return std::string_view(text);
+}
 
+// fill geometry from located text; shared by all UGX readers
+void loadUgxObjectText(const UgxObjectText& text, DenseUgxGeometry& ugxg, const std::string& filename) {
     // --- 1. Load Points ---
-    XMLElement* vertsElem = root->FirstChildElement("vertices");
-    if (vertsElem && vertsElem->GetText()) {
-        std::istringstream coordStream(vertsElem->GetText());
+    if (text.vertices) {
+        UgxTextScanner coordScanner(*text.vertices);
         double x, y, z;
-        int index = 0;
 
-        while (coordStream >> x >> y >> z) {
-            ugxg.points[index++] = {x, y, z};
+        while (coordScanner.next(x) && coordScanner.next(y) && coordScanner.next(z)) {
+            ugxg.points.push_back({x, y, z});
         }
-        std::cout << "[UGXObject] Loaded " << ugxg.points.size() << " points from " << filename << std::endl;
+        NM_LOG(Info) << "[UGXObject] Loaded " << ugxg.points.size() << " points from " << filename << std::endl;
     } else {
         std::cerr << "[UGXObject Warning] No vertex data found in: " << filename << std::endl;
     }
 
     // Parse radius or diameter from vertex_attachment blocks (as flat value list)
-    for (tinyxml2::XMLElement* attach = root->FirstChildElement("vertex_attachment");
-        attach; attach = attach->NextSiblingElement("vertex_attachment")) {
-
-        const char* name = attach->Attribute("name");
-        if (!name) continue;
-
-        bool isDiameter = std::string(name) == "diameter";
-        bool isRadius   = std::string(name) == "radius";
-        if (!isDiameter && !isRadius) continue;
-
-        const char* rawText = attach->GetText();
-        if (!rawText) continue;
-
-        std::istringstream stream(rawText);
+    for (const auto& attach : text.attachments) {
+        bool isDiameter = attach.name == "diameter";
+        UgxTextScanner scanner(attach.text);
         double value;
-        int index = 0;
+        std::size_t index = 0;
 
-        while (stream >> value) {
+        ugxg.radii.resize(ugxg.points.size(), 0.0);
+        while (index < ugxg.radii.size() && scanner.next(value)) {
             ugxg.radii[index++] = isDiameter ? value / 2.0 : value;
         }
 
-        std::cout << "[UGXObject] Parsed " << index << " values for " << name << std::endl;
+        NM_LOG(Debug) << "[UGXObject] Parsed " << index << " values for " << attach.name << std::endl;
     }
 
     // --- 2. Load Edges (if present) ---
-    XMLElement* edgesElem = root->FirstChildElement("edges");
-    if (edgesElem && edgesElem->GetText()) {
-        std::istringstream edgeStream(edgesElem->GetText());
+    if (text.edges) {
+        UgxTextScanner edgeScanner(*text.edges);
         int from, to;
-        while (edgeStream >> from >> to) {
+        while (edgeScanner.next(from) && edgeScanner.next(to)) {
             ugxg.edges.emplace_back(from, to);
         }
-        std::cout << "[UGXObject] Loaded " << ugxg.edges.size() << " edges from " << filename << std::endl;
+        NM_LOG(Info) << "[UGXObject] Loaded " << ugxg.edges.size() << " edges from " << filename << std::endl;
     }
 
     // --- 3. Load Faces (optional) ---
-    XMLElement* facesElem = root->FirstChildElement("triangles");
-    if (facesElem && facesElem->GetText()) {
-        std::istringstream faceStream(facesElem->GetText());
+    if (text.triangles) {
+        UgxTextScanner faceScanner(*text.triangles);
         int v0, v1, v2;
-        while (faceStream >> v0 >> v1 >> v2) {
+        while (faceScanner.next(v0) && faceScanner.next(v1) && faceScanner.next(v2)) {
             ugxg.faces.push_back({v0, v1, v2});
         }
-        std::cout << "[UGXObject] Loaded " << ugxg.faces.size() << " faces from " << filename << std::endl;
-    }
-
-	// --- 4. Load Subset Info ---
-	XMLElement* subsetHandler = root->FirstChildElement("subset_handler");
-	if (subsetHandler) {
-		int subsetIndex = 0;
-		for (XMLElement* subset = subsetHandler->FirstChildElement("subset");
-			subset; subset = subset->NextSiblingElement("subset"), ++subsetIndex) {
-
-			const char* nameAttr = subset->Attribute("name");
-			std::string subsetName = nameAttr ? nameAttr : "unnamed";
-			ugxg.subsetNames[subsetIndex] = subsetName;
-
-			// Vertex membership
-			if (XMLElement* vElem = subset->FirstChildElement("vertices"); vElem && vElem->GetText()) {
-				std::istringstream vStream(vElem->GetText());
-				int vid;
-				while (vStream >> vid)
-					ugxg.vertexSubsets[vid] = subsetIndex;
-			}
-
-			// Edge membership
-			if (XMLElement* eElem = subset->FirstChildElement("edges"); eElem && eElem->GetText()) {
-				std::istringstream eStream(eElem->GetText());
-				int eid;
-				while (eStream >> eid)
-					ugxg.edgeSubsets[eid] = subsetIndex;
-			}
-
-			// Face membership
-			if (XMLElement* fElem = subset->FirstChildElement("faces"); fElem && fElem->GetText()) {
-				std::istringstream fStream(fElem->GetText());
-				int fid;
-				while (fStream >> fid)
-					ugxg.faceSubsets[fid] = subsetIndex;
-			}
-		}
-
-		std::cout << "[UGXObject] Loaded " << ugxg.subsetNames.size()
-				<< " subsets from " << filename << std::endl;
-	}
+        NM_LOG(Info) << "[UGXObject] Loaded " << ugxg.faces.size() << " faces from " << filename << std::endl;
+    }
+
+    // --- 4. Load Subset Info ---
+    if (text.hasSubsetHandler) {
+        // membership of an index beyond the element count is dropped
+        auto assign = [](const std::optional<std::string_view>& members, std::vector<int>& subsets,
+                         std::size_t count, int subsetIndex) {
+            if (!members) return;
+            if (subsets.empty()) subsets.assign(count, -1);
+            UgxTextScanner scanner(*members);
+            int id;
+            while (scanner.next(id))
+                if (id >= 0 && static_cast<std::size_t>(id) < count) subsets[id] = subsetIndex;
+        };
+
+        int subsetIndex = 0;
+        for (const auto& subset : text.subsets) {
+            ugxg.subsetNames[subsetIndex] = subset.name;
+            assign(subset.vertices, ugxg.vertexSubsets, ugxg.points.size(), subsetIndex);
+            assign(subset.edges, ugxg.edgeSubsets, ugxg.edges.size(), subsetIndex);
+            assign(subset.faces, ugxg.faceSubsets, ugxg.faces.size(), subsetIndex);
+            ++subsetIndex;
+        }
+
+        NM_LOG(Info) << "[UGXObject] Loaded " << ugxg.subsetNames.size()
+                << " subsets from " << filename << std::endl;
+    }
 }
 
-void UgxObject::writeUGX(const std::string& filename) const {
+// locate the element text with the tinyxml2 DOM; the text lives in doc
+bool locateUgxTextDOM(const std::string& filename, XMLDocument& doc, UgxObjectText& text) {
+    if (doc.LoadFile(filename.c_str()) != XML_SUCCESS) {
+        std::cerr << "[UGXObject Error] Failed to load: " << filename << std::endl;
+        return false;
+    }
+
+    XMLElement* root = doc.FirstChildElement("grid");
+    if (!root) {
+        std::cerr << "[UGXObject Error] Missing <grid> root element in: " << filename << std::endl;
+        return false;
+    }
+
+    if (XMLElement* vertsElem = root->FirstChildElement("vertices"))
+        text.vertices = optionalText(vertsElem->GetText());
+
+    for (XMLElement* attach = root->FirstChildElement("vertex_attachment");
+        attach; attach = attach->NextSiblingElement("vertex_attachment")) {
+        const char* name = attach->Attribute("name");
+        if (!name) continue;
+        if (std::string(name) != "diameter" && std::string(name) != "radius") continue;
+        if (const char* rawText = attach->GetText())
+            text.attachments.push_back({name, rawText});
+    }
+
+    if (XMLElement* edgesElem = root->FirstChildElement("edges"))
+        text.edges = optionalText(edgesElem->GetText());
+
+    if (XMLElement* facesElem = root->FirstChildElement("triangles"))
+        text.triangles = optionalText(facesElem->GetText());
+
+    if (XMLElement* subsetHandler = root->FirstChildElement("subset_handler")) {
+        text.hasSubsetHandler = true;
+        for (XMLElement* subset = subsetHandler->FirstChildElement("subset");
+            subset; subset = subset->NextSiblingElement("subset")) {
+            UgxObjectText::Subset entry;
+            const char* nameAttr = subset->Attribute("name");
+            entry.name = nameAttr ? nameAttr : "unnamed";
+            if (XMLElement* vElem = subset->FirstChildElement("vertices"))
+                entry.vertices = optionalText(vElem->GetText());
+            if (XMLElement* eElem = subset->FirstChildElement("edges"))
+                entry.edges = optionalText(eElem->GetText());
+            if (XMLElement* fElem = subset->FirstChildElement("faces"))
+                entry.faces = optionalText(fElem->GetText());
+            text.subsets.push_back(entry);
+        }
+    }
+    return true;
+}
+
+// locate the element text with the pull parser; the text lives in file or ownedText
+bool locateUgxTextStream(const std::string& filename, MappedFile& file, std::deque<std::string>& ownedText,
+                         UgxObjectText& text) {
+    if (!file.open(filename)) {
+        std::cerr << "[UGXObject Error] Failed to load: " << filename << std::endl;
+        return false;
+    }
+
+    // role of each open element; text is taken from an element's first child only
+    enum class Role { Other, Grid, Vertices, Attachment, Edges, Triangles, SubsetHandler, Subset,
+                      SubsetVertices, SubsetEdges, SubsetFaces };
+
+    std::vector<Role> roles;
+    std::optional<std::string_view>* textTarget = nullptr;
+    bool gridFound = false, verticesFound = false, edgesFound = false, trianglesFound = false;
+    bool subsetVerticesFound = false, subsetEdgesFound = false, subsetFacesFound = false;
+    std::optional<std::string_view> attachmentText;
+    std::string attachmentName;
+
+    UgxPullParser parser(file.view());
+    for (auto ev = parser.next(); ev != UgxPullParser::Event::End; ev = parser.next()) {
+        if (ev == UgxPullParser::Event::Error) {
+            std::cerr << "[UGXObject Error] Failed to load: " << filename << std::endl;
+            return false;
+        }
+
+        std::optional<std::string_view>* target = textTarget;
+        textTarget = nullptr;
+
+        if (ev == UgxPullParser::Event::Text) {
+            if (target) {
+                std::string_view t = parser.text();
+                if (t.data() < file.data() || t.data() >= file.data() + file.size()) {
+                    ownedText.emplace_back(t);
+                    t = ownedText.back();
+                }
+                *target = t;
+            }
+            continue;
+        }
+
+        if (ev == UgxPullParser::Event::EndElement) {
+            if (roles.back() == Role::Attachment && attachmentText)
+                text.attachments.push_back({attachmentName, *attachmentText});
+            roles.pop_back();
+            continue;
+        }
+
+        const std::string_view name = parser.name();
+        const Role parent = roles.empty() ? Role::Other : roles.back();
+        Role role = Role::Other;
+        std::string_view attr;
+
+        if (roles.empty()) {
+            if (name == "grid" && !gridFound) { gridFound = true; role = Role::Grid; }
+        } else if (parent == Role::Grid) {
+            if (name == "vertices" && !verticesFound) {
+                verticesFound = true;
+                role = Role::Vertices;
+                textTarget = &text.vertices;
+            } else if (name == "vertex_attachment" && parser.attribute("name", attr) &&
+                       (attr == "diameter" || attr == "radius")) {
+                role = Role::Attachment;
+                attachmentName = std::string(attr);
+                attachmentText.reset();
+                textTarget = &attachmentText;
+            } else if (name == "edges" && !edgesFound) {
+                edgesFound = true;
+                role = Role::Edges;
+                textTarget = &text.edges;
+            } else if (name == "triangles" && !trianglesFound) {
+                trianglesFound = true;
+                role = Role::Triangles;
+                textTarget = &text.triangles;
+            } else if (name == "subset_handler" && !text.hasSubsetHandler) {
+                text.hasSubsetHandler = true;
+                role = Role::SubsetHandler;
+            }
+        } else if (parent == Role::SubsetHandler && name == "subset") {
+            UgxObjectText::Subset entry;
+            entry.name = parser.attribute("name", attr) ? std::string(attr) : "unnamed";
+            text.subsets.push_back(entry);
+            role = Role::Subset;
+            subsetVerticesFound = subsetEdgesFound = subsetFacesFound = false;
+        } else if (parent == Role::Subset) {
+            auto& subset = text.subsets.back();
+            if (name == "vertices" && !subsetVerticesFound) {
+                subsetVerticesFound = true;
+                role = Role::SubsetVertices;
+                textTarget = &subset.vertices;
+            } else if (name == "edges" && !subsetEdgesFound) {
+                subsetEdgesFound = true;
+                role = Role::SubsetEdges;
+                textTarget = &subset.edges;
+            } else if (name == "faces" && !subsetFacesFound) {
+                subsetFacesFound = true;
+                role = Role::SubsetFaces;
+                textTarget = &subset.faces;
+            }
+        }
+
+        roles.push_back(role);
+    }
+
+    if (!gridFound) {
+        std::cerr << "[UGXObject Error] Missing <grid> root element in: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+DenseUgxGeometry readDenseDOM(const std::string& filename) {
+    DenseUgxGeometry ugxg;
+    XMLDocument doc;
+    UgxObjectText text;
+    if (locateUgxTextDOM(filename, doc, text)) loadUgxObjectText(text, ugxg, filename);
+    return ugxg;
+}
+
+DenseUgxGeometry readDenseStream(const std::string& filename) {
+    DenseUgxGeometry ugxg;
+    MappedFile file;
+    std::deque<std::string> ownedText;
+    UgxObjectText text;
+    if (locateUgxTextStream(filename, file, ownedText, text)) loadUgxObjectText(text, ugxg, filename);
+    return ugxg;
+}
+
+// write with the tinyxml2 DOM
+template <typename Scalar>
+void writeDenseDOM(const BasicDenseUgxGeometry<Scalar>& ugxg, const std::string& filename) {
     XMLDocument doc;
     doc.InsertFirstChild(doc.NewDeclaration());
 
@@ -138,7 +306,7 @@ void UgxObject::writeUGX(const std::string& filename) const {
     vertsElem->SetAttribute("coords", "3");
 
     std::ostringstream coordStream;
-    for (const auto& [id, coord] : ugxg.points)
+    for (const auto& coord : ugxg.points)
         coordStream << coord.x << " " << coord.y << " " << coord.z << " ";
 
     std::string coordStr = coordStream.str();
@@ -179,16 +347,9 @@ void UgxObject::writeUGX(const std::string& filename) const {
         attachElem->SetAttribute("passOn", "0");
         attachElem->SetAttribute("global", "1");
 
-        // Create ordered output string by vertex index
         std::ostringstream oss;
-        for (size_t i = 0; i < ugxg.points.size(); ++i) {
-            double radius = 0.0;
-            auto it = ugxg.radii.find(i);
-            if (it != ugxg.radii.end())
-                oss << (2.0 * it->second) << " ";  // write as diameter
-            else
-                oss << "0.0 ";  // fallback if missing
-        }
+        for (double radius : ugxg.radii)
+            oss << (2.0 * radius) << " ";  // write as diameter
 
         std::string radiiText = oss.str();
         if (!radiiText.empty()) radiiText.pop_back();  // remove trailing space
@@ -202,49 +363,28 @@ void UgxObject::writeUGX(const std::string& filename) const {
         XMLElement* shElem = doc.NewElement("subset_handler");
         shElem->SetAttribute("name", "defSH");
 
+        auto joined = [](const std::vector<int>& indices) {
+            std::ostringstream out;
+            for (std::size_t i = 0; i < indices.size(); ++i) out << (i ? " " : "") << indices[i];
+            return out.str();
+        };
+
+        const auto members = ugxg.subsetMembers();
+        std::size_t slot = 0;
         for (const auto& [subsetId, subsetName] : ugxg.subsetNames) {
+            const auto& m = members[slot++];
             XMLElement* subset = doc.NewElement("subset");
             subset->SetAttribute("name", subsetName.c_str());
             subset->SetAttribute("state", "0");
             subset->SetAttribute("color", "0.5 0.5 0.5");
 
-            // Vertices
-            std::ostringstream vi;
-            for (const auto& [vid, sid] : ugxg.vertexSubsets)
-                if (sid == subsetId) vi << vid << " ";
-            std::string vis = vi.str();
-            if (!vis.empty()) vis.pop_back();
-
-            if (!vis.empty()) {
-                XMLElement* verts = doc.NewElement("vertices");
-                verts->SetText(vis.c_str());
-                subset->InsertEndChild(verts);
-            }
-
-            // Edges
-            std::ostringstream ei;
-            for (const auto& [eid, sid] : ugxg.edgeSubsets)
-                if (sid == subsetId) ei << eid << " ";
-            std::string eis = ei.str();
-            if (!eis.empty()) eis.pop_back();
-
-            if (!eis.empty()) {
-                XMLElement* edges = doc.NewElement("edges");
-                edges->SetText(eis.c_str());
-                subset->InsertEndChild(edges);
-            }
-
-            // Faces
-            std::ostringstream fi;
-            for (const auto& [fid, sid] : ugxg.faceSubsets)
-                if (sid == subsetId) fi << fid << " ";
-            std::string fis = fi.str();
-            if (!fis.empty()) fis.pop_back();
-
-            if (!fis.empty()) {
-                XMLElement* faces = doc.NewElement("faces");
-                faces->SetText(fis.c_str());
-                subset->InsertEndChild(faces);
+            const std::pair<const char*, const std::vector<int>*> lists[] = {
+                {"vertices", &m.vertices}, {"edges", &m.edges}, {"faces", &m.faces}};
+            for (const auto& [tag, indices] : lists) {
+                if (indices->empty()) continue;
+                XMLElement* elem = doc.NewElement(tag);
+                elem->SetText(joined(*indices).c_str());
+                subset->InsertEndChild(elem);
             }
 
             shElem->InsertEndChild(subset);
@@ -257,10 +397,557 @@ void UgxObject::writeUGX(const std::string& filename) const {
     if (doc.SaveFile(filename.c_str()) != XML_SUCCESS) {
         std::cerr << "[UGXObject Error] Failed to write: " << filename << std::endl;
     } else {
-        std::cout << "[UGXObject] Successfully wrote: " << filename << std::endl;
+        NM_LOG(Info) << "[UGXObject] Successfully wrote: " << filename << std::endl;
+    }
+}
+
+// same output as writeDenseDOM, written through the chunked stream writer
+template <typename Scalar>
+void writeDenseStream(const BasicDenseUgxGeometry<Scalar>& ugxg, const std::string& filename) {
+    UgxStreamWriter w;
+    if (!w.open(filename)) {
+        std::cerr << "[UGXObject Error] Failed to write: " << filename << std::endl;
+        return;
+    }
+
+    w.declaration(R"(xml version="1.0" encoding="UTF-8")");
+    w.openElement("grid");
+    w.attribute("name", "defGrid");
+
+    // --- Write Vertices ---
+    w.openElement("vertices");
+    w.attribute("coords", "3");
+    w.beginText();
+    for (const auto& coord : ugxg.points) {
+        w.number(coord.x);
+        w.number(coord.y);
+        w.number(coord.z);
+    }
+    w.closeElement();
+
+    // --- Write Edges ---
+    if (!ugxg.edges.empty()) {
+        w.openElement("edges");
+        w.beginText();
+        for (const auto& [v0, v1] : ugxg.edges) {
+            w.number(v0);
+            w.number(v1);
+        }
+        w.closeElement();
+    }
+
+    // --- Write Faces ---
+    if (!ugxg.faces.empty()) {
+        w.openElement("triangles");
+        w.beginText();
+        for (const auto& face : ugxg.faces) {
+            w.number(face[0]);
+            w.number(face[1]);
+            w.number(face[2]);
+        }
+        w.closeElement();
+    }
+
+    // --- Write Radii as Vertex Attachment ---
+    if (!ugxg.radii.empty()) {
+        w.openElement("vertex_attachment");
+        w.attribute("name", "diameter");
+        w.attribute("type", "double");
+        w.attribute("passOn", "0");
+        w.attribute("global", "1");
+        w.beginText();
+        for (double radius : ugxg.radii) w.number(2.0 * radius);  // write as diameter
+        w.closeElement();
+    }
+
+    // --- Write Subsets ---
+    if (!ugxg.subsetNames.empty()) {
+        w.openElement("subset_handler");
+        w.attribute("name", "defSH");
+
+        const auto members = ugxg.subsetMembers();
+        std::size_t slot = 0;
+        for (const auto& [subsetId, subsetName] : ugxg.subsetNames) {
+            const auto& m = members[slot++];
+            w.openElement("subset");
+            w.attribute("name", subsetName);
+            w.attribute("state", "0");
+            w.attribute("color", "0.5 0.5 0.5");
+
+            const std::pair<const char*, const std::vector<int>*> lists[] = {
+                {"vertices", &m.vertices}, {"edges", &m.edges}, {"faces", &m.faces}};
+            for (const auto& [tag, indices] : lists) {
+                if (indices->empty()) continue;
+                w.openElement(tag);
+                w.beginText();
+                for (int index : *indices) w.number(index);
+                w.closeElement();
+            }
+
+            w.closeElement();
+        }
+
+        w.closeElement();
+    }
+
+    w.closeElement();  // </grid>
+
+    if (!w.close()) {
+        std::cerr << "[UGXObject Error] Failed to write: " << filename << std::endl;
+    } else {
+        NM_LOG(Info) << "[UGXObject] Successfully wrote: " << filename << std::endl;
+    }
+}
+
+} // namespace
+
+// bucket sort of the elements by subset: slot of a subset ID by binary search over
+// the (few) named subsets, members come out in increasing index order
+template <typename Scalar>
+std::vector<typename BasicDenseUgxGeometry<Scalar>::SubsetMembers> BasicDenseUgxGeometry<Scalar>::subsetMembers() const {
+    std::vector<int> ids;
+    ids.reserve(subsetNames.size());
+    for (const auto& [id, name] : subsetNames) ids.push_back(id);
+    std::vector<SubsetMembers> members(ids.size());
+
+    auto bucket = [&ids, &members](const std::vector<int>& subsets, std::vector<int> SubsetMembers::*list) {
+        for (std::size_t i = 0; i < subsets.size(); ++i) {
+            auto it = std::lower_bound(ids.begin(), ids.end(), subsets[i]);
+            if (it != ids.end() && *it == subsets[i])
+                (members[it - ids.begin()].*list).push_back(static_cast<int>(i));
+        }
+    };
+    bucket(vertexSubsets, &SubsetMembers::vertices);
+    bucket(edgeSubsets, &SubsetMembers::edges);
+    bucket(faceSubsets, &SubsetMembers::faces);
+    return members;
+}
+
+template <typename Scalar>
+void BasicDenseUgxGeometry<Scalar>::append(const BasicDenseUgxGeometry& part) {
+    const int vertexOffset = static_cast<int>(points.size());
+    const std::size_t edgeOffset = edges.size(), faceOffset = faces.size();
+
+    // keep the per-element vectors either empty or complete
+    auto appendColumn = [](auto& column, const auto& partColumn, std::size_t before, std::size_t partCount,
+                           auto fill) {
+        if (column.empty() && partColumn.empty()) return;
+        column.resize(before, fill);
+        if (partColumn.empty()) column.resize(before + partCount, fill);
+        else column.insert(column.end(), partColumn.begin(), partColumn.end());
+    };
+    appendColumn(radii, part.radii, points.size(), part.points.size(), Scalar(0));
+    appendColumn(vertexSubsets, part.vertexSubsets, points.size(), part.points.size(), -1);
+    appendColumn(edgeSubsets, part.edgeSubsets, edgeOffset, part.edges.size(), -1);
+    appendColumn(faceSubsets, part.faceSubsets, faceOffset, part.faces.size(), -1);
+
+    points.insert(points.end(), part.points.begin(), part.points.end());
+    edges.reserve(edgeOffset + part.edges.size());
+    for (const auto& [from, to] : part.edges) edges.emplace_back(from + vertexOffset, to + vertexOffset);
+    faces.reserve(faceOffset + part.faces.size());
+    for (const auto& f : part.faces) faces.push_back({f[0] + vertexOffset, f[1] + vertexOffset, f[2] + vertexOffset});
+
+    for (const auto& [subsetId, name] : part.subsetNames) subsetNames.emplace(subsetId, name);
+}
+
+template <typename Scalar>
+void BasicDenseUgxGeometry<Scalar>::appendAll(const std::vector<BasicDenseUgxGeometry>& parts, std::size_t threads) {
+    // prefix sums of vertex, edge and face counts
+    std::vector<std::size_t> vertexOffset(parts.size()), edgeOffset(parts.size()), faceOffset(parts.size());
+    std::size_t v = points.size(), e = edges.size(), f = faces.size();
+    bool anyRadii = !radii.empty(), anyVertexSubsets = !vertexSubsets.empty();
+    bool anyEdgeSubsets = !edgeSubsets.empty(), anyFaceSubsets = !faceSubsets.empty();
+    for (std::size_t k = 0; k < parts.size(); ++k) {
+        vertexOffset[k] = v;
+        edgeOffset[k] = e;
+        faceOffset[k] = f;
+        v += parts[k].points.size();
+        e += parts[k].edges.size();
+        f += parts[k].faces.size();
+        anyRadii |= !parts[k].radii.empty();
+        anyVertexSubsets |= !parts[k].vertexSubsets.empty();
+        anyEdgeSubsets |= !parts[k].edgeSubsets.empty();
+        anyFaceSubsets |= !parts[k].faceSubsets.empty();
     }
+
+    // keep the per-element vectors either empty or complete
+    const std::size_t v0 = points.size(), e0 = edges.size(), f0 = faces.size();
+    if (anyRadii) { radii.resize(v0, Scalar(0)); radii.resize(v, Scalar(0)); }
+    if (anyVertexSubsets) { vertexSubsets.resize(v0, -1); vertexSubsets.resize(v, -1); }
+    if (anyEdgeSubsets) { edgeSubsets.resize(e0, -1); edgeSubsets.resize(e, -1); }
+    if (anyFaceSubsets) { faceSubsets.resize(f0, -1); faceSubsets.resize(f, -1); }
+    points.resize(v);
+    edges.resize(e);
+    faces.resize(f);
+
+    // every part owns disjoint ranges of every vector
+    parallelFor(parts.size(), threads, [&](std::size_t k) {
+        const BasicDenseUgxGeometry& part = parts[k];
+        const int off = static_cast<int>(vertexOffset[k]);
+        std::copy(part.points.begin(), part.points.end(), points.begin() + vertexOffset[k]);
+        std::copy(part.radii.begin(), part.radii.end(), radii.begin() + (anyRadii ? vertexOffset[k] : 0));
+        std::copy(part.vertexSubsets.begin(), part.vertexSubsets.end(),
+                  vertexSubsets.begin() + (anyVertexSubsets ? vertexOffset[k] : 0));
+        std::copy(part.edgeSubsets.begin(), part.edgeSubsets.end(),
+                  edgeSubsets.begin() + (anyEdgeSubsets ? edgeOffset[k] : 0));
+        std::copy(part.faceSubsets.begin(), part.faceSubsets.end(),
+                  faceSubsets.begin() + (anyFaceSubsets ? faceOffset[k] : 0));
+        auto* edgeOut = edges.data() + edgeOffset[k];
+        for (const auto& [from, to] : part.edges) *edgeOut++ = {from + off, to + off};
+        auto* faceOut = faces.data() + faceOffset[k];
+        for (const auto& face : part.faces) *faceOut++ = {face[0] + off, face[1] + off, face[2] + off};
+    });
+
+    for (const auto& part : parts)
+        for (const auto& [subsetId, name] : part.subsetNames) subsetNames.emplace(subsetId, name);
 }
 
+template <typename Scalar>
+std::vector<int> BasicDenseUgxGeometry<Scalar>::compact(double tolerance) {
+    NM_SCOPED_TIMER("DenseUgxGeometry::compact");
+    const std::size_t numVertices = points.size();
+
+    // hash grid with cells no smaller than the tolerance, so a partner is always in one of
+    // the 27 cells around a vertex; the cells grow with the extent to keep indices in range
+    double extent = 0.0;
+    for (const auto& p : points)
+        extent = std::max({extent, std::abs(double(p.x)), std::abs(double(p.y)), std::abs(double(p.z))});
+    const double cell = std::max({tolerance, 1e-12 * extent, std::numeric_limits<double>::min()});
+    const int reach = tolerance > 0.0 ? 1 : 0;
+    auto cellKey = [](std::int64_t i, std::int64_t j, std::int64_t k) {
+        return static_cast<std::uint64_t>(i) * 73856093u ^ static_cast<std::uint64_t>(j) * 19349663u ^
+               static_cast<std::uint64_t>(k) * 83492791u;
+    };
+    std::unordered_map<std::uint64_t, std::vector<int>> grid;
+    grid.reserve(numVertices);
+
+    std::vector<int> newIndex(numVertices);
+    std::vector<Point> keptPoints;
+    std::vector<Scalar> keptRadii;
+    std::vector<int> keptSubsets;
+    keptPoints.reserve(numVertices);
+    for (std::size_t v = 0; v < numVertices; ++v) {
+        const Point& p = points[v];
+        const std::int64_t ci = static_cast<std::int64_t>(std::floor(p.x / cell));
+        const std::int64_t cj = static_cast<std::int64_t>(std::floor(p.y / cell));
+        const std::int64_t ck = static_cast<std::int64_t>(std::floor(p.z / cell));
+        int partner = -1;
+        for (int di = -reach; di <= reach && partner < 0; ++di)
+            for (int dj = -reach; dj <= reach && partner < 0; ++dj)
+                for (int dk = -reach; dk <= reach && partner < 0; ++dk) {
+                    auto it = grid.find(cellKey(ci + di, cj + dj, ck + dk));
+                    if (it == grid.end()) continue;
+                    for (int kept : it->second) {
+                        const Point& q = keptPoints[kept];
+                        const double dx = double(p.x) - q.x, dy = double(p.y) - q.y, dz = double(p.z) - q.z;
+                        if (dx * dx + dy * dy + dz * dz <= tolerance * tolerance) {
+                            partner = kept;
+                            break;
+                        }
+                    }
+                }
+        if (partner >= 0) {
+            newIndex[v] = partner;
+            continue;
+        }
+        newIndex[v] = static_cast<int>(keptPoints.size());
+        grid[cellKey(ci, cj, ck)].push_back(newIndex[v]);
+        keptPoints.push_back(p);
+        if (!radii.empty()) keptRadii.push_back(radii[v]);
+        if (!vertexSubsets.empty()) keptSubsets.push_back(vertexSubsets[v]);
+    }
+
+    // faces: drop collapsed ones and repeats of the same three vertices
+    std::vector<std::array<int, 3>> keptFaces;
+    std::vector<int> keptFaceSubsets;
+    std::set<std::array<int, 3>> seenFaces;
+    keptFaces.reserve(faces.size());
+    for (std::size_t f = 0; f < faces.size(); ++f) {
+        std::array<int, 3> face = {newIndex[faces[f][0]], newIndex[faces[f][1]], newIndex[faces[f][2]]};
+        if (face[0] == face[1] || face[1] == face[2] || face[2] == face[0]) continue;
+        std::array<int, 3> sorted = face;
+        std::sort(sorted.begin(), sorted.end());
+        if (!seenFaces.insert(sorted).second) continue;
+        keptFaces.push_back(face);
+        if (!faceSubsets.empty()) keptFaceSubsets.push_back(faceSubsets[f]);
+    }
+
+    // edges: the old ones first (keeping their subsets), then face edges not seen yet
+    const bool withEdgeSubsets = !edgeSubsets.empty() || !faceSubsets.empty();
+    std::vector<std::pair<int, int>> keptEdges;
+    std::vector<int> keptEdgeSubsets;
+    std::unordered_set<std::uint64_t> seenEdges;
+    seenEdges.reserve(edges.size() + keptFaces.size());
+    auto addEdge = [&](int a, int b, int subset) {
+        if (a == b) return;
+        const std::uint64_t key = static_cast<std::uint64_t>(std::min(a, b)) << 32 | static_cast<std::uint32_t>(std::max(a, b));
+        if (!seenEdges.insert(key).second) return;
+        keptEdges.emplace_back(a, b);
+        if (withEdgeSubsets) keptEdgeSubsets.push_back(subset);
+    };
+    for (std::size_t e = 0; e < edges.size(); ++e)
+        addEdge(newIndex[edges[e].first], newIndex[edges[e].second], edgeSubsets.empty() ? -1 : edgeSubsets[e]);
+    for (std::size_t f = 0; f < keptFaces.size(); ++f) {
+        const auto& face = keptFaces[f];
+        const int subset = keptFaceSubsets.empty() ? -1 : keptFaceSubsets[f];
+        addEdge(face[0], face[1], subset);
+        addEdge(face[1], face[2], subset);
+        addEdge(face[2], face[0], subset);
+    }
+
+    NM_COUNT("compact.vertices.welded", numVertices - keptPoints.size());
+    NM_COUNT("compact.edges.removed", edges.size() > keptEdges.size() ? edges.size() - keptEdges.size() : 0);
+
+    points = std::move(keptPoints);
+    radii = std::move(keptRadii);
+    vertexSubsets = std::move(keptSubsets);
+    edges = std::move(keptEdges);
+    edgeSubsets = std::move(keptEdgeSubsets);
+    faces = std::move(keptFaces);
+    faceSubsets = std::move(keptFaceSubsets);
+    return newIndex;
+}
+
+template <typename Scalar>
+BasicDenseUgxGeometry<Scalar> BasicDenseUgxGeometry<Scalar>::fromGeometry(const UgxGeometry& geometry) {
+    BasicDenseUgxGeometry dense;
+    const int n = geometry.points.empty() ? 0 : std::max(0, geometry.points.rbegin()->first + 1);
+    dense.points.resize(n);
+    for (const auto& [id, coord] : geometry.points)
+        if (id >= 0) dense.points[id] = convertCoordinates<Scalar>(coord);
+
+    auto scatter = [](const auto& source, auto& target, int count, auto fill) {
+        if (source.empty()) return;
+        target.assign(count, fill);
+        for (const auto& [index, value] : source)
+            if (index >= 0 && index < count) target[index] = static_cast<decltype(fill)>(value);
+    };
+    scatter(geometry.radii, dense.radii, n, Scalar(0));
+    scatter(geometry.vertexSubsets, dense.vertexSubsets, n, -1);
+    scatter(geometry.edgeSubsets, dense.edgeSubsets, static_cast<int>(geometry.edges.size()), -1);
+    scatter(geometry.faceSubsets, dense.faceSubsets, static_cast<int>(geometry.faces.size()), -1);
+
+    dense.edges = geometry.edges;
+    dense.faces = geometry.faces;
+    dense.subsetNames = geometry.subsetNames;
+    return dense;
+}
+
+// keys are increasing, so every map insert is hinted at the end
+template <typename Scalar>
+UgxGeometry BasicDenseUgxGeometry<Scalar>::toGeometry() const {
+    UgxGeometry geometry;
+    for (std::size_t i = 0; i < points.size(); ++i)
+        geometry.points.emplace_hint(geometry.points.end(), static_cast<int>(i), convertCoordinates<double>(points[i]));
+
+    auto gather = [](const auto& source, auto& target, bool skipUnassigned) {
+        for (std::size_t i = 0; i < source.size(); ++i)
+            if (!skipUnassigned || source[i] != -1)
+                target.emplace_hint(target.end(), static_cast<int>(i), source[i]);
+    };
+    gather(radii, geometry.radii, false);
+    gather(vertexSubsets, geometry.vertexSubsets, true);
+    gather(edgeSubsets, geometry.edgeSubsets, true);
+    gather(faceSubsets, geometry.faceSubsets, true);
+
+    geometry.edges = edges;
+    geometry.faces = faces;
+    geometry.subsetNames = subsetNames;
+    return geometry;
+}
+
+template struct BasicDenseUgxGeometry<double>;
+template struct BasicDenseUgxGeometry<float>;
+
+void UgxObject::readUGX(const std::string& filename) {
+    NM_SCOPED_TIMER("UgxObject::readUGX");
+    if (useUgxStreaming(filename)) {
+        readUGXStream(filename);
+        return;
+    }
+    ugxg = readDenseDOM(filename).toGeometry();
+}
+
+void UgxObject::readUGXStream(const std::string& filename) {
+    NM_SCOPED_TIMER("UgxObject::readUGXStream");
+    ugxg = readDenseStream(filename).toGeometry();
+}
+
+// both writers go through the dense form, which buckets the subset members once
+void UgxObject::writeUGX(const std::string& filename) const {
+    NM_SCOPED_TIMER("UgxObject::writeUGX");
+    if (useUgxStreaming(filename)) {
+        writeUGXStream(filename);
+        return;
+    }
+    writeDenseDOM(DenseUgxGeometry::fromGeometry(ugxg), filename);
+}
+
+void UgxObject::writeUGXStream(const std::string& filename) const {
+    NM_SCOPED_TIMER("UgxObject::writeUGXStream");
+    writeDenseStream(DenseUgxGeometry::fromGeometry(ugxg), filename);
+}
+
+DenseUgxGeometry UgxObject::readDenseUGX(const std::string& filename) {
+    NM_SCOPED_TIMER("UgxObject::readDenseUGX");
+    return useUgxStreaming(filename) ? readDenseStream(filename) : readDenseDOM(filename);
+}
+
+void UgxObject::writeDenseUGX(const DenseUgxGeometry& geometry, const std::string& filename) {
+    NM_SCOPED_TIMER("UgxObject::writeDenseUGX");
+    NM_COUNT("ugx.vertices.written", geometry.points.size());
+    if (useUgxStreaming(filename)) writeDenseStream(geometry, filename);
+    else writeDenseDOM(geometry, filename);
+}
+
+// the text keeps 6 significant digits, well within float precision
+void UgxObject::writeDenseUGX(const DenseUgxGeometry32& geometry, const std::string& filename) {
+    NM_SCOPED_TIMER("UgxObject::writeDenseUGX");
+    NM_COUNT("ugx.vertices.written", geometry.points.size());
+    if (useUgxStreaming(filename)) writeDenseStream(geometry, filename);
+    else writeDenseDOM(geometry, filename);
+}
+
+// flatten map-based geometry into aligned binary cache sections
+void UgxObject::writeBIN(const std::string& filename, StoragePrecision precision) const {
+    NM_SCOPED_TIMER("UgxObject::writeBIN");
+    const bool single = precision == StoragePrecision::Float32;
+    std::vector<int> pointIds, radiusKeys, subsetIds;
+    std::vector<Coordinates> points;
+    std::vector<Coordinates32> points32;
+    std::vector<double> radii;
+    std::vector<float> radii32;
+    std::vector<std::array<int, 2>> edges, vertexSubsets, edgeSubsets, faceSubsets;
+    std::vector<std::uint64_t> nameOffsets{0};
+    std::string nameChars;
+
+    pointIds.reserve(ugxg.points.size());
+    if (single) points32.reserve(ugxg.points.size());
+    else points.reserve(ugxg.points.size());
+    for (const auto& [id, c] : ugxg.points) {
+        pointIds.push_back(id);
+        if (single) points32.push_back(convertCoordinates<float>(c));
+        else points.push_back(c);
+    }
+    for (const auto& [id, r] : ugxg.radii) {
+        radiusKeys.push_back(id);
+        if (single) radii32.push_back(static_cast<float>(r));
+        else radii.push_back(r);
+    }
+    edges.reserve(ugxg.edges.size());
+    for (const auto& [v0, v1] : ugxg.edges) edges.push_back({v0, v1});
+    for (const auto& [k, v] : ugxg.vertexSubsets) vertexSubsets.push_back({k, v});
+    for (const auto& [k, v] : ugxg.edgeSubsets)   edgeSubsets.push_back({k, v});
+    for (const auto& [k, v] : ugxg.faceSubsets)   faceSubsets.push_back({k, v});
+    for (const auto& [id, name] : ugxg.subsetNames) {
+        subsetIds.push_back(id);
+        nameChars += name;
+        nameOffsets.push_back(nameChars.size());
+    }
+
+    BinaryCacheWriter writer;
+    writer.addSection(BinarySection::PointIds,          pointIds);
+    if (single) writer.addSection(BinarySection::Points, points32);
+    else writer.addSection(BinarySection::Points,       points);
+    writer.addSection(BinarySection::RadiusKeys,        radiusKeys);
+    if (single) writer.addSection(BinarySection::Radii, radii32);
+    else writer.addSection(BinarySection::Radii,        radii);
+    writer.addSection(BinarySection::Edges,             edges);
+    writer.addSection(BinarySection::Faces,             ugxg.faces);
+    writer.addSection(BinarySection::VertexSubsets,     vertexSubsets);
+    writer.addSection(BinarySection::EdgeSubsets,       edgeSubsets);
+    writer.addSection(BinarySection::FaceSubsets,       faceSubsets);
+    writer.addSection(BinarySection::SubsetIds,         subsetIds);
+    writer.addSection(BinarySection::SubsetNameOffsets, nameOffsets);
+    writer.addSection(BinarySection::SubsetNameChars,   nameChars.data(), nameChars.size());
+
+    if (!writer.write(filename, BinaryCacheKind::Geometry)) {
+        std::cerr << "[UGXObject Error] Failed to write: " << filename << std::endl;
+    } else {
+        NM_LOG(Info) << "[UGXObject] Successfully wrote: " << filename << std::endl;
+    }
+}
+
+// map a binary cache file and rebuild the geometry from its sections;
+// the sections are sorted by key, so every map insert uses an end hint
+void UgxObject::readBIN(const std::string& filename) {
+    NM_SCOPED_TIMER("UgxObject::readBIN");
+    ugxg = UgxGeometry();
+
+    BinaryCacheFile file;
+    if (!file.open(filename)) {
+        std::cerr << "[UGXObject Error] Failed to load " << filename << ": " << file.errorMessage() << std::endl;
+        return;
+    }
+    if (file.kind() != BinaryCacheKind::Geometry) {
+        std::cerr << "[UGXObject Error] " << filename << " does not contain UGX geometry" << std::endl;
+        return;
+    }
+
+    auto pointIds    = file.section<int>(BinarySection::PointIds);
+    auto points      = file.section<Coordinates>(BinarySection::Points);
+    auto points32    = file.section<Coordinates32>(BinarySection::Points);
+    auto radiusKeys  = file.section<int>(BinarySection::RadiusKeys);
+    auto radii       = file.section<double>(BinarySection::Radii);
+    auto radii32     = file.section<float>(BinarySection::Radii);
+    const std::size_t pointCount = points.empty() ? points32.size : points.size;
+    const std::size_t radiusCount = radii.empty() ? radii32.size : radii.size;
+    auto subsetIds   = file.section<int>(BinarySection::SubsetIds);
+    auto nameOffsets = file.section<std::uint64_t>(BinarySection::SubsetNameOffsets);
+    auto nameChars   = file.section<char>(BinarySection::SubsetNameChars);
+
+    bool valid = pointIds.size == pointCount && radiusKeys.size == radiusCount &&
+                 nameOffsets.size == subsetIds.size + 1;
+    for (std::size_t i = 0; valid && i < subsetIds.size; ++i)
+        valid = nameOffsets[i] <= nameOffsets[i + 1] && nameOffsets[i + 1] <= nameChars.size;
+    if (!valid) {
+        std::cerr << "[UGXObject Error] Inconsistent sections in " << filename << std::endl;
+        return;
+    }
+
+    for (std::size_t i = 0; i < pointCount; ++i)
+        ugxg.points.emplace_hint(ugxg.points.end(), pointIds[i],
+                                 points.empty() ? convertCoordinates<double>(points32[i]) : points[i]);
+    for (std::size_t i = 0; i < radiusCount; ++i)
+        ugxg.radii.emplace_hint(ugxg.radii.end(), radiusKeys[i], radii.empty() ? double(radii32[i]) : radii[i]);
+
+    auto edges = file.section<std::array<int, 2>>(BinarySection::Edges);
+    ugxg.edges.reserve(edges.size);
+    for (const auto& e : edges) ugxg.edges.emplace_back(e[0], e[1]);
+
+    auto faces = file.section<std::array<int, 3>>(BinarySection::Faces);
+    ugxg.faces.assign(faces.begin(), faces.end());
+
+    auto loadPairs = [&file](BinarySection id, std::map<int, int>& target) {
+        for (const auto& p : file.section<std::array<int, 2>>(id))
+            target.emplace_hint(target.end(), p[0], p[1]);
+    };
+    loadPairs(BinarySection::VertexSubsets, ugxg.vertexSubsets);
+    loadPairs(BinarySection::EdgeSubsets, ugxg.edgeSubsets);
+    loadPairs(BinarySection::FaceSubsets, ugxg.faceSubsets);
+
+    for (std::size_t i = 0; i < subsetIds.size; ++i) {
+        ugxg.subsetNames.emplace_hint(ugxg.subsetNames.end(), subsetIds[i],
+            std::string(nameChars.data + nameOffsets[i], nameChars.data + nameOffsets[i + 1]));
+    }
+
+    NM_LOG(Info) << "[UGXObject] Loaded " << ugxg.points.size() << " points from " << filename << std::endl;
+}
+
+namespace {
+
+// subset name of an element with one lookup per map, "n/a" if it has none
+const std::string& subsetNameOf(const std::map<int, int>& subsets, int index,
+                                const std::map<int, std::string>& names) {
+    static const std::string none = "n/a";
+    auto it = subsets.find(index);
+    if (it == subsets.end()) return none;
+    auto name = names.find(it->second);
+    return name == names.end() ? none : name->second;
+}
+
+} // namespace
+
 void UgxObject::printCoordinates() const {
     if (ugxg.points.empty()) {
         std::cout << "No points to display.\n";
@@ -270,9 +957,7 @@ void UgxObject::printCoordinates() const {
     std::cout << std::fixed << std::setprecision(3);
     std::cout << "ID\tX\tY\tZ\tSubset\n";
 	for (const auto& [id, coord] : ugxg.points) {
-		int subsetId = ugxg.vertexSubsets.count(id) ? ugxg.vertexSubsets.at(id) : -1;
-		std::string subsetName = subsetId >= 0 && ugxg.subsetNames.count(subsetId)
-								? ugxg.subsetNames.at(subsetId) : "n/a";
+		const std::string& subsetName = subsetNameOf(ugxg.vertexSubsets, id, ugxg.subsetNames);
 		std::cout << id << "\t" << coord.x << "\t" << coord.y << "\t"
 				<< coord.z << "\t" << subsetName << "\n";
 	}
@@ -287,9 +972,7 @@ void UgxObject::printEdges() const {
     std::cout << "Edge (v0 → v1)\tSubset\n";
     for (size_t i = 0; i < ugxg.edges.size(); ++i) {
         auto [v0, v1] = ugxg.edges[i];
-        int subsetId = ugxg.edgeSubsets.count(i) ? ugxg.edgeSubsets.at(i) : -1;
-        std::string name = (subsetId >= 0 && ugxg.subsetNames.count(subsetId))
-                           ? ugxg.subsetNames.at(subsetId) : "n/a";
+        const std::string& name = subsetNameOf(ugxg.edgeSubsets, static_cast<int>(i), ugxg.subsetNames);
         std::cout << v0 << " → " << v1 << "\t" << name << "\n";
     }
 }
@@ -303,9 +986,7 @@ void UgxObject::printFaces() const {
     std::cout << "Face (v0, v1, v2)\tSubset\n";
     for (size_t i = 0; i < ugxg.faces.size(); ++i) {
         const auto& face = ugxg.faces[i];
-        int subsetId = ugxg.faceSubsets.count(i) ? ugxg.faceSubsets.at(i) : -1;
-        std::string name = (subsetId >= 0 && ugxg.subsetNames.count(subsetId))
-                           ? ugxg.subsetNames.at(subsetId) : "n/a";
+        const std::string& name = subsetNameOf(ugxg.faceSubsets, static_cast<int>(i), ugxg.subsetNames);
         std::cout << face[0] << ", " << face[1] << ", " << face[2]
                   << "\t" << name << "\n";
     }
@@ -363,73 +1044,100 @@ const UgxGeometry UgxObject::convertToUGX(const std::map<int, SWCNode>& nodeSet)
 }
 
 UgxGeometry UgxObject::addUGXGeometry(const UgxGeometry& geometry1, const UgxGeometry& geometry2) {
-    UgxGeometry combined;
+    UgxGeometryBuilder builder(geometry1);
+    builder.append(geometry2);
+    return builder.release();
+}
 
-    // Step 1: Copy and insert all points from geometry1
-    combined.points = geometry1.points;
-    combined.radii = geometry1.radii;
-    combined.vertexSubsets = geometry1.vertexSubsets;
-    combined.edges = geometry1.edges;
-    combined.edgeSubsets = geometry1.edgeSubsets;
-    combined.faces = geometry1.faces;
-    combined.faceSubsets = geometry1.faceSubsets;
-    combined.subsetNames = geometry1.subsetNames;  // Start with geometry1's subset names
+UgxGeometryBuilder::UgxGeometryBuilder(UgxGeometry base) : g(std::move(base)) {
+    nextVertex = vertexSpan(g);
+}
 
-    // Determine current max indices
-    int vertexOffset = combined.points.empty() ? 0 : (combined.points.rbegin()->first + 1);
-    int edgeOffset = static_cast<int>(combined.edges.size());
-    int faceOffset = static_cast<int>(combined.faces.size());
+int UgxGeometryBuilder::vertexSpan(const UgxGeometry& part) {
+    return part.points.empty() ? 0 : (part.points.rbegin()->first + 1);
+}
 
-    // Step 2: Insert points from geometry2 with reindexed vertex IDs
-    std::map<int, int> pointRemap;
-    for (const auto& [id, coord] : geometry2.points) {
-        int newId = id + vertexOffset;
-        combined.points[newId] = coord;
-        pointRemap[id] = newId;
-    }
+void UgxGeometryBuilder::reserve(std::size_t edges, std::size_t faces) {
+    g.edges.reserve(g.edges.size() + edges);
+    g.faces.reserve(g.faces.size() + faces);
+}
 
-    // Step 3: Insert radii with new vertex IDs
-    for (const auto& [id, r] : geometry2.radii) {
-        int newId = pointRemap.at(id);
-        combined.radii[newId] = r;
+// points, radii and subsets of one part; keys only grow, so every insert is hinted at the end
+void UgxGeometryBuilder::appendMaps(const UgxGeometry& part, int vertexOffset, int edgeOffset, int faceOffset) {
+    for (const auto& [id, coord] : part.points)
+        g.points.emplace_hint(g.points.end(), id + vertexOffset, coord);
+    for (const auto& [id, r] : part.radii)
+        g.radii.emplace_hint(g.radii.end(), id + vertexOffset, r);
+    for (const auto& [id, subset] : part.vertexSubsets)
+        g.vertexSubsets.emplace_hint(g.vertexSubsets.end(), id + vertexOffset, subset);
+
+    // only subsets of edges/faces that exist in the part are carried over
+    for (const auto& [i, subset] : part.edgeSubsets) {
+        if (i >= 0 && i < static_cast<int>(part.edges.size()))
+            g.edgeSubsets.emplace_hint(g.edgeSubsets.end(), edgeOffset + i, subset);
     }
-
-    // Step 4: Insert vertex subsets
-    for (const auto& [id, subset] : geometry2.vertexSubsets) {
-        int newId = pointRemap.at(id);
-        combined.vertexSubsets[newId] = subset;
+    for (const auto& [i, subset] : part.faceSubsets) {
+        if (i >= 0 && i < static_cast<int>(part.faces.size()))
+            g.faceSubsets.emplace_hint(g.faceSubsets.end(), faceOffset + i, subset);
     }
 
-    // Step 5: Append edges (with reindexed vertices)
-    for (size_t i = 0; i < geometry2.edges.size(); ++i) {
-        auto [from, to] = geometry2.edges[i];
-        combined.edges.emplace_back(pointRemap.at(from), pointRemap.at(to));
+    // if subset IDs collide, keep the name that was merged first
+    for (const auto& [subsetId, name] : part.subsetNames)
+        g.subsetNames.emplace(subsetId, name);
+}
+
+void UgxGeometryBuilder::append(const UgxGeometry& part) {
+    const int vertexOffset = nextVertex;
+    const int edgeOffset = static_cast<int>(g.edges.size());
+    const int faceOffset = static_cast<int>(g.faces.size());
 
-        int newEdgeIndex = edgeOffset + static_cast<int>(i);
-        if (geometry2.edgeSubsets.count(static_cast<int>(i)))
-            combined.edgeSubsets[newEdgeIndex] = geometry2.edgeSubsets.at(static_cast<int>(i));
-    }
+    appendMaps(part, vertexOffset, edgeOffset, faceOffset);
 
-    // Step 6: Append faces (with reindexed vertices)
-    for (size_t i = 0; i < geometry2.faces.size(); ++i) {
-        auto [v0, v1, v2] = geometry2.faces[i];
-        combined.faces.push_back({
-            pointRemap.at(v0),
-            pointRemap.at(v1),
-            pointRemap.at(v2)
-        });
+    g.edges.reserve(g.edges.size() + part.edges.size());
+    for (const auto& [from, to] : part.edges)
+        g.edges.emplace_back(from + vertexOffset, to + vertexOffset);
+    g.faces.reserve(g.faces.size() + part.faces.size());
+    for (const auto& f : part.faces)
+        g.faces.push_back({f[0] + vertexOffset, f[1] + vertexOffset, f[2] + vertexOffset});
 
-        int newFaceIndex = faceOffset + static_cast<int>(i);
-        if (geometry2.faceSubsets.count(static_cast<int>(i)))
-            combined.faceSubsets[newFaceIndex] = geometry2.faceSubsets.at(static_cast<int>(i));
-    }
+    if (!part.points.empty()) nextVertex = vertexOffset + vertexSpan(part);
+}
 
-    // Step 7: Merge subset names (if subset IDs collide, we assume the names are consistent)
-    for (const auto& [subsetId, name] : geometry2.subsetNames) {
-        // If already exists, keep geometry1's label
-        if (combined.subsetNames.count(subsetId) == 0)
-            combined.subsetNames[subsetId] = name;
+void UgxGeometryBuilder::appendAll(const std::vector<UgxGeometry>& parts, std::size_t threads) {
+    // prefix sums of vertex spans, edge counts and face counts
+    std::vector<int> vertexOffset(parts.size()), edgeOffset(parts.size()), faceOffset(parts.size());
+    int v = nextVertex;
+    std::size_t e = g.edges.size(), f = g.faces.size();
+    for (std::size_t k = 0; k < parts.size(); ++k) {
+        vertexOffset[k] = v;
+        edgeOffset[k] = static_cast<int>(e);
+        faceOffset[k] = static_cast<int>(f);
+        if (!parts[k].points.empty()) v += vertexSpan(parts[k]);
+        e += parts[k].edges.size();
+        f += parts[k].faces.size();
     }
 
-    return combined;
+    // edges and faces go into disjoint, pre-sized ranges and can be remapped in parallel
+    g.edges.resize(e);
+    g.faces.resize(f);
+    parallelFor(parts.size(), threads, [&](std::size_t k) {
+        const int off = vertexOffset[k];
+        auto* edgeOut = g.edges.data() + edgeOffset[k];
+        for (const auto& [from, to] : parts[k].edges) *edgeOut++ = {from + off, to + off};
+        auto* faceOut = g.faces.data() + faceOffset[k];
+        for (const auto& face : parts[k].faces) *faceOut++ = {face[0] + off, face[1] + off, face[2] + off};
+    });
+
+    // the ordered maps are filled serially, in one pass with end hints
+    for (std::size_t k = 0; k < parts.size(); ++k)
+        appendMaps(parts[k], vertexOffset[k], edgeOffset[k], faceOffset[k]);
+
+    nextVertex = v;
+}
+
+UgxGeometry UgxGeometryBuilder::release() {
+    UgxGeometry result = std::move(g);
+    g = UgxGeometry();
+    nextVertex = 0;
+    return result;
 }
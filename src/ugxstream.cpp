@@ -0,0 +1,447 @@
+/**
+ * @file ugxstream.cpp
+ * @brief Implementation of the streaming UGX pull parser and writer
+ *
+ * The parser understands the subset of XML that appears in UGX files:
+ * elements, attributes, character data, CDATA sections, the predefined and
+ * numeric entities, comments, processing instructions and DOCTYPE lines.
+ *
+ * The writer mirrors the state machine of tinyxml2's XMLPrinter (depth
+ * tracking, text depth, sealing of just-opened elements and entity
+ * escaping), which is what makes its output byte-identical to
+ * XMLDocument::SaveFile().
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "ugxstream.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+std::atomic<UgxBackend> activeUgxBackend{UgxBackend::DOM};
+}
+
+void setUgxBackend(UgxBackend backend) {
+    activeUgxBackend.store(backend, std::memory_order_relaxed);
+}
+
+UgxBackend getUgxBackend() {
+    return activeUgxBackend.load(std::memory_order_relaxed);
+}
+
+// both backends produce the same bytes, so compressed files need no DOM path
+bool useUgxStreaming(const std::string& filename) {
+    return getUgxBackend() == UgxBackend::Streaming || compressionFromFilename(filename) != Compression::None;
+}
+
+// ============================================================================
+// UgxPullParser
+// ============================================================================
+
+UgxPullParser::UgxPullParser(std::string_view document)
+    : cur(document.data()), end(document.data() + document.size()) {}
+
+UgxPullParser::Event UgxPullParser::fail(const std::string& message) {
+    error = message;
+    cur = end;
+    openElements.clear();
+    return Event::Error;
+}
+
+/**
+ * @brief Appends a code point to a string as UTF-8
+ */
+static void appendUtf8(std::string& out, unsigned long cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+/**
+ * @brief Replaces entity references in raw character data
+ * @param raw Raw text or attribute value
+ * @param out Receives the decoded text
+ * @return true if any entity was decoded
+ *
+ * Unknown entities are copied through unchanged, as tinyxml2 does.
+ */
+bool UgxPullParser::decode(std::string_view raw, std::string& out) {
+    out.clear();
+    out.reserve(raw.size());
+    bool changed = false;
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] != '&') {
+            out += raw[i];
+            continue;
+        }
+        std::size_t semi = raw.find(';', i);
+        if (semi == std::string_view::npos) {
+            out += raw[i];
+            continue;
+        }
+        std::string_view ent = raw.substr(i + 1, semi - i - 1);
+        if      (ent == "lt")   out += '<';
+        else if (ent == "gt")   out += '>';
+        else if (ent == "amp")  out += '&';
+        else if (ent == "quot") out += '"';
+        else if (ent == "apos") out += '\'';
+        else if (ent.size() > 1 && ent[0] == '#') {
+            bool hex = ent[1] == 'x' || ent[1] == 'X';
+            unsigned long cp = 0;
+            const char* first = ent.data() + (hex ? 2 : 1);
+            auto [ptr, ec] = std::from_chars(first, ent.data() + ent.size(), cp, hex ? 16 : 10);
+            if (ec != std::errc() || ptr != ent.data() + ent.size()) {
+                out += raw[i];
+                continue;
+            }
+            appendUtf8(out, cp);
+        } else {
+            out += raw[i];
+            continue;
+        }
+        changed = true;
+        i = semi;
+    }
+    return changed;
+}
+
+/**
+ * @brief Skips a comment, processing instruction or DOCTYPE at the cursor
+ * @return true if markup was skipped, false if the cursor is at another construct
+ */
+bool UgxPullParser::skipMarkup() {
+    std::string_view rest(cur, end - cur);
+    std::string_view terminator;
+    if      (rest.compare(0, 4, "<!--") == 0)    terminator = "-->";
+    else if (rest.compare(0, 9, "<![CDATA[") == 0) return false;
+    else if (rest.compare(0, 2, "<?") == 0)      terminator = "?>";
+    else if (rest.compare(0, 2, "<!") == 0)      terminator = ">";
+    else return false;
+
+    std::size_t pos = rest.find(terminator, 2);
+    cur = (pos == std::string_view::npos) ? end : cur + pos + terminator.size();
+    return true;
+}
+
+bool UgxPullParser::attribute(std::string_view attrName, std::string_view& value) const {
+    for (const auto& [n, v] : attributes) {
+        if (n == attrName) {
+            value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isNameEnd(char c) {
+    return UgxTextScanner::isBlank(c) || c == '/' || c == '>' || c == '=';
+}
+
+UgxPullParser::Event UgxPullParser::next() {
+    decoded.clear();
+    textView = {};
+
+    if (pendingEnd) {
+        pendingEnd = false;
+        elementName = openElements.back();
+        openElements.pop_back();
+        currentDepth = static_cast<int>(openElements.size());
+        return Event::EndElement;
+    }
+
+    while (true) {
+        if (cur >= end) {
+            if (!openElements.empty())
+                return fail("unexpected end of document inside <" + std::string(openElements.back()) + ">");
+            return Event::End;
+        }
+
+        // --- Character data ---
+        if (*cur != '<') {
+            const char* start = cur;
+            const char* lt = static_cast<const char*>(std::memchr(cur, '<', end - cur));
+            cur = lt ? lt : end;
+            std::string_view raw(start, cur - start);
+
+            bool blank = true;
+            for (char c : raw) {
+                if (!UgxTextScanner::isBlank(c)) { blank = false; break; }
+            }
+            if (blank) continue;
+            if (openElements.empty()) return fail("text outside of the document element");
+
+            textView = raw;
+            if (raw.find('&') != std::string_view::npos) {
+                decoded.emplace_back();
+                if (decode(raw, decoded.back())) textView = decoded.back();
+            }
+            currentDepth = static_cast<int>(openElements.size()) - 1;
+            return Event::Text;
+        }
+
+        if (skipMarkup()) continue;
+
+        std::string_view rest(cur, end - cur);
+
+        // --- CDATA section ---
+        if (rest.compare(0, 9, "<![CDATA[") == 0) {
+            std::size_t close = rest.find("]]>", 9);
+            if (close == std::string_view::npos) return fail("unterminated CDATA section");
+            if (openElements.empty()) return fail("CDATA outside of the document element");
+            textView = rest.substr(9, close - 9);
+            cur += close + 3;
+            currentDepth = static_cast<int>(openElements.size()) - 1;
+            return Event::Text;
+        }
+
+        // --- End tag ---
+        if (rest.compare(0, 2, "</") == 0) {
+            const char* p = cur + 2;
+            const char* nameStart = p;
+            while (p < end && !isNameEnd(*p)) ++p;
+            std::string_view tag(nameStart, p - nameStart);
+            while (p < end && UgxTextScanner::isBlank(*p)) ++p;
+            if (p >= end || *p != '>') return fail("malformed end tag");
+            if (openElements.empty() || openElements.back() != tag)
+                return fail("mismatched end tag </" + std::string(tag) + ">");
+            cur = p + 1;
+            elementName = tag;
+            openElements.pop_back();
+            currentDepth = static_cast<int>(openElements.size());
+            return Event::EndElement;
+        }
+
+        // --- Start tag ---
+        const char* p = cur + 1;
+        const char* nameStart = p;
+        while (p < end && !isNameEnd(*p)) ++p;
+        if (p == nameStart) return fail("empty element name");
+        elementName = std::string_view(nameStart, p - nameStart);
+        attributes.clear();
+
+        bool selfClosing = false;
+        while (true) {
+            while (p < end && UgxTextScanner::isBlank(*p)) ++p;
+            if (p >= end) return fail("unterminated start tag <" + std::string(elementName) + ">");
+            if (*p == '>') { ++p; break; }
+            if (*p == '/') {
+                if (p + 1 >= end || p[1] != '>') return fail("malformed empty element tag");
+                selfClosing = true;
+                p += 2;
+                break;
+            }
+
+            const char* attrStart = p;
+            while (p < end && !isNameEnd(*p)) ++p;
+            std::string_view attrName(attrStart, p - attrStart);
+            while (p < end && UgxTextScanner::isBlank(*p)) ++p;
+            if (attrName.empty() || p >= end || *p != '=')
+                return fail("malformed attribute in <" + std::string(elementName) + ">");
+            ++p;
+            while (p < end && UgxTextScanner::isBlank(*p)) ++p;
+            if (p >= end || (*p != '"' && *p != '\''))
+                return fail("unquoted attribute value in <" + std::string(elementName) + ">");
+            const char quote = *p++;
+            const char* valueStart = p;
+            while (p < end && *p != quote) ++p;
+            if (p >= end) return fail("unterminated attribute value");
+            std::string_view value(valueStart, p - valueStart);
+            ++p;
+
+            if (value.find('&') != std::string_view::npos) {
+                decoded.emplace_back();
+                if (decode(value, decoded.back())) value = decoded.back();
+            }
+            attributes.emplace_back(attrName, value);
+        }
+
+        cur = p;
+        currentDepth = static_cast<int>(openElements.size());
+        openElements.push_back(elementName);
+        pendingEnd = selfClosing;
+        return Event::StartElement;
+    }
+}
+
+// ============================================================================
+// UgxStreamWriter
+// ============================================================================
+
+UgxStreamWriter::UgxStreamWriter(std::size_t bufferSize)
+    : buffer(bufferSize > 0 ? bufferSize : 1) {}
+
+UgxStreamWriter::~UgxStreamWriter() {
+    close();
+}
+
+bool UgxStreamWriter::open(const std::string& filename) {
+    close();
+    ok = file.open(filename);
+    stack.clear();
+    depth = 0;
+    textDepth = -1;
+    elementJustOpened = false;
+    firstElement = true;
+    textHasValues = false;
+    return ok;
+}
+
+bool UgxStreamWriter::close() {
+    if (!file.isOpen()) return false;
+    flush();
+    if (!file.close()) ok = false;
+    return ok;
+}
+
+void UgxStreamWriter::flush() {
+    if (used == 0) return;
+    if (file.isOpen() && !file.write(buffer.data(), used)) ok = false;
+    used = 0;
+}
+
+void UgxStreamWriter::write(std::string_view s) {
+    while (!s.empty()) {
+        if (used == buffer.size()) flush();
+        std::size_t n = std::min(s.size(), buffer.size() - used);
+        std::memcpy(buffer.data() + used, s.data(), n);
+        used += n;
+        s.remove_prefix(n);
+    }
+}
+
+/**
+ * @brief Writes text with XML entity escaping
+ * @param s Text to write
+ * @param attributeValue true for attribute values, which also escape quotes
+ *
+ * Text content escapes only '&', '<' and '>', exactly like XMLPrinter.
+ */
+void UgxStreamWriter::writeEscaped(std::string_view s, bool attributeValue) {
+    for (char c : s) {
+        switch (c) {
+            case '&': write("&amp;"); break;
+            case '<': write("&lt;"); break;
+            case '>': write("&gt;"); break;
+            case '"':  if (attributeValue) write("&quot;"); else put(c); break;
+            case '\'': if (attributeValue) write("&apos;"); else put(c); break;
+            default: put(c); break;
+        }
+    }
+}
+
+void UgxStreamWriter::space(int d) {
+    for (int i = 0; i < d; ++i) write("    ");
+}
+
+void UgxStreamWriter::sealElement() {
+    if (elementJustOpened) {
+        elementJustOpened = false;
+        put('>');
+    }
+}
+
+void UgxStreamWriter::declaration(std::string_view text) {
+    sealElement();
+    if (textDepth < 0 && !firstElement) {
+        put('\n');
+        space(depth);
+    }
+    firstElement = false;
+    write("<?");
+    write(text);
+    write("?>");
+}
+
+void UgxStreamWriter::openElement(std::string_view name) {
+    sealElement();
+    stack.emplace_back(name);
+    if (textDepth < 0 && !firstElement) {
+        put('\n');
+        space(depth);
+    }
+    put('<');
+    write(name);
+    elementJustOpened = true;
+    firstElement = false;
+    textHasValues = false;
+    ++depth;
+}
+
+void UgxStreamWriter::attribute(std::string_view name, std::string_view value) {
+    put(' ');
+    write(name);
+    write("=\"");
+    writeEscaped(value, true);
+    put('"');
+}
+
+void UgxStreamWriter::beginText() {
+    textDepth = depth - 1;
+    sealElement();
+    textHasValues = false;
+}
+
+void UgxStreamWriter::text(std::string_view value) {
+    beginText();
+    writeEscaped(value, false);
+}
+
+void UgxStreamWriter::separator() {
+    if (textHasValues) put(' ');
+    textHasValues = true;
+}
+
+void UgxStreamWriter::token(std::string_view value) {
+    separator();
+    writeEscaped(value, false);
+}
+
+void UgxStreamWriter::number(long long value) {
+    char tmp[24];
+    auto [ptr, ec] = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    separator();
+    write(std::string_view(tmp, ptr - tmp));
+}
+
+void UgxStreamWriter::number(double value) {
+    char tmp[32];
+    auto [ptr, ec] = std::to_chars(tmp, tmp + sizeof(tmp), value, std::chars_format::general, 6);
+    separator();
+    write(std::string_view(tmp, ptr - tmp));
+}
+
+void UgxStreamWriter::closeElement() {
+    --depth;
+    if (elementJustOpened) {
+        write("/>");
+    } else {
+        if (textDepth < 0) {
+            put('\n');
+            space(depth);
+        }
+        write("</");
+        write(stack.back());
+        put('>');
+    }
+    stack.pop_back();
+    if (textDepth == depth) textDepth = -1;
+    if (depth == 0) put('\n');
+    elementJustOpened = false;
+}
@@ -25,6 +25,7 @@
 #include "utils.h"
 #include <filesystem>
 #include <iostream>
+#include "instrumentation.h"
 
 namespace fs = std::filesystem;
 
@@ -60,10 +61,10 @@ std::string getExecutableDir() {
  */
 void checkFolder(std::string& folderPath) {
     if (fs::exists(folderPath)) {
-        std::cout << "Folder already exists: " << folderPath << std::endl;
+        NM_LOG(Info) << "Folder already exists: " << folderPath << std::endl;
     } else {
         if (fs::create_directory(folderPath)) {
-            std::cout << "Folder created: " << folderPath << std::endl;
+            NM_LOG(Info) << "Folder created: " << folderPath << std::endl;
         } else {
             std::cerr << "Failed to create folder: " << folderPath << std::endl;
         }
@@ -90,7 +91,7 @@ void deleteFolder(const std::string& path) {
     if (ec) {
         std::cerr << "Failed to delete directory: " << ec.message() << std::endl;
     } else {
-        std::cout << "Directory '" << path <<  "' deleted successfully.\n";
+        NM_LOG(Info) << "Directory '" << path <<  "' deleted successfully.\n";
     }
 }
 
@@ -26,6 +26,8 @@
 
 #include "globals.h"
 #include "callbacks.h"
+#include "draw_utils.h"  // For uploadSWC()
+#include "refinement_service.h"  // For RefinementService
 
 /**
  * @brief Handles keyboard input events for the neuron viewer
@@ -45,8 +47,9 @@
  * - H: Show/hide help window
  * - S: Save the current neuron data to file
  *
- * The function modifies global state for view parameters and triggers updates
- * to the neuron visualization when geometry is refined or coarsened.
+ * The function modifies global state for view parameters. Refinement and
+ * coarsening only queue a request on the refinement worker, so the event
+ * thread never blocks; pollRefinement() swaps the result in when it is ready.
  *
  * @note The function only processes key press events (GLFW_PRESS)
  * @note Modifier keys (Ctrl, Shift, Alt) are checked using the mods parameter
@@ -55,22 +58,6 @@
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (action == GLFW_PRESS) {
         if (key == GLFW_KEY_F) {
-            auto sharedData = static_cast<std::tuple<
-                std::vector<SWCNode>*,
-                double*, double*, double*, double*, double*, double*,
-                double*, double*, double*, double*>*>(glfwGetWindowUserPointer(window));
-
-            auto& nodes = *std::get<0>(*sharedData);
-
-            std::map<int, SWCNode> originalNodeMap;
-            for (const auto& n : nodes)
-                originalNodeMap[n.id] = n;
-
-            //NeuronGraph graph;
-            graph.setNodes(originalNodeMap);
-
-            auto trunks = graph.getTrunks(false);
-
             if (mods & GLFW_MOD_CONTROL) {
                 // Ctrl+F → double delta
                 refineDelta = std::min(refineDelta * 2.0, 64.0);
@@ -81,23 +68,8 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
                 std::cout << "[Refinement] Refining with delta = " << refineDelta << "\n";
             }
 
-            auto refined = graph.allCubicSplineResampledTrunks(trunks, refineDelta);
-            auto trunkParentMap = graph.getTrunkParentMap(originalNodeMap, trunks);
-            auto assembled = graph.assembleTrunks(refined, trunkParentMap);
-
-            nodes.clear();
-            for (const auto& [_, n] : assembled)
-                nodes.push_back(n);
-            currentNodes = nodes;
-            computeBounds(nodes,
-                          *std::get<1>(*sharedData), *std::get<2>(*sharedData),
-                          *std::get<3>(*sharedData), *std::get<4>(*sharedData),
-                          *std::get<5>(*sharedData), *std::get<6>(*sharedData),
-                          *std::get<7>(*sharedData), *std::get<8>(*sharedData),
-                          *std::get<9>(*sharedData), *std::get<10>(*sharedData));
-
-            std::cout << "[Done] Geometry updated. Current delta: " << refineDelta << "\n";
-            graph.setNodes(assembled);
+            // Runs on the refinement worker; the render loop swaps the result in
+            refinementService.request(refineDelta);
         }
 
         if (key >= GLFW_KEY_1 && key <= GLFW_KEY_6) {
@@ -262,3 +234,42 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
     zoom *= std::pow(1.1f, yoffset);
     zoom = std::clamp(static_cast<float>(zoom), 0.05f, 10.0f);
 }
+
+/**
+ * @brief Swaps finished refinement geometry into the viewer
+ * @param[in] window The main GLFW window (its user pointer holds the node and bounds data)
+ *
+ * Called once per frame from the render loop, on the thread owning the GL
+ * context. When the refinement worker has finished the latest request, the
+ * displayed nodes, bounds, GPU buffers and global graph are replaced in one
+ * step between two frames.
+ *
+ * @see RefinementService::poll()
+ */
+void pollRefinement(GLFWwindow* window) {
+    auto sharedData = static_cast<std::tuple<
+        std::vector<SWCNode>*,
+        double*, double*, double*, double*, double*, double*,
+        double*, double*, double*, double*>*>(glfwGetWindowUserPointer(window));
+    if (!sharedData) return;
+
+    auto& nodes = *std::get<0>(*sharedData);
+    double delta = refineDelta;
+    if (!refinementService.poll(nodes, delta)) return;
+
+    currentNodes = nodes;
+    uploadSWC(nodes);
+    computeBounds(nodes,
+                  *std::get<1>(*sharedData), *std::get<2>(*sharedData),
+                  *std::get<3>(*sharedData), *std::get<4>(*sharedData),
+                  *std::get<5>(*sharedData), *std::get<6>(*sharedData),
+                  *std::get<7>(*sharedData), *std::get<8>(*sharedData),
+                  *std::get<9>(*sharedData), *std::get<10>(*sharedData));
+
+    std::map<int, SWCNode> nodeMap;
+    for (const auto& n : nodes)
+        nodeMap[n.id] = n;
+    graph.setNodes(nodeMap);
+
+    std::cout << "[Done] Geometry updated. Current delta: " << delta << "\n";
+}
@@ -13,8 +13,13 @@
  * - Multiple rendering modes (wireframe, solid, etc.)
  * - Support for different levels of detail
  *
- * The implementation uses legacy OpenGL immediate mode (glBegin/glEnd) for simplicity
- * and compatibility with the existing visualization pipeline.
+ * The primitives use legacy OpenGL (glBegin/glEnd and GLU quadrics) for simplicity
+ * and compatibility with the existing visualization pipeline. renderSWC() does not
+ * issue them every frame: uploadSWC() computes the parent index
+ * once and splits the neuron into trunk chunks. Each frame culls the chunks against
+ * the view frustum, picks a level of detail for each visible chunk from its
+ * projected size, and replays that chunk's display list for the current render
+ * mode and level (compiled the first time it is needed).
  *
  * @author CPPNeuronMesher Team
  * @date 2025-07-27
@@ -24,9 +29,116 @@
  */
 
  #include <array>
+ #include <unordered_map>
  #include "neurongraph.h"  // For SWCNode definition
  #include "globals.h"      // For renderMode and other globals
  #include "draw_utils.h"
+ #include "scene_culling.h" // For render chunks, the chunk BVH and LOD selection
+
+ namespace {
+
+ /// One quadric shared by all GLU primitives instead of one per primitive
+ GLUquadric* sharedQuadric() {
+     static GLUquadric* quad = [] {
+         GLUquadric* q = gluNewQuadric();
+         gluQuadricNormals(q, GLU_SMOOTH);
+         return q;
+     }();
+     return quad;
+ }
+
+ /// Retained rendering state of the uploaded morphology
+ struct SWCRenderCache {
+     bool uploaded = false;
+     std::size_t nodeCount = 0;
+     std::vector<int> parentIndex;        ///< Index of each node's parent in the node vector, -1 if none
+     std::vector<RenderChunk> chunks;     ///< Trunk chunks culled and drawn independently
+     ChunkBVH bvh;                        ///< Hierarchy over the chunk bounds
+     std::vector<std::array<std::array<GLuint, LOD_COUNT>, 7>> chunkLists;  ///< [chunk][mode][lod] display list (0 = not built)
+     std::vector<int> visible;            ///< Chunks that passed the frustum test this frame
+     GLuint simpleSphere = 0;             ///< Unit sphere, 8x8 (instanced by drawSimpleSphere())
+     GLuint detailedSphere = 0;           ///< Unit sphere, 6x6 (instanced by drawSphere())
+     GLuint coarseSphere = 0;             ///< Unit sphere, 4x4 (coarse level of detail)
+ };
+
+ SWCRenderCache cache;
+
+ /// Unit sphere compiled once per context; instances are translated and scaled copies
+ GLuint unitSphere(GLuint& list, int slices, int stacks) {
+     if (list == 0) {
+         list = glGenLists(1);
+         if (list == 0) return 0;
+         glNewList(list, GL_COMPILE);
+         gluSphere(sharedQuadric(), 1.0, slices, stacks);
+         glEndList();
+     }
+     return list;
+ }
+
+ void drawSphereInstance(const SWCNode& node, double radius, GLuint& list, int slices, int stacks) {
+     glPushMatrix();
+     glTranslatef(node.x, node.y, node.z);
+     GLuint sphere = unitSphere(list, slices, stacks);
+     if (sphere != 0) {
+         glScalef(radius, radius, radius);
+         glCallList(sphere);
+     } else {
+         gluSphere(sharedQuadric(), radius, slices, stacks);
+     }
+     glPopMatrix();
+ }
+
+ /// Issues the primitives of one chunk in one render mode (compiled into that chunk's display list)
+ void drawChunk(int mode, ChunkLOD lod, const std::vector<SWCNode>& nodes, const RenderChunk& chunk) {
+     const bool spheres = (mode >= 2 && mode <= 4) || mode == 6;
+     const bool lines = mode == 1 || mode == 2 || ((mode == 5 || mode == 6) && lod == LOD_LINES);
+
+     if (spheres && lod == LOD_LINES && mode != 2 && mode != 6) {
+         // Sphere-only modes collapse to points
+         glBegin(GL_POINTS);
+         for (int i : chunk.nodes) {
+             if (mode == 3) glColor3f(1, 0.8f, 0);
+             else glColor3f(0.6f, 0.4f, 1.0f);
+             glVertex3f(nodes[i].x, nodes[i].y, nodes[i].z);
+         }
+         glEnd();
+     } else if (spheres && lod != LOD_LINES) {
+         for (int i : chunk.nodes) {
+             const SWCNode& node = nodes[i];
+             if (mode == 3) {
+                 glColor3f(1, 0.8f, 0);
+                 if (lod == LOD_FULL) drawSimpleSphere(node);
+                 else drawSphereInstance(node, 0.5, cache.coarseSphere, 4, 4);
+                 continue;
+             }
+             if (mode == 4) glColor3f(0.6f, 0.4f, 1.0f);
+             else setColorByType(node.type);
+             if (lod == LOD_FULL) drawSphere(node);
+             else drawSphereInstance(node, node.radius, cache.coarseSphere, 4, 4);
+         }
+     }
+
+     if (lines) {
+         glBegin(GL_LINES);
+         for (int i : chunk.nodes) {
+             if (cache.parentIndex[i] < 0) continue;
+             const SWCNode& p = nodes[cache.parentIndex[i]];
+             if (mode == 1 || mode == 2) glColor3f(1, 1, 1);
+             else setColorByType(nodes[i].type);
+             glVertex3f(p.x, p.y, p.z);
+             glVertex3f(nodes[i].x, nodes[i].y, nodes[i].z);
+         }
+         glEnd();
+     } else if (mode == 5 || mode == 6) {
+         for (int i : chunk.nodes) {
+             if (cache.parentIndex[i] < 0) continue;
+             setColorByType(nodes[i].type);
+             drawCylinder(nodes[cache.parentIndex[i]], nodes[i], lod == LOD_FULL ? 6 : 3);
+         }
+     }
+ }
+
+ } // namespace
  
  /**
   * @brief Renders a low-detail sphere at the specified node's position
@@ -47,14 +159,9 @@
   * @see gluSphere() for details on the underlying GLU primitive
   */
  void drawSimpleSphere(const SWCNode& node, double size) {
-     glPushMatrix();
-     glTranslatef(node.x, node.y, node.z);
-     GLUquadric* quad = gluNewQuadric();
      // Apply a scaling factor for soma nodes (type 1)
      //double radius = (node.type == 1) ? size * 0.3 : size;
-     gluSphere(quad, size, 8, 8);
-     gluDeleteQuadric(quad);
-     glPopMatrix();
+     drawSphereInstance(node, size, cache.simpleSphere, 8, 8);
  }
  
  /**
@@ -102,14 +209,15 @@
   * @see gluQuadricNormals() for details on normal generation
   */
  void drawSphere(const SWCNode& node, int slices, int stacks) {
-     glPushMatrix();
-     glTranslatef(node.x, node.y, node.z);
-     GLUquadric* quad = gluNewQuadric();
-     gluQuadricNormals(quad, GLU_SMOOTH);
      // Apply a scaling factor for soma nodes (type 1)
      //double radius = (node.type == 1) ? node.radius * 0.3 : node.radius;
-     gluSphere(quad, node.radius, slices, stacks);
-     gluDeleteQuadric(quad);
+     if (slices == 6 && stacks == 6) {
+         drawSphereInstance(node, node.radius, cache.detailedSphere, slices, stacks);
+         return;
+     }
+     glPushMatrix();
+     glTranslatef(node.x, node.y, node.z);
+     gluSphere(sharedQuadric(), node.radius, slices, stacks);
      glPopMatrix();
  }
  
@@ -147,10 +255,7 @@
      glTranslatef(a.x, a.y, a.z);
      glRotatef(ax, rx, ry, 0.0f);
  
-     GLUquadric* quad = gluNewQuadric();
-     gluQuadricNormals(quad, GLU_SMOOTH);
-     gluCylinder(quad, a.radius, b.radius, len, segments, 1);
-     gluDeleteQuadric(quad);
+     gluCylinder(sharedQuadric(), a.radius, b.radius, len, segments, 1);
  
      glPopMatrix();
  }
@@ -253,37 +358,91 @@
   * then renders the connections between nodes. Node colors are determined by
   * their SWC type using the setColorByType() function.
   *
+  * Only chunks inside the view frustum are drawn. Chunks whose nodes project
+  * to a few pixels use coarser spheres and cylinders, and sub-pixel chunks
+  * are drawn as lines (points in the sphere-only modes 3 and 4). Each chunk,
+  * mode and level is compiled into a display list on first use; the lists are
+  * rebuilt after uploadSWC() (called automatically if the node count changed).
+  *
   * @note The function uses the global `renderMode` variable to determine rendering style
-  * @note Parent-child relationships are determined by the node.pid field
+  * @note Parent-child relationships are determined by the node.pid field,
+  *       resolved once per upload into a parent index
   * @note The function skips rendering of invalid parent references (pid = -1)
   * @see setColorByType() for information about color mapping
   * @see drawSphere(), drawCylinder() for the actual rendering primitives
   */
  void renderSWC(const std::vector<SWCNode>& nodes) {
-     for (const auto& node : nodes) {
-         if (renderMode == 3) {
-             glColor3f(1, 0.8f, 0);
-             drawSimpleSphere(node);
-         } else if (renderMode == 4) {
-             glColor3f(0.6f, 0.4f, 1.0f);
-             drawSphere(node);
-         } else if (renderMode == 2 || renderMode == 6) {
-             setColorByType(node.type);
-             drawSphere(node);
-         }
-     }
-     for (const auto& node : nodes) {
-         if (node.pid == -1) continue;
-         auto it = std::find_if(nodes.begin(), nodes.end(), [&](const SWCNode& n) { return n.id == node.pid; });
-         if (it != nodes.end()) {
-             if (renderMode == 1 || renderMode == 2) {
-                 glColor3f(1, 1, 1);
-                 drawSimpleLine(*it, node);
-             } else if (renderMode == 5 || renderMode == 6) {
-                 setColorByType(node.type);
-                 drawCylinder(*it, node);
+     if (!cache.uploaded || cache.nodeCount != nodes.size())
+         uploadSWC(nodes);
+     if (renderMode < 1 || renderMode > 6) return;
+
+     GLdouble modelview[16], projection[16];
+     GLint viewport[4];
+     glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+     glGetDoublev(GL_PROJECTION_MATRIX, projection);
+     glGetIntegerv(GL_VIEWPORT, viewport);
+
+     cache.bvh.query(Frustum::fromMatrices(modelview, projection), cache.visible);
+
+     // The instanced unit spheres must exist before a chunk list is being compiled
+     unitSphere(cache.simpleSphere, 8, 8);
+     unitSphere(cache.detailedSphere, 6, 6);
+     unitSphere(cache.coarseSphere, 4, 4);
+
+     for (int c : cache.visible) {
+         const RenderChunk& chunk = cache.chunks[c];
+         // Line mode has a single level of detail
+         ChunkLOD lod = renderMode == 1 ? LOD_FULL : selectLOD(chunk, modelview, projection, viewport[3]);
+
+         GLuint& list = cache.chunkLists[c][renderMode][lod];
+         if (list == 0) {
+             list = glGenLists(1);
+             if (list == 0) {
+                 // No display list available: fall back to drawing directly
+                 drawChunk(renderMode, lod, nodes, chunk);
+                 continue;
              }
+             glNewList(list, GL_COMPILE);
+             drawChunk(renderMode, lod, nodes, chunk);
+             glEndList();
          }
+         glCallList(list);
      }
  }
- 
\ No newline at end of file
+
+ /**
+  * @brief Prepares a morphology for retained-mode rendering
+  * @param[in] nodes The nodes that subsequent renderSWC() calls will draw
+  *
+  * Builds the parent index (one hash lookup per node instead of a linear
+  * search per node per frame), splits the neuron into trunk chunks with a
+  * bounding volume hierarchy for culling, and releases the display lists
+  * compiled for the previous morphology. Must be called with the rendering
+  * context current whenever the node vector is replaced, e.g. after loading
+  * or refining a neuron.
+  */
+ void uploadSWC(const std::vector<SWCNode>& nodes) {
+     for (auto& modes : cache.chunkLists)
+         for (auto& lods : modes)
+             for (auto& list : lods)
+                 if (list != 0) glDeleteLists(list, 1);
+
+     std::unordered_map<int, int> indexOfId;
+     indexOfId.reserve(nodes.size());
+     for (std::size_t i = 0; i < nodes.size(); ++i)
+         indexOfId.emplace(nodes[i].id, static_cast<int>(i));
+
+     cache.parentIndex.assign(nodes.size(), -1);
+     for (std::size_t i = 0; i < nodes.size(); ++i) {
+         if (nodes[i].pid == -1) continue;
+         auto it = indexOfId.find(nodes[i].pid);
+         if (it != indexOfId.end()) cache.parentIndex[i] = it->second;
+     }
+
+     cache.chunks = buildRenderChunks(nodes, cache.parentIndex);
+     cache.bvh.build(cache.chunks);
+     cache.chunkLists.assign(cache.chunks.size(), {});
+
+     cache.nodeCount = nodes.size();
+     cache.uploaded = true;
+ }
@@ -25,6 +25,7 @@
 
 #include <string>
 #include "neurongraph.h"  // For NeuronGraph definition
+#include "refinement_service.h"  // For RefinementService definition
 #include "globals.h"
 
 /** @brief Current rendering mode (1-6) that determines how the neuron is displayed */
@@ -117,3 +118,13 @@ GLFWwindow* helpWindow = nullptr;
  * @see NeuronGraph class for available operations
  */
 NeuronGraph graph;
+
+/**
+ * @brief Global refinement worker
+ *
+ * Refines the loaded neuron off the event thread; the render loop swaps
+ * finished geometry in with RefinementService::poll().
+ *
+ * @see keyCallback() for the requests
+ */
+RefinementService refinementService;
@@ -26,6 +26,8 @@
 
 #include "opgl_utils.h"
 #include "globals.h"
+#include "draw_utils.h"  // For uploadSWC()
+#include "refinement_service.h"  // For RefinementService::setSource()
 
 /** @brief Path to the currently loaded neuron file */
 std::string currentLoadedFile = ".";
@@ -183,6 +185,8 @@ void openNeuronFile(std::vector<SWCNode>& nodes,
     // Load and assign directly
     nodes = loadSWC(filename);
     currentNodes = nodes; 
+    uploadSWC(nodes);
+    refinementService.setSource(nodes);
 
     std::cout << "[Loaded] " << filename << " with " << nodes.size() << " nodes.\n";
 
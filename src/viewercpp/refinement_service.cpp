@@ -0,0 +1,128 @@
+/**
+ * @file refinement_service.cpp
+ * @brief Implementation of the viewer's background refinement worker
+ *
+ * The worker owns the RefinementHierarchy of the current source, so the trunk
+ * decomposition and spline fits are done once per loaded neuron and each
+ * request only costs the resampling and reassembly. A level is cancelled
+ * between trunks as soon as a newer request or neuron arrives. Results are published
+ * under the mutex as shared, immutable node vectors; the render thread
+ * copies one out in poll() and never sees a partially built level.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include <iostream>
+#include "neurongraph.h"         // For NeuronGraph and SWCNode
+#include "refinement.h"          // For RefinementHierarchy
+#include "threadpool.h"          // For ThreadPool::defaultThreadCount()
+#include "refinement_service.h"
+
+RefinementService::~RefinementService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void RefinementService::setSource(const std::vector<SWCNode>& nodes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    source = std::make_shared<const std::vector<SWCNode>>(nodes);
+    ++sourceVersion;
+    cache.clear();
+    ready.reset();
+    hasRequest = false;
+}
+
+void RefinementService::request(double delta) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++requestId;
+        requestedDelta = delta;
+
+        auto it = cache.find(delta);
+        if (it != cache.end()) {
+            ready = it->second;
+            readyDelta = delta;
+            hasRequest = false;
+            return;
+        }
+
+        ready.reset();
+        hasRequest = true;
+        if (!worker.joinable()) worker = std::thread(&RefinementService::workerLoop, this);
+    }
+    wake.notify_one();
+}
+
+bool RefinementService::poll(std::vector<SWCNode>& nodes, double& delta) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ready) return false;
+    nodes = *ready;
+    delta = readyDelta;
+    ready.reset();
+    return true;
+}
+
+void RefinementService::workerLoop() {
+    // leave one core to the render thread
+    const std::size_t cores = ThreadPool::defaultThreadCount();
+    const std::size_t threads = cores > 1 ? cores - 1 : 1;
+
+    std::unique_ptr<RefinementHierarchy> hierarchy;
+    std::uint64_t hierarchyVersion = 0;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || hasRequest; });
+        if (stopping) return;
+
+        hasRequest = false;
+        const double delta = requestedDelta;
+        const std::uint64_t id = requestId;
+        const std::uint64_t version = sourceVersion;
+        auto nodes = source;
+        lock.unlock();
+
+        if (!nodes) continue;
+
+        if (!hierarchy || hierarchyVersion != version) {
+            std::map<int, SWCNode> nodeMap;
+            for (const auto& n : *nodes) nodeMap[n.id] = n;
+            NeuronGraph graph(nodeMap);
+            hierarchy = std::make_unique<RefinementHierarchy>(graph, nodeMap, "cubic", threads);
+            hierarchyVersion = version;
+
+            // a newer request or neuron arrived while preparing: serve that one instead
+            lock.lock();
+            bool superseded = id != requestId || version != sourceVersion;
+            lock.unlock();
+            if (superseded) continue;
+        }
+
+        // a newer request or neuron cancels this level between trunks
+        auto assembled = hierarchy->level(delta, [&] { return id != requestId || version != sourceVersion; });
+        if (!assembled) {
+            std::cout << "[Refinement] Level for delta = " << delta << " cancelled by a newer request\n";
+            continue;
+        }
+        auto level = std::make_shared<std::vector<SWCNode>>();
+        level->reserve(assembled->size());
+        for (const auto& [_, n] : *assembled) level->push_back(n);
+
+        lock.lock();
+        if (version != sourceVersion) continue;  // the neuron was replaced meanwhile
+        cache[delta] = level;
+        if (id == requestId) {
+            ready = level;
+            readyDelta = delta;
+        } else {
+            std::cout << "[Refinement] Result for delta = " << delta << " cached; a newer request is pending\n";
+        }
+    }
+}
@@ -0,0 +1,207 @@
+/**
+ * @file scene_culling.cpp
+ * @brief Implementation of render chunks, the chunk BVH and level-of-detail selection
+ *
+ * Chunks follow the trunks of the neuron so that a chunk is a spatially
+ * compact piece of neurite; the BVH lets a frame skip whole subtrees of
+ * off-screen chunks with one box test.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include "neurongraph.h"     // For NeuronGraph and SWCNode
+#include "scene_culling.h"
+
+namespace {
+
+/// Projected node radius (pixels) from which chunks are drawn at full detail
+constexpr double kFullDetailPixels = 4.0;
+
+/// Projected node radius (pixels) below which chunks are drawn as lines
+constexpr double kLineDetailPixels = 1.0;
+
+void extend(RenderChunk& chunk, const SWCNode& n) {
+    const double p[3] = {n.x, n.y, n.z};
+    for (int k = 0; k < 3; ++k) {
+        chunk.min[k] = std::min(chunk.min[k], p[k] - n.radius);
+        chunk.max[k] = std::max(chunk.max[k], p[k] + n.radius);
+    }
+}
+
+void appendChunks(std::vector<RenderChunk>& chunks, const std::vector<int>& indices) {
+    for (std::size_t first = 0; first < indices.size(); first += kMaxChunkNodes) {
+        RenderChunk chunk;
+        std::size_t last = std::min(indices.size(), first + kMaxChunkNodes);
+        chunk.nodes.assign(indices.begin() + first, indices.begin() + last);
+        chunks.push_back(std::move(chunk));
+    }
+}
+
+} // namespace
+
+Frustum Frustum::fromMatrices(const double* modelview, const double* projection) {
+    // clip = projection * modelview, column-major
+    double clip[16];
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r) {
+            double sum = 0.0;
+            for (int k = 0; k < 4; ++k) sum += projection[k * 4 + r] * modelview[c * 4 + k];
+            clip[c * 4 + r] = sum;
+        }
+
+    auto row = [&](int r, int c) { return clip[c * 4 + r]; };
+    Frustum f;
+    for (int i = 0; i < 3; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            f.planes[2 * i][c]     = row(3, c) + row(i, c);
+            f.planes[2 * i + 1][c] = row(3, c) - row(i, c);
+        }
+    }
+    return f;
+}
+
+bool Frustum::intersects(const std::array<double, 3>& min, const std::array<double, 3>& max) const {
+    for (const auto& p : planes) {
+        // corner of the box furthest along the plane normal
+        double d = p[3];
+        for (int k = 0; k < 3; ++k) d += p[k] * (p[k] >= 0.0 ? max[k] : min[k]);
+        if (d < 0.0) return false;
+    }
+    return true;
+}
+
+std::vector<RenderChunk> buildRenderChunks(const std::vector<SWCNode>& nodes, const std::vector<int>& parentIndex) {
+    std::map<int, SWCNode> nodeMap;
+    std::unordered_map<int, int> indexOfId;
+    indexOfId.reserve(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        nodeMap.emplace(nodes[i].id, nodes[i]);
+        indexOfId.emplace(nodes[i].id, static_cast<int>(i));
+    }
+
+    NeuronGraph tools(nodeMap);
+    auto trunks = tools.getTrunks(false);
+
+    std::vector<RenderChunk> chunks;
+    std::vector<char> assigned(nodes.size(), 0);
+    std::vector<int> indices;
+    for (const auto& [_, trunk] : trunks) {
+        indices.clear();
+        for (const auto& [id, node] : trunk) {
+            auto it = indexOfId.find(id);
+            if (it == indexOfId.end() || assigned[it->second]) continue;
+            assigned[it->second] = 1;
+            indices.push_back(it->second);
+        }
+        appendChunks(chunks, indices);
+    }
+
+    // Nodes outside every trunk (e.g. an unbranched neuron) are chunked in order
+    indices.clear();
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+        if (!assigned[i]) indices.push_back(static_cast<int>(i));
+    appendChunks(chunks, indices);
+
+    const double inf = std::numeric_limits<double>::infinity();
+    for (auto& chunk : chunks) {
+        chunk.min = {inf, inf, inf};
+        chunk.max = {-inf, -inf, -inf};
+        for (int i : chunk.nodes) {
+            extend(chunk, nodes[i]);
+            if (parentIndex[i] >= 0) extend(chunk, nodes[parentIndex[i]]);
+            chunk.maxRadius = std::max(chunk.maxRadius, nodes[i].radius);
+        }
+    }
+    return chunks;
+}
+
+void ChunkBVH::build(const std::vector<RenderChunk>& chunks) {
+    tree.clear();
+    order.resize(chunks.size());
+    for (std::size_t i = 0; i < chunks.size(); ++i) order[i] = static_cast<int>(i);
+    if (!chunks.empty()) {
+        tree.reserve(2 * chunks.size());
+        buildRange(chunks, 0, static_cast<int>(chunks.size()));
+    }
+}
+
+int ChunkBVH::buildRange(const std::vector<RenderChunk>& chunks, int first, int count) {
+    const double inf = std::numeric_limits<double>::infinity();
+    Node node;
+    node.min = {inf, inf, inf};
+    node.max = {-inf, -inf, -inf};
+    for (int i = first; i < first + count; ++i) {
+        const auto& c = chunks[order[i]];
+        for (int k = 0; k < 3; ++k) {
+            node.min[k] = std::min(node.min[k], c.min[k]);
+            node.max[k] = std::max(node.max[k], c.max[k]);
+        }
+    }
+
+    int self = static_cast<int>(tree.size());
+    tree.push_back(node);
+    if (count <= 4) {
+        tree[self].first = first;
+        tree[self].count = count;
+        return self;
+    }
+
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+        if (node.max[k] - node.min[k] > node.max[axis] - node.min[axis]) axis = k;
+
+    auto center = [&](int c) { return chunks[c].min[axis] + chunks[c].max[axis]; };
+    int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                     [&](int a, int b) { return center(a) < center(b); });
+
+    int left = buildRange(chunks, first, half);
+    int right = buildRange(chunks, first + half, count - half);
+    tree[self].left = left;
+    tree[self].right = right;
+    return self;
+}
+
+void ChunkBVH::query(const Frustum& frustum, std::vector<int>& visible) const {
+    visible.clear();
+    if (tree.empty()) return;
+
+    std::vector<int> stack = {0};
+    while (!stack.empty()) {
+        const Node& node = tree[stack.back()];
+        stack.pop_back();
+        if (!frustum.intersects(node.min, node.max)) continue;
+        if (node.left < 0) {
+            visible.insert(visible.end(), order.begin() + node.first, order.begin() + node.first + node.count);
+        } else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+ChunkLOD selectLOD(const RenderChunk& chunk, const double* modelview, const double* projection, int viewportHeight) {
+    double c[3], half = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        c[k] = 0.5 * (chunk.min[k] + chunk.max[k]);
+        half += 0.25 * (chunk.max[k] - chunk.min[k]) * (chunk.max[k] - chunk.min[k]);
+    }
+
+    // Eye-space depth of the part of the chunk closest to the camera
+    double zEye = modelview[2] * c[0] + modelview[6] * c[1] + modelview[10] * c[2] + modelview[14];
+    double distance = -zEye - std::sqrt(half);
+    if (distance <= 0.0) return LOD_FULL;
+
+    // projection[5] = cot(fov / 2) for a gluPerspective projection
+    double pixels = chunk.maxRadius * projection[5] * 0.5 * viewportHeight / distance;
+    if (pixels >= kFullDetailPixels) return LOD_FULL;
+    if (pixels >= kLineDetailPixels) return LOD_COARSE;
+    return LOD_LINES;
+}
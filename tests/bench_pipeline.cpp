@@ -0,0 +1,454 @@
+/**
+ * @file bench_pipeline.cpp
+ * @brief Performance suite for every stage of the meshing pipeline
+ *
+ * Micro benchmarks time single stages (SWC/UGX read, preprocess, getTrunks,
+ * spline resampling, assembleTrunks, pftFromPath, addUGXGeometry, UGX write)
+ * and a macro benchmark times the whole read-to-mesh pipeline. Stages run on
+ * the bundled data sets and on synthetic neurons of 1k to 1M nodes.
+ *
+ * Each benchmark is repeated until it has run for a minimum time; the mean
+ * wall time per iteration, the throughput and the peak resident set size are
+ * reported in the JSON layout of Google Benchmark, so its compare tools can
+ * read the files. On Linux the peak is reset before every benchmark (through
+ * /proc/self/clear_refs), so it covers that benchmark and its setup only;
+ * elsewhere it is the cumulative peak of the process, and the JSON context
+ * says which. A stored baseline can be compared against directly:
+ *
+ * @code
+ * ./benchmarks --json=results.json --baseline=../tests/bench_baseline.json --tolerance=0.15
+ * ./benchmarks --filter=getTrunks --max-nodes=100000
+ * @endcode
+ *
+ * Topology and resampling stages sweep up to --max-nodes (1M); the mesh
+ * stages stop at --max-mesh-nodes (100k) by default.
+ *
+ * The exit code is 1 if any benchmark is slower than its baseline by more
+ * than the tolerance, and 2 if --baseline names a file that does not exist.
+ * Timings only compare on the machine that recorded them, so the repository
+ * ships no baseline; record one with `make bench_baseline` first.
+ *
+ * @author CPPNeuronMesher Team
+ * @date 2026-10-14
+ * @version 1.0
+ * @copyright MIT License
+ */
+
+#include "project/neurongraph.h"
+#include "project/synthetic.h"
+#include "project/ugxobject.h"
+#include "project/utils.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Timing loop handed to a benchmark body
+ *
+ * The body does its untimed setup first and then times one iteration per
+ * call of iteration(); items() records how much work an iteration did.
+ */
+class BenchState {
+public:
+    explicit BenchState(double minSeconds) : minSeconds(minSeconds) {}
+
+    /** @brief Runs @p work until the minimum time is reached (at least once) */
+    template <typename Work>
+    void iterate(const Work& work) {
+        using clock = std::chrono::steady_clock;
+        while (iterations == 0 || (seconds < minSeconds && iterations < kMaxIterations)) {
+            auto start = clock::now();
+            work();
+            seconds += std::chrono::duration<double>(clock::now() - start).count();
+            ++iterations;
+        }
+    }
+
+    /** @brief Work items (nodes, vertices, ...) processed by one iteration */
+    void setItems(double n) { itemsPerIteration = n; }
+
+    /** @brief Bytes processed by one iteration */
+    void setBytes(double n) { bytesPerIteration = n; }
+
+    static constexpr long kMaxIterations = 1000;
+
+    double minSeconds;
+    double seconds = 0.0;
+    long iterations = 0;
+    double itemsPerIteration = 0.0;
+    double bytesPerIteration = 0.0;
+};
+
+/** @brief A named, parameterised benchmark */
+struct Benchmark {
+    std::string name;
+    std::function<void(BenchState&)> body;
+};
+
+/** @brief Result of one benchmark run */
+struct BenchResult {
+    std::string name;
+    long iterations = 0;
+    double realTimeMs = 0.0;       ///< Mean wall time per iteration
+    double itemsPerSecond = 0.0;
+    double bytesPerSecond = 0.0;
+    long peakRssKb = 0;            ///< Resident set high-water mark of the run (see resetPeakRss())
+};
+
+/**
+ * @brief Resets the resident set high-water mark of the process
+ * @return false where it cannot be reset (not Linux, or /proc not writable);
+ *         peakRssKb() then keeps the peak of every earlier benchmark
+ */
+bool resetPeakRss() {
+#ifdef __linux__
+#ifdef __GLIBC__
+    malloc_trim(0);   // hand memory freed by earlier benchmarks back, or it still counts as resident
+#endif
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5";   // 5: reset the peak RSS (VmHWM) to the current RSS
+    clear.flush();
+    return static_cast<bool>(clear);
+#else
+    return false;
+#endif
+}
+
+/** @brief Peak resident set size since the last resetPeakRss() in KiB (0 where unsupported) */
+long peakRssKb() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) return std::stol(line.substr(6));
+    }
+#endif
+#ifdef __unix__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+/** @brief Silences std::cout while in scope (the library logs every read and write) */
+struct QuietStdout {
+    std::ostringstream sink;
+    std::streambuf* saved;
+    QuietStdout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietStdout() { std::cout.rdbuf(saved); }
+};
+
+/** @brief Reproducible random neuron of n nodes (soma included), seeded with n */
+std::map<int, SWCNode> syntheticNeuron(int n) {
+    SyntheticMorphologyOptions options;
+    options.nodes = n;
+    options.seed = static_cast<std::uint32_t>(n);
+    return generateMorphology(options);
+}
+
+/** @brief Paths of the files in a data folder, sorted by name */
+std::vector<std::string> dataFiles(const std::string& folder) {
+    std::vector<std::string> files;
+    if (std::filesystem::is_directory(folder)) files = listFilesInDirectory(folder);
+    return files;
+}
+
+std::uintmax_t totalBytes(const std::vector<std::string>& files) {
+    std::uintmax_t bytes = 0;
+    for (const auto& f : files) bytes += std::filesystem::file_size(f);
+    return bytes;
+}
+
+/**
+ * @brief Registers the stage benchmarks for one synthetic size
+ * @param out Benchmark list to extend
+ * @param n Node count of the synthetic neuron
+ * @param meshing Also register the mesh stages (PFT, merge, UGX write, pipeline)
+ * @param scratch Folder for files written by the benchmarks
+ */
+void addSizeBenchmarks(std::vector<Benchmark>& out, int n, bool meshing, const std::string& scratch) {
+    const std::string tag = "/" + std::to_string(n);
+
+    out.push_back({"preprocess" + tag, [n](BenchState& s) {
+        NeuronGraph g;
+        auto nodes = syntheticNeuron(n);
+        s.setItems(n);
+        s.iterate([&] { g.preprocess(nodes); });
+    }});
+
+    out.push_back({"getTrunks" + tag, [n](BenchState& s) {
+        NeuronGraph g;
+        auto nodes = syntheticNeuron(n);
+        s.setItems(n);
+        s.iterate([&] { g.getTrunks(nodes, false); });
+    }});
+
+    for (const char* method : {"linear", "cubic"}) {
+        std::string m = method;
+        out.push_back({m + "Resample" + tag, [n, m](BenchState& s) {
+            NeuronGraph g(syntheticNeuron(n));
+            auto trunks = g.getTrunks(false);
+            s.setItems(n);
+            s.iterate([&] {
+                double delta = 2.0;
+                if (m == "cubic") g.allCubicSplineResampledTrunks(trunks, delta);
+                else g.allLinearSplineResampledTrunks(trunks, delta);
+            });
+        }});
+    }
+
+    out.push_back({"assembleTrunks" + tag, [n](BenchState& s) {
+        NeuronGraph g(syntheticNeuron(n));
+        auto trunks = g.getTrunks(false);
+        auto parents = g.getTrunkParentMap();
+        double delta = 2.0;
+        auto resampled = g.allCubicSplineResampledTrunks(trunks, delta);
+        s.setItems(n);
+        s.iterate([&] { g.assembleTrunks(resampled, parents); });
+    }});
+
+    if (!meshing) return;
+
+    out.push_back({"pftFromPath" + tag, [n](BenchState& s) {
+        NeuronGraph g(syntheticNeuron(n));
+        auto trunks = g.getTrunks(true);
+        s.setItems(n);
+        s.iterate([&] {
+            for (const auto& [id, trunk] : trunks) g.pftFromPath(trunk, 16);
+        });
+    }});
+
+    out.push_back({"addUGXGeometry" + tag, [n](BenchState& s) {
+        NeuronGraph g(syntheticNeuron(n));
+        std::vector<UgxGeometry> parts;
+        for (const auto& [id, trunk] : g.getTrunks(true)) parts.push_back(g.pftFromPath(trunk, 16).getGeometry());
+        double vertices = 0;
+        for (const auto& p : parts) vertices += p.points.size();
+        s.setItems(vertices);
+        s.iterate([&] {
+            UgxGeometryBuilder builder;
+            builder.appendAll(parts);
+        });
+    }});
+
+    out.push_back({"writeUGX" + tag, [n, scratch](BenchState& s) {
+        NeuronGraph g(syntheticNeuron(n));
+        std::string file = scratch + "/write" + std::to_string(n) + ".ugx";
+        s.setItems(n);
+        s.iterate([&] { g.writeToFileUGX(file); });
+        s.setBytes(static_cast<double>(std::filesystem::file_size(file)));
+    }});
+
+    // Macro: SWC on disk to a merged tube mesh
+    out.push_back({"pipeline" + tag, [n, scratch](BenchState& s) {
+        std::string input = scratch + "/synthetic" + std::to_string(n) + ".swc";
+        NeuronGraph(syntheticNeuron(n)).writeToFile(input);
+        std::string output = scratch + "/pipeline" + std::to_string(n) + ".ugx";
+        s.setItems(n);
+        s.iterate([&] {
+            NeuronGraph g(input);
+            g.setNodes(g.preprocess(g.getNodes()));
+            auto trunks = g.getTrunks(false);
+            auto parents = g.getTrunkParentMap();
+            double delta = 2.0;
+            NeuronGraph refined(g.assembleTrunks(g.allCubicSplineResampledTrunks(trunks, delta), parents));
+
+            UgxGeometryBuilder builder;
+            for (const auto& [id, trunk] : refined.getTrunks(true)) builder.append(refined.pftFromPath(trunk, 16).getGeometry());
+            UgxObject mesh;
+            mesh.setGeometry(builder.release());
+            mesh.writeUGX(output);
+        });
+    }});
+}
+
+/** @brief All benchmarks of the suite, smallest problems first */
+std::vector<Benchmark> registerBenchmarks(const std::string& dataDir, const std::string& scratch, int maxNodes,
+                                          int maxMeshNodes) {
+    std::vector<Benchmark> all;
+
+    auto swcFiles = dataFiles(dataDir + "/SWC");
+    auto ugxFiles = dataFiles(dataDir + "/UGX");
+
+    all.push_back({"readSWC/data_SWC", [swcFiles](BenchState& s) {
+        s.setItems(static_cast<double>(swcFiles.size()));
+        s.setBytes(static_cast<double>(totalBytes(swcFiles)));
+        s.iterate([&] {
+            for (const auto& f : swcFiles) NeuronGraph g(f);
+        });
+    }});
+
+    all.push_back({"readUGX/data_UGX", [ugxFiles](BenchState& s) {
+        s.setItems(static_cast<double>(ugxFiles.size()));
+        s.setBytes(static_cast<double>(totalBytes(ugxFiles)));
+        s.iterate([&] {
+            for (const auto& f : ugxFiles) {
+                NeuronGraph g;
+                g.readFromFileUGX(f);
+            }
+        });
+    }});
+
+    all.push_back({"getTrunks/data_SWC", [swcFiles](BenchState& s) {
+        std::vector<NeuronGraph> graphs;
+        double nodes = 0;
+        for (const auto& f : swcFiles) {
+            graphs.emplace_back(f);
+            nodes += graphs.back().numberOfNodes();
+        }
+        s.setItems(nodes);
+        s.iterate([&] {
+            for (const auto& g : graphs) g.getTrunks(g.getNodes(), false);
+        });
+    }});
+
+    for (int n = 1000; n <= maxNodes; n *= 10) addSizeBenchmarks(all, n, n <= maxMeshNodes, scratch);
+    return all;
+}
+
+/** @brief Writes results in the Google Benchmark JSON layout */
+void writeJson(const std::vector<BenchResult>& results, const std::string& path, bool rssPerBenchmark) {
+    std::ofstream out(path);
+    out << "{\n  \"context\": {\"library\": \"CPPNeuronMesher\", \"time_unit\": \"ms\", \"peak_rss\": \""
+        << (rssPerBenchmark ? "per benchmark" : "cumulative process peak") << "\"},\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"real_time\": " << r.realTimeMs << ", \"time_unit\": \"ms\""
+            << ", \"items_per_second\": " << r.itemsPerSecond << ", \"bytes_per_second\": " << r.bytesPerSecond
+            << ", \"peak_rss_kb\": " << r.peakRssKb << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+/**
+ * @brief Reads name -> real_time pairs from a JSON file written by writeJson()
+ * @return false if the file cannot be opened
+ *
+ * Expects one benchmark object per line, which writeJson() guarantees.
+ */
+bool readBaseline(const std::string& path, std::map<std::string, double>& times) {
+    std::ifstream in(path);
+    if (!in) return false;
+    static const std::regex entry("\"name\": \"([^\"]+)\".*\"real_time\": ([0-9.eE+-]+)");
+    std::string line;
+    std::smatch m;
+    while (std::getline(in, line)) {
+        if (std::regex_search(line, m, entry)) times[m[1]] = std::stod(m[2]);
+    }
+    return true;
+}
+
+std::string optionValue(const std::string& arg, const std::string& key) {
+    return arg.rfind(key, 0) == 0 ? arg.substr(key.size()) : std::string();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string execDir = getExecutableDir();
+    std::string jsonPath = execDir + "/../output/bench/results.json";
+    std::string baselinePath;
+    std::string filter = ".*";
+    double tolerance = 0.15;
+    double minSeconds = 0.5;
+    int maxNodes = 1000000;
+    int maxMeshNodes = 100000;   // map-based meshes of 1M nodes need tens of GB
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i], v;
+        if (!(v = optionValue(arg, "--json=")).empty()) jsonPath = v;
+        else if (!(v = optionValue(arg, "--baseline=")).empty()) baselinePath = v;
+        else if (!(v = optionValue(arg, "--filter=")).empty()) filter = v;
+        else if (!(v = optionValue(arg, "--tolerance=")).empty()) tolerance = std::stod(v);
+        else if (!(v = optionValue(arg, "--min-time=")).empty()) minSeconds = std::stod(v);
+        else if (!(v = optionValue(arg, "--max-nodes=")).empty()) maxNodes = std::stoi(v);
+        else if (!(v = optionValue(arg, "--max-mesh-nodes=")).empty()) maxMeshNodes = std::stoi(v);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--json=file] [--baseline=file] [--tolerance=0.15]"
+                      << " [--filter=regex] [--min-time=seconds] [--max-nodes=n] [--max-mesh-nodes=n]\n";
+            return 1;
+        }
+    }
+
+    std::string scratch = execDir + "/../output/bench";
+    std::filesystem::create_directories(scratch);
+    std::filesystem::path jsonDir = std::filesystem::path(jsonPath).parent_path();
+    if (!jsonDir.empty()) std::filesystem::create_directories(jsonDir);
+
+    std::regex selected(filter);
+    std::vector<BenchResult> results;
+    bool rssPerBenchmark = true;
+    std::printf("%-28s %12s %10s %14s %12s\n", "Benchmark", "Time (ms)", "Iter", "Items/s", "Peak RSS MB");
+    for (const auto& bench : registerBenchmarks(execDir + "/../data", scratch, maxNodes, maxMeshNodes)) {
+        if (!std::regex_search(bench.name, selected)) continue;
+
+        BenchState state(minSeconds);
+        rssPerBenchmark = resetPeakRss() && rssPerBenchmark;
+        {
+            QuietStdout quiet;
+            bench.body(state);
+        }
+
+        BenchResult r;
+        r.name = bench.name;
+        r.iterations = state.iterations;
+        r.realTimeMs = 1e3 * state.seconds / state.iterations;
+        r.itemsPerSecond = state.itemsPerIteration * state.iterations / state.seconds;
+        r.bytesPerSecond = state.bytesPerIteration * state.iterations / state.seconds;
+        r.peakRssKb = peakRssKb();
+        results.push_back(r);
+        std::printf("%-28s %12.3f %10ld %14.4g %12.1f\n", r.name.c_str(), r.realTimeMs, r.iterations,
+                    r.itemsPerSecond, r.peakRssKb / 1024.0);
+        std::fflush(stdout);
+    }
+
+    if (!rssPerBenchmark) std::cout << "Peak RSS could not be reset: it is the cumulative peak of the process" << std::endl;
+    writeJson(results, jsonPath, rssPerBenchmark);
+    std::cout << "Wrote " << results.size() << " results to " << jsonPath << std::endl;
+
+    if (baselinePath.empty()) return 0;
+
+    std::map<std::string, double> baseline;
+    if (!readBaseline(baselinePath, baseline)) {
+        std::cerr << "Error: no baseline at " << baselinePath << "; record one on this machine with "
+                  << "`make bench_baseline` (or --json=" << baselinePath << ")" << std::endl;
+        return 2;
+    }
+
+    int regressions = 0;
+    int compared = 0;
+    for (const auto& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0.0) continue;
+        ++compared;
+        double ratio = r.realTimeMs / it->second;
+        if (ratio > 1.0 + tolerance) {
+            std::printf("REGRESSION %-28s %10.3f ms vs %10.3f ms baseline (%+.1f%%)\n", r.name.c_str(), r.realTimeMs,
+                        it->second, 100.0 * (ratio - 1.0));
+            ++regressions;
+        }
+    }
+    std::cout << regressions << " regression(s) in " << compared << " of " << results.size()
+              << " benchmarks found in " << baselinePath << std::endl;
+    return regressions == 0 ? 0 : 1;
+}
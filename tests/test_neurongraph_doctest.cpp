@@ -2,7 +2,24 @@
 #include "externals/doctest.h"
 #include "project/neurongraph.h"
 #include "project/utils.h"
+#include "project/batch.h"
+#include "project/shard.h"
+#include "project/threadpool.h"
+#include "project/asyncio.h"
+#include "project/spline.h"
+#include "project/refinement.h"
+#include "project/trunkbatch.h"
+#include "project/synthetic.h"
+#include "project/compression.h"
+#include <atomic>
+#include <cmath>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <sstream>
 
 TEST_CASE("Constructor 1"){
     NeuronGraph graph;
@@ -35,6 +52,30 @@ TEST_CASE("Add nodes") {
     CHECK(graph.numberOfEdges() == 1);
 }
 
+TEST_CASE("Flat morphology storage") {
+    NeuronGraph graph;
+    graph.addNode(SWCNode{5,2,3,2.0,0.0,0.0,1.0});
+    graph.addNode(SWCNode{1,-1,1,0.0,0.0,0.0,1.0});
+    graph.addNode(SWCNode{2,1,3,1.0,0.0,0.0,1.0});
+    graph.addNode(SWCNode{3,2,3,1.0,1.0,0.0,1.0});
+
+    const Morphology& m = graph.getMorphology();
+    REQUIRE(m.size() == 4);
+    CHECK(m.id == std::vector<int>{1, 2, 3, 5});
+    CHECK(m.indexOf(5) == 3);
+    CHECK(m.indexOf(4) == -1);
+    CHECK(m.parent == std::vector<int>{-1, 0, 1, 1});
+    CHECK(m.childCount(1) == 2);
+    CHECK(m.degree(1) == 3);
+    CHECK(graph.numberOfEdges() == 2);
+
+    NeuronGraph copy(m);
+    auto nodes = copy.getNodes();
+    REQUIRE(nodes.size() == 4);
+    CHECK(nodes.at(5).pid == 2);
+    CHECK(nodes.at(3).y == doctest::Approx(1.0));
+}
+
 TEST_CASE("Read from SWC data folder") {
     std::string filepath = getExecutableDir() + "/../data/neuron.swc";
     NeuronGraph graph;
@@ -43,6 +84,30 @@ TEST_CASE("Read from SWC data folder") {
     CHECK(graph.numberOfEdges() > 0);
 }
 
+TEST_CASE("Read SWC with comments, tabs and malformed lines") {
+    std::string tempFile = getExecutableDir() + "/../output/test_output/test_parse.swc";
+    {
+        std::ofstream out(tempFile, std::ios::binary);
+        out << "# header comment\n"
+            << "\n"
+            << "1 1 0.0 0.0 0.0 2.5 -1   # soma\r\n"
+            << "\t2\t3\t1.5\t-2e1\t+0.25\t1\t1\n"
+            << "3 3 abc 0 0 1 2\n"
+            << "   # indented comment\n"
+            << "4 3 3 0 0 0.5 2";
+    }
+    NeuronGraph g;
+    g.readFromFile(tempFile);
+    auto nodes = g.getNodes();
+    REQUIRE(nodes.size() == 3);
+    CHECK(nodes.at(1).radius == doctest::Approx(2.5));
+    CHECK(nodes.at(2).y == doctest::Approx(-20.0));
+    CHECK(nodes.at(2).z == doctest::Approx(0.25));
+    CHECK(nodes.at(2).pid == 1);
+    CHECK(nodes.count(3) == 0);
+    CHECK(nodes.at(4).pid == 2);
+}
+
 TEST_CASE("Read all SWC files in folder") {
     std::string swcDir = getExecutableDir() + "/../data/SWC";
     REQUIRE(std::filesystem::exists(swcDir));
@@ -115,6 +180,301 @@ TEST_CASE("Write and read UGX") {
     CHECK(g2.numberOfEdges() == g.numberOfEdges());
 }
 
+TEST_CASE("Streaming UGX backend matches the DOM backend") {
+    auto slurp = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    std::string dir = getExecutableDir();
+    std::string domFile = dir + "/../output/test_output/dom_backend.ugx";
+    std::string streamFile = dir + "/../output/test_output/stream_backend.ugx";
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir + "/../data/SWC")) {
+        INFO("Input: " << entry.path().string());
+        NeuronGraph g(entry.path().string());
+        g.writeToFileUGX(domFile);
+        g.writeToFileUGXStream(g.getNodes(), streamFile);
+        CHECK(slurp(domFile) == slurp(streamFile));
+
+        NeuronGraph fromDom, fromStream;
+        fromDom.readFromFileUGX(domFile);
+        fromStream.readFromFileUGXStream(domFile);
+        auto a = fromDom.getNodes();
+        auto b = fromStream.getNodes();
+        REQUIRE(a.size() == b.size());
+        for (const auto& [id, node] : a) {
+            CHECK(b.at(id).pid == node.pid);
+            CHECK(b.at(id).type == node.type);
+            CHECK(b.at(id).x == node.x);
+            CHECK(b.at(id).radius == node.radius);
+        }
+    }
+
+    // Selecting the backend routes the regular methods through the stream path
+    NeuronGraph empty;
+    setUgxBackend(UgxBackend::Streaming);
+    empty.writeToFileUGX(streamFile);
+    setUgxBackend(UgxBackend::DOM);
+    empty.writeToFileUGX(domFile);
+    CHECK(slurp(domFile) == slurp(streamFile));
+}
+
+TEST_CASE("Binary cache round trip") {
+    std::string dir = getExecutableDir();
+    std::string binFile = dir + "/../output/test_output/neuron.bin";
+
+    NeuronGraph g(dir + "/../data/neuron.swc");
+    g.swc2bin(dir + "/../data/neuron.swc", binFile);
+
+    NeuronGraph loaded(binFile);
+    CHECK(loaded.numberOfNodes() == g.numberOfNodes());
+    CHECK(loaded.numberOfEdges() == g.numberOfEdges());
+    auto a = g.getNodes();
+    auto b = loaded.getNodes();
+    for (const auto& [id, node] : a) {
+        REQUIRE(b.count(id) == 1);
+        CHECK(b.at(id).pid == node.pid);
+        CHECK(b.at(id).type == node.type);
+        CHECK(b.at(id).y == node.y);
+        CHECK(b.at(id).radius == node.radius);
+    }
+    CHECK(loaded.getMorphology().children == g.getMorphology().children);
+
+    // A UGX file is not a binary cache
+    NeuronGraph bad;
+    bad.readFromFileBIN(dir + "/../data/neuron.ugx");
+    CHECK(bad.numberOfNodes() == 0);
+}
+
+TEST_CASE("Binary cache stores single precision columns") {
+    std::string dir = getExecutableDir();
+    std::string wide = dir + "/../output/test_output/neuron64.bin";
+    std::string narrow = dir + "/../output/test_output/neuron32.bin";
+
+    NeuronGraph g(dir + "/../data/neuron.swc");
+    g.writeToFileBIN(wide);
+    g.writeToFileBIN(narrow, StoragePrecision::Float32);
+    CHECK(std::filesystem::file_size(narrow) < std::filesystem::file_size(wide));
+
+    NeuronGraph loaded(narrow);
+    REQUIRE(loaded.numberOfNodes() == g.numberOfNodes());
+    CHECK(loaded.getMorphology().children == g.getMorphology().children);
+    const Morphology& a = g.getMorphology();
+    const Morphology& b = loaded.getMorphology();
+    CHECK(b.id == a.id);
+    CHECK(b.pid == a.pid);
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        CHECK(b.x[i] == static_cast<double>(static_cast<float>(a.x[i])));
+        CHECK(b.z[i] == doctest::Approx(a.z[i]).epsilon(1e-6));
+        CHECK(b.radius[i] == static_cast<double>(static_cast<float>(a.radius[i])));
+    }
+}
+
+TEST_CASE("Thread pool runs every task") {
+    ThreadPool pool(4);
+    std::atomic<int> sum{0};
+    for (int i = 1; i <= 100; ++i) {
+        pool.submit([&sum, &pool, i] {
+            sum += i;
+            if (i % 10 == 0) pool.submit([&sum] { sum += 1000; });   // nested submit
+        });
+    }
+    pool.wait();
+    CHECK(sum == 5050 + 10 * 1000);
+
+    pool.submit([] { throw std::runtime_error("task failed"); });
+    CHECK_THROWS_AS(pool.wait(), std::runtime_error);
+    pool.wait();   // the error is reported once
+}
+
+TEST_CASE("I/O service runs operations in order behind a bounded queue") {
+    IoService io(1, 1);
+    std::vector<int> order;
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 20; ++i) results.push_back(io.submit([&order, i] { order.push_back(i); return i * i; }));
+    auto failed = io.submit([] { throw std::runtime_error("disk full"); });
+    for (int i = 0; i < 20; ++i) CHECK(results[i].get() == i * i);
+    CHECK_THROWS_AS(failed.get(), std::runtime_error);
+    io.drain();
+    CHECK(io.pending() == 0);
+    CHECK(order.size() == 20);
+    CHECK(std::is_sorted(order.begin(), order.end()));
+
+    // one operation running and one queued: the next submit waits for space
+    std::promise<void> gate;
+    std::shared_future<void> open = gate.get_future().share();
+    auto blocked = io.submit([open] { open.wait(); });
+    auto queued = io.submit([] {});
+    std::atomic<bool> submitted{false};
+    std::thread producer([&] {
+        io.submit([] {}).get();
+        submitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK_FALSE(submitted);
+    gate.set_value();
+    producer.join();
+    CHECK(submitted);
+    blocked.get();
+    queued.get();
+}
+
+TEST_CASE("Read-ahead loader prefetches inputs in order") {
+    std::promise<void> secondStarted;
+    auto started = secondStarted.get_future();
+    std::vector<std::string> inputs = {"a", "b", "bad", "c"};
+    ReadAhead<std::string> reader(inputs, [&secondStarted](const std::string& input) {
+        if (input == "b") secondStarted.set_value();
+        if (input == "bad") throw std::runtime_error("unreadable " + input);
+        return input + input;
+    });
+
+    // the second input loads before the consumer asks for the first
+    CHECK(started.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    CHECK(reader.nextInput() == "a");
+    CHECK(reader.next() == "aa");
+    CHECK(reader.next() == "bb");
+    CHECK(reader.nextInput() == "bad");
+    CHECK_THROWS_AS(reader.next(), std::runtime_error);
+    CHECK(reader.next() == "cc");
+    CHECK(reader.done());
+
+    // whole graphs, the way the drivers use it
+    std::string dir = getExecutableDir() + "/../data/";
+    ReadAhead<NeuronGraph> graphs({dir + "neuron.swc", dir + "neuron.swc"}, [](const std::string& f) {
+        NeuronGraph g;
+        g.readFromFile(f);
+        return g;
+    }, 2, 2);
+    std::size_t first = graphs.next().numberOfNodes();
+    CHECK(first > 0);
+    CHECK(graphs.next().numberOfNodes() == first);
+}
+
+TEST_CASE("Batch driver reports failures without aborting") {
+    std::string dir = getExecutableDir();
+    auto inputs = collectBatchInputs(dir + "/../data/SWC");
+    REQUIRE(inputs.size() == listFilesInDirectory(dir + "/../data/SWC").size());
+    CHECK(std::is_sorted(inputs.begin(), inputs.end()));
+
+    std::string manifest = dir + "/../output/test_output/batch_manifest.txt";
+    {
+        std::ofstream out(manifest);
+        out << "# neurons to process\n\n../../data/neuron.swc\nmissing.swc\n";
+    }
+    inputs = collectBatchInputs(manifest);
+    REQUIRE(inputs.size() == 2);
+
+    BatchOptions options;
+    options.threads = 2;
+    options.maxInFlight = 1;
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    auto results = runBatch(inputs, [&](const std::string& file) {
+        int now = ++running;
+        peak = std::max(peak.load(), now);
+        NeuronGraph g;
+        g.readFromFile(file);
+        --running;
+        if (g.numberOfNodes() == 0) throw std::runtime_error("empty neuron");
+    }, options);
+
+    REQUIRE(results.size() == 2);
+    CHECK(results[0].ok);
+    CHECK_FALSE(results[1].ok);
+    CHECK(results[1].error == "empty neuron");
+    CHECK(peak == 1);
+
+    std::ostringstream report;
+    CHECK(printBatchReport(results, report) == 1);
+    CHECK(report.str().find("[FAILED]") != std::string::npos);
+}
+
+TEST_CASE("Shards are balanced by node count") {
+    std::vector<std::uint64_t> costs = {100, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 1};
+    auto owner = assignShards(costs, 2);
+    REQUIRE(owner.size() == costs.size());
+    CHECK(owner == assignShards(costs, 2));   // every rank computes the same split
+
+    std::uint64_t load[2] = {0, 0};
+    for (std::size_t i = 0; i < costs.size(); ++i) load[owner[i]] += costs[i];
+    CHECK(owner[0] == 0);
+    CHECK(load[0] == 101);   // the last input breaks the tie towards shard 0
+    CHECK(load[1] == 100);
+
+    CHECK(assignShards(costs, 1) == std::vector<int>(costs.size(), 0));
+    auto spread = assignShards(std::vector<std::uint64_t>(4, 0), 4);
+    CHECK(std::set<int>(spread.begin(), spread.end()).size() == 4);
+
+    std::string dir = getExecutableDir();
+    NeuronGraph g(dir + "/../data/neuron.swc");
+    CHECK(estimateNodeCount(dir + "/../data/neuron.swc") == g.numberOfNodes());
+    CHECK(estimateNodeCount(dir + "/../data/missing.swc") == 0);
+}
+
+TEST_CASE("Sharded batch resumes from its checkpoint") {
+    std::string dir = getExecutableDir();
+    std::string state = dir + "/../output/test_output/shard_state";
+    std::filesystem::remove_all(state);
+    auto inputs = collectBatchInputs(dir + "/../data/SWC");
+    REQUIRE(inputs.size() >= 2);
+
+    BatchOptions options;
+    options.threads = 2;
+    std::mutex mutex;
+    std::multiset<std::string> processed;
+    auto job = [&](const std::string& file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        processed.insert(file);
+    };
+
+    // rank 0 of two finishes its shard, then rank 1 "crashes" after one input
+    ShardStats first;
+    runShardedBatch(inputs, job, ShardSession(0, 2), state, options, first);
+    CHECK(first.succeeded == first.assigned);
+    CHECK(first.assigned < inputs.size());
+    bool crashed = false;
+    ShardStats second;
+    runShardedBatch(inputs, [&](const std::string& file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (crashed) throw std::runtime_error("node lost");
+        crashed = true;
+        processed.insert(file);
+    }, ShardSession(1, 2), state, BatchOptions{1, 1, 0}, second);
+    CHECK(first.assigned + second.assigned == inputs.size());
+    CHECK(second.succeeded == 1);
+    CHECK(second.failed == second.assigned - 1);
+
+    // the rerun repeats only the failed inputs
+    ShardStats rerun;
+    runShardedBatch(inputs, job, ShardSession(1, 2), state, options, rerun);
+    CHECK(rerun.skipped == 1);
+    CHECK(rerun.succeeded == second.failed);
+    CHECK(processed.size() == inputs.size());
+    CHECK(std::set<std::string>(processed.begin(), processed.end()).size() == inputs.size());
+    CHECK(BatchCheckpoint(state, 0).previouslyDone() == inputs.size());
+
+    CHECK(gatherShardStats(rerun, ShardSession(1, 2, "run-2"), state).empty());
+    auto all = gatherShardStats(first, ShardSession(0, 2, "run-2"), state);
+    REQUIRE(all.size() == 2);
+    CHECK(all[1].succeeded == rerun.succeeded);
+    std::ostringstream report;
+    CHECK(printShardReport(all, report, 2) == 0);
+    CHECK(report.str().find("2 ranks") != std::string::npos);
+    CHECK(report.str().find("did not report") == std::string::npos);
+
+    // statistics left by an earlier run are not reported as this run's
+    auto fresh = gatherShardStats(first, ShardSession(0, 2, "run-3"), state, 0.3);
+    REQUIRE(fresh.size() == 1);
+    CHECK(fresh[0].rank == 0);
+    std::ostringstream partial;
+    printShardReport(fresh, partial, 2);
+    CHECK(partial.str().find("1 of 2 ranks did not report") != std::string::npos);
+
+    // without a run id the other ranks' files cannot be trusted at all
+    CHECK(gatherShardStats(first, ShardSession(0, 2), state).size() == 1);
+}
+
 TEST_CASE("Write to swc"){
     NeuronGraph g;
     g.readFromFileUGXorSWC(getExecutableDir() + "/../data/neuron.swc");
@@ -214,6 +574,36 @@ TEST_CASE("Split Edges 2") {
     }
 }
 
+TEST_CASE("Split Edges matches midpoint insertion followed by topologicalSort") {
+    NeuronGraph g;
+    g.readFromFileUGXorSWC(getExecutableDir() + "/../data/neuron.swc");
+    auto nodes = g.getNodes();
+
+    // Reference: insert the midpoints with fresh ids, then sort
+    std::map<int, SWCNode> reference = nodes;
+    int nextId = nodes.rbegin()->first + 1;
+    for (const auto& [id, node] : nodes) {
+        if (node.pid == -1 || !nodes.count(node.pid)) continue;
+        const SWCNode& parent = nodes.at(node.pid);
+        SWCNode mid{nextId, parent.id, node.type, (parent.x + node.x) / 2.0, (parent.y + node.y) / 2.0,
+                    (parent.z + node.z) / 2.0, (parent.radius + node.radius) / 2.0};
+        reference[nextId] = mid;
+        reference[id].pid = nextId++;
+    }
+    reference = g.topologicalSort(reference);
+
+    auto split = g.splitEdges(nodes);
+    REQUIRE(split.size() == reference.size());
+    for (const auto& [id, node] : reference) {
+        const SWCNode& got = split.at(id);
+        CHECK((got.pid == node.pid && got.type == node.type && got.x == node.x && got.y == node.y &&
+               got.z == node.z && got.radius == node.radius));
+    }
+
+    auto levels = g.splitEdgesN(nodes, 2);
+    CHECK(levels[1].size() == g.splitEdges(split).size());
+}
+
 TEST_CASE("SplitEdgesN performs multiple edge refinements") {
     std::string path = getExecutableDir() + "/../data/neuron.swc";
     NeuronGraph g;
@@ -417,6 +807,39 @@ TEST_CASE("Assemble Resampled Trunks And Refine"){
     }
 }
 
+TEST_CASE("Dense trunk assembly matches the map form for any thread count"){
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.ugx");
+    g.setNodes(g.removeSomaSegment());
+
+    bool resetIndex = false;
+    auto trunks = g.getTrunks(resetIndex);
+    auto trunkParentMap = g.getTrunkParentMap(g.getNodes(), trunks);
+    double delta = 4.0;
+    auto resampledTrunks = g.allCubicSplineResampledTrunks(trunks, delta);
+
+    auto nodeSet = g.assembleTrunks(resampledTrunks, trunkParentMap);
+    auto serial = g.assembleTrunksDense(resampledTrunks, trunkParentMap, 1);
+    auto parallel = g.assembleTrunksDense(resampledTrunks, trunkParentMap, 4);
+    REQUIRE(serial.size() == nodeSet.size());
+    REQUIRE(parallel.size() == nodeSet.size());
+
+    int roots = 0;
+    for (std::size_t i = 0; i < parallel.size(); ++i) {
+        const SWCNode& node = parallel[i];
+        CHECK(node.id == static_cast<int>(i + 1));
+        CHECK(node.pid == serial[i].pid);
+        CHECK(node.pid == nodeSet.at(node.id).pid);
+        CHECK(node.x == nodeSet.at(node.id).x);
+        CHECK(node.pid < node.id);
+        if (node.pid == -1) ++roots;
+    }
+    CHECK(roots == 1);
+
+    std::map<int, int> missingParent = trunkParentMap;
+    missingParent.erase(std::prev(missingParent.end()));
+    CHECK_THROWS_AS(g.assembleTrunksDense(resampledTrunks, missingParent, 2), std::out_of_range);
+}
+
 TEST_CASE("Assemble Resampled Trunks and Refine - Multiple Neurons"){
     // get paths of all .swc in the data folder
     std::string path = getExecutableDir() + "/../data/SWC";
@@ -559,6 +982,770 @@ TEST_CASE("GenerateRefinements LINEAR"){
     }
 }
 
+TEST_CASE("Multi-channel cubic spline"){
+    // Channel 0 is linear in t (reproduced exactly), channel 1 is a parabola
+    std::vector<double> knots = {0.0, 1.0, 2.5, 3.0, 5.0};
+    std::vector<double> values;
+    for (double t : knots) values.insert(values.end(), {2 * t + 1, t * t});
+
+    NaturalCubicSpline<2> spline;
+    spline.fit(knots, values.data());
+
+    std::vector<double> ts = {0.0, 0.5, 1.0, 2.0, 2.5, 4.0, 5.0};
+    std::vector<double> out(2 * ts.size());
+    spline.evaluate(ts, out.data());
+    for (std::size_t q = 0; q < ts.size(); ++q) CHECK(out[2 * q] == doctest::Approx(2 * ts[q] + 1));
+    for (std::size_t k = 0; k < knots.size(); ++k) {
+        std::size_t cursor = 0;
+        double v[2];
+        spline.evaluate(knots[k], v, cursor);
+        CHECK(v[1] == doctest::Approx(knots[k] * knots[k]));
+    }
+
+    // Unsorted queries find the same segments as a sorted sweep
+    std::size_t cursor = 3;
+    for (std::size_t q = ts.size(); q-- > 0;) {
+        double v[2];
+        spline.evaluate(ts[q], v, cursor);
+        CHECK(v[0] == out[2 * q]);
+        CHECK(v[1] == out[2 * q + 1]);
+    }
+}
+
+TEST_CASE("Parallel resampling matches serial resampling"){
+    auto sameNodes = [](const std::map<int, SWCNode>& a, const std::map<int, SWCNode>& b) {
+        if (a.size() != b.size()) return false;
+        for (auto ia = a.begin(), ib = b.begin(); ia != a.end(); ++ia, ++ib) {
+            const SWCNode& p = ia->second;
+            const SWCNode& q = ib->second;
+            if (ia->first != ib->first || p.pid != q.pid || p.type != q.type ||
+                p.x != q.x || p.y != q.y || p.z != q.z || p.radius != q.radius) return false;
+        }
+        return true;
+    };
+
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    g.setNodes(g.removeSomaSegment());
+    auto trunks = g.getTrunks(false);
+    double delta = 2;
+
+    auto serial = g.allCubicSplineResampledTrunks(trunks, delta);
+    auto parallel = g.allCubicSplineResampledTrunks(trunks, delta, 4);
+    REQUIRE(serial.size() == parallel.size());
+    for (const auto& [id, trunk] : serial) CHECK(sameNodes(trunk, parallel.at(id)));
+
+    serial = g.allLinearSplineResampledTrunks(trunks, delta);
+    parallel = g.allLinearSplineResampledTrunks(trunks, delta, 0);
+    for (const auto& [id, trunk] : serial) CHECK(sameNodes(trunk, parallel.at(id)));
+
+    double d1 = 12, d2 = 12;
+    int N = 3;
+    std::string method = "cubic";
+    auto r1 = g.generateRefinements(d1, N, method);
+    auto r2 = g.generateRefinements(d2, N, method, 3);
+    CHECK(d1 == d2);
+    REQUIRE(r1.size() == r2.size());
+    for (const auto& [level, nodes] : r1) CHECK(sameNodes(nodes, r2.at(level)));
+}
+
+TEST_CASE("Batched cubic resampling matches the per-trunk resampling"){
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    auto trunks = g.getTrunks(false);
+    TrunkBatch batch = TrunkBatch::fromTrunks(trunks);
+    REQUIRE(batch.size() == trunks.size());
+
+    for (double delta : {0.5, 2.0, 12.0}) {
+        INFO("Delta: " << delta);
+        TrunkBatch serial = resampleTrunkBatchCubic(batch, delta);
+        TrunkBatch parallel = resampleTrunkBatchCubic(batch, delta, 4);
+        CHECK(serial.offsets == parallel.offsets);
+        CHECK(serial.xyzr == parallel.xyzr);
+        CHECK(serial.types == parallel.types);
+
+        std::size_t t = 0;
+        for (const auto& [id, trunk] : trunks) {
+            auto expected = g.cubicSplineResampleTrunk(trunk, delta);
+            auto actual = serial.trunk(t++);
+            REQUIRE(actual.size() == expected.size());
+            for (const auto& [nid, node] : expected) {
+                const SWCNode& other = actual.at(nid);
+                CHECK(other.pid == node.pid);
+                CHECK(other.type == node.type);
+                CHECK(other.x == node.x);
+                CHECK(other.y == node.y);
+                CHECK(other.z == node.z);
+                CHECK(other.radius == node.radius);
+            }
+        }
+    }
+
+    // spans give the same rows as the maps of the renumbered trunks
+    TrunkBatch spans = TrunkBatch::fromSpans(g.getTrunkSpans(true));
+    TrunkBatch maps = TrunkBatch::fromTrunks(g.getTrunks(true));
+    CHECK(spans.offsets == maps.offsets);
+    CHECK(spans.xyzr == maps.xyzr);
+}
+
+TEST_CASE("Refinement hierarchy streams the same levels"){
+    std::string dir = getExecutableDir();
+    NeuronGraph g(dir + "/../data/neuron.swc");
+    g.setNodes(g.removeSomaSegment());
+
+    double delta = 12;
+    int N = 4;
+    std::string method = "cubic";
+    auto refinements = g.generateRefinements(delta, N, method);
+
+    RefinementHierarchy hierarchy(g, g.getNodes(), "cubic", 2);
+    CHECK(hierarchy.numberOfTrunks() == g.getTrunks().size());
+    int levels = 0;
+    hierarchy.generate(12, N, [&](int i, const std::map<int, SWCNode>& nodes) {
+        REQUIRE(refinements.count(i) == 1);
+        CHECK(nodes.size() == refinements.at(i).size());
+        CHECK(nodes.rbegin()->second.x == refinements.at(i).rbegin()->second.x);
+        ++levels;
+    });
+    CHECK(levels == N);
+
+    // a cancelled level is dropped; the check is polled once per trunk and before the reassembly
+    std::atomic<std::size_t> checks{0};
+    auto whole = hierarchy.level(3, [&] { ++checks; return false; });
+    REQUIRE(whole);
+    auto plain = hierarchy.level(3);
+    CHECK(whole->size() == plain.size());
+    CHECK(whole->rbegin()->second.x == plain.rbegin()->second.x);
+    CHECK(checks == hierarchy.numberOfTrunks() + 1);
+    checks = 0;
+    CHECK_FALSE(hierarchy.level(3, [&] { return ++checks > 2; }));
+    CHECK(checks < hierarchy.numberOfTrunks());
+
+    std::string folder = dir + "/../output/test_output/hierarchy";
+    checkFolder(folder);
+    g.writeRefinements(g.getNodes(), 12, 2, "linear", folder);
+    NeuronGraph level1(folder + "/refinement_1.swc");
+    CHECK(level1.numberOfNodes() > g.numberOfNodes());
+
+    auto splits = g.splitEdgesN(2);
+    g.splitEdgesN(g.getNodes(), 2, [&](int i, const std::map<int, SWCNode>& nodes) {
+        CHECK(nodes.size() == splits[i].size());
+    });
+}
+
+TEST_CASE("Adaptive resampling follows curvature and radius"){
+    NeuronGraph g;
+    auto node = [](int id, double x, double y, double r) { return SWCNode{id, id - 1, 3, x, y, 0.0, r}; };
+
+    // straight trunk of constant radius: only the minimum number of nodes
+    std::map<int, SWCNode> straight;
+    for (int i = 1; i <= 41; ++i) straight[i] = node(i, i - 1.0, 0.0, 1.0);
+    auto coarse = g.adaptiveSplineResampleTrunk(straight, 0.01, 100.0);
+    CHECK(coarse.size() == 4);
+    CHECK(coarse.begin()->second.x == doctest::Approx(0.0));
+    CHECK(coarse.rbegin()->second.x == doctest::Approx(40.0));
+    CHECK(g.adaptiveSplineResampleTrunk(straight, 0.01, 5.0).size() == 9);
+
+    // quarter circle of radius 20: chords stay within the tolerance of the arc
+    std::map<int, SWCNode> arc;
+    for (int i = 1; i <= 31; ++i) {
+        double a = (i - 1) * M_PI / 60;
+        arc[i] = node(i, 20 * std::cos(a), 20 * std::sin(a), 1.0);
+    }
+    double tolerance = 0.05;
+    auto bent = g.adaptiveSplineResampleTrunk(arc, tolerance, 100.0);
+    CHECK(bent.size() > 4);
+    for (auto it = std::next(bent.begin()); it != bent.end(); ++it) {
+        const SWCNode& a = std::prev(it)->second;
+        const SWCNode& b = it->second;
+        double mx = 0.5 * (a.x + b.x), my = 0.5 * (a.y + b.y);
+        CHECK(20 - std::hypot(mx, my) <= 2 * tolerance);
+    }
+    CHECK(g.adaptiveSplineResampleTrunk(arc, tolerance / 4, 100.0).size() > bent.size());
+
+    // tapering radius on a straight line also needs samples
+    std::map<int, SWCNode> taper;
+    for (int i = 1; i <= 41; ++i) taper[i] = node(i, i - 1.0, 0.0, 1.0 + 0.5 * std::sin((i - 1) * M_PI / 20));
+    CHECK(g.adaptiveSplineResampleTrunk(taper, 0.01, 100.0).size() > 4);
+
+    // selectable in generateRefinements: fewer nodes than uniform cubic sampling
+    std::string dir = getExecutableDir();
+    NeuronGraph neuron(dir + "/../data/neuron.swc");
+    neuron.setNodes(neuron.removeSomaSegment());
+    double d1 = 2, d2 = 2;
+    int N = 2;
+    std::string cubic = "cubic", adaptive = "adaptive";
+    auto uniform = neuron.generateRefinements(d1, N, cubic);
+    auto fewer = neuron.generateRefinements(d2, N, adaptive, 2);
+    REQUIRE(fewer.size() == 2);
+    CHECK(fewer.at(0).size() < uniform.at(0).size());
+    CHECK(fewer.at(1).size() >= fewer.at(0).size());
+    NeuronGraph level(fewer.at(1));
+    CHECK(level.getTrunks().size() == neuron.getTrunks().size());
+}
+
+TEST_CASE("Cached topology indices follow mutations"){
+    auto sameNodes = [](const std::map<int, SWCNode>& a, const std::map<int, SWCNode>& b) {
+        if (a.size() != b.size()) return false;
+        for (auto ia = a.begin(), ib = b.begin(); ia != a.end(); ++ia, ++ib) {
+            const SWCNode& x = ia->second;
+            const SWCNode& y = ib->second;
+            if (ia->first != ib->first || x.id != y.id || x.pid != y.pid || x.type != y.type ||
+                x.x != y.x || x.y != y.y || x.z != y.z || x.radius != y.radius) return false;
+        }
+        return true;
+    };
+    auto checkAgainstUncached = [&](NeuronGraph& g) {
+        auto nodes = g.getNodes();
+        for (bool resetIndex : {false, true}) {
+            auto cached = g.getTrunks(resetIndex);
+            auto rebuilt = g.getTrunks(nodes, resetIndex);
+            REQUIRE(cached.size() == rebuilt.size());
+            for (const auto& [id, trunk] : rebuilt) CHECK(sameNodes(trunk, cached.at(id)));
+        }
+        CHECK(g.getTrunkParentMap() == g.getTrunkParentMap(nodes, g.getTrunks(nodes, false)));
+        CHECK(g.getNeighborMap() == g.getNeighborMap(nodes));
+        CHECK(g.isSomaMissing() == g.isSomaMissing(nodes));
+        CHECK(g.hasSomaSegment() == g.hasSomaSegment(nodes));
+    };
+
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    checkAgainstUncached(g);
+
+    // unchanged graph: one shared build
+    auto index = g.topology();
+    auto trunks = g.trunkDecomposition();
+    CHECK(g.topology() == index);
+    CHECK(g.trunkDecomposition() == trunks);
+    CHECK(index->branchPoints.size() > 0);
+
+    // a new leaf on the first branch point invalidates both indices
+    SWCNode branch = g.getMorphology().node(index->branchPoints[0]);
+    SWCNode leaf = branch;
+    leaf.id = g.getNodes().rbegin()->first + 1;
+    leaf.pid = branch.id;
+    leaf.x += 1.0;
+    g.addNode(leaf);
+    CHECK(g.topology() != index);
+    CHECK(g.trunkDecomposition() != trunks);
+    CHECK(g.topology()->degree(g.getMorphology().indexOf(branch.id)) == index->degree(index->branchPoints[0]) + 1);
+    checkAgainstUncached(g);
+
+    g.setNodes(g.removeSomaSegment());
+    checkAgainstUncached(g);
+}
+
+TEST_CASE("Trunk spans match getTrunks"){
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    auto nodes = g.getNodes();
+    for (bool resetIndex : {false, true}) {
+        auto expected = g.getTrunks(nodes, resetIndex);
+        TrunkSpans spans = g.getTrunkSpans(nodes, resetIndex);
+        REQUIRE(spans.size() == expected.size());
+
+        auto maps = NeuronGraph::trunkSpansToMaps(spans);
+        for (const auto& [id, trunk] : expected) {
+            REQUIRE(maps.at(id).size() == trunk.size());
+            for (const auto& [nid, node] : trunk) {
+                const SWCNode& got = maps.at(id).at(nid);
+                CHECK((got.id == node.id && got.pid == node.pid && got.x == node.x && got.radius == node.radius));
+            }
+        }
+
+        // the cached spans of the graph are the same decomposition
+        TrunkSpans cached = g.getTrunkSpans(resetIndex);
+        CHECK(cached.offsets == spans.offsets);
+        CHECK(cached.nodes.size() == spans.nodes.size());
+    }
+
+    TrunkSpans spans = g.getTrunkSpans(false);
+    auto parents = g.getTrunkParentMap();
+    REQUIRE(parents.size() == spans.size());
+    for (std::size_t t = 0; t < spans.size(); ++t) CHECK(parents.at(static_cast<int>(t)) == spans.parentTrunk[t]);
+}
+
+TEST_CASE("Segment index queries match brute force"){
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    auto index = g.segmentIndex();
+    CHECK(g.segmentIndex() == index);
+    const Morphology& m = g.getMorphology();
+    REQUIRE(index->size() == m.size());
+
+    // same hierarchy for any thread count
+    SegmentIndex parallel = SegmentIndex::build(m, 4);
+    CHECK(parallel.bvh.order == index->bvh.order);
+    CHECK(parallel.bvh.nodes.size() == index->bvh.nodes.size());
+
+    Aabb bounds;
+    for (const Point3& p : index->nodePoints) bounds.expand(p);
+    std::vector<Point3> queries;
+    for (int k = 0; k < 64; ++k) {
+        Point3 q;
+        for (int a = 0; a < 3; ++a) {
+            double t = std::fmod(0.618033988749895 * (k * 3 + a + 1), 1.0);
+            q[a] = bounds.lo[a] - 5.0 + t * (bounds.hi[a] - bounds.lo[a] + 10.0);
+        }
+        queries.push_back(q);
+    }
+
+    auto dist = [](const Point3& a, const Point3& b) {
+        return std::sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+    };
+    auto batched = index->nearestNodes(queries, 4);
+    for (std::size_t k = 0; k < queries.size(); ++k) {
+        double best = std::numeric_limits<double>::infinity();
+        std::vector<int> within;
+        for (std::size_t i = 0; i < m.size(); ++i) {
+            double d = dist(queries[k], index->nodePoints[i]);
+            best = std::min(best, d);
+            if (d <= 8.0) within.push_back(static_cast<int>(i));
+        }
+        SpatialHit hit = index->nearestNode(queries[k]);
+        CHECK(hit.distance == doctest::Approx(best));
+        CHECK(batched[k].index == hit.index);
+        CHECK(index->nodesWithin(queries[k], 8.0) == within);
+        CHECK(index->nearestSegment(queries[k]).distance <= hit.distance - index->radii[hit.index] + 1e-9);
+    }
+
+    // a ray aimed at a node from outside the bounds hits at or before it
+    const Point3& target = index->nodePoints[m.size() / 2];
+    Point3 origin{bounds.hi[0] + 50.0, target[1], target[2]};
+    SpatialHit ray = index->raycast(origin, {-1.0, 0.0, 0.0});
+    REQUIRE(ray.index != -1);
+    CHECK(ray.distance <= dist(origin, target) + 1e-9);
+
+    // candidate pairs cover every two capsules with overlapping boxes
+    std::set<std::pair<int, int>> candidates;
+    index->bvh.selfOverlaps([&](int i, int j) { CHECK(candidates.insert({i, j}).second); });
+    std::vector<Aabb> boxes(m.size());
+    for (std::size_t i = 0; i < m.size(); ++i) {
+        boxes[i].expand(index->nodePoints[i]);
+        if (index->parentRows[i] != -1) boxes[i].expand(index->nodePoints[index->parentRows[i]]);
+        boxes[i].inflate(index->radii[i]);
+    }
+    for (std::size_t i = 0; i < m.size(); ++i)
+        for (std::size_t j = i + 1; j < m.size(); ++j)
+            if (boxes[i].overlaps(boxes[j])) CHECK(candidates.count({static_cast<int>(i), static_cast<int>(j)}) == 1);
+
+    // the index follows mutations
+    g.setNodes(g.removeSomaSegment());
+    CHECK(g.segmentIndex() != index);
+    CHECK(g.segmentIndex()->size() == g.numberOfNodes());
+}
+
+TEST_CASE("Segment index reports crossing branches"){
+    std::map<int, SWCNode> nodes;
+    nodes[1] = {1, -1, 1, 0.0, 0.0, 0.0, 0.5};
+    nodes[2] = {2, 1, 3, 10.0, 0.0, 0.0, 0.5};
+    nodes[3] = {3, 2, 3, 20.0, 0.0, 0.0, 0.5};
+    nodes[4] = {4, 1, 3, 0.0, 10.0, 0.0, 0.5};
+    nodes[5] = {5, 4, 3, 25.0, -5.0, 0.0, 0.5};
+    NeuronGraph g(nodes);
+    const Morphology& m = g.getMorphology();
+    auto rows = std::make_pair(std::min(m.indexOf(3), m.indexOf(5)), std::max(m.indexOf(3), m.indexOf(5)));
+
+    auto index = g.segmentIndex();
+    CHECK(index->intersections(0) == std::vector<std::pair<int, int>>{rows});
+    CHECK(index->intersections(1) == std::vector<std::pair<int, int>>{rows});
+    CHECK(index->intersections(2).empty());
+
+    SpatialHit inside = index->nearestSegment({15.0, 0.1, 0.0});
+    CHECK(inside.index == m.indexOf(3));
+    CHECK(inside.distance < 0.0);
+    CHECK(index->raycast({15.0, 0.0, 10.0}, {0.0, 0.0, -2.0}).distance == doctest::Approx(9.5));
+}
+
+TEST_CASE("Synthetic morphologies are reproducible trees of the requested size"){
+    auto sameNodes = [](const std::map<int, SWCNode>& a, const std::map<int, SWCNode>& b) {
+        if (a.size() != b.size()) return false;
+        for (auto ia = a.begin(), ib = b.begin(); ia != a.end(); ++ia, ++ib) {
+            const SWCNode& p = ia->second;
+            const SWCNode& q = ib->second;
+            if (ia->first != ib->first || p.pid != q.pid || p.type != q.type ||
+                p.x != q.x || p.y != q.y || p.z != q.z || p.radius != q.radius) return false;
+        }
+        return true;
+    };
+    for (SyntheticSoma soma : {SyntheticSoma::None, SyntheticSoma::Point, SyntheticSoma::ThreePoint, SyntheticSoma::Cylinder}) {
+        for (int n : {1, 2, 6, 1000, 20000}) {
+            SyntheticMorphologyOptions options;
+            options.nodes = n;
+            options.seed = 11;
+            options.soma = soma;
+            auto nodes = generateMorphology(options);
+            REQUIRE(nodes.size() == static_cast<std::size_t>(n));
+            CHECK(nodes.begin()->first == 1);
+            CHECK(nodes.rbegin()->first == n);
+            int roots = 0;
+            for (const auto& [id, node] : nodes) {
+                CHECK(node.id == id);
+                if (node.pid == -1) ++roots;
+                else CHECK((node.pid >= 1 && node.pid < id));
+                CHECK(node.radius > 0.0);
+            }
+            CHECK(roots == 1);
+            CHECK(sameNodes(generateMorphology(options), nodes));
+        }
+    }
+
+    SyntheticMorphologyOptions options;
+    auto first = generateMorphology(options);
+    options.seed = 2;
+    CHECK(!sameNodes(generateMorphology(options), first));
+
+    // the soma configurations
+    options.nodes = 500;
+    options.soma = SyntheticSoma::ThreePoint;
+    auto threePoint = generateMorphology(options);
+    CHECK(threePoint[2].type == 1);
+    CHECK(threePoint[3].type == 1);
+    CHECK(threePoint[4].type != 1);
+    options.soma = SyntheticSoma::Cylinder;
+    options.somaNodes = 7;
+    auto cylinder = generateMorphology(options);
+    for (int id = 1; id <= 7; ++id) CHECK(cylinder[id].type == 1);
+    CHECK(cylinder[8].type != 1);
+    CHECK(cylinder[8].pid == 4);
+    options.soma = SyntheticSoma::None;
+    for (const auto& [id, node] : generateMorphology(options)) CHECK(node.type == 3);
+    CHECK(syntheticSomaFromString("three-point") == SyntheticSoma::ThreePoint);
+    CHECK_THROWS_AS(syntheticSomaFromString("sphere"), std::invalid_argument);
+}
+
+TEST_CASE("Synthetic morphology options shape the tree"){
+    SyntheticMorphologyOptions options;
+    options.nodes = 20000;
+    options.branchingFactor = 3;
+    NeuronGraph g(generateMorphology(options));
+    std::map<int, int> children;
+    for (const auto& [id, node] : g.getNodes())
+        if (node.pid != -1) ++children[node.pid];
+    int trifurcations = 0;
+    for (const auto& [id, count] : children) {
+        if (id == 1) continue;
+        CHECK(count <= 3);
+        if (count == 3) ++trifurcations;
+    }
+    CHECK(trifurcations > 0);
+    auto trunks = g.getTrunks(false);
+    CHECK(trunks.size() > static_cast<std::size_t>(options.stems));
+
+    // without tortuosity and branching every stem is a straight line of unit steps
+    options.nodes = 401;
+    options.tortuosity = 0.0;
+    options.branchProbability = 0.0;
+    auto nodes = generateMorphology(options);
+    int tips = 0;
+    for (const auto& [id, node] : nodes) {
+        if (node.pid <= 1) continue;
+        const SWCNode& p = nodes.at(node.pid);
+        CHECK(std::hypot(node.x - p.x, node.y - p.y, node.z - p.z) == doctest::Approx(1.0));
+        if (p.pid > 1) {
+            const SWCNode& q = nodes.at(p.pid);
+            double cross = std::hypot((p.y - q.y) * (node.z - p.z) - (p.z - q.z) * (node.y - p.y),
+                                      (p.z - q.z) * (node.x - p.x) - (p.x - q.x) * (node.z - p.z),
+                                      (p.x - q.x) * (node.y - p.y) - (p.y - q.y) * (node.x - p.x));
+            CHECK(cross == doctest::Approx(0.0));
+        }
+    }
+    std::set<int> parents;
+    for (const auto& [id, node] : nodes) parents.insert(node.pid);
+    for (const auto& [id, node] : nodes) if (!parents.count(id)) ++tips;
+    CHECK(tips == options.stems);
+
+    // a size sweep keeps the growth statistics: roughly one branch point per 1 / branchProbability nodes
+    options = SyntheticMorphologyOptions();
+    for (int n : {1000, 10000, 100000}) {
+        options.nodes = n;
+        std::map<int, int> counts;
+        for (const auto& [id, node] : generateMorphology(options)) if (node.pid > 1) ++counts[node.pid];
+        int branchPoints = 0;
+        for (const auto& [id, count] : counts) if (count > 1) ++branchPoints;
+        CHECK(branchPoints > n * options.branchProbability / 2);
+        CHECK(branchPoints < n * options.branchProbability * 2);
+    }
+}
+
+TEST_CASE("Morphometrics of a small tree"){
+    // soma, a straight stem to a branch point at x = 10, then a short and a bent branch
+    std::map<int, SWCNode> nodes = {
+        {1, {1, -1, 1, 0, 0, 0, 1}},
+        {2, {2, 1, 3, 5, 0, 0, 1}},
+        {3, {3, 2, 3, 10, 0, 0, 1}},
+        {4, {4, 3, 3, 13, 4, 0, 1}},
+        {5, {5, 3, 3, 10, 6, 0, 1}},
+        {6, {6, 5, 3, 10, 6, 3, 1}},
+    };
+    NeuronGraph g(nodes);
+    MorphometricsOptions options;
+    options.shollStep = 5.0;
+    Morphometrics m = g.morphometrics(options);
+
+    CHECK(m.totalLength == doctest::Approx(24.0));
+    CHECK(m.totalArea == doctest::Approx(48.0 * M_PI));
+    CHECK(m.totalVolume == doctest::Approx(24.0 * M_PI));
+    REQUIRE(m.lengthByType.size() == 4);
+    CHECK(m.lengthByType[1] == 0.0);
+    CHECK(m.lengthByType[3] == doctest::Approx(24.0));
+    CHECK(m.branchPoints == 1);
+    CHECK(m.tips == 2);
+    CHECK(m.stems == 1);
+    CHECK(m.maxBranchOrder == 1);
+    CHECK(m.maxPathDistance == doctest::Approx(19.0));
+    CHECK(m.segmentLength == std::vector<double>{0, 5, 5, 5, 6, 3});
+    CHECK(m.pathDistance == std::vector<double>{0, 5, 10, 15, 16, 19});
+    CHECK(m.branchOrder == std::vector<int>{0, 0, 0, 1, 1, 1});
+
+    CHECK(m.sectionRows == std::vector<int>{0, 1, 2, 3, 4, 5});
+    CHECK(m.sectionOffsets == std::vector<int>{0, 3, 4, 6});
+    CHECK(m.sectionParent == std::vector<int>{-1, 0, 0});
+    CHECK(m.sectionOrder == std::vector<int>{0, 1, 1});
+    CHECK(m.sectionLength == std::vector<double>{10, 5, 9});
+    CHECK(m.sectionTortuosity[0] == doctest::Approx(1.0));
+    CHECK(m.sectionTortuosity[1] == doctest::Approx(1.0));
+    CHECK(m.sectionTortuosity[2] == doctest::Approx(9.0 / std::sqrt(45.0)));
+
+    // the farthest node is at sqrt(185) < 15; a segment ending on a sphere crosses it
+    CHECK(m.shollCenter == std::array<double, 3>{0, 0, 0});
+    CHECK(m.shollRadii == std::vector<double>{5, 10, 15});
+    CHECK(m.shollIntersections == std::vector<int>{1, 1, 0});
+
+    options.shollStep = 0.0;
+    CHECK_THROWS_AS(g.morphometrics(options), std::invalid_argument);
+    CHECK(NeuronGraph(std::map<int, SWCNode>{}).morphometrics().sectionOffsets == std::vector<int>{0});
+}
+
+TEST_CASE("Morphometrics match a node-by-node computation"){
+    NeuronGraph g;
+    g.readFromFile(getExecutableDir() + "/../data/neuron.swc");
+    auto nodes = g.getNodes();
+    Morphometrics m = g.morphometrics();
+
+    std::map<int, int> children;
+    for (const auto& [id, node] : nodes)
+        if (node.pid != -1) ++children[node.pid];
+    double length = 0.0, area = 0.0;
+    std::map<int, double> lengthByType;
+    int tips = 0, branchPoints = 0;
+    for (const auto& [id, node] : nodes) {
+        if (node.type != 1 && children[id] == 0) ++tips;
+        if (node.type != 1 && children[id] >= 2) ++branchPoints;
+        if (node.pid == -1) continue;
+        const SWCNode& p = nodes.at(node.pid);
+        double l = std::hypot(node.x - p.x, node.y - p.y, node.z - p.z);
+        length += l;
+        area += M_PI * (node.radius + p.radius) * std::hypot(l, node.radius - p.radius);
+        lengthByType[node.type] += l;
+    }
+    CHECK(m.totalLength == doctest::Approx(length));
+    CHECK(m.totalArea == doctest::Approx(area));
+    for (const auto& [type, l] : lengthByType) CHECK(m.lengthByType[type] == doctest::Approx(l));
+    CHECK(m.tips == tips);
+    CHECK(m.branchPoints == branchPoints);
+
+    // path distance and branch order by walking up from every node
+    const Morphology& morph = g.getMorphology();
+    double sectionTotal = 0.0;
+    for (double l : m.sectionLength) sectionTotal += l;
+    CHECK(sectionTotal == doctest::Approx(length));
+    for (std::size_t row = 0; row < morph.size(); ++row) {
+        double path = 0.0;
+        int order = 0;
+        for (int id = morph.id[row]; nodes.at(id).pid != -1; id = nodes.at(id).pid) {
+            const SWCNode& node = nodes.at(id);
+            const SWCNode& p = nodes.at(node.pid);
+            path += std::hypot(node.x - p.x, node.y - p.y, node.z - p.z);
+            if (p.type != 1 && children[p.id] >= 2) ++order;
+        }
+        CHECK(m.pathDistance[row] == doctest::Approx(path));
+        CHECK(m.branchOrder[row] == order);
+    }
+
+    // Sholl counts by testing every segment against every sphere
+    for (std::size_t k = 0; k < m.shollRadii.size(); ++k) {
+        int crossings = 0;
+        for (const auto& [id, node] : nodes) {
+            if (node.pid == -1) continue;
+            const SWCNode& p = nodes.at(node.pid);
+            if (node.type == 1 && p.type == 1) continue;
+            double a = std::hypot(node.x - m.shollCenter[0], node.y - m.shollCenter[1], node.z - m.shollCenter[2]);
+            double b = std::hypot(p.x - m.shollCenter[0], p.y - m.shollCenter[1], p.z - m.shollCenter[2]);
+            if (std::min(a, b) < m.shollRadii[k] && m.shollRadii[k] <= std::max(a, b)) ++crossings;
+        }
+        CHECK(m.shollIntersections[k] == crossings);
+    }
+}
+
+TEST_CASE("Morphometrics do not depend on the thread count"){
+    SyntheticMorphologyOptions synthetic;
+    synthetic.nodes = 100000;
+    NeuronGraph g(generateMorphology(synthetic));
+    MorphometricsOptions options;
+    Morphometrics serial = g.morphometrics(options);
+    options.threads = 4;
+    Morphometrics parallel = g.morphometrics(options);
+
+    CHECK(serial.totalLength == parallel.totalLength);
+    CHECK(serial.totalArea == parallel.totalArea);
+    CHECK(serial.totalVolume == parallel.totalVolume);
+    CHECK(serial.areaByType == parallel.areaByType);
+    CHECK(serial.pathDistance == parallel.pathDistance);
+    CHECK(serial.branchOrder == parallel.branchOrder);
+    CHECK(serial.sectionTortuosity == parallel.sectionTortuosity);
+    CHECK(serial.shollIntersections == parallel.shollIntersections);
+    CHECK(serial.sectionOffsets.size() > 1000);
+    CHECK(serial.sectionRows.size() == g.numberOfNodes());
+}
+
+TEST_CASE("Copies of a graph get their own access lock"){
+    SyntheticMorphologyOptions synthetic;
+    synthetic.nodes = 100;
+    NeuronGraph g(generateMorphology(synthetic));
+    std::unique_lock<std::shared_mutex> writer(g.accessMutex());
+
+    NeuronGraph copy(g);
+    CHECK(copy.numberOfNodes() == g.numberOfNodes());
+    CHECK(copy.accessMutex().try_lock());
+    copy.accessMutex().unlock();
+
+    NeuronGraph assigned;
+    assigned = g;
+    CHECK(assigned.accessMutex().try_lock_shared());
+    assigned.accessMutex().unlock_shared();
+}
+
+TEST_CASE("Compressed SWC and UGX files read back like plain files"){
+    auto slurp = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    const std::string dir = getExecutableDir() + "/../output/test_output/";
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    g.writeToFile(dir + "plain.swc");
+    g.writeToFileUGX(dir + "plain.ugx");
+
+    for (Compression compression : {Compression::Gzip, Compression::Zstd}) {
+        if (!compressionAvailable(compression)) continue;
+        const std::string suffix = compression == Compression::Gzip ? ".gz" : ".zst";
+        INFO("Suffix: " << suffix);
+        CHECK(compressionFromFilename("neuron.swc" + suffix) == compression);
+
+        g.writeToFile(dir + "compressed.swc" + suffix);
+        g.writeToFileUGX(dir + "compressed.ugx" + suffix);
+        CHECK(slurp(dir + "compressed.swc" + suffix).size() < slurp(dir + "plain.swc").size());
+
+        MappedFile swc(dir + "compressed.swc" + suffix), ugx(dir + "compressed.ugx" + suffix);
+        REQUIRE(swc.isOpen());
+        REQUIRE(ugx.isOpen());
+        CHECK(std::string(swc.view()) == slurp(dir + "plain.swc"));
+        CHECK(std::string(ugx.view()) == slurp(dir + "plain.ugx"));
+
+        NeuronGraph fromSwc(dir + "compressed.swc" + suffix);
+        NeuronGraph fromUgx(dir + "compressed.ugx" + suffix);
+        CHECK(fromSwc.numberOfNodes() == g.numberOfNodes());
+        CHECK(fromUgx.numberOfNodes() == g.numberOfNodes());
+
+        // the DOM backend hands compressed names to the streaming backend
+        const UgxBackend previous = getUgxBackend();
+        setUgxBackend(UgxBackend::DOM);
+        g.writeToFileUGX(dir + "dom.ugx" + suffix);
+        NeuronGraph fromDom(dir + "dom.ugx" + suffix);
+        setUgxBackend(previous);
+        CHECK(fromDom.numberOfNodes() == g.numberOfNodes());
+
+        // a truncated file fails to open instead of yielding partial data
+        std::string bytes = slurp(dir + "compressed.swc" + suffix);
+        std::ofstream(dir + "truncated.swc" + suffix, std::ios::binary).write(bytes.data(), bytes.size() / 2);
+        CHECK_FALSE(MappedFile(dir + "truncated.swc" + suffix).isOpen());
+    }
+}
+
+TEST_CASE("Multithreaded compression decompresses to the same bytes"){
+    std::string text;
+    for (int i = 0; i < 400000; ++i) text += std::to_string(i) + " " + std::to_string(i * 0.25) + "\n";
+    const std::string dir = getExecutableDir() + "/../output/test_output/";
+
+    for (Compression compression : {Compression::Gzip, Compression::Zstd}) {
+        if (!compressionAvailable(compression)) continue;
+        const std::string name = dir + "threads" + (compression == Compression::Gzip ? ".txt.gz" : ".txt.zst");
+        for (std::size_t threads : {1, 4}) {
+            INFO("Threads: " << threads);
+            CompressionOptions options;
+            options.threads = threads;
+            CompressedFileWriter writer;
+            REQUIRE(writer.open(name, options));
+            // uneven pieces so blocks straddle writes
+            for (std::size_t pos = 0; pos < text.size(); pos += 70001) {
+                CHECK(writer.write(std::string_view(text).substr(pos, 70001)));
+            }
+            REQUIRE(writer.close());
+
+            MappedFile file(name);
+            REQUIRE(file.isOpen());
+            CHECK(file.view() == text);
+        }
+
+        std::string error;
+        std::vector<char> output;
+        CHECK_FALSE(decompressBuffer(compression, "definitely not compressed", output, error));
+        CHECK_FALSE(error.empty());
+    }
+
+    // an empty compressed file is still a valid one
+    if (compressionAvailable(Compression::Gzip)) {
+        CompressedFileWriter writer;
+        REQUIRE(writer.open(dir + "empty.txt.gz"));
+        REQUIRE(writer.close());
+        MappedFile file(dir + "empty.txt.gz");
+        CHECK(file.isOpen());
+        CHECK(file.size() == 0);
+    }
+}
+
+#ifndef NEURONMESHER_NO_INSTRUMENTATION
+TEST_CASE("Metrics record stage timings and counters"){
+    Metrics& metrics = Metrics::instance();
+    const bool wasEnabled = metrics.enabled();
+    const LogLevel wasLevel = logLevel();
+    metrics.reset();
+    metrics.setTracing(true);
+    setLogLevel(LogLevel::Quiet);
+
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    auto trunks = g.getTrunks(false);
+    double delta = 2.0;
+    g.allLinearSplineResampledTrunks(trunks, delta);
+
+    auto stages = metrics.stages();
+    auto counters = metrics.counters();
+    REQUIRE(stages.count("readSWC") == 1);
+    CHECK(stages["readSWC"].calls == 1);
+    CHECK(stages["readSWC"].totalSeconds >= stages["readSWC"].maxSeconds);
+    CHECK(stages.count("getTrunks") == 1);
+    CHECK(stages.count("linearResample") == 1);
+    CHECK(counters["nodes.read"] == static_cast<std::int64_t>(g.numberOfNodes()));
+    CHECK(counters["bytes.read"] > 0);
+    CHECK(counters["trunks"] == static_cast<std::int64_t>(trunks.size()));
+
+    const std::string dir = getExecutableDir() + "/../output/test_output/";
+    REQUIRE(metrics.writeChromeTrace(dir + "metrics_trace.json"));
+    REQUIRE(metrics.writeJson(dir + "metrics.json"));
+    std::ifstream trace(dir + "metrics_trace.json");
+    std::stringstream text;
+    text << trace.rdbuf();
+    CHECK(text.str().find("\"name\": \"readSWC\", \"ph\": \"X\"") != std::string::npos);
+
+    // with collection off nothing is recorded
+    metrics.setTracing(false);
+    metrics.setEnabled(false);
+    metrics.reset();
+    g.getTrunks(false);
+    CHECK(metrics.stages().empty());
+    CHECK(metrics.counters().empty());
+
+    metrics.setEnabled(wasEnabled);
+    setLogLevel(wasLevel);
+}
+#endif
+
 TEST_CASE("Get Neighbor Map"){
     std::string inputfile = getExecutableDir() + "/../data/neuron.ugx";
     NeuronGraph g(inputfile);
@@ -3,7 +3,12 @@
 #include "project/ugxobject.h"
 #include "project/neurongraph.h"
 #include "project/utils.h"
+#include "project/spatialindex.h"
+#include "project/resultcache.h"
+#include "project/trunkbatch.h"
+#include "project/compression.h"
 #include <filesystem>
+#include <fstream>
 
 TEST_CASE("UGXObject default constructor") {
     UgxObject u;
@@ -211,4 +216,655 @@ TEST_CASE("Write .ugx containing radii"){
     std::string outputugx = getExecutableDir() + "/../output/test_output/test_ugx_with_radius.ugx";
     g.writeUGX(outputugx);
     CHECK(true);
-}
\ No newline at end of file
+}
+TEST_CASE("Streaming UGX backend matches the DOM backend"){
+    auto slurp = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    std::string output = getExecutableDir() + "/../output/test_output/";
+    std::vector<std::string> inputs = {getExecutableDir() + "/../data/neuron.ugx"};
+    for (const auto& entry : std::filesystem::directory_iterator(getExecutableDir() + "/../data/UGXMESHES"))
+        inputs.push_back(entry.path().string());
+
+    for (const auto& input : inputs) {
+        INFO("Input: " << input);
+        UgxObject dom, stream;
+        dom.readUGX(input);
+        stream.readUGXStream(input);
+
+        const auto& a = dom.getGeometry();
+        const auto& b = stream.getGeometry();
+        REQUIRE(a.points.size() == b.points.size());
+        CHECK(a.edges == b.edges);
+        CHECK(a.faces == b.faces);
+        CHECK(a.radii == b.radii);
+        CHECK(a.subsetNames == b.subsetNames);
+        CHECK(a.vertexSubsets == b.vertexSubsets);
+        CHECK(a.edgeSubsets == b.edgeSubsets);
+        CHECK(a.faceSubsets == b.faceSubsets);
+
+        dom.writeUGX(output + "dom_backend.ugx");
+        dom.writeUGXStream(output + "stream_backend.ugx");
+        CHECK(slurp(output + "dom_backend.ugx") == slurp(output + "stream_backend.ugx"));
+    }
+}
+
+TEST_CASE("Compressed UGX meshes round trip"){
+    if (!compressionAvailable(Compression::Gzip)) return;
+    std::string output = getExecutableDir() + "/../output/test_output/";
+    UgxObject mesh;
+    mesh.readUGX(getExecutableDir() + "/../data/neuron.ugx");
+    mesh.writeUGX(output + "mesh_plain.ugx");
+    mesh.writeUGX(output + "mesh.ugx.gz");
+
+    MappedFile plain(output + "mesh_plain.ugx"), compressed(output + "mesh.ugx.gz");
+    REQUIRE(compressed.isOpen());
+    CHECK(plain.view() == compressed.view());
+
+    UgxObject back;
+    back.readUGX(output + "mesh.ugx.gz");
+    CHECK(back.getGeometry().points.size() == mesh.getGeometry().points.size());
+    CHECK(back.getGeometry().edges == mesh.getGeometry().edges);
+    CHECK(back.getGeometry().faceSubsets == mesh.getGeometry().faceSubsets);
+}
+
+TEST_CASE("UGXObject binary cache round trip"){
+    std::string input = getExecutableDir() + "/../data/UGXMESHES/twosubsets.ugx";
+    std::string output = getExecutableDir() + "/../output/test_output/twosubsets.bin";
+    UgxObject u(input);
+    u.writeBIN(output);
+
+    UgxObject u2;
+    u2.readBIN(output);
+    const auto& a = u.getGeometry();
+    const auto& b = u2.getGeometry();
+    REQUIRE(a.points.size() == b.points.size());
+    CHECK(a.points.at(4).x == b.points.at(4).x);
+    CHECK(a.edges == b.edges);
+    CHECK(a.faces == b.faces);
+    CHECK(a.radii == b.radii);
+    CHECK(a.subsetNames == b.subsetNames);
+    CHECK(a.vertexSubsets == b.vertexSubsets);
+    CHECK(a.faceSubsets == b.faceSubsets);
+}
+
+TEST_CASE("Single precision meshes and binary files"){
+    std::map<int, SWCNode> path;
+    for (int i = 1; i <= 20; ++i) path[i] = {i, i - 1, 3, 0.37 * i, std::sin(0.3 * i), 100.0 + 0.1 * i, 1.0 + 0.01 * i};
+    path[1].pid = -1;
+    DenseUgxGeometry tube = NeuronGraph::pftDenseFromPath(path, 8);
+
+    DenseUgxGeometry32 narrow = tube.convert<float>();
+    REQUIRE(narrow.points.size() == tube.points.size());
+    CHECK(sizeof(narrow.points[0]) * 2 == sizeof(tube.points[0]));
+    CHECK(narrow.edges == tube.edges);
+    CHECK(narrow.faces == tube.faces);
+    for (std::size_t i = 0; i < tube.points.size(); ++i) {
+        CHECK(narrow.points[i].x == static_cast<float>(tube.points[i].x));
+        CHECK(narrow.radii[i] == static_cast<float>(tube.radii[i]));
+    }
+
+    // merging and compaction work on the stored precision
+    DenseUgxGeometry merged = tube, shifted = tube;
+    merged.append(shifted);
+    DenseUgxGeometry32 merged32;
+    merged32.appendAll({narrow, narrow}, 2);
+    REQUIRE(merged32.points.size() == merged.points.size());
+    merged.compact();
+    merged32.compact(1e-5);
+    CHECK(merged32.points.size() == merged.points.size());
+    CHECK(merged32.edges.size() == merged.edges.size());
+    CHECK(merged32.faces.size() == merged.faces.size());
+    CHECK(merged32.convert<double>().points[5].y == doctest::Approx(merged.points[5].y).epsilon(1e-6));
+
+    // the text keeps six significant digits, so both precisions read back alike
+    const std::string dir = getExecutableDir() + "/../output/test_output/";
+    UgxObject::writeDenseUGX(tube, dir + "tube64.ugx");
+    UgxObject::writeDenseUGX(narrow, dir + "tube32.ugx");
+    DenseUgxGeometry a = UgxObject::readDenseUGX(dir + "tube64.ugx");
+    DenseUgxGeometry b = UgxObject::readDenseUGX(dir + "tube32.ugx");
+    REQUIRE(a.points.size() == b.points.size());
+    for (std::size_t i = 0; i < a.points.size(); ++i) CHECK(b.points[i].z == doctest::Approx(a.points[i].z).epsilon(1e-5));
+
+    UgxObject object(tube.toGeometry());
+    object.writeBIN(dir + "tube64.bin");
+    object.writeBIN(dir + "tube32.bin", StoragePrecision::Float32);
+    CHECK(std::filesystem::file_size(dir + "tube32.bin") < std::filesystem::file_size(dir + "tube64.bin"));
+    UgxObject loaded;
+    loaded.readBIN(dir + "tube32.bin");
+    const auto& g = loaded.getGeometry();
+    REQUIRE(g.points.size() == tube.points.size());
+    CHECK(g.edges == tube.edges);
+    CHECK(g.points.at(7).x == static_cast<double>(static_cast<float>(tube.points[7].x)));
+    CHECK(g.radii.at(7) == static_cast<double>(static_cast<float>(tube.radii[7])));
+}
+
+TEST_CASE("Tube mesh from a parallel transport frame path"){
+    // Straight path along x with growing radius
+    std::map<int, SWCNode> path;
+    for (int i = 1; i <= 4; ++i) path[i] = {i, i == 1 ? -1 : i - 1, 3, 2.0 * i, 1.0, -1.0, 0.5 * i};
+
+    NeuronGraph g;
+    const int segments = 8;
+    auto geom = g.pftFromPath(path, segments).getGeometry();
+
+    CHECK(geom.points.size() == 4 * segments);
+    CHECK(geom.radii.size() == geom.points.size());
+    CHECK(geom.edges.size() == 4 * 3 * segments);
+    CHECK(geom.faces.size() == 2 * 3 * segments);
+    CHECK(geom.edgeSubsets.size() == geom.edges.size());
+    CHECK(geom.faceSubsets.size() == geom.faces.size());
+    CHECK(geom.subsetNames.at(3) == "Dendrite");
+
+    // Every ring vertex lies on a circle of the node's radius around the node
+    for (const auto& [vid, p] : geom.points) {
+        const SWCNode& n = path.at(vid / segments + 1);
+        double dist = std::sqrt((p.x - n.x) * (p.x - n.x) + (p.y - n.y) * (p.y - n.y) + (p.z - n.z) * (p.z - n.z));
+        CHECK(dist == doctest::Approx(n.radius));
+        CHECK(p.x == doctest::Approx(n.x));
+    }
+}
+
+TEST_CASE("Specialized tube kernels match the generic ring"){
+    std::map<int, SWCNode> path;
+    for (int i = 1; i <= 5; ++i) path[i] = {i, i == 1 ? -1 : i - 1, 3, 1.5 * i, 0.3 * i * i, 0.5, 0.2 + 0.1 * i};
+
+    // 8, 16 and 32 use the compile-time kernels, 4 and 64 the generic one; every
+    // ring of m vertices contains the ring of m / 2 vertices at its even positions
+    std::map<int, DenseUgxGeometry> tubes;
+    for (int segments : {4, 8, 16, 32, 64}) tubes[segments] = NeuronGraph::pftDenseFromPath(path, segments);
+    for (int segments : {8, 16, 32, 64}) {
+        const DenseUgxGeometry& fine = tubes.at(segments);
+        const DenseUgxGeometry& coarse = tubes.at(segments / 2);
+        CHECK(fine.points.size() == 5 * static_cast<std::size_t>(segments));
+        CHECK(fine.faces.size() == 2 * 4 * static_cast<std::size_t>(segments));
+        CHECK(fine.edges.size() == 4 * 4 * static_cast<std::size_t>(segments));
+        for (int ring = 0; ring < 5; ++ring)
+            for (int j = 0; j < segments / 2; ++j) {
+                const Coordinates& a = coarse.points[ring * segments / 2 + j];
+                const Coordinates& b = fine.points[ring * segments + 2 * j];
+                CHECK(a.x == doctest::Approx(b.x).epsilon(1e-12));
+                CHECK(a.y == doctest::Approx(b.y).epsilon(1e-12));
+                CHECK(a.z == doctest::Approx(b.z).epsilon(1e-12));
+            }
+    }
+
+    // the quad of the last segment closes the ring
+    const DenseUgxGeometry& tube = tubes.at(16);
+    CHECK(tube.faces[2 * 15] == std::array<int, 3>{15, 0, 31});
+}
+
+TEST_CASE("Tube batch buffers match the per-trunk tubes"){
+    NeuronGraph g(getExecutableDir() + "/../data/neuron.swc");
+    auto trunks = g.getTrunks(false);
+    TrunkBatch batch = resampleTrunkBatchCubic(TrunkBatch::fromTrunks(trunks), 2.0, 2);
+    batch.append({{1, {1, -1, 3, 0.0, 0.0, 0.0, 1.0}}});   // a single node has no tube
+
+    for (int segments : {6, 16}) {
+        INFO("Segments: " << segments);
+        TubeBuffers serial = meshTubeBatch(batch, segments);
+        TubeBuffers parallel = meshTubeBatch(batch, segments, 4);
+        CHECK(serial.vertices == parallel.vertices);
+        CHECK(serial.triangles == parallel.triangles);
+
+        TubeBatchLayout layout = tubeBatchLayout(batch, segments);
+        REQUIRE(serial.vertices.size() == 3 * layout.vertices());
+        REQUIRE(serial.triangles.size() == 3 * layout.triangles());
+        CHECK(layout.vertexOffsets[batch.size()] == layout.vertexOffsets[batch.size() - 1]);
+
+        for (std::size_t t = 0; t < batch.size(); ++t) {
+            DenseUgxGeometry32 tube = NeuronGraph::pftDenseFromPath(batch.trunk(t), segments).convert<float>();
+            const std::size_t base = layout.vertexOffsets[t];
+            REQUIRE(tube.points.size() == layout.vertexOffsets[t + 1] - base);
+            REQUIRE(tube.faces.size() == layout.triangleOffsets[t + 1] - layout.triangleOffsets[t]);
+            bool same = true;
+            for (std::size_t v = 0; v < tube.points.size(); ++v) {
+                const float* p = &serial.vertices[3 * (base + v)];
+                same = same && p[0] == tube.points[v].x && p[1] == tube.points[v].y && p[2] == tube.points[v].z;
+            }
+            for (std::size_t f = 0; f < tube.faces.size(); ++f) {
+                const std::uint32_t* tri = &serial.triangles[3 * (layout.triangleOffsets[t] + f)];
+                for (int k = 0; k < 3; ++k) same = same && tri[k] == base + tube.faces[f][k];
+            }
+            CHECK(same);
+        }
+    }
+}
+
+TEST_CASE("Geometry builder matches repeated addUGXGeometry"){
+    std::vector<UgxGeometry> parts;
+    NeuronGraph g;
+    for (int k = 0; k < 5; ++k) {
+        std::map<int, SWCNode> path;
+        for (int i = 1; i <= 3 + k; ++i) path[i] = {i, i == 1 ? -1 : i - 1, 2 + k % 2, 1.0 * i, 0.5 * k, 0.0, 0.3};
+        parts.push_back(g.pftFromPath(path, 6).getGeometry());
+    }
+    parts.insert(parts.begin() + 2, UgxGeometry{});   // empty parts do not shift offsets
+
+    UgxObject tempObj;
+    UgxGeometry expected;
+    for (const auto& p : parts) expected = tempObj.addUGXGeometry(expected, p);
+
+    auto same = [](const UgxGeometry& a, const UgxGeometry& b) {
+        if (a.points.size() != b.points.size()) return false;
+        for (auto ia = a.points.begin(), ib = b.points.begin(); ia != a.points.end(); ++ia, ++ib)
+            if (ia->first != ib->first || ia->second.x != ib->second.x || ia->second.z != ib->second.z) return false;
+        return a.edges == b.edges && a.faces == b.faces && a.radii == b.radii &&
+               a.vertexSubsets == b.vertexSubsets && a.edgeSubsets == b.edgeSubsets &&
+               a.faceSubsets == b.faceSubsets && a.subsetNames == b.subsetNames;
+    };
+
+    UgxGeometryBuilder incremental;
+    for (const auto& p : parts) incremental.append(p);
+    CHECK(same(incremental.geometry(), expected));
+
+    UgxGeometryBuilder batched;
+    batched.append(parts[0]);
+    batched.appendAll(std::vector<UgxGeometry>(parts.begin() + 1, parts.end()), 3);
+    CHECK(same(batched.geometry(), expected));
+
+    UgxGeometry released = batched.release();
+    CHECK(same(released, expected));
+    CHECK(batched.geometry().points.empty());
+}
+
+TEST_CASE("Dense geometry matches the map geometry"){
+    auto slurp = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    std::string output = getExecutableDir() + "/../output/test_output/";
+    for (const char* name : {"twosubsets.ugx", "sphere.ugx", "sphereNoFaceNoEdge.ugx"}) {
+        std::string input = getExecutableDir() + "/../data/UGXMESHES/" + name;
+        INFO("Input: " << input);
+        UgxObject u(input);
+        DenseUgxGeometry dense = UgxObject::readDenseUGX(input);
+        UgxGeometry back = dense.toGeometry();
+        const auto& a = u.getGeometry();
+        REQUIRE(back.points.size() == a.points.size());
+        CHECK(back.edges == a.edges);
+        CHECK(back.faces == a.faces);
+        CHECK(back.radii == a.radii);
+        CHECK(back.vertexSubsets == a.vertexSubsets);
+        CHECK(back.edgeSubsets == a.edgeSubsets);
+        CHECK(back.faceSubsets == a.faceSubsets);
+        CHECK(back.subsetNames == a.subsetNames);
+
+        // buckets hold every element of a subset, in increasing order
+        auto members = dense.subsetMembers();
+        REQUIRE(members.size() == a.subsetNames.size());
+        std::size_t slot = 0;
+        for (const auto& [id, _] : a.subsetNames) {
+            std::vector<int> expected;
+            for (const auto& [f, sid] : a.faceSubsets) if (sid == id) expected.push_back(f);
+            CHECK(members[slot++].faces == expected);
+        }
+
+        u.writeUGX(output + "map_writer.ugx");
+        UgxObject::writeDenseUGX(dense, output + "dense_writer.ugx");
+        CHECK(slurp(output + "map_writer.ugx") == slurp(output + "dense_writer.ugx"));
+    }
+
+    // sparse vertex keys are padded, unknown subsets dropped
+    UgxGeometry sparse;
+    sparse.points[0] = {1, 2, 3};
+    sparse.points[2] = {4, 5, 6};
+    sparse.vertexSubsets[2] = 1;
+    sparse.vertexSubsets[7] = 1;
+    DenseUgxGeometry padded = DenseUgxGeometry::fromGeometry(sparse);
+    REQUIRE(padded.points.size() == 3);
+    CHECK(padded.points[1].x == 0.0);
+    CHECK(padded.vertexSubsets == std::vector<int>{-1, -1, 1});
+    CHECK(padded.radii.empty());
+}
+
+TEST_CASE("Dense tube meshes append like the geometry builder"){
+    NeuronGraph g;
+    UgxGeometryBuilder builder;
+    DenseUgxGeometry merged;
+    std::vector<DenseUgxGeometry> tubes;
+    for (int k = 0; k < 4; ++k) {
+        std::map<int, SWCNode> path;
+        for (int i = 1; i <= 3 + k; ++i) path[i] = {i, i == 1 ? -1 : i - 1, 2 + k % 2, 1.0 * i, 0.5 * k, 0.0, 0.3};
+        DenseUgxGeometry tube = NeuronGraph::pftDenseFromPath(path, 6);
+        UgxGeometry mapped = g.pftFromPath(path, 6).getGeometry();
+        CHECK(tube.points.size() == mapped.points.size());
+        CHECK(tube.faces == mapped.faces);
+        builder.append(mapped);
+        merged.append(tube);
+        tubes.push_back(tube);
+    }
+
+    // one parallel pass over all parts gives the same geometry as appending one by one
+    DenseUgxGeometry batched;
+    batched.appendAll(tubes, 3);
+    CHECK(batched.points.size() == merged.points.size());
+    CHECK(batched.edges == merged.edges);
+    CHECK(batched.faces == merged.faces);
+    CHECK(batched.radii == merged.radii);
+    CHECK(batched.vertexSubsets == merged.vertexSubsets);
+    CHECK(batched.faceSubsets == merged.faceSubsets);
+    CHECK(batched.subsetNames == merged.subsetNames);
+
+    UgxGeometry a = merged.toGeometry();
+    const UgxGeometry& b = builder.geometry();
+    REQUIRE(a.points.size() == b.points.size());
+    CHECK(a.points.rbegin()->second.y == b.points.rbegin()->second.y);
+    CHECK(a.edges == b.edges);
+    CHECK(a.faces == b.faces);
+    CHECK(a.radii == b.radii);
+    CHECK(a.vertexSubsets == b.vertexSubsets);
+    CHECK(a.edgeSubsets == b.edgeSubsets);
+    CHECK(a.faceSubsets == b.faceSubsets);
+    CHECK(a.subsetNames == b.subsetNames);
+}
+
+TEST_CASE("Triangle index queries the mesh surface"){
+    UgxObject sphere(getExecutableDir() + "/../data/UGXMESHES/sphere.ugx");
+    DenseUgxGeometry dense = sphere.getDenseGeometry();
+    TriangleIndex index = TriangleIndex::build(dense, 4);
+    REQUIRE(index.faces.size() == dense.faces.size());
+    REQUIRE(!dense.faces.empty());
+
+    Point3 centre{0.0, 0.0, 0.0};
+    for (const Point3& v : index.vertices)
+        for (int k = 0; k < 3; ++k) centre[k] += v[k] / index.vertices.size();
+    auto dist = [](const Point3& a, const Point3& b) {
+        return std::sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+    };
+
+    // vertices lie on the surface; any point is no farther from it than from the nearest vertex
+    std::vector<Point3> queries;
+    for (std::size_t v = 0; v < index.vertices.size(); v += 7) {
+        CHECK(index.nearest(index.vertices[v]).distance == doctest::Approx(0.0));
+        const Point3& p = index.vertices[v];
+        queries.push_back({centre[0] + 1.7 * (p[0] - centre[0]), centre[1] + 1.7 * (p[1] - centre[1]), p[2]});
+    }
+    auto batched = index.nearest(queries, 4);
+    for (std::size_t q = 0; q < queries.size(); ++q) {
+        double nearestVertex = std::numeric_limits<double>::infinity();
+        for (const Point3& v : index.vertices) nearestVertex = std::min(nearestVertex, dist(queries[q], v));
+        CHECK(batched[q].distance <= nearestVertex + 1e-12);
+        CHECK(batched[q].index == index.nearest(queries[q]).index);
+
+        std::vector<int> expected;
+        double r = nearestVertex * 1.5;
+        for (std::size_t f = 0; f < dense.faces.size(); ++f)
+            for (int v : dense.faces[f])
+                if (dist(queries[q], index.vertices[v]) <= r) {
+                    expected.push_back(static_cast<int>(f));
+                    break;
+                }
+        auto within = index.facesWithin(queries[q], r);
+        CHECK(std::includes(within.begin(), within.end(), expected.begin(), expected.end()));
+    }
+
+    // a ray from outside towards the centre stops at the surface
+    Point3 origin = queries.front();
+    Point3 towards{centre[0] - origin[0], centre[1] - origin[1], centre[2] - origin[2]};
+    SpatialHit ray = index.raycast(origin, towards);
+    REQUIRE(ray.index != -1);
+    CHECK(ray.distance < dist(origin, centre));
+    CHECK(index.raycast(origin, {-towards[0], -towards[1], -towards[2]}).index == -1);
+
+    // a closed mesh does not cut itself
+    CHECK(index.selfIntersections().empty());
+}
+
+TEST_CASE("Triangle index finds crossing tubes"){
+    std::map<int, SWCNode> along, across;
+    for (int i = 1; i <= 5; ++i) {
+        along[i] = {i, i == 1 ? -1 : i - 1, 3, 1.0 * i, 3.0, 0.0, 0.4};
+        across[i] = {i, i == 1 ? -1 : i - 1, 3, 3.0, 1.0 * i, 0.0, 0.4};
+    }
+    DenseUgxGeometry a = NeuronGraph::pftDenseFromPath(along, 8);
+    DenseUgxGeometry merged = a;
+    merged.append(NeuronGraph::pftDenseFromPath(across, 8));
+    CHECK(TriangleIndex::build(a).selfIntersections().empty());
+
+    const int firstFaces = static_cast<int>(a.faces.size());
+    auto pairs = TriangleIndex::build(merged, 2).selfIntersections();
+    REQUIRE(!pairs.empty());
+    for (const auto& [f, g] : pairs) CHECK((f < firstFaces && g >= firstFaces));
+    CHECK(std::is_sorted(pairs.begin(), pairs.end()));
+}
+
+TEST_CASE("Mesh compaction welds vertices and removes repeated edges"){
+    std::map<int, SWCNode> path;
+    for (int i = 1; i <= 4; ++i) path[i] = {i, i == 1 ? -1 : i - 1, 3, 2.0 * i, 1.0, -1.0, 0.5 * i};
+    const int segments = 8;
+    DenseUgxGeometry tube = NeuronGraph::pftDenseFromPath(path, segments);
+
+    // the same tube twice, the second copy shifted by less than the tolerance
+    DenseUgxGeometry shifted = tube;
+    for (auto& p : shifted.points) p.x += 1e-7;
+    DenseUgxGeometry mesh = tube;
+    mesh.append(shifted);
+    REQUIRE(mesh.points.size() == 2 * 4 * segments);
+
+    std::string dir = getExecutableDir() + "/../output/test_output";
+    checkFolder(dir);
+    UgxObject::writeDenseUGX(mesh, dir + "/uncompacted.ugx");
+
+    auto newIndex = mesh.compact(1e-6);
+    REQUIRE(newIndex.size() == 2 * 4 * segments);
+    for (int v = 0; v < 4 * segments; ++v) {
+        CHECK(newIndex[v] == v);
+        CHECK(newIndex[v + 4 * segments] == v);
+    }
+    CHECK(mesh.points.size() == 4 * segments);
+    CHECK(mesh.faces.size() == 2 * 3 * segments);
+    CHECK(mesh.edges.size() == (4 + 2 * 3) * segments);
+    CHECK(mesh.radii.size() == mesh.points.size());
+    CHECK(mesh.vertexSubsets.size() == mesh.points.size());
+    CHECK(mesh.edgeSubsets.size() == mesh.edges.size());
+    CHECK(mesh.faceSubsets.size() == mesh.faces.size());
+    CHECK(mesh.subsetNames.at(3) == "Dendrite");
+
+    std::set<std::pair<int, int>> unique;
+    for (const auto& [a, b] : mesh.edges) unique.insert({std::min(a, b), std::max(a, b)});
+    CHECK(unique.size() == mesh.edges.size());
+    for (const auto& face : mesh.faces)
+        for (int k = 0; k < 3; ++k)
+            CHECK(unique.count({std::min(face[k], face[(k + 1) % 3]), std::max(face[k], face[(k + 1) % 3])}) == 1);
+
+    UgxObject::writeDenseUGX(mesh, dir + "/compacted.ugx");
+    CHECK(std::filesystem::file_size(dir + "/compacted.ugx") < std::filesystem::file_size(dir + "/uncompacted.ugx") / 2);
+
+    // exact welding keeps vertices that are only close
+    DenseUgxGeometry apart = tube;
+    apart.append(shifted);
+    apart.compact(0.0);
+    CHECK(apart.points.size() == 2 * 4 * segments);
+    CHECK(apart.edges.size() == 2 * (4 + 2 * 3) * segments);
+}
+
+TEST_CASE("Whole neuron surface welds trunks and junctions"){
+    // a Y: 1-2-3 along x, branching at 3 into 4-5 and 6-7
+    std::map<int, SWCNode> y;
+    y[1] = {1, -1, 3, 0.0, 0.0, 0.0, 0.3};
+    y[2] = {2, 1, 3, 1.0, 0.0, 0.0, 0.3};
+    y[3] = {3, 2, 3, 2.0, 0.0, 0.0, 0.3};
+    y[4] = {4, 3, 3, 3.0, 1.0, 0.0, 0.3};
+    y[5] = {5, 4, 3, 4.0, 2.0, 0.0, 0.3};
+    y[6] = {6, 3, 3, 3.0, -1.0, 0.0, 0.3};
+    y[7] = {7, 6, 3, 4.0, -2.0, 0.0, 0.3};
+    NeuronGraph g;
+    g.setNodes(y);
+
+    SurfaceMeshOptions options;
+    options.segments = 8;
+    options.bezierPoints = 4;
+    DenseUgxGeometry surface = g.meshSurface(options);
+
+    // three clipped trunk tubes (2 rings) and three junction curves (5 rings); the six
+    // curve rings on nodes 2, 4 and 6 are welded away and the three tips are capped
+    CHECK(surface.points.size() == 3 * 2 * 8 + 3 * 5 * 8 - 6 * 8 + 3);
+    CHECK(surface.faces.size() == 3 * 16 + 3 * 4 * 16 + 3 * 8);
+    // unique edges: a tube of R rings has R ring, R - 1 axial and R - 1 diagonal edges per segment
+    CHECK(surface.edges.size() == 3 * 4 * 8 + 3 * 13 * 8 - 6 * 8 + 3 * 8);
+    CHECK(surface.radii.size() == surface.points.size());
+    CHECK(surface.vertexSubsets.size() == surface.points.size());
+    CHECK(surface.edgeSubsets.size() == surface.edges.size());
+    CHECK(surface.faceSubsets.size() == surface.faces.size());
+
+    auto components = [](const DenseUgxGeometry& mesh) {
+        std::vector<int> root(mesh.points.size());
+        std::iota(root.begin(), root.end(), 0);
+        std::function<int(int)> find = [&](int v) { return root[v] == v ? v : root[v] = find(root[v]); };
+        for (const auto& [a, b] : mesh.edges) root[find(a)] = find(b);
+        std::set<int> roots;
+        for (std::size_t v = 0; v < mesh.points.size(); ++v) roots.insert(find(static_cast<int>(v)));
+        return roots.size();
+    };
+    CHECK(components(surface) == 1);
+
+    // the same node set passed explicitly gives the same mesh
+    DenseUgxGeometry explicitSet = g.meshSurface(y, options);
+    CHECK(explicitSet.faces == surface.faces);
+    CHECK(explicitSet.edges == surface.edges);
+
+    // a real neuron: valid, connected and independent of the thread count
+    NeuronGraph neuron(getExecutableDir() + "/../data/neuron.swc");
+    SurfaceMeshOptions serial;
+    serial.delta = 1.0;
+    SurfaceMeshOptions parallel = serial;
+    parallel.threads = 4;
+    DenseUgxGeometry a = neuron.meshSurface(serial);
+    DenseUgxGeometry b = neuron.meshSurface(parallel);
+    REQUIRE(!a.faces.empty());
+    CHECK(a.faces == b.faces);
+    CHECK(a.edges == b.edges);
+    REQUIRE(a.points.size() == b.points.size());
+    CHECK(a.points.back().x == b.points.back().x);
+    CHECK(components(a) == 1);
+    const int n = static_cast<int>(a.points.size());
+    for (const auto& f : a.faces) {
+        CHECK((f[0] >= 0 && f[0] < n && f[1] >= 0 && f[1] < n && f[2] >= 0 && f[2] < n));
+        CHECK((f[0] != f[1] && f[1] != f[2] && f[0] != f[2]));
+    }
+}
+
+TEST_CASE("Result cache serves refinements and meshes by input content"){
+    std::string dir = getExecutableDir();
+    std::string input = dir + "/../data/neuron.swc";
+    std::string folder = dir + "/../output/test_output/result_cache";
+    ResultCache cache(folder);
+    cache.clear();
+    REQUIRE(cache.enabled());
+
+    // keys follow the file contents and every parameter
+    std::string hash = ResultCache::hashFile(input);
+    CHECK(hash.size() == 32);
+    CHECK(hash == ResultCache::hashFile(input));
+    CHECK(ResultCache::hashFile(dir + "/../data/missing.swc").empty());
+    std::string key = ResultCache::key(hash, "generateRefinements", {12.0, 2}, "cubic");
+    CHECK(key != ResultCache::key(hash, "generateRefinements", {12.0, 2}, "linear"));
+    CHECK(key != ResultCache::key(hash, "generateRefinements", {12.000000000001, 2}, "cubic"));
+    CHECK(ResultCache::key("", "generateRefinements", {12.0, 2}, "cubic").empty());
+
+    std::map<int, std::map<int, SWCNode>> levels;
+    CHECK_FALSE(cache.loadLevels(key, levels));
+    NeuronGraph g(input);
+    double delta = 12;
+    int N = 2;
+    std::string method = "cubic";
+    auto refinements = g.generateRefinements(delta, N, method);
+    cache.storeLevels(key, refinements);
+    REQUIRE(cache.loadLevels(key, levels));
+    REQUIRE(levels.size() == refinements.size());
+    for (const auto& [level, nodes] : refinements) {
+        REQUIRE(levels.at(level).size() == nodes.size());
+        CHECK(levels.at(level).rbegin()->second.x == nodes.rbegin()->second.x);
+        CHECK(levels.at(level).rbegin()->second.pid == nodes.rbegin()->second.pid);
+    }
+
+    // a second writer of the same key keeps the first entry
+    cache.storeLevels(key, refinements);
+    CHECK(cache.loadLevels(key, levels));
+
+    // an entry that loses a level (evicted by another process while being read) is a miss
+    std::string truncatedKey = ResultCache::key(hash, "generateRefinements", {12.0, 2}, "truncated");
+    cache.storeLevels(truncatedKey, refinements);
+    std::filesystem::remove(ResultCache::levelPath(folder + "/" + truncatedKey, 1));
+    auto before = levels;
+    CHECK_FALSE(cache.loadLevels(truncatedKey, levels));
+    CHECK(levels.size() == before.size());
+
+    // an entry without a level count is a miss and gets replaced by the next store
+    std::filesystem::remove(folder + "/" + key + "/levels.txt");
+    CHECK_FALSE(cache.loadLevels(key, levels));
+    CHECK_FALSE(cache.find(key));
+    cache.storeLevels(key, refinements);
+    CHECK(cache.loadLevels(key, levels));
+
+    // continue with only the complete refinement entry in the cache
+    cache.clear();
+    cache.storeLevels(key, refinements);
+
+    SurfaceMeshOptions options;
+    options.segments = 8;
+    DenseUgxGeometry surface = g.meshSurface(options);
+    std::string meshKey = ResultCache::key(hash, "meshSurface", {8.0});
+    DenseUgxGeometry loaded;
+    CHECK_FALSE(cache.loadGeometry(meshKey, loaded));
+    cache.storeGeometry(meshKey, surface);
+    REQUIRE(cache.loadGeometry(meshKey, loaded));
+    CHECK(loaded.points.size() == surface.points.size());
+    CHECK(loaded.faces == surface.faces);
+    CHECK(loaded.edges == surface.edges);
+    CHECK(loaded.faceSubsets == surface.faceSubsets);
+
+    // an empty mesh is a result like any other; a mesh entry without element counts is a miss
+    std::string emptyKey = ResultCache::key(hash, "meshSurface", {0.0});
+    cache.storeGeometry(emptyKey, DenseUgxGeometry());
+    DenseUgxGeometry empty = surface;
+    REQUIRE(cache.loadGeometry(emptyKey, empty));
+    CHECK(empty.points.empty());
+    CHECK(empty.faces.empty());
+    std::filesystem::remove(folder + "/" + emptyKey + "/geometry.txt");
+    CHECK_FALSE(cache.loadGeometry(emptyKey, loaded));
+    CHECK(loaded.points.size() == surface.points.size());
+    CHECK_FALSE(cache.find(emptyKey));
+
+    // an uncommitted entry leaves nothing behind
+    {
+        auto entry = cache.prepare("abandoned");
+        REQUIRE_FALSE(entry.folder().empty());
+        CHECK(std::filesystem::is_directory(entry.folder()));
+    }
+    CHECK_FALSE(cache.find("abandoned"));
+
+    // every entry records its size at commit, and the total sums the records
+    std::uint64_t total = cache.size();
+    CHECK(total > 0);
+    for (const std::string& k : {key, meshKey}) {
+        std::ifstream recorded(folder + "/" + k + "/size.txt");
+        std::uint64_t bytes = 0;
+        REQUIRE(static_cast<bool>(recorded >> bytes));
+        CHECK(bytes > 0);
+    }
+    {
+        std::ofstream(folder + "/" + meshKey + "/size.txt") << (std::uint64_t(1) << 40) << '\n';
+        CHECK(cache.size() > (std::uint64_t(1) << 40));
+        std::filesystem::remove(folder + "/" + meshKey + "/size.txt");   // entries without a record are measured
+        CHECK(cache.size() == total);
+    }
+
+    // the bound evicts the least recently used entry
+    std::filesystem::last_write_time(folder + "/" + key, std::filesystem::file_time_type::clock::now() - std::chrono::hours(2));
+    ResultCache bounded(folder, total - 1);
+    bounded.trim();
+    CHECK_FALSE(bounded.find(key));
+    CHECK(bounded.find(meshKey));
+    CHECK(bounded.size() <= total - 1);
+
+    // disabled caches never hit
+    ResultCache disabled("");
+    disabled.storeGeometry(meshKey, surface);
+    CHECK_FALSE(disabled.loadGeometry(meshKey, loaded));
+
+    cache.clear();
+    CHECK(cache.size() == 0);
+}